@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_ASYNC_QP_CONTROLLER_HPP
+#define GISKARD_ASYNC_QP_CONTROLLER_HPP
+
+#include <giskard/qp_controller.hpp>
+#include <giskard/thread_affinity.hpp>
+#include <giskard/triple_buffer.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+
+namespace giskard
+{
+  typedef boost::chrono::steady_clock::time_point TimePoint;
+
+  struct ObservableSample
+  {
+    ObservableSample() : sequence_(0) {}
+
+    Eigen::VectorXd observables_;
+    TimePoint stamp_;
+    size_t sequence_;
+  };
+
+  struct AsyncCommand
+  {
+    AsyncCommand() : sequence_(0), success_(false) {}
+
+    Eigen::VectorXd command_, slack_;
+    // stamp of the observables this command was computed from
+    TimePoint stamp_;
+    // moment the solver finished computing this command
+    TimePoint solved_;
+    // sequence number of the observables this command was computed from; 0
+    // means no command has been computed yet
+    size_t sequence_;
+    // false if the solver failed; the command is zero in that case
+    bool success_;
+  };
+
+  // Runs a QPController on a dedicated worker thread. The control thread hands
+  // over observables with set_observables() and reads back the freshest finished
+  // command with get_command(). Both calls are lock-free and never wait for the
+  // solver: observables posted while the solver is busy replace each other and
+  // only the latest one gets solved.
+  class AsyncQPController : boost::noncopyable
+  {
+    public:
+      // Works on a clone of controller, so the caller may keep using its own.
+      AsyncQPController(const QPController& controller, int nWSR) :
+        controller_(controller.clone()), nWSR_(nWSR), running_(false), sequence_(0),
+        num_solved_(0), num_failed_(0), idle_sleep_(boost::chrono::microseconds(50))
+      {}
+
+      ~AsyncQPController()
+      {
+        stop();
+      }
+
+      // Initializes the QP with observables on the calling thread and launches the
+      // worker thread, pinned to cpu unless it is negative.
+      bool start(const Eigen::VectorXd& observables, int cpu=-1)
+      {
+        if(is_running())
+          throw std::runtime_error("Asked to start an AsyncQPController which is already running.");
+
+        if(!controller_.start(observables, nWSR_))
+          return false;
+
+        prepare_buffers(observables);
+        running_.store(true, boost::memory_order_release);
+        worker_ = boost::thread(boost::bind(&AsyncQPController::run, this));
+        set_thread_affinity(worker_, cpu);
+
+        return true;
+      }
+
+      void stop()
+      {
+        running_.store(false, boost::memory_order_release);
+        if(worker_.joinable())
+          worker_.join();
+      }
+
+      bool is_running() const
+      {
+        return running_.load(boost::memory_order_acquire);
+      }
+
+      /// control thread interface
+
+      void set_observables(const Eigen::VectorXd& observables)
+      {
+        set_observables(observables, boost::chrono::steady_clock::now());
+      }
+
+      // Throws std::invalid_argument on the calling thread if observables holds
+      // fewer than num_observables() entries.
+      void set_observables(const Eigen::VectorXd& observables, const TimePoint& stamp)
+      {
+        if(static_cast<size_t>(observables.rows()) < num_observables())
+          throw std::invalid_argument("AsyncQPController received " +
+              boost::lexical_cast<std::string>(observables.rows()) + " observables, but the controller has " +
+              boost::lexical_cast<std::string>(num_observables()) + " observables.");
+
+        ObservableSample& sample = observables_.get_back();
+        sample.observables_ = observables;
+        sample.stamp_ = stamp;
+        sample.sequence_ = ++sequence_;
+        observables_.publish();
+      }
+
+      const AsyncCommand& get_command()
+      {
+        commands_.update();
+        return commands_.get_front();
+      }
+
+      // Age of the observables behind the last command returned by get_command().
+      double get_command_age() const
+      {
+        return boost::chrono::duration<double>(
+            boost::chrono::steady_clock::now() - commands_.get_front().stamp_).count();
+      }
+
+      size_t num_observables() const
+      {
+        return controller_.get_qp_builder().num_observables();
+      }
+
+      size_t get_num_solved() const
+      {
+        return num_solved_.load(boost::memory_order_relaxed);
+      }
+
+      size_t get_num_failed() const
+      {
+        return num_failed_.load(boost::memory_order_relaxed);
+      }
+
+      // Time the worker sleeps when it finds no new observables.
+      void set_idle_sleep(const boost::chrono::microseconds& idle_sleep)
+      {
+        idle_sleep_ = idle_sleep;
+      }
+
+    private:
+      QPController controller_;
+      int nWSR_;
+      TripleBuffer<ObservableSample> observables_;
+      TripleBuffer<AsyncCommand> commands_;
+      boost::thread worker_;
+      boost::atomic<bool> running_;
+      size_t sequence_;
+      boost::atomic<size_t> num_solved_, num_failed_;
+      boost::chrono::microseconds idle_sleep_;
+
+      void prepare_buffers(const Eigen::VectorXd& observables)
+      {
+        // size all slots up-front to keep allocations out of the loop
+        ObservableSample sample;
+        sample.observables_ = observables;
+        observables_.reset(sample);
+
+        AsyncCommand command;
+        command.command_ = Eigen::VectorXd::Zero(controller_.get_qp_builder().num_controllables());
+        command.slack_ = Eigen::VectorXd::Zero(controller_.get_qp_builder().num_soft_constraints());
+        commands_.reset(command);
+      }
+
+      void run()
+      {
+        while(running_.load(boost::memory_order_acquire))
+        {
+          if(!observables_.update())
+          {
+            boost::this_thread::sleep_for(idle_sleep_);
+            continue;
+          }
+
+          const ObservableSample& sample = observables_.get_front();
+          AsyncCommand& command = commands_.get_back();
+          command.success_ = controller_.update(sample.observables_, nWSR_);
+          if(command.success_)
+          {
+            command.command_ = controller_.get_command();
+            command.slack_ = controller_.get_slack();
+            num_solved_.fetch_add(1, boost::memory_order_relaxed);
+          }
+          else
+          {
+            // never hand out a stale command
+            command.command_.setZero();
+            command.slack_.setZero();
+            num_failed_.fetch_add(1, boost::memory_order_relaxed);
+          }
+          command.stamp_ = sample.stamp_;
+          command.solved_ = boost::chrono::steady_clock::now();
+          command.sequence_ = sample.sequence_;
+          commands_.publish();
+        }
+      }
+  };
+}
+
+#endif // GISKARD_ASYNC_QP_CONTROLLER_HPP
@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CONSTRAINT_PROFILER_HPP
+#define GISKARD_CONSTRAINT_PROFILER_HPP
+
+#include <set>
+#include <map>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <stdexcept>
+#include <Eigen/Core>
+#include <boost/lexical_cast.hpp>
+#include <kdl/expressiontree.hpp>
+#include <giskard/specifications.hpp>
+#include <giskard/expression_generation.hpp>
+#include <giskard/cost_model.hpp>
+#include <giskard/stopwatch.hpp>
+
+namespace giskard
+{
+  enum ProfileMetric
+  {
+    PROFILE_NANOSECONDS,
+    PROFILE_NODE_VISITS
+  };
+
+  // Cost of one part of the expression graph, evaluated on behalf of a
+  // constraint. The part is either a scope entry or, if name_ is empty, the
+  // nodes spelled out in the constraint itself.
+  class ProfileFrame
+  {
+    public:
+      ProfileFrame(const std::string& name="") :
+        name_(name), seconds_(0.0), node_visits_(0.0) {}
+
+      std::string name_;
+      double seconds_, node_visits_;
+  };
+
+  // Evaluation cost of one controllable, soft or hard constraint per update.
+  // The first frame is the constraint itself, followed by the scope entries
+  // it uses in scope order.
+  class ConstraintProfile
+  {
+    public:
+      ConstraintProfile() :
+        seconds_(0.0), node_visits_(0.0) {}
+
+      std::string group_, name_;
+      double seconds_, node_visits_;
+      std::vector<ProfileFrame> frames_;
+  };
+
+  // Opt-in profiling of the expressions of a controller specification. Every
+  // constraint is evaluated on its own, values plus one derivative per input
+  // it depends on, and its measured time is split over the scope entries it
+  // uses in proportion to their node visits. Cached scope entries are
+  // evaluated once per update, no matter how many constraints use them, so
+  // their cost is apportioned equally among those constraints. Entries which
+  // are not cached are paid for by every constraint which uses them.
+  class ConstraintProfiler
+  {
+    public:
+      explicit ConstraintProfiler(const QPControllerSpec& spec) :
+        num_observables_(0)
+      {
+        for(size_t i=0; i<spec.scope_.size(); ++i)
+        {
+          scope_[spec.scope_[i].name] = spec.scope_[i].spec;
+          scope_order_[spec.scope_[i].name] = i;
+        }
+
+        Scope scope = generate(spec.scope_);
+
+        for(size_t i=0; i<spec.controllable_constraints_.size(); ++i)
+        {
+          Constraint& constraint = add_constraint("controllable", spec.controllable_constraints_[i].name_);
+          add_spec(constraint, spec.controllable_constraints_[i].lower_, scope);
+          add_spec(constraint, spec.controllable_constraints_[i].upper_, scope);
+          add_spec(constraint, spec.controllable_constraints_[i].weight_, scope);
+        }
+
+        for(size_t i=0; i<spec.soft_constraints_.size(); ++i)
+        {
+          Constraint& constraint = add_constraint("soft", spec.soft_constraints_[i].name_);
+          add_spec(constraint, spec.soft_constraints_[i].expression_, scope);
+          add_spec(constraint, spec.soft_constraints_[i].lower_, scope);
+          add_spec(constraint, spec.soft_constraints_[i].upper_, scope);
+          add_spec(constraint, spec.soft_constraints_[i].weight_, scope);
+        }
+
+        // hard constraints have no names, they are known by their position
+        for(size_t i=0; i<spec.hard_constraints_.size(); ++i)
+        {
+          Constraint& constraint = add_constraint("hard", boost::lexical_cast<std::string>(i));
+          add_spec(constraint, spec.hard_constraints_[i].expression_, scope);
+          add_spec(constraint, spec.hard_constraints_[i].lower_, scope);
+          add_spec(constraint, spec.hard_constraints_[i].upper_, scope);
+        }
+
+        count_visits();
+        inputs_.resize(num_observables_, 0.0);
+      }
+
+      size_t num_observables() const
+      {
+        return num_observables_;
+      }
+
+      // Evaluates every constraint runs times with the given observables and
+      // replaces the previous profiles with the averages.
+      void profile(const Eigen::VectorXd& observables, size_t runs=100)
+      {
+        if(static_cast<size_t>(observables.rows()) < num_observables_)
+          throw std::invalid_argument("Profiler needs " + boost::lexical_cast<std::string>(num_observables_) +
+              " observables, but received " + boost::lexical_cast<std::string>(observables.rows()) + ".");
+        if(runs == 0)
+          throw std::invalid_argument("Profiler needs at least one run.");
+
+        for(size_t i=0; i<inputs_.size(); ++i)
+          inputs_[i] = observables(i);
+
+        std::vector<double> seconds(constraints_.size(), 0.0);
+        for(size_t run=0; run<runs; ++run)
+          for(size_t i=0; i<constraints_.size(); ++i)
+          {
+            Stopwatch stopwatch;
+            evaluate(constraints_[i]);
+            seconds[i] += stopwatch.get_elapsed_seconds();
+          }
+
+        for(size_t i=0; i<constraints_.size(); ++i)
+          apportion(constraints_[i], seconds[i] / runs, profiles_[i]);
+      }
+
+      const std::vector<ConstraintProfile>& get_profiles() const
+      {
+        return profiles_;
+      }
+
+      // Writes one line 'group;constraint[;entry] value' per frame, the folded
+      // stack format read by flame graph tools. Values are rounded to integers.
+      void write_folded(std::ostream& os, ProfileMetric metric) const
+      {
+        for(size_t i=0; i<profiles_.size(); ++i)
+          for(size_t j=0; j<profiles_[i].frames_.size(); ++j)
+          {
+            const ProfileFrame& frame = profiles_[i].frames_[j];
+            double value = (metric == PROFILE_NANOSECONDS) ? 1e9 * frame.seconds_ : frame.node_visits_;
+            long count = static_cast<long>(std::floor(value + 0.5));
+            if(count <= 0)
+              continue;
+
+            os << sanitize(profiles_[i].group_) << ";" << sanitize(profiles_[i].name_);
+            if(!frame.name_.empty())
+              os << ";" << sanitize(frame.name_);
+            os << " " << count << std::endl;
+          }
+      }
+
+    private:
+      typedef std::map<std::string, double> VisitMap;
+
+      class Constraint
+      {
+        public:
+          std::vector<SpecPtr> specs_;
+          std::vector< KDL::Expression<double>::Ptr > expressions_;
+          std::vector< std::vector<int> > dependencies_;
+
+          // node visits per update, by scope entry, before apportioning
+          VisitMap visits_;
+      };
+
+      // node visits of one evaluation of a scope entry, not counting cached
+      // entries it refers to, and the names of those cached entries
+      class EntryVisits
+      {
+        public:
+          VisitMap visits_;
+          std::set<std::string> caches_;
+      };
+
+      std::map<std::string, SpecPtr> scope_;
+      std::map<std::string, size_t> scope_order_;
+      std::map<std::string, EntryVisits> entry_visits_;
+      std::map<std::string, size_t> num_users_;
+      std::vector<Constraint> constraints_;
+      std::vector<ConstraintProfile> profiles_;
+      std::vector<double> inputs_;
+      size_t num_observables_;
+
+      Constraint& add_constraint(const std::string& group, const std::string& name)
+      {
+        constraints_.push_back(Constraint());
+        profiles_.push_back(ConstraintProfile());
+        profiles_.back().group_ = group;
+        profiles_.back().name_ = name;
+        return constraints_.back();
+      }
+
+      void add_spec(Constraint& constraint, const DoubleSpecPtr& spec, const Scope& scope)
+      {
+        KDL::Expression<double>::Ptr expression = spec->get_expression(scope);
+        std::set<int> dependencies;
+        expression->getDependencies(dependencies);
+        if(!dependencies.empty())
+          num_observables_ = std::max(num_observables_, static_cast<size_t>(*dependencies.rbegin() + 1));
+
+        constraint.specs_.push_back(spec);
+        constraint.expressions_.push_back(expression);
+        constraint.dependencies_.push_back(std::vector<int>(dependencies.begin(), dependencies.end()));
+      }
+
+      void evaluate(Constraint& constraint)
+      {
+        for(size_t i=0; i<constraint.expressions_.size(); ++i)
+        {
+          constraint.expressions_[i]->setInputValues(inputs_);
+          constraint.expressions_[i]->value();
+          for(size_t j=0; j<constraint.dependencies_[i].size(); ++j)
+            constraint.expressions_[i]->derivative(constraint.dependencies_[i][j]);
+        }
+      }
+
+      // Counts node visits per scope entry for every constraint, and how
+      // many constraints use each entry.
+      void count_visits()
+      {
+        for(size_t i=0; i<constraints_.size(); ++i)
+        {
+          Constraint& constraint = constraints_[i];
+          for(size_t j=0; j<constraint.specs_.size(); ++j)
+          {
+            EntryVisits root;
+            count(constraint.specs_[j], "", root);
+            expand_caches(root);
+
+            // one value plus one derivative per input
+            add(constraint.visits_, root.visits_, 1.0 + constraint.dependencies_[j].size());
+          }
+
+          for(VisitMap::const_iterator it = constraint.visits_.begin(); it != constraint.visits_.end(); ++it)
+            if(!it->first.empty())
+              num_users_[it->first]++;
+        }
+      }
+
+      void count(const SpecPtr& spec, const std::string& frame, EntryVisits& result)
+      {
+        if(!spec.get())
+          return;
+
+        result.visits_[frame] += 1.0;
+
+        SpecChildCollector collector;
+        collector.collect(spec);
+
+        if(collector.is_reference())
+        {
+          const std::string& name = collector.get_reference();
+          if(is_cached(name))
+            result.caches_.insert(name);
+          else
+          {
+            const EntryVisits& entry = get_entry_visits(name);
+            add(result.visits_, entry.visits_, 1.0);
+            result.caches_.insert(entry.caches_.begin(), entry.caches_.end());
+          }
+        }
+
+        // copy, the collector is reused by the recursion
+        std::vector<SpecPtr> children = collector.get_children();
+        for(size_t i=0; i<children.size(); ++i)
+          count(children[i], frame, result);
+      }
+
+      // adds every cached entry once, including the caches they refer to
+      void expand_caches(EntryVisits& result)
+      {
+        std::set<std::string> expanded;
+        while(expanded.size() < result.caches_.size())
+          for(std::set<std::string>::const_iterator it = result.caches_.begin(); it != result.caches_.end(); ++it)
+            if(expanded.insert(*it).second)
+            {
+              const EntryVisits& entry = get_entry_visits(*it);
+              add(result.visits_, entry.visits_, 1.0);
+              result.caches_.insert(entry.caches_.begin(), entry.caches_.end());
+              break;
+            }
+      }
+
+      const EntryVisits& get_entry_visits(const std::string& name)
+      {
+        std::map<std::string, EntryVisits>::const_iterator memo = entry_visits_.find(name);
+        if(memo != entry_visits_.end())
+          return memo->second;
+
+        EntryVisits result;
+        count(resolve(name), name, result);
+        return entry_visits_[name] = result;
+      }
+
+      void apportion(const Constraint& constraint, double seconds, ConstraintProfile& profile) const
+      {
+        double total_visits = 0.0;
+        for(VisitMap::const_iterator it = constraint.visits_.begin(); it != constraint.visits_.end(); ++it)
+          total_visits += it->second;
+
+        // own frame first, entries in scope order
+        std::vector<std::string> names;
+        std::map<size_t, std::string> entries;
+        for(VisitMap::const_iterator it = constraint.visits_.begin(); it != constraint.visits_.end(); ++it)
+          if(!it->first.empty())
+            entries[scope_order_.find(it->first)->second] = it->first;
+        names.push_back("");
+        for(std::map<size_t, std::string>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+          names.push_back(it->second);
+
+        profile.frames_.clear();
+        profile.seconds_ = 0.0;
+        profile.node_visits_ = 0.0;
+        for(size_t i=0; i<names.size(); ++i)
+        {
+          VisitMap::const_iterator visits = constraint.visits_.find(names[i]);
+          double share = 1.0;
+          if(!names[i].empty() && is_cached(names[i]))
+            share /= num_users_.find(names[i])->second;
+
+          ProfileFrame frame(names[i]);
+          if(visits != constraint.visits_.end())
+          {
+            frame.node_visits_ = share * visits->second;
+            if(total_visits > 0.0)
+              frame.seconds_ = share * seconds * visits->second / total_visits;
+          }
+
+          profile.frames_.push_back(frame);
+          profile.seconds_ += frame.seconds_;
+          profile.node_visits_ += frame.node_visits_;
+        }
+      }
+
+      static void add(VisitMap& lhs, const VisitMap& rhs, double factor)
+      {
+        for(VisitMap::const_iterator it = rhs.begin(); it != rhs.end(); ++it)
+          lhs[it->first] += factor * it->second;
+      }
+
+      static std::string sanitize(const std::string& name)
+      {
+        std::string result = name;
+        for(size_t i=0; i<result.size(); ++i)
+          if(result[i] == ';' || result[i] == ' ')
+            result[i] = '_';
+        return result;
+      }
+
+      const SpecPtr& resolve(const std::string& name) const
+      {
+        std::map<std::string, SpecPtr>::const_iterator entry = scope_.find(name);
+        if(entry == scope_.end())
+          throw std::invalid_argument("Could not find scope entry with name: " + name);
+
+        return entry->second;
+      }
+
+      bool is_cached(const std::string& name) const
+      {
+        const SpecPtr& spec = resolve(name);
+        return spec->get_type() == VECTOR_CACHED_SPEC || spec->get_type() == FRAME_CACHED_SPEC;
+      }
+  };
+}
+
+#endif // GISKARD_CONSTRAINT_PROFILER_HPP
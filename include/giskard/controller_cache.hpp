@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CONTROLLER_CACHE_HPP
+#define GISKARD_CONTROLLER_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/cstdint.hpp>
+#include <boost/functional/hash.hpp>
+#include <giskard/exceptions.hpp>
+#include <giskard/expression_generation.hpp>
+#include <giskard/spec_dependencies.hpp>
+#include <giskard/spec_folding.hpp>
+#include <giskard/spec_serialization.hpp>
+#include <giskard/version.hpp>
+#include <giskard/yaml_parser.hpp>
+
+// bump on every change of the cache file layout
+#define GISKARD_CACHE_FORMAT 3
+
+namespace giskard
+{
+  ///
+  /// prebuilt evaluation artefact of a controller
+  ///
+
+  class ControllerArtefact
+  {
+    public:
+      // specification the controller is generated from: constants are folded
+      // and unused scope entries are removed
+      QPControllerSpec spec_;
+
+      size_t get_num_controllables() const
+      {
+        return spec_.controllable_constraints_.size();
+      }
+
+      size_t get_num_soft_constraints() const
+      {
+        return spec_.soft_constraints_.size();
+      }
+
+      size_t get_num_hard_constraints() const
+      {
+        return spec_.hard_constraints_.size();
+      }
+  };
+
+  inline ControllerArtefact build_artefact(const QPControllerSpec& spec)
+  {
+    ControllerArtefact artefact;
+    artefact.spec_ = remove_unused_scope_entries(fold_constants(spec));
+    return artefact;
+  }
+
+  ///
+  /// content-addressed on-disk cache of controller artefacts
+  ///
+
+  // Artefacts are stored as one file per controller named after the hash of
+  // its YAML source and the giskard version. Changing either the source or
+  // the version leads to a different file, stale files are never read. Each
+  // file also holds the source to rule out hash collisions. On a hit the
+  // source is neither parsed nor folded, only the binary artefact is read.
+  // The files are written in host byte order and are not meant to be shared
+  // between machines.
+  class ControllerCache
+  {
+    public:
+      explicit ControllerCache(const std::string& directory) :
+        directory_(directory), hits_(0), misses_(0) {}
+
+      const std::string& get_directory() const
+      {
+        return directory_;
+      }
+
+      size_t get_hits() const
+      {
+        return hits_;
+      }
+
+      size_t get_misses() const
+      {
+        return misses_;
+      }
+
+      static std::size_t get_key(const std::string& source)
+      {
+        std::size_t seed = boost::hash_value(source);
+        boost::hash_combine(seed, std::string(GISKARD_VERSION));
+        boost::hash_combine(seed, GISKARD_CACHE_FORMAT);
+        return seed;
+      }
+
+      std::string get_path(const std::string& source) const
+      {
+        char key[2 * sizeof(std::size_t) + 1];
+        std::sprintf(key, "%0*lx", static_cast<int>(2 * sizeof(std::size_t)),
+            static_cast<unsigned long>(get_key(source)));
+
+        return directory_ + "/" + key + ".giskard";
+      }
+
+      // Returns false if there is no valid artefact for the source.
+      bool load(const std::string& source, ControllerArtefact& artefact) const
+      {
+        std::ifstream file(get_path(source).c_str(), std::ios::in | std::ios::binary);
+        if(!file.is_open())
+          return false;
+
+        try
+        {
+          std::string version;
+          boost::uint64_t format, key;
+          read_binary(file, version);
+          read_binary(file, format);
+          read_binary(file, key);
+          if(version != GISKARD_VERSION || format != GISKARD_CACHE_FORMAT || key != get_key(source))
+            return false;
+
+          std::string original;
+          read_binary(file, original);
+          if(original != source)
+            return false;
+
+          read_binary(file, artefact.spec_);
+        }
+        catch(const std::exception& e)
+        {
+          // corrupt or truncated files count as misses
+          return false;
+        }
+
+        return true;
+      }
+
+      // Creates the cache directory if needed. Throws WriteError if that fails.
+      void store(const std::string& source, const ControllerArtefact& artefact) const
+      {
+        create_directories(directory_);
+        std::string path = get_path(source);
+        std::string tmp_path = create_tmp_file(path);
+
+        {
+          std::ofstream file(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+          if(!file.is_open())
+          {
+            std::remove(tmp_path.c_str());
+            throw WriteError(tmp_path);
+          }
+
+          write_binary(file, std::string(GISKARD_VERSION));
+          write_binary(file, static_cast<boost::uint64_t>(GISKARD_CACHE_FORMAT));
+          write_binary(file, static_cast<boost::uint64_t>(get_key(source)));
+          write_binary(file, source);
+          write_binary(file, artefact.spec_);
+
+          if(!file.good())
+          {
+            std::remove(tmp_path.c_str());
+            throw WriteError(tmp_path);
+          }
+        }
+
+        // publish atomically to not expose half-written files to other processes
+        if(std::rename(tmp_path.c_str(), path.c_str()) != 0)
+        {
+          std::remove(tmp_path.c_str());
+          throw WriteError(path);
+        }
+      }
+
+      // Loads the artefact of a YAML controller specification, parsing the
+      // source and storing its artefact only on a miss. Failing to store the
+      // artefact, e.g. in a read-only directory, only costs the next call a miss.
+      ControllerArtefact get_artefact(const std::string& source)
+      {
+        ControllerArtefact artefact;
+        if(load(source, artefact))
+        {
+          ++hits_;
+          return artefact;
+        }
+
+        ++misses_;
+        artefact = build_artefact(YAML::Load(source).as<QPControllerSpec>());
+        try
+        {
+          store(source, artefact);
+        }
+        catch(const WriteError&)
+        {
+          std::cout << "Could not store controller artefact in cache directory '" <<
+              directory_ << "'." << std::endl;
+        }
+        return artefact;
+      }
+
+    private:
+      std::string directory_;
+      size_t hits_, misses_;
+
+      // Creates directory and its parents, like mkdir -p.
+      static void create_directories(const std::string& directory)
+      {
+        for(size_t end = directory.find('/', 1); ; end = directory.find('/', end + 1))
+        {
+          std::string path = directory.substr(0, end);
+          if(mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+            throw WriteError(path);
+
+          if(end == std::string::npos)
+            return;
+        }
+      }
+
+      // Every writer gets its own temporary file next to path, so that processes
+      // which miss on the same key at once do not write into the same file.
+      static std::string create_tmp_file(const std::string& path)
+      {
+        std::string name = path + ".XXXXXX";
+        std::vector<char> buffer(name.begin(), name.end());
+        buffer.push_back('\0');
+
+        int fd = mkstemp(&buffer[0]);
+        if(fd == -1)
+          throw WriteError(name);
+        // mkstemp() only grants access to the owner, cache files are readable by all
+        fchmod(fd, 0644);
+        close(fd);
+
+        return std::string(&buffer[0]);
+      }
+  };
+
+  // Generates the controller of a YAML specification, e.g. the contents of a
+  // controller file, from its cached artefact.
+  inline giskard::QPController generate_from_yaml(const std::string& source,
+      giskard::ControllerCache& cache)
+  {
+    return generate(cache.get_artefact(source).spec_);
+  }
+}
+
+#endif // GISKARD_CONTROLLER_CACHE_HPP
@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CONTROLLER_POOL_HPP
+#define GISKARD_CONTROLLER_POOL_HPP
+
+#include <deque>
+#include <stdexcept>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <giskard/qp_controller.hpp>
+#include <giskard/stopwatch.hpp>
+#include <giskard/thread_affinity.hpp>
+
+namespace giskard
+{
+  class ControllerPoolStatistics
+  {
+    public:
+      ControllerPoolStatistics() :
+        num_ticks_(0), num_updates_(0), num_failures_(0), num_steals_(0), seconds_(0.0) {}
+
+      size_t num_ticks_, num_updates_, num_failures_, num_steals_;
+      double seconds_;
+
+      // controller updates per second of wall-clock time spent in ticks
+      double get_throughput() const
+      {
+        return seconds_ > 0.0 ? num_updates_ / seconds_ : 0.0;
+      }
+  };
+
+  // Steps many independent QPControllers per tick on a persistent pool of
+  // threads. Every controller has a home thread which updates it whenever it
+  // is not busy with other work, so a controller usually stays in the caches
+  // of one core. Threads which run out of work steal controllers from the back
+  // of the queues of other threads. tick() returns once all controllers have
+  // been updated.
+  class ControllerPool
+  {
+    public:
+      // The calling thread takes part in each tick, i.e. num_threads - 1
+      // workers are started. If pin_threads is set, worker i is pinned to CPU i.
+      explicit ControllerPool(size_t num_threads, bool pin_threads=false) :
+        barrier_(num_threads > 0 ? num_threads : 1), stop_(false)
+      {
+        for(size_t i=0; i<std::max(num_threads, size_t(1)); ++i)
+          queues_.push_back(boost::shared_ptr<WorkQueue>(new WorkQueue()));
+
+        for(size_t i=1; i<num_threads; ++i)
+        {
+          boost::thread* worker = workers_.create_thread(boost::bind(&ControllerPool::run, this, i));
+          if(pin_threads)
+            set_thread_affinity(*worker, i);
+        }
+      }
+
+      ~ControllerPool()
+      {
+        stop_ = true;
+        barrier_.wait();
+        workers_.join_all();
+      }
+
+      size_t get_num_threads() const
+      {
+        return queues_.size();
+      }
+
+      size_t num_controllers() const
+      {
+        return entries_.size();
+      }
+
+      // Adds a clone of controller to the pool, homed on the threads in round-robin
+      // fashion. The first tick starts the controller with its first observables.
+      size_t add_controller(const QPController& controller, int nWSR)
+      {
+        return add_controller(controller, nWSR, num_controllers() % get_num_threads());
+      }
+
+      size_t add_controller(const QPController& controller, int nWSR, size_t thread)
+      {
+        if(thread >= get_num_threads())
+          throw std::invalid_argument("Asked to home a controller on thread " +
+              boost::lexical_cast<std::string>(thread) + ", but the pool only has " +
+              boost::lexical_cast<std::string>(get_num_threads()) + " threads.");
+
+        boost::shared_ptr<Entry> entry(new Entry());
+        entry->controller_ = controller.clone();
+        entry->nWSR_ = nWSR;
+        entry->thread_ = thread;
+        entries_.push_back(entry);
+        return entries_.size() - 1;
+      }
+
+      // Throws std::invalid_argument on the calling thread if observables holds
+      // fewer entries than controller index has observables.
+      void set_observables(size_t index, const Eigen::VectorXd& observables)
+      {
+        Entry& entry = get_entry(index);
+        size_t num_observables = entry.controller_.get_qp_builder().num_observables();
+        if(static_cast<size_t>(observables.rows()) < num_observables)
+          throw std::invalid_argument("ControllerPool received " +
+              boost::lexical_cast<std::string>(observables.rows()) + " observables for controller " +
+              boost::lexical_cast<std::string>(index) + ", but it has " +
+              boost::lexical_cast<std::string>(num_observables) + " observables.");
+        entry.observables_ = observables;
+      }
+
+      const Eigen::VectorXd& get_command(size_t index) const
+      {
+        return get_entry(index).controller_.get_command();
+      }
+
+      // Returns whether the last update of controller index succeeded. Updates
+      // which throw, e.g. because no observables were set, count as failures.
+      bool get_success(size_t index) const
+      {
+        return get_entry(index).success_;
+      }
+
+      const QPController& get_controller(size_t index) const
+      {
+        return get_entry(index).controller_;
+      }
+
+      // Updates all controllers once. Returns false if any of them failed.
+      bool tick()
+      {
+        Stopwatch stopwatch;
+
+        for(size_t i=0; i<entries_.size(); ++i)
+          queues_[entries_[i]->thread_]->tasks_.push_back(i);
+
+        barrier_.wait();
+        work(0);
+        barrier_.wait();
+
+        statistics_.seconds_ += stopwatch.get_elapsed_seconds();
+        statistics_.num_ticks_++;
+        bool success = true;
+        for(size_t i=0; i<queues_.size(); ++i)
+        {
+          statistics_.num_updates_ += queues_[i]->num_updates_;
+          statistics_.num_failures_ += queues_[i]->num_failures_;
+          statistics_.num_steals_ += queues_[i]->num_steals_;
+          success &= (queues_[i]->num_failures_ == 0);
+          queues_[i]->reset_counters();
+        }
+
+        return success;
+      }
+
+      const ControllerPoolStatistics& get_statistics() const
+      {
+        return statistics_;
+      }
+
+      void reset_statistics()
+      {
+        statistics_ = ControllerPoolStatistics();
+      }
+
+    private:
+      class Entry
+      {
+        public:
+          Entry() : nWSR_(0), thread_(0), started_(false), success_(false) {}
+
+          QPController controller_;
+          Eigen::VectorXd observables_;
+          int nWSR_;
+          size_t thread_;
+          bool started_, success_;
+      };
+
+      class WorkQueue
+      {
+        public:
+          WorkQueue() { reset_counters(); }
+
+          void reset_counters()
+          {
+            num_updates_ = 0;
+            num_failures_ = 0;
+            num_steals_ = 0;
+          }
+
+          bool pop_front(size_t& task)
+          {
+            boost::mutex::scoped_lock lock(mutex_);
+            if(tasks_.empty())
+              return false;
+            task = tasks_.front();
+            tasks_.pop_front();
+            return true;
+          }
+
+          bool pop_back(size_t& task)
+          {
+            boost::mutex::scoped_lock lock(mutex_);
+            if(tasks_.empty())
+              return false;
+            task = tasks_.back();
+            tasks_.pop_back();
+            return true;
+          }
+
+          boost::mutex mutex_;
+          std::deque<size_t> tasks_;
+          // only touched by the thread owning this queue
+          size_t num_updates_, num_failures_, num_steals_;
+      };
+
+      std::vector< boost::shared_ptr<Entry> > entries_;
+      std::vector< boost::shared_ptr<WorkQueue> > queues_;
+      boost::thread_group workers_;
+      boost::barrier barrier_;
+      bool stop_;
+      ControllerPoolStatistics statistics_;
+
+      Entry& get_entry(size_t index) const
+      {
+        if(index >= entries_.size())
+          throw std::out_of_range("Asked for controller " + boost::lexical_cast<std::string>(index) +
+              ", but the pool only has " + boost::lexical_cast<std::string>(entries_.size()) + ".");
+        return *(entries_[index]);
+      }
+
+      void run(size_t thread)
+      {
+        while(true)
+        {
+          barrier_.wait();
+          if(stop_)
+            return;
+
+          work(thread);
+          barrier_.wait();
+        }
+      }
+
+      void work(size_t thread)
+      {
+        WorkQueue& own = *(queues_[thread]);
+        size_t task;
+
+        while(own.pop_front(task))
+          update(own, task);
+
+        // queues only shrink during a tick, so one round without loot means we are done
+        for(size_t i=1; i<queues_.size(); ++i)
+        {
+          WorkQueue& victim = *(queues_[(thread + i) % queues_.size()]);
+          while(victim.pop_back(task))
+          {
+            own.num_steals_++;
+            update(own, task);
+          }
+        }
+      }
+
+      void update(WorkQueue& queue, size_t index)
+      {
+        Entry& entry = *(entries_[index]);
+
+        // an exception must neither kill a worker nor leave the others waiting at the barrier
+        try
+        {
+          if(!entry.started_)
+            entry.started_ = entry.controller_.start(entry.observables_, entry.nWSR_);
+
+          entry.success_ = entry.started_ && entry.controller_.update(entry.observables_, entry.nWSR_);
+        }
+        catch(const std::exception&)
+        {
+          entry.success_ = false;
+        }
+
+        queue.num_updates_++;
+        if(!entry.success_)
+          queue.num_failures_++;
+      }
+
+      // not copyable
+      ControllerPool(const ControllerPool&);
+      ControllerPool& operator=(const ControllerPool&);
+  };
+}
+
+#endif // GISKARD_CONTROLLER_POOL_HPP
@@ -0,0 +1,845 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_COST_MODEL_HPP
+#define GISKARD_COST_MODEL_HPP
+
+#include <set>
+#include <map>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/functional/hash.hpp>
+#include <giskard/specifications.hpp>
+#include <giskard/spec_dependencies.hpp>
+#include <giskard/qp_controller.hpp>
+
+namespace giskard
+{
+  ///
+  /// names of specification types
+  ///
+
+  inline std::string spec_type_name(SpecType type)
+  {
+    switch(type)
+    {
+      case DOUBLE_CONST_SPEC: return "DoubleConst";
+      case DOUBLE_INPUT_SPEC: return "DoubleInput";
+      case DOUBLE_REFERENCE_SPEC: return "DoubleReference";
+      case DOUBLE_ADDITION_SPEC: return "DoubleAddition";
+      case DOUBLE_SUBTRACTION_SPEC: return "DoubleSubtraction";
+      case DOUBLE_NORM_OF_SPEC: return "DoubleNormOf";
+      case DOUBLE_MULTIPLICATION_SPEC: return "DoubleMultiplication";
+      case DOUBLE_DIVISION_SPEC: return "DoubleDivision";
+      case DOUBLE_X_COORD_OF_SPEC: return "DoubleXCoordOf";
+      case DOUBLE_Y_COORD_OF_SPEC: return "DoubleYCoordOf";
+      case DOUBLE_Z_COORD_OF_SPEC: return "DoubleZCoordOf";
+      case VECTOR_DOT_SPEC: return "VectorDot";
+      case VECTOR_CACHED_SPEC: return "VectorCached";
+      case VECTOR_CONSTRUCTOR_SPEC: return "VectorConstructor";
+      case VECTOR_ADDITION_SPEC: return "VectorAddition";
+      case VECTOR_SUBTRACTION_SPEC: return "VectorSubtraction";
+      case VECTOR_REFERENCE_SPEC: return "VectorReference";
+      case VECTOR_ORIGIN_OF_SPEC: return "VectorOriginOf";
+      case VECTOR_FRAME_MULTIPLICATION_SPEC: return "VectorFrameMultiplication";
+      case VECTOR_DOUBLE_MULTIPLICATION_SPEC: return "VectorDoubleMultiplication";
+      case VECTOR_ROTATION_VECTOR_SPEC: return "VectorRotationVector";
+      case ROTATION_QUATERNION_CONSTRUCTOR_SPEC: return "RotationQuaternionConstructor";
+      case AXIS_ANGLE_SPEC: return "AxisAngle";
+      case ROTATION_REFERENCE_SPEC: return "RotationReference";
+      case INVERSE_ROTATION_SPEC: return "InverseRotation";
+      case ROTATION_MULTIPLICATION_SPEC: return "RotationMultiplication";
+      case FRAME_CACHED_SPEC: return "FrameCached";
+      case FRAME_CONSTRUCTOR_SPEC: return "FrameConstructor";
+      case ORIENTATION_OF_SPEC: return "OrientationOf";
+      case FRAME_MULTIPLICATION_SPEC: return "FrameMultiplication";
+      case FRAME_REFERENCE_SPEC: return "FrameReference";
+      default: throw std::invalid_argument("Received unknown specification type.");
+    }
+  }
+
+  ///
+  /// direct children of specifications
+  ///
+
+  // Collects the direct child specifications of a specification, and the
+  // name of the scope entry it refers to, if it is a reference.
+  class SpecChildCollector : public SpecVisitor
+  {
+    public:
+      const std::vector<SpecPtr>& get_children() const
+      {
+        return children_;
+      }
+
+      const std::string& get_reference() const
+      {
+        return reference_;
+      }
+
+      bool is_reference() const
+      {
+        return !reference_.empty();
+      }
+
+      void collect(const SpecPtr& spec)
+      {
+        children_.clear();
+        reference_.clear();
+        if(spec.get())
+          spec->accept(*this);
+      }
+
+      virtual void visit(const DoubleConstSpec&) {}
+
+      virtual void visit(const DoubleInputSpec&) {}
+
+      virtual void visit(const DoubleReferenceSpec& spec)
+      {
+        reference_ = spec.get_reference_name();
+      }
+
+      virtual void visit(const DoubleAdditionSpec& spec)
+      {
+        add(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleSubtractionSpec& spec)
+      {
+        add(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleNormOfSpec& spec)
+      {
+        add(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleMultiplicationSpec& spec)
+      {
+        add(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleDivisionSpec& spec)
+      {
+        add(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleXCoordOfSpec& spec)
+      {
+        add(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleYCoordOfSpec& spec)
+      {
+        add(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleZCoordOfSpec& spec)
+      {
+        add(spec.get_vector());
+      }
+
+      virtual void visit(const VectorDotSpec& spec)
+      {
+        add(spec.get_lhs());
+        add(spec.get_rhs());
+      }
+
+      virtual void visit(const VectorCachedSpec& spec)
+      {
+        add(spec.get_vector());
+      }
+
+      virtual void visit(const VectorConstructorSpec& spec)
+      {
+        add(spec.get_x());
+        add(spec.get_y());
+        add(spec.get_z());
+      }
+
+      virtual void visit(const VectorAdditionSpec& spec)
+      {
+        add(spec.get_inputs());
+      }
+
+      virtual void visit(const VectorSubtractionSpec& spec)
+      {
+        add(spec.get_inputs());
+      }
+
+      virtual void visit(const VectorReferenceSpec& spec)
+      {
+        reference_ = spec.get_reference_name();
+      }
+
+      virtual void visit(const VectorOriginOfSpec& spec)
+      {
+        add(spec.get_frame());
+      }
+
+      virtual void visit(const VectorFrameMultiplicationSpec& spec)
+      {
+        add(spec.get_frame());
+        add(spec.get_vector());
+      }
+
+      virtual void visit(const VectorDoubleMultiplicationSpec& spec)
+      {
+        add(spec.get_double());
+        add(spec.get_vector());
+      }
+
+      virtual void visit(const VectorRotationVectorSpec& spec)
+      {
+        add(spec.get_rotation());
+      }
+
+      virtual void visit(const RotationQuaternionConstructorSpec&) {}
+
+      virtual void visit(const AxisAngleSpec& spec)
+      {
+        add(spec.get_axis());
+        add(spec.get_angle());
+      }
+
+      virtual void visit(const RotationReferenceSpec& spec)
+      {
+        reference_ = spec.get_reference_name();
+      }
+
+      virtual void visit(const InverseRotationSpec& spec)
+      {
+        add(spec.get_rotation());
+      }
+
+      virtual void visit(const RotationMultiplicationSpec& spec)
+      {
+        add(spec.get_inputs());
+      }
+
+      virtual void visit(const FrameCachedSpec& spec)
+      {
+        add(spec.get_frame());
+      }
+
+      virtual void visit(const FrameConstructorSpec& spec)
+      {
+        add(spec.get_translation());
+        add(spec.get_rotation());
+      }
+
+      virtual void visit(const OrientationOfSpec& spec)
+      {
+        add(spec.get_frame());
+      }
+
+      virtual void visit(const FrameMultiplicationSpec& spec)
+      {
+        add(spec.get_inputs());
+      }
+
+      virtual void visit(const FrameReferenceSpec& spec)
+      {
+        reference_ = spec.get_reference_name();
+      }
+
+    private:
+      std::vector<SpecPtr> children_;
+      std::string reference_;
+
+      void add(const SpecPtr& spec)
+      {
+        if(spec.get())
+          children_.push_back(spec);
+      }
+
+      template<class T>
+      void add(const std::vector< boost::shared_ptr<T> >& specs)
+      {
+        for(size_t i=0; i<specs.size(); ++i)
+          add(specs[i]);
+      }
+  };
+
+  ///
+  /// per-node cost estimates
+  ///
+
+  // Floating point operations to evaluate a single node once, given the
+  // values of its children, and to propagate one derivative column through
+  // it. Constants, inputs, references, caches and accessors cost nothing.
+  class NodeCost
+  {
+    public:
+      NodeCost(double value_flops=0.0, double derivative_flops=0.0) :
+        value_flops_(value_flops), derivative_flops_(derivative_flops) {}
+
+      double value_flops_, derivative_flops_;
+  };
+
+  inline NodeCost estimate_node_cost(SpecType type, size_t num_children)
+  {
+    double n = (num_children > 1) ? num_children - 1 : 1;
+
+    switch(type)
+    {
+      case DOUBLE_ADDITION_SPEC:
+      case DOUBLE_SUBTRACTION_SPEC:
+        return NodeCost(n, n);
+      case DOUBLE_MULTIPLICATION_SPEC:
+        return NodeCost(n, 3*n);
+      case DOUBLE_DIVISION_SPEC:
+        return NodeCost(n, 5*n);
+      case DOUBLE_NORM_OF_SPEC:
+        return NodeCost(6, 6);
+      case VECTOR_DOT_SPEC:
+        return NodeCost(5, 11);
+      case VECTOR_ADDITION_SPEC:
+      case VECTOR_SUBTRACTION_SPEC:
+        return NodeCost(3*n, 3*n);
+      case VECTOR_FRAME_MULTIPLICATION_SPEC:
+        return NodeCost(18, 24);
+      case VECTOR_DOUBLE_MULTIPLICATION_SPEC:
+        return NodeCost(3, 9);
+      case VECTOR_ROTATION_VECTOR_SPEC:
+        return NodeCost(30, 30);
+      case AXIS_ANGLE_SPEC:
+        return NodeCost(30, 6);
+      case INVERSE_ROTATION_SPEC:
+        return NodeCost(0, 15);
+      case ROTATION_MULTIPLICATION_SPEC:
+        return NodeCost(45*n, 15*n);
+      case FRAME_MULTIPLICATION_SPEC:
+        return NodeCost(63*n, 36*n);
+      default:
+        return NodeCost();
+    }
+  }
+
+  ///
+  /// statistics of QP problems
+  ///
+
+  class QPStatistics
+  {
+    public:
+      QPStatistics() :
+        num_controllables_(0), num_soft_constraints_(0), num_hard_constraints_(0),
+        num_observables_(0), jacobian_nonzeros_(0) {}
+
+      size_t num_controllables_, num_soft_constraints_, num_hard_constraints_;
+      size_t num_observables_, jacobian_nonzeros_;
+
+      // Jacobian columns, i.e. controllables, each constraint expression
+      // depends on
+      std::vector<size_t> soft_derivative_columns_, hard_derivative_columns_;
+
+      size_t num_variables() const
+      {
+        return num_controllables_ + num_soft_constraints_;
+      }
+
+      size_t num_constraints() const
+      {
+        return num_soft_constraints_ + num_hard_constraints_;
+      }
+
+      // Copying the problem into the solver plus one hotstart with a single
+      // working set change: residuals of all constraints and a dense update
+      // of the factorization.
+      double estimate_flops() const
+      {
+        double n = num_variables();
+        double m = num_constraints();
+        return 3*n + 2*m + jacobian_nonzeros_ + 2*n*m + (n + m)*(n + m);
+      }
+  };
+
+  inline QPStatistics analyze(const QPProblemBuilder& builder)
+  {
+    QPStatistics result;
+    result.num_controllables_ = builder.num_controllables();
+    result.num_soft_constraints_ = builder.num_soft_constraints();
+    result.num_hard_constraints_ = builder.num_hard_constraints();
+    result.num_observables_ = builder.num_observables();
+
+    for(size_t i=0; i<builder.get_soft_expressions().size(); ++i)
+    {
+      std::set<int> dependencies;
+      builder.get_soft_expressions()[i]->getDependencies(dependencies);
+      result.soft_derivative_columns_.push_back(std::distance(dependencies.begin(),
+          dependencies.lower_bound(builder.num_controllables())));
+      result.jacobian_nonzeros_ += result.soft_derivative_columns_.back();
+    }
+
+    for(size_t i=0; i<builder.get_hard_expressions().size(); ++i)
+    {
+      std::set<int> dependencies;
+      builder.get_hard_expressions()[i]->getDependencies(dependencies);
+      result.hard_derivative_columns_.push_back(std::distance(dependencies.begin(),
+          dependencies.lower_bound(builder.num_controllables())));
+      result.jacobian_nonzeros_ += result.hard_derivative_columns_.back();
+    }
+
+    return result;
+  }
+
+  inline QPStatistics analyze(const QPController& controller)
+  {
+    return analyze(controller.get_qp_builder());
+  }
+
+  ///
+  /// statistics of controller specifications
+  ///
+
+  class SpecStatistics
+  {
+    public:
+      SpecStatistics() :
+        num_nodes_(0), num_scope_entries_(0), max_depth_(0), max_fan_out_(0),
+        mean_fan_out_(0.0), num_shared_entries_(0), num_duplicated_entries_(0),
+        num_duplicated_subtrees_(0), node_visits_(0.0), expression_flops_(0.0),
+        derivative_flops_(0.0) {}
+
+      // distinct specification nodes, in total and by type
+      size_t num_nodes_;
+      std::map<SpecType, size_t> node_counts_;
+
+      size_t num_scope_entries_;
+
+      // longest path from a constraint down to a leaf, following references
+      size_t max_depth_;
+
+      // number of places which refer to a scope entry
+      size_t max_fan_out_;
+      double mean_fan_out_;
+
+      // Composite scope entries referred to more than once are shared if they
+      // are cached, i.e. evaluated once per update, and duplicated otherwise.
+      size_t num_shared_entries_, num_duplicated_entries_;
+
+      // subtrees which are spelled out again although an equal one exists
+      size_t num_duplicated_subtrees_;
+
+      // node evaluations and floating point operations per update
+      double node_visits_, expression_flops_, derivative_flops_;
+
+      QPStatistics qp_;
+
+      double get_total_flops() const
+      {
+        return expression_flops_ + derivative_flops_ + qp_.estimate_flops();
+      }
+  };
+
+  // Walks a controller specification and estimates what updating the
+  // generated controller costs. Nodes are evaluated once per use unless they
+  // are cached, and derivatives are propagated once per input an expression
+  // depends on.
+  class SpecAnalyzer
+  {
+    public:
+      explicit SpecAnalyzer(const QPControllerSpec& spec) :
+        dependencies_(spec.scope_)
+      {
+        for(size_t i=0; i<spec.scope_.size(); ++i)
+          scope_[spec.scope_[i].name] = spec.scope_[i].spec;
+
+        collect_roots(spec);
+        count_nodes(spec);
+        count_references();
+        measure_depth();
+        estimate_costs();
+        collect_dimensions(spec);
+      }
+
+      const SpecStatistics& get_statistics() const
+      {
+        return statistics_;
+      }
+
+    private:
+      class EvaluationCost
+      {
+        public:
+          EvaluationCost() :
+            visits_(0.0), value_flops_(0.0), derivative_flops_(0.0) {}
+
+          double visits_, value_flops_, derivative_flops_;
+      };
+
+      SpecStatistics statistics_;
+      ScopeDependencies dependencies_;
+      std::map<std::string, SpecPtr> scope_;
+      std::vector<SpecPtr> roots_;
+      std::map<std::string, size_t> references_;
+      std::map<const Spec*, size_t> depths_;
+      std::map<const Spec*, EvaluationCost> costs_;
+      std::map<size_t, std::vector<SpecPtr> > subtrees_;
+
+      // expressions in the order the QP problem builder evaluates them
+      void collect_roots(const QPControllerSpec& spec)
+      {
+        for(size_t i=0; i<spec.controllable_constraints_.size(); ++i)
+        {
+          roots_.push_back(spec.controllable_constraints_[i].lower_);
+          roots_.push_back(spec.controllable_constraints_[i].upper_);
+          roots_.push_back(spec.controllable_constraints_[i].weight_);
+        }
+
+        for(size_t i=0; i<spec.soft_constraints_.size(); ++i)
+        {
+          roots_.push_back(spec.soft_constraints_[i].expression_);
+          roots_.push_back(spec.soft_constraints_[i].lower_);
+          roots_.push_back(spec.soft_constraints_[i].upper_);
+          roots_.push_back(spec.soft_constraints_[i].weight_);
+        }
+
+        for(size_t i=0; i<spec.hard_constraints_.size(); ++i)
+        {
+          roots_.push_back(spec.hard_constraints_[i].expression_);
+          roots_.push_back(spec.hard_constraints_[i].lower_);
+          roots_.push_back(spec.hard_constraints_[i].upper_);
+        }
+      }
+
+      void count_nodes(const QPControllerSpec& spec)
+      {
+        std::set<const Spec*> visited;
+
+        for(size_t i=0; i<spec.scope_.size(); ++i)
+          count_nodes(spec.scope_[i].spec, visited, false);
+
+        for(size_t i=0; i<roots_.size(); ++i)
+          count_nodes(roots_[i], visited, false);
+
+        statistics_.num_scope_entries_ = spec.scope_.size();
+      }
+
+      void count_nodes(const SpecPtr& spec, std::set<const Spec*>& visited, bool inside_duplicate)
+      {
+        if(!spec.get() || !visited.insert(spec.get()).second)
+          return;
+
+        statistics_.num_nodes_++;
+        statistics_.node_counts_[spec->get_type()]++;
+
+        SpecChildCollector collector;
+        collector.collect(spec);
+
+        if(collector.is_reference())
+          references_[collector.get_reference()]++;
+
+        if(!inside_duplicate && !collector.get_children().empty())
+          inside_duplicate = register_subtree(spec);
+
+        for(size_t i=0; i<collector.get_children().size(); ++i)
+          count_nodes(collector.get_children()[i], visited, inside_duplicate);
+      }
+
+      // returns true if an equal subtree has been registered before
+      bool register_subtree(const SpecPtr& spec)
+      {
+        std::vector<SpecPtr>& candidates = subtrees_[hash_value(*spec)];
+        for(size_t i=0; i<candidates.size(); ++i)
+          if(*candidates[i] == *spec)
+          {
+            statistics_.num_duplicated_subtrees_++;
+            return true;
+          }
+
+        candidates.push_back(spec);
+        return false;
+      }
+
+      void count_references()
+      {
+        size_t total = 0;
+        for(std::map<std::string, SpecPtr>::const_iterator it = scope_.begin(); it != scope_.end(); ++it)
+        {
+          size_t fan_out = references_.count(it->first) ? references_[it->first] : 0;
+          total += fan_out;
+          statistics_.max_fan_out_ = std::max(statistics_.max_fan_out_, fan_out);
+
+          SpecChildCollector collector;
+          collector.collect(it->second);
+          if(fan_out > 1 && !collector.get_children().empty())
+          {
+            if(is_cached(it->second))
+              statistics_.num_shared_entries_++;
+            else
+              statistics_.num_duplicated_entries_++;
+          }
+        }
+
+        if(!scope_.empty())
+          statistics_.mean_fan_out_ = static_cast<double>(total) / scope_.size();
+      }
+
+      void measure_depth()
+      {
+        for(size_t i=0; i<roots_.size(); ++i)
+          statistics_.max_depth_ = std::max(statistics_.max_depth_, depth(roots_[i]));
+      }
+
+      size_t depth(const SpecPtr& spec)
+      {
+        if(!spec.get())
+          return 0;
+
+        std::map<const Spec*, size_t>::const_iterator memo = depths_.find(spec.get());
+        if(memo != depths_.end())
+          return memo->second;
+
+        SpecChildCollector collector;
+        collector.collect(spec);
+
+        size_t result = 1;
+        if(collector.is_reference())
+          result += depth(resolve(collector.get_reference()));
+        for(size_t i=0; i<collector.get_children().size(); ++i)
+          result = std::max(result, 1 + depth(collector.get_children()[i]));
+
+        depths_[spec.get()] = result;
+        return result;
+      }
+
+      // Every root is evaluated, and differentiated once per input. Caches are
+      // charged once for their contents and once per use for the lookup.
+      void estimate_costs()
+      {
+        std::map<const Spec*, SpecPtr> caches;
+        for(size_t i=0; i<roots_.size(); ++i)
+        {
+          EvaluationCost root = cost(roots_[i]);
+          add_cost(root, dependencies_.get_inputs(roots_[i]).size());
+          collect_caches(roots_[i], caches);
+        }
+
+        for(std::map<const Spec*, SpecPtr>::const_iterator it = caches.begin(); it != caches.end(); ++it)
+        {
+          SpecChildCollector collector;
+          collector.collect(it->second);
+          SpecPtr contents = collector.get_children().front();
+          add_cost(cost(contents), dependencies_.get_inputs(contents).size());
+        }
+      }
+
+      void add_cost(const EvaluationCost& cost, size_t num_inputs)
+      {
+        statistics_.node_visits_ += cost.visits_;
+        statistics_.expression_flops_ += cost.value_flops_;
+        statistics_.derivative_flops_ += num_inputs * cost.derivative_flops_;
+      }
+
+      // cost of a single evaluation, treating caches as already filled
+      EvaluationCost cost(const SpecPtr& spec)
+      {
+        if(!spec.get())
+          return EvaluationCost();
+
+        std::map<const Spec*, EvaluationCost>::const_iterator memo = costs_.find(spec.get());
+        if(memo != costs_.end())
+          return memo->second;
+
+        SpecChildCollector collector;
+        collector.collect(spec);
+
+        EvaluationCost result;
+        if(collector.is_reference())
+          result = cost(resolve(collector.get_reference()));
+        else if(is_cached(spec))
+          result.visits_ = 1.0;
+        else
+        {
+          NodeCost node = estimate_node_cost(spec->get_type(), collector.get_children().size());
+          result.visits_ = 1.0;
+          result.value_flops_ = node.value_flops_;
+          result.derivative_flops_ = node.derivative_flops_;
+          for(size_t i=0; i<collector.get_children().size(); ++i)
+          {
+            EvaluationCost child = cost(collector.get_children()[i]);
+            result.visits_ += child.visits_;
+            result.value_flops_ += child.value_flops_;
+            result.derivative_flops_ += child.derivative_flops_;
+          }
+        }
+
+        costs_[spec.get()] = result;
+        return result;
+      }
+
+      void collect_caches(const SpecPtr& spec, std::map<const Spec*, SpecPtr>& caches)
+      {
+        std::set<const Spec*> visited;
+        collect_caches(spec, caches, visited);
+      }
+
+      void collect_caches(const SpecPtr& spec, std::map<const Spec*, SpecPtr>& caches,
+          std::set<const Spec*>& visited)
+      {
+        if(!spec.get() || !visited.insert(spec.get()).second)
+          return;
+
+        if(is_cached(spec))
+          caches[spec.get()] = spec;
+
+        SpecChildCollector collector;
+        collector.collect(spec);
+        if(collector.is_reference())
+          collect_caches(resolve(collector.get_reference()), caches, visited);
+        for(size_t i=0; i<collector.get_children().size(); ++i)
+          collect_caches(collector.get_children()[i], caches, visited);
+      }
+
+      void collect_dimensions(const QPControllerSpec& spec)
+      {
+        QPStatistics& qp = statistics_.qp_;
+        qp.num_controllables_ = spec.controllable_constraints_.size();
+        qp.num_soft_constraints_ = spec.soft_constraints_.size();
+        qp.num_hard_constraints_ = spec.hard_constraints_.size();
+
+        for(size_t i=0; i<roots_.size(); ++i)
+        {
+          const std::set<size_t>& inputs = dependencies_.get_inputs(roots_[i]);
+          if(!inputs.empty())
+            qp.num_observables_ = std::max(qp.num_observables_, *inputs.rbegin() + 1);
+        }
+
+        for(size_t i=0; i<spec.soft_constraints_.size(); ++i)
+        {
+          qp.soft_derivative_columns_.push_back(
+              count_columns(spec.soft_constraints_[i].expression_));
+          qp.jacobian_nonzeros_ += qp.soft_derivative_columns_.back();
+        }
+
+        for(size_t i=0; i<spec.hard_constraints_.size(); ++i)
+        {
+          qp.hard_derivative_columns_.push_back(
+              count_columns(spec.hard_constraints_[i].expression_));
+          qp.jacobian_nonzeros_ += qp.hard_derivative_columns_.back();
+        }
+      }
+
+      size_t count_columns(const SpecPtr& expression) const
+      {
+        std::set<size_t> inputs = dependencies_.get_inputs(expression);
+        return std::distance(inputs.begin(),
+            inputs.lower_bound(statistics_.qp_.num_controllables_));
+      }
+
+      const SpecPtr& resolve(const std::string& name) const
+      {
+        std::map<std::string, SpecPtr>::const_iterator entry = scope_.find(name);
+        if(entry == scope_.end())
+          throw std::invalid_argument("Could not find scope entry with name: " + name);
+
+        return entry->second;
+      }
+
+      bool is_cached(const SpecPtr& spec) const
+      {
+        return spec.get() && (spec->get_type() == VECTOR_CACHED_SPEC ||
+            spec->get_type() == FRAME_CACHED_SPEC);
+      }
+  };
+
+  inline SpecStatistics analyze(const QPControllerSpec& spec)
+  {
+    return SpecAnalyzer(spec).get_statistics();
+  }
+
+  ///
+  /// cycle-time budgets
+  ///
+
+  // Time available for one controller update, and the floating point
+  // throughput to assume for the target machine.
+  class CostBudget
+  {
+    public:
+      CostBudget(double cycle_time, double flops_per_second=1e9) :
+        cycle_time_(cycle_time), flops_per_second_(flops_per_second) {}
+
+      double cycle_time_, flops_per_second_;
+  };
+
+  inline double estimate_cycle_time(const SpecStatistics& statistics, double flops_per_second)
+  {
+    if(flops_per_second <= 0.0)
+      throw std::invalid_argument("Floating point throughput needs to be positive.");
+
+    return statistics.get_total_flops() / flops_per_second;
+  }
+
+  inline bool is_within_budget(const SpecStatistics& statistics, const CostBudget& budget)
+  {
+    return estimate_cycle_time(statistics, budget.flops_per_second_) <= budget.cycle_time_;
+  }
+
+  ///
+  /// reports
+  ///
+
+  inline void print_statistics(std::ostream& os, const QPStatistics& statistics)
+  {
+    os << "qp:" << std::endl;
+    os << "  controllables: " << statistics.num_controllables_ << std::endl;
+    os << "  soft constraints: " << statistics.num_soft_constraints_ << std::endl;
+    os << "  hard constraints: " << statistics.num_hard_constraints_ << std::endl;
+    os << "  observables: " << statistics.num_observables_ << std::endl;
+    os << "  variables: " << statistics.num_variables() << std::endl;
+    os << "  constraints: " << statistics.num_constraints() << std::endl;
+    os << "  jacobian nonzeros: " << statistics.jacobian_nonzeros_ << std::endl;
+    os << "  soft derivative columns:";
+    for(size_t i=0; i<statistics.soft_derivative_columns_.size(); ++i)
+      os << " " << statistics.soft_derivative_columns_[i];
+    os << std::endl << "  hard derivative columns:";
+    for(size_t i=0; i<statistics.hard_derivative_columns_.size(); ++i)
+      os << " " << statistics.hard_derivative_columns_[i];
+    os << std::endl << "  estimated flops: " << statistics.estimate_flops() << std::endl;
+  }
+
+  inline void print_statistics(std::ostream& os, const SpecStatistics& statistics)
+  {
+    os << "nodes: " << statistics.num_nodes_ << std::endl;
+    for(std::map<SpecType, size_t>::const_iterator it = statistics.node_counts_.begin();
+        it != statistics.node_counts_.end(); ++it)
+      os << "  " << spec_type_name(it->first) << ": " << it->second << std::endl;
+    os << "scope entries: " << statistics.num_scope_entries_ << std::endl;
+    os << "max depth: " << statistics.max_depth_ << std::endl;
+    os << "max fan-out: " << statistics.max_fan_out_ << std::endl;
+    os << "mean fan-out: " << statistics.mean_fan_out_ << std::endl;
+    os << "shared entries: " << statistics.num_shared_entries_ << std::endl;
+    os << "duplicated entries: " << statistics.num_duplicated_entries_ << std::endl;
+    os << "duplicated subtrees: " << statistics.num_duplicated_subtrees_ << std::endl;
+    os << "node visits per update: " << statistics.node_visits_ << std::endl;
+    os << "expression flops: " << statistics.expression_flops_ << std::endl;
+    os << "derivative flops: " << statistics.derivative_flops_ << std::endl;
+    print_statistics(os, statistics.qp_);
+    os << "total flops: " << statistics.get_total_flops() << std::endl;
+  }
+}
+
+#endif // GISKARD_COST_MODEL_HPP
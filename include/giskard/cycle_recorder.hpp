@@ -0,0 +1,452 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_CYCLE_RECORDER_HPP
+#define GISKARD_CYCLE_RECORDER_HPP
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
+#include <giskard/expression_generation.hpp>
+#include <giskard/observable_binding.hpp>
+#include <giskard/qp_controller.hpp>
+#include <giskard/qp_working_set.hpp>
+#include <giskard/ring_buffer.hpp>
+#include <giskard/spec_serialization.hpp>
+#include <giskard/specifications.hpp>
+#include <giskard/version.hpp>
+
+namespace giskard
+{
+  ///
+  /// recorded controller cycles
+  ///
+
+  enum CycleKind
+  {
+    START_CYCLE,
+    UPDATE_CYCLE
+  };
+
+  // One call to QPController::start() or update(). The observables are in the
+  // order of the controller, i.e. the controllables followed by parameters
+  // like goals, see QPController::get_observable_names().
+  class RecordedCycle
+  {
+    public:
+      RecordedCycle() :
+        kind_(UPDATE_CYCLE), nWSR_(0), success_(false), status_(QP_NOT_INITIALIZED),
+        num_iterations_(0) {}
+
+      CycleKind kind_;
+      int nWSR_;
+      bool success_;
+      QPSolverStatus status_;
+      int num_iterations_;
+      QPCycleTimings timings_;
+      Eigen::VectorXd observables_, command_, slack_;
+  };
+
+  // A recorded session: the specification of the controller, the giskard
+  // version which recorded it and its cycles. A session whose recorder did
+  // not finish its last cycle, e.g. because the process died, is truncated.
+  class RecordedSession
+  {
+    public:
+      RecordedSession() :
+        truncated_(false) {}
+
+      std::string version_;
+      QPControllerSpec spec_;
+      std::vector<std::string> observable_names_;
+      std::vector<RecordedCycle> cycles_;
+      bool truncated_;
+  };
+
+  ///
+  /// binary recording
+  ///
+
+  // The stream layout is a header, written once, followed by one record per
+  // cycle. Records are only ever appended, and use the binary primitives of
+  // spec_serialization.hpp in host byte order.
+  const std::string CYCLE_LOG_MAGIC = "giskard-cycles";
+  const boost::uint64_t CYCLE_LOG_FORMAT = 2;
+
+  namespace detail
+  {
+    // same layout as write_binary(os, Eigen::VectorXd), but a single write
+    inline void write_block(std::ostream& os, const Eigen::VectorXd& values)
+    {
+      giskard::write_binary(os, static_cast<boost::uint64_t>(values.rows()));
+      os.write(reinterpret_cast<const char*>(values.data()), values.rows() * sizeof(double));
+    }
+  }
+
+  inline void write_binary(std::ostream& os, const RecordedCycle& cycle)
+  {
+    write_binary(os, static_cast<boost::uint64_t>(cycle.kind_));
+    write_binary(os, static_cast<boost::uint64_t>(static_cast<boost::int64_t>(cycle.nWSR_)));
+    write_binary(os, static_cast<boost::uint64_t>(cycle.success_));
+    write_binary(os, static_cast<boost::uint64_t>(cycle.status_));
+    write_binary(os, static_cast<boost::uint64_t>(static_cast<boost::int64_t>(cycle.num_iterations_)));
+    write_binary(os, cycle.timings_.evaluation_seconds_);
+    write_binary(os, cycle.timings_.solve_seconds_);
+    detail::write_block(os, cycle.observables_);
+    detail::write_block(os, cycle.command_);
+    detail::write_block(os, cycle.slack_);
+  }
+
+  // Appends the cycles of a QPController to a binary stream, e.g. a
+  // std::ofstream opened in binary mode. Call record() right after each call
+  // to start() or update(). Recording a cycle only copies it into a slot of a
+  // preallocated ring buffer, see RingBuffer, and allocates no memory; a
+  // writer thread drains the buffer into the stream. While the writer lags
+  // behind by more than capacity cycles, e.g. during a slow disk write, new
+  // cycles are dropped and counted instead of blocking the control loop. The
+  // stream must not be used by others until the recorder is destroyed.
+  class CycleRecorder
+  {
+    public:
+      CycleRecorder(std::ostream& os, const QPControllerSpec& spec, const QPController& controller,
+          size_t capacity = 1024) :
+        os_(os), cycles_(capacity, make_cycle(controller)), num_cycles_(0), num_dropped_(0),
+        num_written_(0), stop_(false)
+      {
+        if(spec.controllable_constraints_.size() != controller.get_controllable_names().size() ||
+           spec.soft_constraints_.size() != controller.get_soft_constraint_names().size())
+          throw std::invalid_argument("Cycle recorder received a controller which does not match its specification.");
+
+        write_binary(os_, CYCLE_LOG_MAGIC);
+        write_binary(os_, CYCLE_LOG_FORMAT);
+        write_binary(os_, std::string(GISKARD_VERSION));
+        write_binary(os_, spec);
+        detail::write_binary(os_, controller.get_observable_names());
+
+        writer_ = boost::thread(boost::bind(&CycleRecorder::write, this));
+      }
+
+      // Writes all recorded cycles before returning.
+      ~CycleRecorder()
+      {
+        stop_.store(true, boost::memory_order_release);
+        writer_.join();
+        os_.flush();
+      }
+
+      // Returns false if the cycle was dropped.
+      bool record(const QPController& controller, CycleKind kind,
+          const Eigen::Ref<const Eigen::VectorXd>& observables, int nWSR, bool success)
+      {
+        RecordedCycle* cycle = begin_cycle(controller, kind, nWSR, success);
+        if(!cycle)
+          return false;
+
+        cycle->observables_ = observables.head(cycle->observables_.rows());
+        end_cycle();
+        return true;
+      }
+
+      // Records a cycle whose observables were gathered through a binding.
+      bool record(const QPController& controller, CycleKind kind, const ObservableBinding& binding,
+          const double* source, int nWSR, bool success)
+      {
+        RecordedCycle* cycle = begin_cycle(controller, kind, nWSR, success);
+        if(!cycle)
+          return false;
+
+        for(size_t i=0; i<static_cast<size_t>(cycle->observables_.rows()); ++i)
+          cycle->observables_(i) = source[binding.get_indices()[i]];
+        end_cycle();
+        return true;
+      }
+
+      // number of cycles recorded, without the dropped ones
+      size_t num_cycles() const
+      {
+        return num_cycles_;
+      }
+
+      size_t num_dropped() const
+      {
+        return num_dropped_;
+      }
+
+      size_t capacity() const
+      {
+        return cycles_.capacity();
+      }
+
+      // Waits until the writer has written all recorded cycles, and flushes the
+      // stream. Blocks, i.e. do not call this from the control loop.
+      void flush()
+      {
+        while(num_written_.load(boost::memory_order_acquire) != num_cycles_)
+          boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+        os_.flush();
+      }
+
+    private:
+      std::ostream& os_;
+      RingBuffer<RecordedCycle> cycles_;
+      size_t num_cycles_, num_dropped_;
+      boost::atomic<size_t> num_written_;
+      boost::atomic<bool> stop_;
+      boost::thread writer_;
+
+      // not copyable
+      CycleRecorder(const CycleRecorder&);
+      CycleRecorder& operator=(const CycleRecorder&);
+
+      // a cycle with the sizes of the outputs of controller
+      static RecordedCycle make_cycle(const QPController& controller)
+      {
+        RecordedCycle result;
+        result.observables_ = Eigen::VectorXd::Zero(controller.get_qp_builder().num_observables());
+        result.command_ = Eigen::VectorXd::Zero(controller.get_command().rows());
+        result.slack_ = Eigen::VectorXd::Zero(controller.get_slack().rows());
+        return result;
+      }
+
+      RecordedCycle* begin_cycle(const QPController& controller, CycleKind kind, int nWSR, bool success)
+      {
+        RecordedCycle* cycle = cycles_.get_back();
+        if(!cycle)
+        {
+          ++num_dropped_;
+          return 0;
+        }
+
+        cycle->kind_ = kind;
+        cycle->nWSR_ = nWSR;
+        cycle->success_ = success;
+        cycle->status_ = controller.get_solver_status();
+        cycle->num_iterations_ = controller.get_num_working_set_recalculations();
+        cycle->timings_ = controller.get_cycle_timings();
+        cycle->command_ = controller.get_command();
+        cycle->slack_ = controller.get_slack();
+        return cycle;
+      }
+
+      void end_cycle()
+      {
+        cycles_.publish();
+        ++num_cycles_;
+      }
+
+      // drains the ring buffer until the recorder is destroyed
+      void write()
+      {
+        while(true)
+        {
+          bool stop = stop_.load(boost::memory_order_acquire);
+          while(const RecordedCycle* cycle = cycles_.get_front())
+          {
+            write_binary(os_, *cycle);
+            cycles_.pop();
+            num_written_.fetch_add(1, boost::memory_order_release);
+          }
+
+          // the last cycles were published before stop_ was set
+          if(stop)
+            return;
+          boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+        }
+      }
+  };
+
+  inline void read_binary(std::istream& is, RecordedCycle& cycle)
+  {
+    boost::uint64_t value;
+    read_binary(is, value);
+    cycle.kind_ = static_cast<CycleKind>(value);
+    read_binary(is, value);
+    cycle.nWSR_ = static_cast<int>(static_cast<boost::int64_t>(value));
+    read_binary(is, value);
+    cycle.success_ = (value != 0);
+    read_binary(is, value);
+    cycle.status_ = static_cast<QPSolverStatus>(value);
+    read_binary(is, value);
+    cycle.num_iterations_ = static_cast<int>(static_cast<boost::int64_t>(value));
+    read_binary(is, cycle.timings_.evaluation_seconds_);
+    read_binary(is, cycle.timings_.solve_seconds_);
+    detail::read_binary(is, cycle.observables_);
+    detail::read_binary(is, cycle.command_);
+    detail::read_binary(is, cycle.slack_);
+  }
+
+  inline void read_binary(std::istream& is, RecordedSession& session)
+  {
+    std::string magic;
+    read_binary(is, magic);
+    if(magic != CYCLE_LOG_MAGIC)
+      throw std::runtime_error("Cycle log: stream does not start with a cycle log header.");
+
+    boost::uint64_t format;
+    read_binary(is, format);
+    if(format != CYCLE_LOG_FORMAT)
+      throw std::runtime_error("Cycle log: unsupported format " + boost::lexical_cast<std::string>(format) + ".");
+
+    read_binary(is, session.version_);
+    read_binary(is, session.spec_);
+    detail::read_binary(is, session.observable_names_);
+
+    session.cycles_.clear();
+    session.truncated_ = false;
+    while(is.peek() != std::char_traits<char>::eof())
+    {
+      RecordedCycle cycle;
+      try
+      {
+        read_binary(is, cycle);
+      }
+      catch(const std::runtime_error&)
+      {
+        // the recorder died while writing this cycle
+        session.truncated_ = true;
+        break;
+      }
+      session.cycles_.push_back(cycle);
+    }
+  }
+
+  ///
+  /// replaying recorded sessions
+  ///
+
+  class TimingDistribution
+  {
+    public:
+      TimingDistribution() :
+        mean_(0.0), min_(0.0), median_(0.0), p90_(0.0), p99_(0.0), max_(0.0) {}
+
+      double mean_, min_, median_, p90_, p99_, max_;
+  };
+
+  inline TimingDistribution summarize_timings(std::vector<double> seconds)
+  {
+    TimingDistribution result;
+    if(seconds.empty())
+      return result;
+
+    std::sort(seconds.begin(), seconds.end());
+    for(size_t i=0; i<seconds.size(); ++i)
+      result.mean_ += seconds[i] / seconds.size();
+    result.min_ = seconds.front();
+    result.median_ = seconds[(seconds.size() - 1) / 2];
+    result.p90_ = seconds[(9 * (seconds.size() - 1)) / 10];
+    result.p99_ = seconds[(99 * (seconds.size() - 1)) / 100];
+    result.max_ = seconds.back();
+    return result;
+  }
+
+  // Comparison of a replayed session with its recording. Deviations are the
+  // largest absolute differences per cycle, and infinite where the sizes of
+  // the outputs differ.
+  class ReplayResult
+  {
+    public:
+      ReplayResult() :
+        num_success_mismatches_(0) {}
+
+      std::vector<double> command_deviations_, slack_deviations_;
+      size_t num_success_mismatches_;
+      TimingDistribution recorded_evaluation_, replayed_evaluation_;
+      TimingDistribution recorded_solve_, replayed_solve_;
+
+      double get_max_command_deviation() const
+      {
+        return max_of(command_deviations_);
+      }
+
+      double get_max_slack_deviation() const
+      {
+        return max_of(slack_deviations_);
+      }
+
+    private:
+      static double max_of(const std::vector<double>& values)
+      {
+        double result = 0.0;
+        for(size_t i=0; i<values.size(); ++i)
+          result = std::max(result, values[i]);
+        return result;
+      }
+  };
+
+  inline double max_deviation(const Eigen::VectorXd& lhs, const Eigen::VectorXd& rhs)
+  {
+    if(lhs.rows() != rhs.rows())
+      return std::numeric_limits<double>::infinity();
+
+    return (lhs.rows() == 0) ? 0.0 : (lhs - rhs).cwiseAbs().maxCoeff();
+  }
+
+  // Feeds the recorded observables to controller, cycle by cycle, and compares
+  // its outputs and timings with the recorded ones.
+  inline ReplayResult replay(const RecordedSession& session, QPController& controller)
+  {
+    ReplayResult result;
+    std::vector<double> recorded_evaluation, replayed_evaluation, recorded_solve, replayed_solve;
+
+    for(size_t i=0; i<session.cycles_.size(); ++i)
+    {
+      const RecordedCycle& cycle = session.cycles_[i];
+      bool success = (cycle.kind_ == START_CYCLE) ?
+          controller.start(cycle.observables_, cycle.nWSR_) :
+          controller.update(cycle.observables_, cycle.nWSR_);
+
+      if(success != cycle.success_)
+        result.num_success_mismatches_++;
+      result.command_deviations_.push_back(max_deviation(controller.get_command(), cycle.command_));
+      result.slack_deviations_.push_back(max_deviation(controller.get_slack(), cycle.slack_));
+
+      recorded_evaluation.push_back(cycle.timings_.evaluation_seconds_);
+      recorded_solve.push_back(cycle.timings_.solve_seconds_);
+      replayed_evaluation.push_back(controller.get_cycle_timings().evaluation_seconds_);
+      replayed_solve.push_back(controller.get_cycle_timings().solve_seconds_);
+    }
+
+    result.recorded_evaluation_ = summarize_timings(recorded_evaluation);
+    result.replayed_evaluation_ = summarize_timings(replayed_evaluation);
+    result.recorded_solve_ = summarize_timings(recorded_solve);
+    result.replayed_solve_ = summarize_timings(replayed_solve);
+    return result;
+  }
+
+  // Replays against a controller generated from the recorded specification.
+  inline ReplayResult replay(const RecordedSession& session)
+  {
+    QPController controller = generate(session.spec_);
+    return replay(session, controller);
+  }
+}
+
+#endif // GISKARD_CYCLE_RECORDER_HPP
@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_DIAGONAL_QP_SOLVER_HPP
+#define GISKARD_DIAGONAL_QP_SOLVER_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <giskard/qp_solver.hpp>
+
+namespace giskard
+{
+  // Solves the QPs built by QPProblemBuilder exploiting their structure: the
+  // Hessian is diagonal and every soft constraint has its own slack variable
+  // with a unit coefficient. The solver runs Hildreth's method, i.e. projected
+  // coordinate ascent on the dual. With a diagonal Hessian the primal solution
+  // follows in closed form from the multipliers, so each coordinate step costs
+  // one sparse row update. Slack columns never get touched as part of A; they
+  // only contribute their inverse weight to the curvature of their row.
+  //
+  // hotstart() keeps the multipliers of the previous solve, so consecutive problems
+  // of a control loop start from the previous solution. The max_iterations argument
+  // of init() and hotstart() allows for a fixed number of sweeps per iteration, so
+  // retrying with a larger nWSR also gives this solver more sweeps. Guesses are
+  // ignored. Bounds with lower > upper and zero rows of A whose bounds exclude 0
+  // are reported as infeasible without sweeping.
+  class DiagonalQPSolver : public QPSolver
+  {
+    public:
+      DiagonalQPSolver() :
+        sweeps_per_iteration_(100), tolerance_(1e-10) {}
+
+      virtual std::string get_name() const
+      {
+        return "diagonal";
+      }
+
+      virtual QPSolverPtr clone() const
+      {
+        return QPSolverPtr(new DiagonalQPSolver(*this));
+      }
+
+      virtual void get_primal_solution(Eigen::VectorXd& x) const
+      {
+        x = x_;
+      }
+
+      size_t get_sweeps_per_iteration() const
+      {
+        return sweeps_per_iteration_;
+      }
+
+      // A solve stops after max_iterations * sweeps_per_iteration sweeps.
+      void set_sweeps_per_iteration(size_t sweeps_per_iteration)
+      {
+        sweeps_per_iteration_ = std::max(sweeps_per_iteration, size_t(1));
+      }
+
+      double get_tolerance() const
+      {
+        return tolerance_;
+      }
+
+      // Iterations stop once no sweep changes any constraint value by more than tolerance.
+      void set_tolerance(double tolerance)
+      {
+        tolerance_ = tolerance;
+      }
+
+    protected:
+      virtual QPSolverStatus do_init(const QPProblemBuilder& builder, int max_iterations,
+          const QPWorkingSet*)
+      {
+        prepare(builder);
+        mu_bounds_.setZero();
+        mu_rows_.setZero();
+        return solve(builder, max_iterations);
+      }
+
+      virtual QPSolverStatus do_hotstart(const QPProblemBuilder& builder, int max_iterations)
+      {
+        prepare(builder);
+        return solve(builder, max_iterations);
+      }
+
+    private:
+      size_t sweeps_per_iteration_;
+      double tolerance_;
+
+      size_t num_controllables_, num_hard_, num_soft_, num_weights_;
+      Eigen::VectorXd h_inv_, x_, mu_bounds_, mu_rows_, row_norms_;
+
+      // QPProblemBuilder marks missing bounds of the slack variables like this
+      static bool is_infinite(double bound)
+      {
+        return std::abs(bound) >= 1e+9;
+      }
+
+      // Fails if the problem has non-positive weights. The number of iterations
+      // is the number of sweeps over all constraints.
+      QPSolverStatus solve(const QPProblemBuilder& builder, int max_iterations)
+      {
+        set_num_iterations(0);
+        const QPProblemBuilder::Matrix& H = builder.get_H();
+        for(size_t j=0; j<num_weights_; ++j)
+        {
+          if(!(H(j, j) > 0.0))
+            return QP_FAILED;
+          h_inv_(j) = 1.0 / H(j, j);
+        }
+
+        compute_row_norms(builder.get_A());
+        if(has_infeasible_bounds(builder))
+          return QP_INFEASIBLE;
+
+        compute_primal(builder);
+
+        size_t max_sweeps = static_cast<size_t>(std::max(max_iterations, 1)) * sweeps_per_iteration_;
+        for(size_t num_sweeps = 1; num_sweeps <= max_sweeps; ++num_sweeps)
+        {
+          set_num_iterations(num_sweeps);
+          if(sweep(builder) < tolerance_)
+            return QP_SOLVED;
+        }
+
+        // diverging multipliers are the typical sign of infeasibility
+        return QP_MAX_ITERATIONS_REACHED;
+      }
+
+      void prepare(const QPProblemBuilder& builder)
+      {
+        bool resized = static_cast<size_t>(mu_bounds_.rows()) != builder.num_weights() ||
+            static_cast<size_t>(mu_rows_.rows()) != builder.num_constraints();
+
+        num_controllables_ = builder.num_controllables();
+        num_hard_ = builder.num_hard_constraints();
+        num_soft_ = builder.num_soft_constraints();
+        num_weights_ = builder.num_weights();
+
+        h_inv_.resize(num_weights_);
+        x_.resize(num_weights_);
+        row_norms_.resize(num_hard_ + num_soft_);
+        if(resized)
+        {
+          mu_bounds_ = Eigen::VectorXd::Zero(num_weights_);
+          mu_rows_ = Eigen::VectorXd::Zero(num_hard_ + num_soft_);
+        }
+      }
+
+      void compute_row_norms(const QPProblemBuilder::Matrix& A)
+      {
+        for(size_t r=0; r<num_hard_ + num_soft_; ++r)
+        {
+          double norm = 0.0;
+          for(size_t j=0; j<num_controllables_; ++j)
+            norm += A(r, j) * A(r, j) * h_inv_(j);
+          if(r >= num_hard_)
+            norm += h_inv_(num_controllables_ + r - num_hard_);
+          row_norms_(r) = norm;
+        }
+      }
+
+      // Checks the bounds which no sweep could ever satisfy. Rows with a zero norm
+      // are hard constraints with a zero row of A, i.e. their value is always 0.
+      bool has_infeasible_bounds(const QPProblemBuilder& builder) const
+      {
+        const QPProblemBuilder::Vector& lb = builder.get_lb();
+        const QPProblemBuilder::Vector& ub = builder.get_ub();
+        const QPProblemBuilder::Vector& lbA = builder.get_lbA();
+        const QPProblemBuilder::Vector& ubA = builder.get_ubA();
+
+        for(size_t j=0; j<num_weights_; ++j)
+          if(lb(j) > ub(j))
+            return true;
+
+        for(size_t r=0; r<num_hard_ + num_soft_; ++r)
+        {
+          if(lbA(r) > ubA(r))
+            return true;
+          if(row_norms_(r) <= 0.0 && (lbA(r) > tolerance_ || ubA(r) < -tolerance_))
+            return true;
+        }
+
+        return false;
+      }
+
+      // x = H^-1 (-g + mu_bounds + A^T mu_rows)
+      void compute_primal(const QPProblemBuilder& builder)
+      {
+        const QPProblemBuilder::Matrix& A = builder.get_A();
+        x_ = mu_bounds_ - builder.get_g();
+        for(size_t r=0; r<num_hard_ + num_soft_; ++r)
+        {
+          for(size_t j=0; j<num_controllables_; ++j)
+            x_(j) += A(r, j) * mu_rows_(r);
+          if(r >= num_hard_)
+            x_(num_controllables_ + r - num_hard_) += mu_rows_(r);
+        }
+        x_ = x_.cwiseProduct(h_inv_);
+      }
+
+      // Maximizes the dual over one multiplier of a constraint lower <= value <= upper
+      // whose row has the given curvature. Returns the change of the multiplier.
+      static double step(double& mu, double value, double lower, double upper, double curvature)
+      {
+        double target_lower = is_infinite(lower) ? -std::numeric_limits<double>::infinity() :
+            mu + (lower - value) / curvature;
+        double target_upper = is_infinite(upper) ? std::numeric_limits<double>::infinity() :
+            mu + (upper - value) / curvature;
+
+        double new_mu = std::min(std::max(0.0, target_lower), target_upper);
+        double delta = new_mu - mu;
+        mu = new_mu;
+        return delta;
+      }
+
+      // Returns the largest change of a constraint value during this sweep.
+      double sweep(const QPProblemBuilder& builder)
+      {
+        const QPProblemBuilder::Matrix& A = builder.get_A();
+        const QPProblemBuilder::Vector& lb = builder.get_lb();
+        const QPProblemBuilder::Vector& ub = builder.get_ub();
+        const QPProblemBuilder::Vector& lbA = builder.get_lbA();
+        const QPProblemBuilder::Vector& ubA = builder.get_ubA();
+        double max_change = 0.0;
+
+        for(size_t j=0; j<num_weights_; ++j)
+        {
+          if(is_infinite(lb(j)) && is_infinite(ub(j)))
+            continue;
+
+          double delta = step(mu_bounds_(j), x_(j), lb(j), ub(j), h_inv_(j));
+          x_(j) += h_inv_(j) * delta;
+          max_change = std::max(max_change, std::abs(delta) * h_inv_(j));
+        }
+
+        for(size_t r=0; r<num_hard_ + num_soft_; ++r)
+        {
+          if(row_norms_(r) <= 0.0 || (is_infinite(lbA(r)) && is_infinite(ubA(r))))
+            continue;
+
+          size_t slack = num_controllables_ + r - num_hard_;
+          double value = A.row(r).head(num_controllables_).dot(x_.head(num_controllables_));
+          if(r >= num_hard_)
+            value += x_(slack);
+
+          double delta = step(mu_rows_(r), value, lbA(r), ubA(r), row_norms_(r));
+          if(delta == 0.0)
+            continue;
+
+          for(size_t j=0; j<num_controllables_; ++j)
+            x_(j) += h_inv_(j) * A(r, j) * delta;
+          if(r >= num_hard_)
+            x_(slack) += h_inv_(slack) * delta;
+          max_change = std::max(max_change, std::abs(delta) * row_norms_(r));
+        }
+
+        return max_change;
+      }
+  };
+}
+
+#endif // GISKARD_DIAGONAL_QP_SOLVER_HPP
@@ -22,9 +22,188 @@
 #define GISKARD_EXPRESSION_ARRAYS_HPP
 
 #include <kdl/expressiontree.hpp>
+#include <giskard/shared_expression.hpp>
+#include <boost/lexical_cast.hpp>
+#include <set>
+#include <stdexcept>
 
 namespace KDL
 {
+  // Storage of the values of an ExpressionArray: an Eigen vector for doubles,
+  // and a std::vector for all other result types.
+  template<typename ResultType>
+  class ExpressionArrayValues
+  {
+    public:
+      typedef typename std::vector<ResultType> Values;
+
+      static void resize(Values& values, size_t size)
+      {
+        values.resize(size);
+      }
+
+      static void set(Values& values, size_t index, const ResultType& value)
+      {
+        values[index] = value;
+      }
+  };
+
+  template<>
+  class ExpressionArrayValues<double>
+  {
+    public:
+      typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Values;
+
+      static void resize(Values& values, size_t size)
+      {
+        values.resize(size, 1);
+      }
+
+      static void set(Values& values, size_t index, double value)
+      {
+        values(index, 0) = value;
+      }
+  };
+
+  // Layout of the derivatives of an ExpressionArray: the derivative of expression
+  // i with respect to input j fills the column j of the rows
+  // [i * rows, (i + 1) * rows) of the derivative matrix.
+  template<typename DerivType>
+  class ExpressionArrayDerivatives;
+
+  template<>
+  class ExpressionArrayDerivatives<double>
+  {
+    public:
+      enum { rows = 1 };
+
+      template<typename Derived>
+      static void set(Eigen::MatrixBase<Derived>& derivatives, size_t index, size_t input, double derivative)
+      {
+        derivatives(index, input) = derivative;
+      }
+  };
+
+  // derivatives of vectors, and rotational velocities of rotations
+  template<>
+  class ExpressionArrayDerivatives<KDL::Vector>
+  {
+    public:
+      enum { rows = 3 };
+
+      template<typename Derived>
+      static void set(Eigen::MatrixBase<Derived>& derivatives, size_t index, size_t input,
+          const KDL::Vector& derivative)
+      {
+        for(size_t i=0; i<3; ++i)
+          derivatives(rows * index + i, input) = derivative[i];
+      }
+  };
+
+  // twists of frames: translational velocity first, then rotational velocity
+  template<>
+  class ExpressionArrayDerivatives<KDL::Twist>
+  {
+    public:
+      enum { rows = 6 };
+
+      template<typename Derived>
+      static void set(Eigen::MatrixBase<Derived>& derivatives, size_t index, size_t input,
+          const KDL::Twist& derivative)
+      {
+        for(size_t i=0; i<6; ++i)
+          derivatives(rows * index + i, input) = derivative[i];
+      }
+  };
+
+  // Optimizer and inputs shared by several expression arrays of possibly different
+  // result types, e.g. the poses and the positions of the links of a robot: one
+  // call of set_inputs() evaluates the graphs of all arrays added, and nodes shared
+  // between them, see KDL::SharedExpression, are computed only once. The arrays
+  // then copy their results with ExpressionArray::read(). The expressions are
+  // registered on the first set_inputs() after an add(), or by prepare().
+  class ExpressionArrayOptimizer
+  {
+    public:
+      ExpressionArrayOptimizer() :
+        num_inputs_(0), prepared_(false) {}
+
+      template<typename ExpressionPtr>
+      void add(const std::vector<ExpressionPtr>& expressions)
+      {
+        for(size_t i=0; i<expressions.size(); ++i)
+        {
+          expressions_.push_back(expressions[i]);
+          num_inputs_ = std::max(num_inputs_, static_cast<size_t>(expressions[i]->number_of_derivatives()));
+        }
+        prepared_ = false;
+      }
+
+      void clear()
+      {
+        expressions_.clear();
+        num_inputs_ = 0;
+        prepared_ = false;
+      }
+
+      size_t num_inputs() const
+      {
+        return num_inputs_;
+      }
+
+      void prepare()
+      {
+        std::vector<int> input_vars;
+        for(size_t i=0; i<num_inputs_; ++i)
+          input_vars.push_back(i);
+        optimizer_.prepare(input_vars);
+
+        ScopedOptimizerRegistration registration;
+        for(size_t i=0; i<expressions_.size(); ++i)
+          expressions_[i]->addToOptimizer(optimizer_);
+
+        inputs_.resize(num_inputs_);
+        prepared_ = true;
+      }
+
+      // Uses the first num_inputs() entries of inputs. Accepts any contiguous
+      // vector, e.g. segments or Eigen::Maps of caller-owned memory.
+      void set_inputs(const Eigen::Ref<const Eigen::VectorXd>& inputs)
+      {
+        if(static_cast<size_t>(inputs.rows()) < num_inputs_)
+          throw std::invalid_argument("Expression array needs " + boost::lexical_cast<std::string>(num_inputs_) +
+              " inputs, but received " + boost::lexical_cast<std::string>(inputs.rows()) + ".");
+
+        if(!prepared_)
+          prepare();
+        inputs_ = inputs.head(num_inputs_);
+        optimizer_.setInputValues(inputs_);
+      }
+
+      // Gathers input i from source[indices[i]], e.g. from a caller-owned buffer
+      // with a different layout. indices needs at least num_inputs() entries.
+      void set_inputs(const double* source, const std::vector<size_t>& indices)
+      {
+        if(indices.size() < num_inputs_)
+          throw std::invalid_argument("Expression array needs " + boost::lexical_cast<std::string>(num_inputs_) +
+              " input indices, but received " + boost::lexical_cast<std::string>(indices.size()) + ".");
+
+        if(!prepared_)
+          prepare();
+        for(size_t i=0; i<num_inputs_; ++i)
+          inputs_(i) = source[indices[i]];
+        optimizer_.setInputValues(inputs_);
+      }
+
+    private:
+      std::vector<ExpressionBase::Ptr> expressions_;
+      size_t num_inputs_;
+      bool prepared_;
+      // input values handed to the optimizer, allocated once
+      Eigen::VectorXd inputs_;
+      KDL::ExpressionOptimizer optimizer_;
+  };
+
   template<typename ResultType>
   class ExpressionArray
   {
@@ -32,6 +211,8 @@ namespace KDL
       typedef typename KDL::Expression<ResultType>::Ptr ExpressionTypePtr;
       typedef typename KDL::AutoDiffTrait<ResultType>::DerivType DerivType;
       typedef typename KDL::Expression<DerivType>::Ptr DerivExpressionTypePtr;
+      typedef typename ExpressionArrayValues<ResultType>::Values Values;
+      typedef ExpressionArrayDerivatives<DerivType> Derivatives;
 
       size_t num_expressions() const
       {
@@ -97,26 +278,93 @@ namespace KDL
 
       void update(const std::vector< double >& inputs)
       {
-        optimizer_.setInputValues(inputs);
-        copy_results();
+        optimizer_.set_inputs(Eigen::Map<const Eigen::VectorXd>(inputs.empty() ? 0 : &inputs[0], inputs.size()));
+        copy_results(derivatives_);
       }
         
-      void update(const Eigen::VectorXd& inputs)
+      // Uses the first num_inputs() entries of inputs. Accepts any contiguous
+      // vector, e.g. segments or Eigen::Maps of caller-owned memory.
+      void update(const Eigen::Ref<const Eigen::VectorXd>& inputs)
+      {
+        optimizer_.set_inputs(inputs);
+        copy_results(derivatives_);
+      }
+
+      // Gathers input i from source[indices[i]], e.g. from a caller-owned buffer
+      // with a different layout. indices needs at least num_inputs() entries.
+      void update(const double* source, const std::vector<size_t>& indices)
+      {
+        optimizer_.set_inputs(source, indices);
+        copy_results(derivatives_);
+      }
+
+      // Like update(), but writes the derivatives straight into the rows of target,
+      // e.g. a block of a QP matrix, instead of get_derivatives(). Only the columns
+      // an expression depends on are written, all others have to be zero already.
+      // Columns beyond target.cols() are skipped.
+      template<typename Derived>
+      void update(const Eigen::Ref<const Eigen::VectorXd>& inputs, const Eigen::MatrixBase<Derived>& target)
+      {
+        optimizer_.set_inputs(inputs);
+        copy_results(const_cast< Eigen::MatrixBase<Derived>& >(target));
+      }
+
+      template<typename Derived>
+      void update(const double* source, const std::vector<size_t>& indices,
+          const Eigen::MatrixBase<Derived>& target)
+      {
+        optimizer_.set_inputs(source, indices);
+        copy_results(const_cast< Eigen::MatrixBase<Derived>& >(target));
+      }
+
+      // Copies values and derivatives after the inputs of a shared optimizer were
+      // set, see ExpressionArrayOptimizer. The own optimizer of this array is only
+      // prepared by the update() functions, i.e. arrays which are only read do not
+      // register their expressions twice.
+      void read()
       {
-        optimizer_.setInputValues(inputs);
-        copy_results();
+        copy_results(derivatives_);
       }
 
-      const Eigen::Matrix<ResultType, Eigen::Dynamic, 1>& get_values() const
+      template<typename Derived>
+      void read(const Eigen::MatrixBase<Derived>& target)
+      {
+        copy_results(const_cast< Eigen::MatrixBase<Derived>& >(target));
+      }
+
+      // Like read(target), but writes the derivatives of expression i to the rows
+      // of target that belong to index rows[i], e.g. scattered rows of a QP matrix.
+      template<typename Derived>
+      void read(const Eigen::MatrixBase<Derived>& target, const std::vector<size_t>& rows)
+      {
+        copy_results(const_cast< Eigen::MatrixBase<Derived>& >(target), &rows);
+      }
+
+      const Values& get_values() const
       {
         return values_;
       }
 
-      const Eigen::Matrix<DerivType, Eigen::Dynamic, Eigen::Dynamic> get_derivatives() const
+      // Contiguous matrix with derivative_rows() rows per expression and one column
+      // per input, e.g. the stacked 6xN Jacobians of an array of frames.
+      const Eigen::MatrixXd& get_derivatives() const
       {
         return derivatives_;
       }
 
+      // number of rows of the derivative matrix per expression
+      static size_t derivative_rows()
+      {
+        return Derivatives::rows;
+      }
+
+      // Inputs the expression structurally depends on, in ascending order. The
+      // derivatives with respect to all other inputs are always zero.
+      const std::vector<int>& get_dependencies(size_t expression_index) const
+      {
+        return dependencies_[expression_index];
+      }
+
       std::vector<DerivExpressionTypePtr> get_derivative_expressions(size_t expression_index) const
       {
         std::vector<DerivExpressionTypePtr> result;
@@ -125,53 +373,89 @@ namespace KDL
         return result;
       }
 
+      // Returns an independent copy of this array whose expressions are deep copies
+      // of the originals, i.e. the copy does not share any mutable expression nodes
+      // with this array and can be updated from another thread. Nodes shared between
+      // several expressions, see KDL::SharedExpression, stay shared in the copy.
+      ExpressionArray<ResultType> clone() const
+      {
+        ExpressionCloneMemo memo;
+        return clone(memo);
+      }
+
+      // Like clone(), but also shares the copies of nodes with all other arrays
+      // cloned with memo, e.g. the arrays of one QP.
+      ExpressionArray<ResultType> clone(ExpressionCloneMemo& memo) const
+      {
+        ScopedCloneMemo scope(memo);
+        std::vector< ExpressionTypePtr > expressions;
+        for(size_t i=0; i<expressions_.size(); ++i)
+          expressions.push_back(expressions_[i]->clone());
+
+        ExpressionArray<ResultType> result;
+        result.set_expressions(expressions);
+        result.values_ = values_;
+        result.derivatives_ = derivatives_;
+        return result;
+      }
+
     private:
-      Eigen::Matrix<ResultType, Eigen::Dynamic, 1> values_;
-      Eigen::Matrix<DerivType, Eigen::Dynamic, Eigen::Dynamic> derivatives_;
+      Values values_;
+      Eigen::MatrixXd derivatives_;
       std::vector< ExpressionTypePtr > expressions_;
-      KDL::ExpressionOptimizer optimizer_;
+      std::vector< std::vector<int> > dependencies_;
+      ExpressionArrayOptimizer optimizer_;
 
       void prepare_internals()
       {
         prepare_optimizer();
         prepare_eigensizes();
+        prepare_dependencies();
       }
 
+      // registration happens on the first update()
       void prepare_optimizer()
       {
-       optimizer_.prepare(calculate_inputs());
-
-       for(size_t i=0; i<expressions_.size(); ++i)
-         expressions_[i]->addToOptimizer(optimizer_);
+        optimizer_.clear();
+        optimizer_.add(expressions_);
       }
 
-      std::vector<int> calculate_inputs() const
+      void prepare_eigensizes()
       {
-        std::vector<int> input_vars;
-        for(size_t i=0; i<num_inputs(); ++i)
-          input_vars.push_back(i);
-        return input_vars;
+        ExpressionArrayValues<ResultType>::resize(values_, num_expressions());
+        // derivatives which are structurally zero are never written again
+        derivatives_.setZero(derivative_rows() * num_expressions(), num_inputs());
       }
 
-      void prepare_eigensizes()
+      void prepare_dependencies()
       {
-        values_.resize(num_expressions(), 1);
-        derivatives_.resize(num_expressions(), num_inputs());        
+        dependencies_.resize(expressions_.size());
+        for(size_t i=0; i<expressions_.size(); ++i)
+        {
+          std::set<int> dependencies;
+          expressions_[i]->getDependencies(dependencies);
+          dependencies_[i].assign(dependencies.begin(), dependencies.end());
+        }
       }
 
-      void copy_results()
+      template<typename Derived>
+      void copy_results(Eigen::MatrixBase<Derived>& derivatives, const std::vector<size_t>* rows = 0)
       {
-        derivatives_.setZero();
         for(size_t i=0; i<expressions_.size(); ++i)
         {
-          values_(i, 0) = expressions_[i]->value();
-          for(size_t j=0; j<expressions_[i]->number_of_derivatives(); ++j)
-            derivatives_(i,j) = expressions_[i]->derivative(j);
+          ExpressionArrayValues<ResultType>::set(values_, i, expressions_[i]->value());
+          size_t row = rows ? (*rows)[i] : i;
+          const std::vector<int>& dependencies = dependencies_[i];
+          for(size_t j=0; j<dependencies.size() && dependencies[j] < derivatives.cols(); ++j)
+            Derivatives::set(derivatives, row, dependencies[j], expressions_[i]->derivative(dependencies[j]));
         }
       }
   };
 
   typedef ExpressionArray<double> DoubleExpressionArray;
+  typedef ExpressionArray<KDL::Vector> VectorExpressionArray;
+  typedef ExpressionArray<KDL::Rotation> RotationExpressionArray;
+  typedef ExpressionArray<KDL::Frame> FrameExpressionArray;
 
 }
 
@@ -21,10 +21,17 @@
 #ifndef GISKARD_EXPRESSION_EXTRACTION_HPP
 #define GISKARD_EXPRESSION_EXTRACTION_HPP
 
+#include <map>
+#include <string>
+#include <vector>
 #include <yaml-cpp/yaml.h>
 #include <urdf/model.h>
 #include <kdl_parser/kdl_parser.hpp>
 #include <boost/shared_ptr.hpp>
+#include <giskard/exceptions.hpp>
+#include <giskard/expression_generation.hpp>
+#include <giskard/spec_arena.hpp>
+#include <giskard/specifications.hpp>
 
 namespace giskard
 {
@@ -142,7 +149,350 @@ namespace giskard
         return extract(start_link, end_link, tree);
       }
 
+      // Builds the same scope as parsing the YAML of extract(chain) would,
+      // but without going through YAML.
+      static inline ScopeSpec extract_scope(const KDL::Chain& chain)
+      {
+        std::string var_suffix = "_var";
+        std::string frame_suffix = "_frame";
+        std::string expression_name = "fk";
+
+        ScopeSpec input_vars, joint_frames;
+        std::vector<FrameSpecPtr> frame_mul;
+
+        size_t input_var_index = 0;
+        for (std::vector<KDL::Segment>::const_iterator it = chain.segments.begin(); it != chain.segments.end(); ++it)
+        {
+          const KDL::Joint& joint = it->getJoint();
+
+          std::string var_name = joint.getName() + var_suffix;
+          std::string frame_name = joint.getName() + frame_suffix;
+
+          std::vector<FrameSpecPtr> joint_frame;
+          if (joint.getType() != KDL::Joint::None)
+          {
+            // Set input variable definition
+            DoubleInputSpecPtr input_var = make_spec<DoubleInputSpec>();
+            input_var->set_input_num(input_var_index);
+            input_var_index++;
+            input_vars.push_back(scope_entry(var_name, input_var));
+
+            joint_frame.push_back(get_joint_spec(joint, double_reference_spec(var_name)));
+          }
+
+          get_frame_tip_specs(*it, joint_frame);
+
+          if (!joint_frame.empty())
+          {
+            joint_frames.push_back(scope_entry(frame_name, frame_multiplication_spec(joint_frame)));
+            frame_mul.push_back(frame_reference_spec(frame_name));
+          }
+        }
+
+        // Merge entries
+        ScopeSpec scope;
+        scope.reserve(input_vars.size() + joint_frames.size() + 1);
+        scope.insert(scope.end(), input_vars.begin(), input_vars.end());
+        scope.insert(scope.end(), joint_frames.begin(), joint_frames.end());
+        scope.push_back(scope_entry(expression_name, frame_multiplication_spec(frame_mul)));
+
+        return scope;
+      }
+
+      static inline ScopeSpec extract_scope(const std::string& start_link, const std::string& end_link, const KDL::Tree& robot_tree)
+      {
+        KDL::Chain chain;
+        if (!robot_tree.getChain(start_link, end_link, chain))
+        {
+          throw InvalidChain(start_link, end_link);
+        }
+        return extract_scope(chain);
+      }
+
+      static inline ScopeSpec extract_scope(const std::string& start_link, const std::string& end_link, const urdf::Model& urdf)
+      {
+        KDL::Tree tree;
+        if (!kdl_parser::treeFromUrdfModel(urdf, tree))
+        {
+          throw InvalidUrdf();
+        }
+        return extract_scope(start_link, end_link, tree);
+      }
+
+      static inline ScopeSpec extract_scope(const std::string& start_link, const std::string& end_link, const std::string& urdf_path)
+      {
+        urdf::Model urdf;
+        if (!urdf.initFile(urdf_path))
+        {
+          throw InvalidUrdf(urdf_path);
+        }
+        return extract_scope(start_link, end_link, urdf);
+      }
+
+      // Builds one scope with the frames of all links on the paths from the
+      // root of the tree to the given tip links, relative to the root. Every
+      // link frame is defined once in terms of its parent, frames of links at
+      // which paths branch are cached. Joint inputs are numbered in depth-first
+      // order, their scope entries are named after the joints.
+      static inline ScopeSpec extract_scope(const KDL::Tree& robot_tree, const std::vector<std::string>& tip_links)
+      {
+        const KDL::SegmentMap& segments = robot_tree.getSegments();
+        KDL::SegmentMap::const_iterator root = robot_tree.getRootSegment();
+
+        // find all links on the paths to the tips and count their extracted children
+        std::map<std::string, size_t> num_children;
+        for (size_t i = 0; i < tip_links.size(); ++i)
+        {
+          KDL::SegmentMap::const_iterator it = segments.find(tip_links[i]);
+          if (it == segments.end())
+          {
+            throw InvalidChain(root->first, tip_links[i]);
+          }
+
+          if (num_children.count(it->first) != 0)
+            continue;
+
+          num_children[it->first] = 0;
+          while (it != root)
+          {
+            KDL::SegmentMap::const_iterator parent = it->second.parent;
+            bool visited = num_children.count(parent->first) != 0;
+            num_children[parent->first] += 1;
+            if (visited)
+              break;
+            it = parent;
+          }
+        }
+
+        TreeExtraction extraction;
+        extraction.root_ = root;
+        extraction.num_children_ = &num_children;
+        extract_subtree(root, extraction);
+
+        ScopeSpec scope;
+        scope.reserve(extraction.input_vars_.size() + extraction.link_frames_.size());
+        scope.insert(scope.end(), extraction.input_vars_.begin(), extraction.input_vars_.end());
+        scope.insert(scope.end(), extraction.link_frames_.begin(), extraction.link_frames_.end());
+
+        return scope;
+      }
+
+      // Extracts the frames of all links of a tree.
+      static inline ScopeSpec extract_scope(const KDL::Tree& robot_tree)
+      {
+        std::vector<std::string> leaves;
+        const KDL::SegmentMap& segments = robot_tree.getSegments();
+        for (KDL::SegmentMap::const_iterator it = segments.begin(); it != segments.end(); ++it)
+          if (it->second.children.empty())
+            leaves.push_back(it->first);
+
+        return extract_scope(robot_tree, leaves);
+      }
+
+      static inline ScopeSpec extract_scope(const urdf::Model& urdf, const std::vector<std::string>& tip_links)
+      {
+        KDL::Tree tree;
+        if (!kdl_parser::treeFromUrdfModel(urdf, tree))
+        {
+          throw InvalidUrdf();
+        }
+        return extract_scope(tree, tip_links);
+      }
+
+      // Forward kinematics of a chain as an expression of its joint positions.
+      static inline KDL::Expression<KDL::Frame>::Ptr extract_fk(const KDL::Chain& chain)
+      {
+        return generate(extract_scope(chain)).find_frame_expression("fk");
+      }
+
+      static inline KDL::Expression<KDL::Frame>::Ptr extract_fk(const std::string& start_link, const std::string& end_link, const KDL::Tree& robot_tree)
+      {
+        return generate(extract_scope(start_link, end_link, robot_tree)).find_frame_expression("fk");
+      }
+
+      static inline KDL::Expression<KDL::Frame>::Ptr extract_fk(const std::string& start_link, const std::string& end_link, const urdf::Model& urdf)
+      {
+        return generate(extract_scope(start_link, end_link, urdf)).find_frame_expression("fk");
+      }
+
     private:
+      class TreeExtraction
+      {
+        public:
+          KDL::SegmentMap::const_iterator root_;
+          const std::map<std::string, size_t>* num_children_;
+          ScopeSpec input_vars_, link_frames_;
+      };
+
+      static inline void extract_subtree(const KDL::SegmentMap::const_iterator& link, TreeExtraction& extraction)
+      {
+        std::string var_suffix = "_var";
+        std::string frame_suffix = "_frame";
+
+        const std::vector<KDL::SegmentMap::const_iterator>& children = link->second.children;
+        for (size_t i = 0; i < children.size(); ++i)
+        {
+          std::map<std::string, size_t>::const_iterator count = 
+              extraction.num_children_->find(children[i]->first);
+          if (count == extraction.num_children_->end())
+            continue;
+
+          const KDL::Segment& segment = children[i]->second.segment;
+          const KDL::Joint& joint = segment.getJoint();
+
+          std::vector<FrameSpecPtr> link_frame;
+          if (link != extraction.root_)
+            link_frame.push_back(frame_reference_spec(link->first + frame_suffix));
+
+          if (joint.getType() != KDL::Joint::None)
+          {
+            std::string var_name = joint.getName() + var_suffix;
+            DoubleInputSpecPtr input_var = make_spec<DoubleInputSpec>();
+            input_var->set_input_num(extraction.input_vars_.size());
+            extraction.input_vars_.push_back(scope_entry(var_name, input_var));
+
+            link_frame.push_back(get_joint_spec(joint, double_reference_spec(var_name)));
+          }
+
+          get_frame_tip_specs(segment, link_frame);
+
+          if (link_frame.empty())
+          {
+            link_frame.push_back(get_frame_spec(get_axis_angle_spec(KDL::Vector(1, 0, 0), get_double_spec(0)),
+                  get_vector3_spec(KDL::Vector::Zero())));
+          }
+
+          FrameSpecPtr frame = frame_multiplication_spec(link_frame);
+
+          // the frames of branch points are evaluated once for all their children
+          if (count->second > 1)
+          {
+            FrameCachedSpecPtr cached = make_spec<FrameCachedSpec>();
+            cached->set_frame(frame);
+            frame = cached;
+          }
+
+          extraction.link_frames_.push_back(scope_entry(children[i]->first + frame_suffix, frame));
+          extract_subtree(children[i], extraction);
+        }
+      }
+
+      static inline ScopeEntry scope_entry(const std::string& name, const SpecPtr& spec)
+      {
+        ScopeEntry entry;
+        entry.name = name;
+        entry.spec = spec;
+        return entry;
+      }
+
+      static inline DoubleReferenceSpecPtr double_reference_spec(const std::string& name)
+      {
+        DoubleReferenceSpecPtr spec = make_spec<DoubleReferenceSpec>();
+        spec->set_reference_name(name);
+        return spec;
+      }
+
+      static inline FrameReferenceSpecPtr frame_reference_spec(const std::string& name)
+      {
+        FrameReferenceSpecPtr spec = make_spec<FrameReferenceSpec>();
+        spec->set_reference_name(name);
+        return spec;
+      }
+
+      static inline FrameMultiplicationSpecPtr frame_multiplication_spec(std::vector<FrameSpecPtr>& inputs)
+      {
+        FrameMultiplicationSpecPtr spec = make_spec<FrameMultiplicationSpec>();
+        spec->swap_inputs(inputs);
+        return spec;
+      }
+
+      static inline VectorConstructorSpecPtr get_vector3_spec(const KDL::Vector& p)
+      {
+        VectorConstructorSpecPtr spec = make_spec<VectorConstructorSpec>();
+        spec->set_x(get_double_spec(p[0]));
+        spec->set_y(get_double_spec(p[1]));
+        spec->set_z(get_double_spec(p[2]));
+        return spec;
+      }
+
+      static inline DoubleConstSpecPtr get_double_spec(double value)
+      {
+        DoubleConstSpecPtr spec = make_spec<DoubleConstSpec>();
+        spec->set_value(value);
+        return spec;
+      }
+
+      static inline AxisAngleSpecPtr get_axis_angle_spec(const KDL::Vector& axis, const DoubleSpecPtr& angle)
+      {
+        AxisAngleSpecPtr spec = make_spec<AxisAngleSpec>();
+        spec->set_axis(get_vector3_spec(axis));
+        spec->set_angle(angle);
+        return spec;
+      }
+
+      static inline FrameConstructorSpecPtr get_frame_spec(const RotationSpecPtr& rotation, const VectorSpecPtr& translation)
+      {
+        FrameConstructorSpecPtr spec = make_spec<FrameConstructorSpec>();
+        spec->set_rotation(rotation);
+        spec->set_translation(translation);
+        return spec;
+      }
+
+      static inline FrameSpecPtr get_joint_spec(const KDL::Joint& joint, const DoubleSpecPtr& var)
+      {
+        if (joint.getType() == KDL::Joint::TransAxis)
+        {
+          VectorDoubleMultiplicationSpecPtr scale_vec = make_spec<VectorDoubleMultiplicationSpec>();
+          scale_vec->set_double(var);
+          scale_vec->set_vector(get_vector3_spec(joint.JointAxis()));
+
+          std::vector<VectorSpecPtr> inputs;
+          inputs.push_back(scale_vec);
+          inputs.push_back(get_vector3_spec(joint.JointOrigin()));
+          VectorAdditionSpecPtr translation = make_spec<VectorAdditionSpec>();
+          translation->swap_inputs(inputs);
+
+          return get_frame_spec(get_axis_angle_spec(KDL::Vector(1, 0, 0), get_double_spec(0)), translation);
+        }
+        else if (joint.getType() == KDL::Joint::RotAxis)
+        {
+          return get_frame_spec(get_axis_angle_spec(joint.JointAxis(), var), 
+              get_vector3_spec(joint.JointOrigin()));
+        }
+
+        throw std::domain_error("Extraction: joint '" + joint.getName() + "' is of non-supported type.");
+      }
+
+      static inline void get_frame_tip_specs(const KDL::Segment& seg, std::vector<FrameSpecPtr>& frames)
+      {
+        KDL::Frame frame = seg.getFrameToTip() * seg.getJoint().pose(0).Inverse();
+
+        // Set xyz
+        if(!KDL::Equal(frame.p, KDL::Vector::Zero()))
+        {
+          frames.push_back(get_frame_spec(get_axis_angle_spec(KDL::Vector(1, 0, 0), get_double_spec(0)),
+                get_vector3_spec(frame.p)));
+        }
+
+        // Set rpy
+        if(!KDL::Equal(frame.M, KDL::Rotation::Identity()))
+        {
+          std::vector<double> rpy(3);
+          frame.M.GetRPY(rpy[0],rpy[1],rpy[2]);
+          for (std::vector<double>::size_type i = rpy.size() - 1;
+                i != (std::vector<double>::size_type) -1; i--)
+          {
+            if(rpy[i] != 0)
+            {
+              KDL::Vector axis;
+              axis[i] = 1;
+              frames.push_back(get_frame_spec(get_axis_angle_spec(axis, get_double_spec(rpy[i])),
+                    get_vector3_spec(KDL::Vector::Zero())));
+            }
+          }
+        }
+      }
+
       static inline std::vector<YAML::Node> get_frame_tip_nodes(const KDL::Segment& seg)
       {
         std::vector<YAML::Node> frames;
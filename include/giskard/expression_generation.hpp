@@ -23,6 +23,7 @@
 
 #include <giskard/scope.hpp>
 #include <giskard/qp_controller.hpp>
+#include <giskard/fixed_size_qp_controller.hpp>
 #include <giskard/specifications.hpp>
 
 namespace giskard
@@ -34,32 +35,58 @@ namespace giskard
 
     for(size_t i=0; i<scope_spec.size(); ++i)
     {
-      std::string name = scope_spec[i].name;
-      giskard::SpecPtr spec = scope_spec[i].spec;
-
-      if(boost::dynamic_pointer_cast<giskard::DoubleSpec>(spec).get())
-        scope.add_double_expression(name,
-            boost::dynamic_pointer_cast<giskard::DoubleSpec>(spec)->get_expression(scope));
-      else if(boost::dynamic_pointer_cast<giskard::VectorSpec>(spec).get())
-        scope.add_vector_expression(name,
-            boost::dynamic_pointer_cast<giskard::VectorSpec>(spec)->get_expression(scope));
-      else if(boost::dynamic_pointer_cast<giskard::FrameSpec>(spec).get())
-        scope.add_frame_expression(name,
-            boost::dynamic_pointer_cast<giskard::FrameSpec>(spec)->get_expression(scope));
-      else if(boost::dynamic_pointer_cast<giskard::RotationSpec>(spec).get())
-        scope.add_rotation_expression(name,
-            boost::dynamic_pointer_cast<giskard::RotationSpec>(spec)->get_expression(scope));
-      else
-        throw std::domain_error("Scope generation: found entry of non-supported type. " + spec->to_string());
+      const std::string& name = scope_spec[i].name;
+      const giskard::SpecPtr& spec = scope_spec[i].spec;
+
+      switch(spec->get_category())
+      {
+        case giskard::DOUBLE_SPEC:
+          scope.add_double_expression(name,
+              boost::static_pointer_cast<giskard::DoubleSpec>(spec)->get_expression(scope));
+          break;
+        case giskard::VECTOR_SPEC:
+          scope.add_vector_expression(name,
+              boost::static_pointer_cast<giskard::VectorSpec>(spec)->get_expression(scope));
+          break;
+        case giskard::FRAME_SPEC:
+          scope.add_frame_expression(name,
+              boost::static_pointer_cast<giskard::FrameSpec>(spec)->get_expression(scope));
+          break;
+        case giskard::ROTATION_SPEC:
+          scope.add_rotation_expression(name,
+              boost::static_pointer_cast<giskard::RotationSpec>(spec)->get_expression(scope));
+          break;
+        default:
+          throw std::domain_error("Scope generation: found entry of non-supported type. " + spec->to_string());
+      }
     }
 
     return scope;
   }
 
-  inline giskard::QPController generate(const giskard::QPControllerSpec& spec)
+  // Only QPController supports priority levels; other controllers accept specs
+  // whose soft constraints all have priority 0.
+  template<typename ControllerType>
+  inline void set_soft_priorities(ControllerType&, const std::vector<size_t>& priorities)
+  {
+    for(size_t i=0; i<priorities.size(); ++i)
+      if(priorities[i] != 0)
+        throw std::invalid_argument("QPController generation: soft constraint at position " +
+            boost::lexical_cast<std::string>(i) + " has priority " +
+            boost::lexical_cast<std::string>(priorities[i]) + ", but the controller does not support priority levels.");
+  }
+
+  inline void set_soft_priorities(giskard::QPController& controller, const std::vector<size_t>& priorities)
   {
-    giskard::Scope scope = generate(spec.scope_);
+    controller.set_soft_priorities(priorities);
+  }
 
+  // Initializes controller with the constraints of spec, using the expressions
+  // from scope. Works for QPController and all FixedSizeQPController variants.
+  template<typename ControllerType>
+  inline void generate_controller(const giskard::QPControllerSpec& spec, const giskard::Scope& scope,
+      ControllerType& controller)
+  {
     // generate controllable constraints
     std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
         controllable_weight;
@@ -82,6 +109,7 @@ namespace giskard
     std::vector< KDL::Expression<double>::Ptr > soft_lower, soft_upper,
         soft_weight, soft_exp;
     std::vector< std::string> soft_name;
+    std::vector<size_t> soft_priority;
     for(size_t i=0; i<spec.soft_constraints_.size(); ++i)
     {
       soft_lower.push_back(spec.soft_constraints_[i].lower_->get_expression(scope));
@@ -89,6 +117,7 @@ namespace giskard
       soft_weight.push_back(spec.soft_constraints_[i].weight_->get_expression(scope));
       soft_exp.push_back(spec.soft_constraints_[i].expression_->get_expression(scope));
       soft_name.push_back(spec.soft_constraints_[i].name_);
+      soft_priority.push_back(spec.soft_constraints_[i].priority_);
     }
 
     // generate hard constraints
@@ -100,13 +129,52 @@ namespace giskard
       hard_exp.push_back(spec.hard_constraints_[i].expression_->get_expression(scope));
     }
 
-    giskard::QPController controller;
-   
     if(!(controller.init(controllable_lower, controllable_upper, controllable_weight,
                            controllable_name, soft_exp, soft_lower, soft_upper, 
                            soft_weight, soft_name, hard_exp, hard_lower, hard_upper)))
       throw std::runtime_error("QPController generation: Init of controller failed.");
 
+    set_soft_priorities(controller, soft_priority);
+  }
+
+  inline giskard::QPController generate(const giskard::QPControllerSpec& spec, const giskard::Scope& scope)
+  {
+    giskard::QPController controller;
+    generate_controller(spec, scope, controller);
+    return controller;
+  }
+
+  inline giskard::QPController generate(const giskard::QPControllerSpec& spec)
+  {
+    return generate(spec, generate(spec.scope_));
+  }
+
+  // Returns true if spec has exactly the dimensions of a fixed-size controller.
+  template<int NumControllables, int NumSoftConstraints, int NumHardConstraints>
+  inline bool has_fixed_size(const giskard::QPControllerSpec& spec)
+  {
+    return spec.controllable_constraints_.size() == NumControllables &&
+        spec.soft_constraints_.size() == NumSoftConstraints &&
+        spec.hard_constraints_.size() == NumHardConstraints;
+  }
+
+  // Generates a controller with compile-time QP dimensions, for specs whose sizes
+  // are known at build time. Throws std::invalid_argument if the sizes do not match.
+  template<int NumControllables, int NumSoftConstraints, int NumHardConstraints>
+  inline giskard::FixedSizeQPController<NumControllables, NumSoftConstraints, NumHardConstraints>
+      generate_fixed_size(const giskard::QPControllerSpec& spec)
+  {
+    if(!has_fixed_size<NumControllables, NumSoftConstraints, NumHardConstraints>(spec))
+      throw std::invalid_argument("QPController generation: Spec with " +
+          boost::lexical_cast<std::string>(spec.controllable_constraints_.size()) + " controllables, " +
+          boost::lexical_cast<std::string>(spec.soft_constraints_.size()) + " soft and " +
+          boost::lexical_cast<std::string>(spec.hard_constraints_.size()) + " hard constraints does not " +
+          "fit a fixed-size controller with " + boost::lexical_cast<std::string>(NumControllables) +
+          " controllables, " + boost::lexical_cast<std::string>(NumSoftConstraints) + " soft and " +
+          boost::lexical_cast<std::string>(NumHardConstraints) + " hard constraints.");
+
+    giskard::FixedSizeQPController<NumControllables, NumSoftConstraints, NumHardConstraints> controller;
+    generate_controller(spec, generate(spec.scope_), controller);
     return controller;
   }
 }
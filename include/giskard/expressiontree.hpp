@@ -23,5 +23,6 @@
 
 #include <kdl/expressiontree.hpp>
 #include <giskard/expression_arrays.hpp>
+#include <giskard/shared_expression.hpp>
 
 #endif // GISKARD_EXPRESSIONTREE_HPP
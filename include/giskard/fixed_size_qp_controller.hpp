@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_FIXED_SIZE_QP_CONTROLLER_HPP
+#define GISKARD_FIXED_SIZE_QP_CONTROLLER_HPP
+
+#include <giskard/expressiontree.hpp>
+#include <boost/array.hpp>
+#include <boost/lexical_cast.hpp>
+#include <qpOASES.hpp>
+
+namespace giskard
+{
+  // Variant of QPProblemBuilder for QPs whose dimensions are known at build time,
+  // e.g. when the controller specification is generated together with the code
+  // using it. All QP matrices are fixed-size Eigen members, i.e. they live inside
+  // the builder object without any heap allocations, and all copy loops have
+  // compile-time trip counts which the compiler can unroll. All expressions share
+  // one KDL::ExpressionOptimizer, so the inputs are set once per update.
+  template<int NumControllables, int NumSoftConstraints, int NumHardConstraints>
+  class FixedSizeQPProblemBuilder
+  {
+    public:
+      enum
+      {
+        NumWeights = NumControllables + NumSoftConstraints,
+        NumConstraints = NumSoftConstraints + NumHardConstraints,
+        // qpOASES expects row-major matrices, Eigen forbids row-major column vectors
+        MatrixOptions = (NumWeights == 1) ? Eigen::ColMajor : Eigen::RowMajor
+      };
+
+      typedef typename std::vector< KDL::Expression<double>::Ptr > DoubleExpressionVector;
+      typedef typename Eigen::Matrix<double, NumWeights, NumWeights, MatrixOptions> HessianMatrix;
+      typedef typename Eigen::Matrix<double, NumConstraints, NumWeights, MatrixOptions> ConstraintMatrix;
+      typedef typename Eigen::Matrix<double, NumWeights, 1> WeightVector;
+      typedef typename Eigen::Matrix<double, NumConstraints, 1> ConstraintVector;
+
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+      FixedSizeQPProblemBuilder() :
+        num_observables_(0) {}
+
+      void init(const DoubleExpressionVector& controllable_lower_bounds,
+          const DoubleExpressionVector& controllable_upper_bounds, const DoubleExpressionVector& controllable_weights,
+          const DoubleExpressionVector& soft_expressions, const DoubleExpressionVector& soft_lower_bounds,
+          const DoubleExpressionVector& soft_upper_bounds, const DoubleExpressionVector& soft_weights,
+          const DoubleExpressionVector& hard_expressions, const DoubleExpressionVector& hard_lower_bounds,
+          const DoubleExpressionVector& hard_upper_bounds)
+      {
+        copy_expressions(controllable_lower_bounds, controllable_lower_bounds_, "controllable lower bounds");
+        copy_expressions(controllable_upper_bounds, controllable_upper_bounds_, "controllable upper bounds");
+        copy_expressions(controllable_weights, controllable_weights_, "controllable weights");
+        copy_expressions(soft_expressions, soft_expressions_, "soft expressions");
+        copy_expressions(soft_lower_bounds, soft_lower_bounds_, "soft lower bounds");
+        copy_expressions(soft_upper_bounds, soft_upper_bounds_, "soft upper bounds");
+        copy_expressions(soft_weights, soft_weights_, "soft weights");
+        copy_expressions(hard_expressions, hard_expressions_, "hard expressions");
+        copy_expressions(hard_lower_bounds, hard_lower_bounds_, "hard lower bounds");
+        copy_expressions(hard_upper_bounds, hard_upper_bounds_, "hard upper bounds");
+
+        prepare_optimizer();
+        create_output_matrices();
+      }
+
+      // observables needs to hold at least num_observables() values. Accepts any
+      // contiguous vector, e.g. an Eigen::Map of a raw pointer.
+      void update(const Eigen::Ref<const Eigen::VectorXd>& observables)
+      {
+        if(observables.rows() < num_observables_)
+          throw std::invalid_argument("Received " + boost::lexical_cast<std::string>(observables.rows()) +
+              " observables, but the QP uses " + boost::lexical_cast<std::string>(num_observables_) + ".");
+
+        inputs_ = observables.head(num_observables_);
+        optimizer_.setInputValues(inputs_);
+        copy_values();
+      }
+
+      const HessianMatrix& get_H() const
+      {
+        return H_;
+      }
+
+      const ConstraintMatrix& get_A() const
+      {
+        return A_;
+      }
+
+      const WeightVector& get_g() const
+      {
+        return g_;
+      }
+
+      const WeightVector& get_lb() const
+      {
+        return lb_;
+      }
+
+      const WeightVector& get_ub() const
+      {
+        return ub_;
+      }
+
+      const ConstraintVector& get_lbA() const
+      {
+        return lbA_;
+      }
+
+      const ConstraintVector& get_ubA() const
+      {
+        return ubA_;
+      }
+
+      size_t num_controllables() const
+      {
+        return NumControllables;
+      }
+
+      size_t num_soft_constraints() const
+      {
+        return NumSoftConstraints;
+      }
+
+      size_t num_hard_constraints() const
+      {
+        return NumHardConstraints;
+      }
+
+      size_t num_constraints() const
+      {
+        return NumConstraints;
+      }
+
+      size_t num_weights() const
+      {
+        return NumWeights;
+      }
+
+      size_t num_observables() const
+      {
+        return num_observables_;
+      }
+
+    private:
+      boost::array< KDL::Expression<double>::Ptr, NumControllables > controllable_lower_bounds_,
+          controllable_upper_bounds_, controllable_weights_;
+      boost::array< KDL::Expression<double>::Ptr, NumSoftConstraints > soft_expressions_,
+          soft_lower_bounds_, soft_upper_bounds_, soft_weights_;
+      boost::array< KDL::Expression<double>::Ptr, NumHardConstraints > hard_expressions_,
+          hard_lower_bounds_, hard_upper_bounds_;
+      // number of columns of A which each constraint expression contributes to
+      boost::array< int, NumConstraints > num_columns_;
+      int num_observables_;
+      KDL::ExpressionOptimizer optimizer_;
+      // input values handed to the optimizer, allocated once
+      Eigen::VectorXd inputs_;
+
+      HessianMatrix H_;
+      ConstraintMatrix A_;
+      WeightVector g_, lb_, ub_;
+      ConstraintVector lbA_, ubA_;
+
+      template<size_t N>
+      void copy_expressions(const DoubleExpressionVector& expressions,
+          boost::array< KDL::Expression<double>::Ptr, N >& target, const std::string& name)
+      {
+        if(expressions.size() != N)
+          throw std::invalid_argument("Fixed-size QP expects " + boost::lexical_cast<std::string>(N) +
+              " " + name + ", but received " + boost::lexical_cast<std::string>(expressions.size()) + ".");
+
+        for(size_t i=0; i<N; ++i)
+        {
+          if(!expressions[i].get())
+            throw std::invalid_argument("Fixed-size QP received null pointer for " + name + ".");
+          target[i] = expressions[i];
+        }
+      }
+
+      template<size_t N>
+      void add_to_optimizer(const boost::array< KDL::Expression<double>::Ptr, N >& expressions)
+      {
+        for(size_t i=0; i<N; ++i)
+          expressions[i]->addToOptimizer(optimizer_);
+      }
+
+      template<size_t N>
+      int max_num_inputs(const boost::array< KDL::Expression<double>::Ptr, N >& expressions) const
+      {
+        int result = 0;
+        for(size_t i=0; i<N; ++i)
+          result = std::max(result, expressions[i]->number_of_derivatives());
+        return result;
+      }
+
+      void prepare_optimizer()
+      {
+        num_observables_ = std::max(
+            std::max(std::max(max_num_inputs(controllable_lower_bounds_), max_num_inputs(controllable_upper_bounds_)),
+                     std::max(max_num_inputs(controllable_weights_), max_num_inputs(soft_expressions_))),
+            std::max(std::max(max_num_inputs(soft_lower_bounds_), max_num_inputs(soft_upper_bounds_)),
+                     std::max(std::max(max_num_inputs(soft_weights_), max_num_inputs(hard_expressions_)),
+                              std::max(max_num_inputs(hard_lower_bounds_), max_num_inputs(hard_upper_bounds_)))));
+
+        std::vector<int> inputs;
+        for(int i=0; i<num_observables_; ++i)
+          inputs.push_back(i);
+        optimizer_.prepare(inputs);
+        inputs_ = Eigen::VectorXd::Zero(num_observables_);
+
+        add_to_optimizer(controllable_lower_bounds_);
+        add_to_optimizer(controllable_upper_bounds_);
+        add_to_optimizer(controllable_weights_);
+        add_to_optimizer(soft_expressions_);
+        add_to_optimizer(soft_lower_bounds_);
+        add_to_optimizer(soft_upper_bounds_);
+        add_to_optimizer(soft_weights_);
+        add_to_optimizer(hard_expressions_);
+        add_to_optimizer(hard_lower_bounds_);
+        add_to_optimizer(hard_upper_bounds_);
+
+        for(size_t i=0; i<NumHardConstraints; ++i)
+          num_columns_[i] = std::min(hard_expressions_[i]->number_of_derivatives(), NumControllables);
+        for(size_t i=0; i<NumSoftConstraints; ++i)
+          num_columns_[NumHardConstraints + i] =
+              std::min(soft_expressions_[i]->number_of_derivatives(), NumControllables);
+      }
+
+      void create_output_matrices()
+      {
+        H_.setZero();
+        A_.setZero();
+        for(size_t i=0; i<NumSoftConstraints; ++i)
+          A_(NumHardConstraints + i, NumControllables + i) = 1.0;
+        g_.setZero();
+        lb_.setZero();
+        ub_.setZero();
+        for(size_t i=0; i<NumSoftConstraints; ++i)
+        {
+          lb_(NumControllables + i) = -1e+9;
+          ub_(NumControllables + i) = 1e+9;
+        }
+        lbA_.setZero();
+        ubA_.setZero();
+      }
+
+      void copy_values()
+      {
+        for(size_t i=0; i<NumControllables; ++i)
+        {
+          H_(i, i) = controllable_weights_[i]->value();
+          lb_(i) = controllable_lower_bounds_[i]->value();
+          ub_(i) = controllable_upper_bounds_[i]->value();
+        }
+
+        for(size_t i=0; i<NumHardConstraints; ++i)
+        {
+          copy_row(hard_expressions_[i], i);
+          lbA_(i) = hard_lower_bounds_[i]->value();
+          ubA_(i) = hard_upper_bounds_[i]->value();
+        }
+
+        for(size_t i=0; i<NumSoftConstraints; ++i)
+        {
+          H_(NumControllables + i, NumControllables + i) = soft_weights_[i]->value();
+          copy_row(soft_expressions_[i], NumHardConstraints + i);
+          lbA_(NumHardConstraints + i) = soft_lower_bounds_[i]->value();
+          ubA_(NumHardConstraints + i) = soft_upper_bounds_[i]->value();
+        }
+      }
+
+      // value() has to be called before derivative() to update the expression
+      void copy_row(const KDL::Expression<double>::Ptr& expression, size_t row)
+      {
+        expression->value();
+        for(int j=0; j<num_columns_[row]; ++j)
+          A_(row, j) = expression->derivative(j);
+      }
+  };
+
+  // Variant of QPController for QPs whose dimensions are known at build time, see
+  // FixedSizeQPProblemBuilder. Commands and slacks are fixed-size vectors, and the
+  // QP is always solved with qpOASES.
+  template<int NumControllables, int NumSoftConstraints, int NumHardConstraints>
+  class FixedSizeQPController
+  {
+    public:
+      typedef FixedSizeQPProblemBuilder<NumControllables, NumSoftConstraints, NumHardConstraints> Builder;
+      typedef typename Builder::DoubleExpressionVector DoubleExpressionVector;
+      typedef typename std::vector< std::string> StringVector;
+      typedef typename Eigen::Matrix<double, NumControllables, 1> CommandVector;
+      typedef typename Eigen::Matrix<double, NumSoftConstraints, 1> SlackVector;
+
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+      FixedSizeQPController() :
+        problem_(Builder::NumWeights, Builder::NumConstraints)
+      {
+        qpOASES::Options options;
+        options.setToMPC();
+        options.printLevel = qpOASES::PL_NONE;
+        problem_.setOptions(options);
+        xdot_full_.setZero();
+      }
+
+      bool init(const DoubleExpressionVector& controllable_lower_bounds,
+          const DoubleExpressionVector& controllable_upper_bounds, const DoubleExpressionVector& controllable_weights,
+          const StringVector& controllable_names, const DoubleExpressionVector& soft_expressions,
+          const DoubleExpressionVector& soft_lower_bounds, const DoubleExpressionVector& soft_upper_bounds,
+          const DoubleExpressionVector& soft_weights, const StringVector& soft_names,
+          const DoubleExpressionVector& hard_expressions, const DoubleExpressionVector& hard_lower_bounds,
+          const DoubleExpressionVector& hard_upper_bounds)
+      {
+        qp_builder_.init(controllable_lower_bounds, controllable_upper_bounds,
+            controllable_weights, soft_expressions, soft_lower_bounds,
+            soft_upper_bounds, soft_weights, hard_expressions,
+            hard_lower_bounds, hard_upper_bounds);
+
+        if( controllable_names.size() != NumControllables )
+          throw std::runtime_error("Received " + boost::lexical_cast<std::string>(controllable_names.size()) + 
+              " controllable names, but " + boost::lexical_cast<std::string>(NumControllables) + 
+              " controllables were specified.");
+        controllable_names_ = controllable_names;
+
+        if( soft_names.size() != NumSoftConstraints )
+          throw std::runtime_error("Received " + boost::lexical_cast<std::string>(soft_names.size()) + 
+              " soft constraint names, but " + boost::lexical_cast<std::string>(NumSoftConstraints) + 
+              " soft constraints were specified.");
+        soft_constraint_names_ = soft_names;
+
+        return true;
+      }
+
+      bool start(const Eigen::Ref<const Eigen::VectorXd>& observables, int nWSR)
+      {
+        qp_builder_.update(observables);
+
+        qpOASES::returnValue return_value = problem_.init(qp_builder_.get_H().data(),
+            qp_builder_.get_g().data(), qp_builder_.get_A().data(), qp_builder_.get_lb().data(),
+            qp_builder_.get_ub().data(), qp_builder_.get_lbA().data(), qp_builder_.get_ubA().data(), nWSR);
+        if(return_value != qpOASES::SUCCESSFUL_RETURN)
+        {
+          std::cout << "Init of fixed-size QP-Problem returned without success! ERROR MESSAGE: " << 
+            qpOASES::MessageHandling::getErrorCodeMessage(return_value) << std::endl;
+          return false;
+        }
+
+        read_solution();
+        return true;
+      }
+
+      bool update(const Eigen::Ref<const Eigen::VectorXd>& observables, int nWSR)
+      {
+        qp_builder_.update(observables);
+
+        qpOASES::returnValue return_value = problem_.hotstart(qp_builder_.get_H().data(),
+            qp_builder_.get_g().data(), qp_builder_.get_A().data(), qp_builder_.get_lb().data(),
+            qp_builder_.get_ub().data(), qp_builder_.get_lbA().data(), qp_builder_.get_ubA().data(), nWSR);
+        if(return_value != qpOASES::SUCCESSFUL_RETURN)
+          return false;
+
+        read_solution();
+        return true;
+      }
+
+      const CommandVector& get_command() const
+      {
+        return xdot_control_;
+      }
+
+      const SlackVector& get_slack() const
+      {
+        return xdot_slack_;
+      }
+
+      const Builder& get_qp_builder() const
+      {
+        return qp_builder_;
+      }
+
+      const std::vector<std::string>& get_controllable_names() const
+      {
+        return controllable_names_;
+      }
+
+      const std::vector<std::string>& get_soft_constraint_names() const
+      {
+        return soft_constraint_names_;
+      }
+
+    private:
+      Builder qp_builder_;
+      qpOASES::SQProblem problem_;
+      typename Builder::WeightVector xdot_full_;
+      CommandVector xdot_control_;
+      SlackVector xdot_slack_;
+      std::vector<std::string> controllable_names_, soft_constraint_names_;
+
+      void read_solution()
+      {
+        problem_.getPrimalSolution(xdot_full_.data());
+        xdot_control_ = xdot_full_.template head<NumControllables>();
+        xdot_slack_ = xdot_full_.template tail<NumSoftConstraints>();
+      }
+  };
+}
+
+#endif // GISKARD_FIXED_SIZE_QP_CONTROLLER_HPP
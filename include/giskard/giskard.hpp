@@ -21,14 +21,39 @@
 #ifndef GISKARD_GISKARD_HPP
 #define GISKARD_GISKARD_HPP
 
+#include <giskard/async_qp_controller.hpp>
+#include <giskard/constraint_profiler.hpp>
+#include <giskard/controller_cache.hpp>
+#include <giskard/controller_pool.hpp>
+#include <giskard/cost_model.hpp>
+#include <giskard/cycle_recorder.hpp>
+#include <giskard/diagonal_qp_solver.hpp>
 #include <giskard/exceptions.hpp>
 #include <giskard/expression_generation.hpp>
 #include <giskard/expression_extraction.hpp>
 #include <giskard/expressiontree.hpp>
+#include <giskard/fixed_size_qp_controller.hpp>
+#include <giskard/horizon_qp_controller.hpp>
+#include <giskard/observable_binding.hpp>
+#include <giskard/parallel_generation.hpp>
+#include <giskard/qp_cascade.hpp>
 #include <giskard/qp_controller.hpp>
 #include <giskard/qp_problem_builder.hpp>
+#include <giskard/qp_solver.hpp>
+#include <giskard/qp_working_set.hpp>
+#include <giskard/qpoases_solver.hpp>
+#include <giskard/riccati_qp_solver.hpp>
+#include <giskard/ring_buffer.hpp>
+#include <giskard/rollout.hpp>
 #include <giskard/scope.hpp>
+#include <giskard/spec_arena.hpp>
+#include <giskard/spec_dependencies.hpp>
+#include <giskard/spec_folding.hpp>
+#include <giskard/spec_generator.hpp>
+#include <giskard/spec_serialization.hpp>
 #include <giskard/specifications.hpp>
+#include <giskard/thread_affinity.hpp>
+#include <giskard/triple_buffer.hpp>
 #include <giskard/yaml_parser.hpp>
 
 #endif // GISKARD_GISKARD_HPP
@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef GISKARD_HORIZON_QP_CONTROLLER_HPP
+#define GISKARD_HORIZON_QP_CONTROLLER_HPP
+
+#include <giskard/expression_generation.hpp>
+#include <giskard/riccati_qp_solver.hpp>
+
+namespace giskard
+{
+  class HorizonOptions
+  {
+    public:
+      HorizonOptions() :
+        num_stages_(10), dt_(1.0), max_iterations_(100), tolerance_(1e-8) {}
+
+      size_t num_stages_;
+      // duration of one stage, the command of every stage is a velocity
+      double dt_;
+      size_t max_iterations_;
+      // relative to the scale of the bounds, see RiccatiQPSolver::set_tolerance()
+      double tolerance_;
+  };
+
+  // Receding-horizon variant of QPController. Every cycle plans the velocities
+  // of num_stages_ stages of single-integrator dynamics, i.e. the controllables
+  // move by dt_ times the command of a stage while all other observables stay
+  // constant, see Rollout. Only the command of the first stage is meant to be
+  // executed.
+  //
+  // All constraints of the controller hold at every stage. Their expressions get
+  // evaluated once per stage at the predicted controllables, and the bounds are
+  // linearized in the controllables around that prediction. The prediction is
+  // the current state in start(), and the plan of the previous cycle shifted by
+  // one stage in update(). The stages of the resulting QP stay separate blocks,
+  // which RiccatiQPSolver solves in time linear in the number of stages.
+  //
+  // Stage k has the inputs [velocities; slacks] and the inequalities, in order:
+  // lower and upper bounds of the controllables, lower and upper bounds of the
+  // hard constraints, lower and upper bounds of the soft constraints.
+  class HorizonQPController
+  {
+    public:
+      typedef typename std::vector< KDL::Expression<double>::Ptr > DoubleExpressionVector;
+      typedef typename std::vector< std::string> StringVector;
+
+      HorizonQPController() :
+        num_observables_(0) {}
+
+      // Same arguments as QPController::init(), i.e. generate_controller() works
+      // for this controller, too.
+      bool init(const DoubleExpressionVector& controllable_lower_bounds,
+          const DoubleExpressionVector& controllable_upper_bounds, const DoubleExpressionVector& controllable_weights,
+          const StringVector& controllable_names, const DoubleExpressionVector& soft_expressions,
+          const DoubleExpressionVector& soft_lower_bounds, const DoubleExpressionVector& soft_upper_bounds,
+          const DoubleExpressionVector& soft_weights, const StringVector& soft_names,
+          const DoubleExpressionVector& hard_expressions, const DoubleExpressionVector& hard_lower_bounds,
+          const DoubleExpressionVector& hard_upper_bounds)
+      {
+        controllable_lower_bounds_.set_expressions(controllable_lower_bounds);
+        controllable_upper_bounds_.set_expressions(controllable_upper_bounds);
+        controllable_weights_.set_expressions(controllable_weights);
+        soft_expressions_.set_expressions(soft_expressions);
+        soft_lower_bounds_.set_expressions(soft_lower_bounds);
+        soft_upper_bounds_.set_expressions(soft_upper_bounds);
+        soft_weights_.set_expressions(soft_weights);
+        hard_expressions_.set_expressions(hard_expressions);
+        hard_lower_bounds_.set_expressions(hard_lower_bounds);
+        hard_upper_bounds_.set_expressions(hard_upper_bounds);
+
+        if(controllable_lower_bounds.size() != num_controllables() ||
+           controllable_upper_bounds.size() != num_controllables() ||
+           soft_lower_bounds.size() != num_soft_constraints() ||
+           soft_upper_bounds.size() != num_soft_constraints() ||
+           soft_weights.size() != num_soft_constraints() ||
+           hard_lower_bounds.size() != num_hard_constraints() ||
+           hard_upper_bounds.size() != num_hard_constraints())
+          throw std::invalid_argument("HorizonQPController: numbers of expressions and bounds do not match.");
+
+        if( controllable_names.size() != num_controllables() )
+          throw std::runtime_error("Received " + boost::lexical_cast<std::string>(controllable_names.size()) +
+              " controllable names, but " + boost::lexical_cast<std::string>(num_controllables()) +
+              " controllables were specified.");
+        controllable_names_ = controllable_names;
+
+        if( soft_names.size() != num_soft_constraints() )
+          throw std::runtime_error("Received " + boost::lexical_cast<std::string>(soft_names.size()) +
+              " soft constraint names, but " + boost::lexical_cast<std::string>(num_soft_constraints()) +
+              " soft constraints were specified.");
+        soft_constraint_names_ = soft_names;
+
+        KDL::DoubleExpressionArray* arrays[] = {&controllable_lower_bounds_, &controllable_upper_bounds_,
+            &controllable_weights_, &soft_expressions_, &soft_lower_bounds_, &soft_upper_bounds_,
+            &soft_weights_, &hard_expressions_, &hard_lower_bounds_, &hard_upper_bounds_};
+        optimizer_.clear();
+        for(size_t i=0; i<10; ++i)
+          optimizer_.add(arrays[i]->get_expressions());
+        optimizer_.prepare();
+        num_observables_ = std::max(num_controllables(), optimizer_.num_inputs());
+
+        prepare_stages();
+        return true;
+      }
+
+      const HorizonOptions& get_options() const
+      {
+        return options_;
+      }
+
+      // Throws std::invalid_argument for an empty horizon or a non-positive dt_.
+      void set_options(const HorizonOptions& options)
+      {
+        if(options.num_stages_ == 0)
+          throw std::invalid_argument("HorizonQPController: horizon needs at least one stage.");
+        if(!(options.dt_ > 0.0))
+          throw std::invalid_argument("HorizonQPController: dt_ has to be positive.");
+
+        options_ = options;
+        solver_.set_max_iterations(options_.max_iterations_);
+        solver_.set_tolerance(options_.tolerance_);
+        prepare_stages();
+      }
+
+      // Plans from scratch, predicting that the controllables stay at their current value.
+      bool start(const Eigen::Ref<const Eigen::VectorXd>& observables)
+      {
+        check_num_observables(observables.rows());
+        predictions_.setZero(num_controllables(), options_.num_stages_);
+        return plan(observables);
+      }
+
+      // Plans around the plan of the previous cycle. Falls back to start() if
+      // the previous cycle failed.
+      bool update(const Eigen::Ref<const Eigen::VectorXd>& observables)
+      {
+        if(solver_.get_status() != QP_SOLVED || solver_.num_stages() != options_.num_stages_)
+          return start(observables);
+
+        check_num_observables(observables.rows());
+        shift_plan();
+        return plan(observables);
+      }
+
+      // velocities of the first stage
+      const Eigen::VectorXd& get_command() const
+      {
+        return xdot_control_;
+      }
+
+      Eigen::VectorXd get_stage_command(size_t stage) const
+      {
+        return solver_.get_inputs(stage).head(num_controllables());
+      }
+
+      Eigen::VectorXd get_stage_slack(size_t stage) const
+      {
+        return solver_.get_inputs(stage).tail(num_soft_constraints());
+      }
+
+      // Controllables predicted at the beginning of stage, relative to their
+      // values at the beginning of the cycle; stage == num_stages_ is the end
+      // of the horizon.
+      const Eigen::VectorXd& get_predicted_displacement(size_t stage) const
+      {
+        return solver_.get_state(stage);
+      }
+
+      const RiccatiQPSolver& get_solver() const
+      {
+        return solver_;
+      }
+
+      const std::vector<HorizonStage>& get_stages() const
+      {
+        return stages_;
+      }
+
+      const QPCycleTimings& get_cycle_timings() const
+      {
+        return cycle_timings_;
+      }
+
+      const std::vector<std::string>& get_controllable_names() const
+      {
+        return controllable_names_;
+      }
+
+      const std::vector<std::string>& get_soft_constraint_names() const
+      {
+        return soft_constraint_names_;
+      }
+
+      size_t num_controllables() const
+      {
+        return controllable_weights_.num_expressions();
+      }
+
+      size_t num_soft_constraints() const
+      {
+        return soft_expressions_.num_expressions();
+      }
+
+      size_t num_hard_constraints() const
+      {
+        return hard_expressions_.num_expressions();
+      }
+
+      size_t num_observables() const
+      {
+        return num_observables_;
+      }
+
+    private:
+      KDL::DoubleExpressionArray controllable_lower_bounds_, controllable_upper_bounds_,
+         controllable_weights_, soft_expressions_, soft_lower_bounds_, soft_upper_bounds_,
+         soft_weights_, hard_expressions_, hard_lower_bounds_, hard_upper_bounds_;
+      // evaluates all arrays at once, see KDL::ExpressionArrayOptimizer
+      KDL::ExpressionArrayOptimizer optimizer_;
+      StringVector controllable_names_, soft_constraint_names_;
+      size_t num_observables_;
+
+      HorizonOptions options_;
+      std::vector<HorizonStage> stages_;
+      Eigen::MatrixXd B_;
+      RiccatiQPSolver solver_;
+
+      // one column per stage: controllables around which the stage is linearized,
+      // relative to the current state
+      Eigen::MatrixXd predictions_;
+      Eigen::VectorXd stage_observables_, xdot_control_;
+
+      QPCycleTimings cycle_timings_;
+      Stopwatch cycle_stopwatch_;
+
+      void check_num_observables(size_t num_observables) const
+      {
+        if(num_observables < num_observables_)
+          throw std::invalid_argument("HorizonQPController needs " +
+              boost::lexical_cast<std::string>(num_observables_) + " observables, but received " +
+              boost::lexical_cast<std::string>(num_observables) + ".");
+      }
+
+      size_t num_inputs() const
+      {
+        return num_controllables() + num_soft_constraints();
+      }
+
+      size_t num_inequalities() const
+      {
+        return 2 * (num_controllables() + num_hard_constraints() + num_soft_constraints());
+      }
+
+      // Sets up the parts of the stages that do not depend on the observables.
+      void prepare_stages()
+      {
+        size_t n = num_controllables(), nh = num_hard_constraints(), ns = num_soft_constraints();
+
+        B_ = Eigen::MatrixXd::Zero(n, num_inputs());
+        B_.leftCols(n).diagonal().setConstant(options_.dt_);
+
+        stages_.resize(options_.num_stages_);
+        for(size_t k=0; k<stages_.size(); ++k)
+        {
+          HorizonStage& stage = stages_[k];
+          stage.r_ = Eigen::VectorXd::Zero(num_inputs());
+          stage.d_ = Eigen::VectorXd::Zero(num_inequalities());
+          stage.C_ = Eigen::MatrixXd::Zero(num_inequalities(), n);
+          stage.D_ = Eigen::MatrixXd::Zero(num_inequalities(), num_inputs());
+
+          stage.D_.block(0, 0, n, n).diagonal().setConstant(-1.0);
+          stage.D_.block(n, 0, n, n).diagonal().setConstant(1.0);
+          size_t soft = 2 * (n + nh);
+          stage.D_.block(soft, n, ns, ns).diagonal().setConstant(-1.0);
+          stage.D_.block(soft + ns, n, ns, ns).diagonal().setConstant(1.0);
+        }
+      }
+
+      // Moves the plan of the last cycle one stage ahead, anchored at the
+      // current state, and repeats the prediction of its final state.
+      void shift_plan()
+      {
+        const Eigen::VectorXd& anchor = solver_.get_state(1);
+        for(size_t k=0; k<options_.num_stages_; ++k)
+          predictions_.col(k) = solver_.get_state(std::min(k + 1, options_.num_stages_)) - anchor;
+      }
+
+      bool plan(const Eigen::Ref<const Eigen::VectorXd>& observables)
+      {
+        cycle_stopwatch_.restart();
+        stage_observables_ = observables;
+        for(size_t k=0; k<stages_.size(); ++k)
+        {
+          stage_observables_.head(num_controllables()) =
+              observables.head(num_controllables()) + predictions_.col(k);
+          evaluate_stage(stages_[k], predictions_.col(k));
+        }
+        cycle_timings_.evaluation_seconds_ = cycle_stopwatch_.get_elapsed_seconds();
+
+        cycle_stopwatch_.restart();
+        bool success = solver_.solve(stages_, B_);
+        cycle_timings_.solve_seconds_ = cycle_stopwatch_.get_elapsed_seconds();
+
+        if(success)
+          xdot_control_ = get_stage_command(0);
+        return success;
+      }
+
+      // Evaluates all expressions at stage_observables_ and writes the stage,
+      // with bounds linearized around the predicted displacement.
+      void evaluate_stage(HorizonStage& stage, const Eigen::VectorXd& prediction)
+      {
+        size_t n = num_controllables(), nh = num_hard_constraints(), ns = num_soft_constraints();
+
+        KDL::DoubleExpressionArray* arrays[] = {&controllable_lower_bounds_, &controllable_upper_bounds_,
+            &controllable_weights_, &soft_expressions_, &soft_lower_bounds_, &soft_upper_bounds_,
+            &soft_weights_, &hard_expressions_, &hard_lower_bounds_, &hard_upper_bounds_};
+        optimizer_.set_inputs(stage_observables_);
+        for(size_t i=0; i<10; ++i)
+          arrays[i]->read();
+
+        stage.r_.head(n) = controllable_weights_.get_values();
+        stage.r_.tail(ns) = soft_weights_.get_values();
+
+        // lower <= value written as -value + C x <= -lower + C prediction
+        write_rows(stage, 0, controllable_lower_bounds_, -1.0);
+        write_rows(stage, n, controllable_upper_bounds_, 1.0);
+        write_rows(stage, 2 * n, hard_lower_bounds_, -1.0);
+        write_rows(stage, 2 * n + nh, hard_upper_bounds_, 1.0);
+        write_rows(stage, 2 * (n + nh), soft_lower_bounds_, -1.0);
+        write_rows(stage, 2 * (n + nh) + ns, soft_upper_bounds_, 1.0);
+        stage.d_ += stage.C_ * prediction;
+
+        write_jacobian(stage.D_.block(2 * n, 0, nh, n), hard_expressions_, -1.0);
+        write_jacobian(stage.D_.block(2 * n + nh, 0, nh, n), hard_expressions_, 1.0);
+        write_jacobian(stage.D_.block(2 * (n + nh), 0, ns, n), soft_expressions_, -1.0);
+        write_jacobian(stage.D_.block(2 * (n + nh) + ns, 0, ns, n), soft_expressions_, 1.0);
+      }
+
+      // Writes the rows of the inequalities sign * value <= sign * bound(x).
+      void write_rows(HorizonStage& stage, size_t offset, const KDL::DoubleExpressionArray& bounds, double sign)
+      {
+        stage.d_.segment(offset, bounds.num_expressions()) = sign * bounds.get_values();
+        write_jacobian(stage.C_.block(offset, 0, bounds.num_expressions(), num_controllables()), bounds, -sign);
+      }
+
+      // Writes sign times the derivatives of array with respect to the controllables.
+      template<typename Derived>
+      static void write_jacobian(const Eigen::MatrixBase<Derived>& target,
+          const KDL::DoubleExpressionArray& array, double sign)
+      {
+        Eigen::MatrixBase<Derived>& result = const_cast< Eigen::MatrixBase<Derived>& >(target);
+        size_t cols = std::min<size_t>(result.cols(), array.get_derivatives().cols());
+        result.setZero();
+        result.leftCols(cols) = sign * array.get_derivatives().leftCols(cols);
+      }
+  };
+
+  inline HorizonQPController generate_horizon(const QPControllerSpec& spec, const HorizonOptions& options)
+  {
+    HorizonQPController controller;
+    controller.set_options(options);
+    generate_controller(spec, generate(spec.scope_), controller);
+    return controller;
+  }
+}
+
+#endif // GISKARD_HORIZON_QP_CONTROLLER_HPP
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_OBSERVABLE_BINDING_HPP
+#define GISKARD_OBSERVABLE_BINDING_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
+
+namespace giskard
+{
+  // Maps the observables of a controller onto a caller-owned buffer with its own
+  // layout, e.g. the joint state array of a middleware. The names are resolved
+  // once on construction; afterwards, each update gathers the observables
+  // straight from the buffer without permuting them into a vector first.
+  class ObservableBinding
+  {
+    public:
+      ObservableBinding() :
+        num_sources_(0) {}
+
+      // observable_names[i] names input i of the controller; source_names[j] names
+      // element j of the buffer. Each observable name has to appear in source_names.
+      ObservableBinding(const std::vector<std::string>& observable_names,
+          const std::vector<std::string>& source_names) :
+        observable_names_(observable_names), num_sources_(source_names.size())
+      {
+        std::map<std::string, size_t> source_indices;
+        for(size_t i=0; i<source_names.size(); ++i)
+          if(!source_indices.insert(std::make_pair(source_names[i], i)).second)
+            throw std::invalid_argument("Observable binding: source name '" + source_names[i] +
+                "' appears more than once.");
+
+        for(size_t i=0; i<observable_names.size(); ++i)
+        {
+          std::map<std::string, size_t>::const_iterator it = source_indices.find(observable_names[i]);
+          if(it == source_indices.end())
+            throw std::invalid_argument("Observable binding: could not find observable '" +
+                observable_names[i] + "' among the " + boost::lexical_cast<std::string>(num_sources_) +
+                " source names.");
+          indices_.push_back(it->second);
+        }
+      }
+
+      size_t num_observables() const
+      {
+        return indices_.size();
+      }
+
+      // number of elements the bound buffer needs to hold
+      size_t num_sources() const
+      {
+        return num_sources_;
+      }
+
+      // observable i is read from element get_indices()[i] of the buffer
+      const std::vector<size_t>& get_indices() const
+      {
+        return indices_;
+      }
+
+      const std::vector<std::string>& get_observable_names() const
+      {
+        return observable_names_;
+      }
+
+    private:
+      std::vector<std::string> observable_names_;
+      std::vector<size_t> indices_;
+      size_t num_sources_;
+  };
+}
+
+#endif // GISKARD_OBSERVABLE_BINDING_HPP
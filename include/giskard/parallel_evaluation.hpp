@@ -0,0 +1,507 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_PARALLEL_EVALUATION_HPP
+#define GISKARD_PARALLEL_EVALUATION_HPP
+
+#include <set>
+#include <limits>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/chrono.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <giskard/expression_arrays.hpp>
+
+namespace giskard
+{
+  // Output matrices of a QP, as laid out by QPProblemBuilder.
+  class QPMatrices
+  {
+    public:
+      typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> Matrix;
+      typedef Eigen::VectorXd Vector;
+
+      QPMatrices(Matrix& H, Matrix& A, Vector& lb, Vector& ub, Vector& lbA, Vector& ubA) :
+        H_(&H), A_(&A), lb_(&lb), ub_(&ub), lbA_(&lbA), ubA_(&ubA) {}
+
+      Matrix* H_;
+      Matrix* A_;
+      Vector *lb_, *ub_, *lbA_, *ubA_;
+  };
+
+  // Deep copies of the expressions of some controllables, soft and hard
+  // constraints of a QP, i.e. of some of its rows. A partition writes only the
+  // rows of the QP matrices it owns, so several partitions can be evaluated
+  // concurrently. All expressions of a partition are copied with one memo and
+  // evaluated by one optimizer, so nodes shared between its rows, e.g. cached
+  // frames, are copied and computed only once per partition.
+  class QPPartition
+  {
+    public:
+      typedef std::vector< KDL::Expression<double>::Ptr > DoubleExpressionVector;
+
+      QPPartition(const std::vector<size_t>& controllables, const std::vector<size_t>& soft_constraints,
+          const std::vector<size_t>& hard_constraints, size_t num_controllables, size_t num_hard_constraints) :
+        controllables_(controllables), soft_constraints_(soft_constraints),
+        hard_constraints_(hard_constraints), num_controllables_(num_controllables)
+      {
+        for(size_t i=0; i<hard_constraints_.size(); ++i)
+          hard_rows_.push_back(hard_constraints_[i]);
+        for(size_t i=0; i<soft_constraints_.size(); ++i)
+          soft_rows_.push_back(num_hard_constraints + soft_constraints_[i]);
+      }
+
+      void set_expressions(const DoubleExpressionVector& controllable_lower_bounds,
+          const DoubleExpressionVector& controllable_upper_bounds, const DoubleExpressionVector& controllable_weights,
+          const DoubleExpressionVector& soft_expressions, const DoubleExpressionVector& soft_lower_bounds,
+          const DoubleExpressionVector& soft_upper_bounds, const DoubleExpressionVector& soft_weights,
+          const DoubleExpressionVector& hard_expressions, const DoubleExpressionVector& hard_lower_bounds,
+          const DoubleExpressionVector& hard_upper_bounds)
+      {
+        KDL::ExpressionCloneMemo memo;
+        KDL::ScopedCloneMemo scope(memo);
+
+        set_expressions(controllable_lower_bounds_, controllable_lower_bounds, controllables_);
+        set_expressions(controllable_upper_bounds_, controllable_upper_bounds, controllables_);
+        set_expressions(controllable_weights_, controllable_weights, controllables_);
+
+        set_expressions(soft_expressions_, soft_expressions, soft_constraints_);
+        set_expressions(soft_lower_bounds_, soft_lower_bounds, soft_constraints_);
+        set_expressions(soft_upper_bounds_, soft_upper_bounds, soft_constraints_);
+        set_expressions(soft_weights_, soft_weights, soft_constraints_);
+
+        set_expressions(hard_expressions_, hard_expressions, hard_constraints_);
+        set_expressions(hard_lower_bounds_, hard_lower_bounds, hard_constraints_);
+        set_expressions(hard_upper_bounds_, hard_upper_bounds, hard_constraints_);
+
+        prepare_optimizer();
+      }
+
+      QPPartition clone() const
+      {
+        KDL::ExpressionCloneMemo memo;
+        QPPartition result(*this);
+        result.controllable_lower_bounds_ = controllable_lower_bounds_.clone(memo);
+        result.controllable_upper_bounds_ = controllable_upper_bounds_.clone(memo);
+        result.controllable_weights_ = controllable_weights_.clone(memo);
+        result.soft_expressions_ = soft_expressions_.clone(memo);
+        result.soft_lower_bounds_ = soft_lower_bounds_.clone(memo);
+        result.soft_upper_bounds_ = soft_upper_bounds_.clone(memo);
+        result.soft_weights_ = soft_weights_.clone(memo);
+        result.hard_expressions_ = hard_expressions_.clone(memo);
+        result.hard_lower_bounds_ = hard_lower_bounds_.clone(memo);
+        result.hard_upper_bounds_ = hard_upper_bounds_.clone(memo);
+        result.prepare_optimizer();
+        return result;
+      }
+
+      size_t num_rows() const
+      {
+        return controllables_.size() + soft_constraints_.size() + hard_constraints_.size();
+      }
+
+      const std::vector<size_t>& get_controllables() const
+      {
+        return controllables_;
+      }
+
+      const std::vector<size_t>& get_soft_constraints() const
+      {
+        return soft_constraints_;
+      }
+
+      const std::vector<size_t>& get_hard_constraints() const
+      {
+        return hard_constraints_;
+      }
+
+      // Exactly one of observables and source is non-null, see ParallelQPEvaluator.
+      void evaluate(const Eigen::Ref<const Eigen::VectorXd>* observables, const double* source,
+          const std::vector<size_t>* indices, const QPMatrices& out)
+      {
+        if(observables)
+          optimizer_.set_inputs(*observables);
+        else
+          optimizer_.set_inputs(source, *indices);
+
+        controllable_lower_bounds_.read();
+        controllable_upper_bounds_.read();
+        controllable_weights_.read();
+        soft_expressions_.read(out.A_->leftCols(num_controllables_), soft_rows_);
+        soft_lower_bounds_.read();
+        soft_upper_bounds_.read();
+        soft_weights_.read();
+        hard_expressions_.read(out.A_->leftCols(num_controllables_), hard_rows_);
+        hard_lower_bounds_.read();
+        hard_upper_bounds_.read();
+
+        for(size_t i=0; i<controllables_.size(); ++i)
+        {
+          size_t row = controllables_[i];
+          (*out.H_)(row, row) = controllable_weights_.get_values()(i);
+          (*out.lb_)(row) = controllable_lower_bounds_.get_values()(i);
+          (*out.ub_)(row) = controllable_upper_bounds_.get_values()(i);
+        }
+
+        for(size_t i=0; i<hard_constraints_.size(); ++i)
+        {
+          size_t row = hard_rows_[i];
+          (*out.lbA_)(row) = hard_lower_bounds_.get_values()(i);
+          (*out.ubA_)(row) = hard_upper_bounds_.get_values()(i);
+        }
+
+        for(size_t i=0; i<soft_constraints_.size(); ++i)
+        {
+          size_t row = soft_rows_[i];
+          size_t weight = num_controllables_ + soft_constraints_[i];
+          (*out.H_)(weight, weight) = soft_weights_.get_values()(i);
+          (*out.lbA_)(row) = soft_lower_bounds_.get_values()(i);
+          (*out.ubA_)(row) = soft_upper_bounds_.get_values()(i);
+        }
+      }
+
+    private:
+      std::vector<size_t> controllables_, soft_constraints_, hard_constraints_;
+      // rows of A written by this partition
+      std::vector<size_t> hard_rows_, soft_rows_;
+      size_t num_controllables_;
+
+      KDL::DoubleExpressionArray controllable_lower_bounds_, controllable_upper_bounds_,
+         controllable_weights_, soft_expressions_, soft_lower_bounds_, soft_upper_bounds_,
+         soft_weights_, hard_expressions_, hard_lower_bounds_, hard_upper_bounds_;
+      KDL::ExpressionArrayOptimizer optimizer_;
+
+      // clones under the memo of the caller
+      static void set_expressions(KDL::DoubleExpressionArray& array,
+          const DoubleExpressionVector& expressions, const std::vector<size_t>& rows)
+      {
+        DoubleExpressionVector clones;
+        for(size_t i=0; i<rows.size(); ++i)
+          clones.push_back(expressions[rows[i]]->clone());
+        array.set_expressions(clones);
+      }
+
+      void prepare_optimizer()
+      {
+        optimizer_.clear();
+        optimizer_.add(controllable_lower_bounds_.get_expressions());
+        optimizer_.add(controllable_upper_bounds_.get_expressions());
+        optimizer_.add(controllable_weights_.get_expressions());
+        optimizer_.add(soft_expressions_.get_expressions());
+        optimizer_.add(soft_lower_bounds_.get_expressions());
+        optimizer_.add(soft_upper_bounds_.get_expressions());
+        optimizer_.add(soft_weights_.get_expressions());
+        optimizer_.add(hard_expressions_.get_expressions());
+        optimizer_.add(hard_lower_bounds_.get_expressions());
+        optimizer_.add(hard_upper_bounds_.get_expressions());
+        optimizer_.prepare();
+      }
+  };
+
+  // Assigns the rows of a QP to partitions, such that rows sharing nodes, see
+  // KDL::SharedExpression, preferably end up in the same partition. A shared
+  // node, e.g. a cached frame at the end of a kinematic chain, is evaluated
+  // once by every partition using it, so spreading its users over all
+  // partitions would repeat its work in every thread. Every row goes to the
+  // partition with the smallest estimated load after adding it: a row costs
+  // one unit per expression, and each shared node new to the partition costs
+  // the number of inputs it depends on, i.e. roughly the length of its chain.
+  class QPRowAssignment
+  {
+    public:
+      typedef QPPartition::DoubleExpressionVector DoubleExpressionVector;
+
+      explicit QPRowAssignment(size_t num_partitions) :
+        loads_(num_partitions, 0.0), shared_nodes_(num_partitions) {}
+
+      // Returns the partition of the row with the given expressions.
+      size_t assign(const DoubleExpressionVector& row)
+      {
+        KDL::ExpressionCloneMemo memo;
+        {
+          KDL::ScopedCloneMemo scope(memo);
+          for(size_t i=0; i<row.size(); ++i)
+            row[i]->clone();
+        }
+
+        size_t best = 0;
+        double best_load = std::numeric_limits<double>::infinity();
+        for(size_t p=0; p<loads_.size(); ++p)
+        {
+          double load = loads_[p] + row.size();
+          for(KDL::ExpressionCloneMemo::Clones::const_iterator it = memo.get_clones().begin();
+              it != memo.get_clones().end(); ++it)
+            if(shared_nodes_[p].find(it->first) == shared_nodes_[p].end())
+              load += get_cost(it->second);
+
+          if(load < best_load)
+          {
+            best = p;
+            best_load = load;
+          }
+        }
+
+        loads_[best] = best_load;
+        for(KDL::ExpressionCloneMemo::Clones::const_iterator it = memo.get_clones().begin();
+            it != memo.get_clones().end(); ++it)
+          shared_nodes_[best].insert(it->first);
+
+        return best;
+      }
+
+      const std::vector<double>& get_loads() const
+      {
+        return loads_;
+      }
+
+    private:
+      std::vector<double> loads_;
+      std::vector< std::set<const KDL::ExpressionBase*> > shared_nodes_;
+
+      static double get_cost(const KDL::ExpressionBase::Ptr& node)
+      {
+        std::set<int> dependencies;
+        node->getDependencies(dependencies);
+        return std::max<size_t>(dependencies.size(), 1);
+      }
+  };
+
+  // Evaluates the expressions of a QP on a persistent pool of threads. The rows of
+  // the QP are split into one partition per thread, see QPRowAssignment; each
+  // thread evaluates its own deep copy of the expressions of its rows and writes
+  // only those rows. Results are thus deterministic and independent of the number
+  // of threads. Updates are handed out through atomic counters. Idle workers spin
+  // for a short while, so back-to-back updates are picked up without a system
+  // call, and then block on a condition variable until the next update.
+  class ParallelQPEvaluator
+  {
+    public:
+      typedef QPPartition::DoubleExpressionVector DoubleExpressionVector;
+
+      // The calling thread evaluates the first partition, i.e. num_threads - 1
+      // workers are started.
+      ParallelQPEvaluator(size_t num_threads, const DoubleExpressionVector& controllable_lower_bounds,
+          const DoubleExpressionVector& controllable_upper_bounds, const DoubleExpressionVector& controllable_weights,
+          const DoubleExpressionVector& soft_expressions, const DoubleExpressionVector& soft_lower_bounds,
+          const DoubleExpressionVector& soft_upper_bounds, const DoubleExpressionVector& soft_weights,
+          const DoubleExpressionVector& hard_expressions, const DoubleExpressionVector& hard_lower_bounds,
+          const DoubleExpressionVector& hard_upper_bounds)
+      {
+        num_threads = std::max(num_threads, size_t(1));
+        size_t num_controllables = controllable_weights.size();
+        size_t num_soft = soft_expressions.size();
+        size_t num_hard = hard_expressions.size();
+
+        // constraints first, the cheap controllables then even out the loads
+        QPRowAssignment assignment(num_threads);
+        std::vector< std::vector<size_t> > controllables(num_threads), soft(num_threads), hard(num_threads);
+        for(size_t i=0; i<num_soft; ++i)
+        {
+          DoubleExpressionVector row;
+          row.push_back(soft_expressions[i]);
+          row.push_back(soft_lower_bounds[i]);
+          row.push_back(soft_upper_bounds[i]);
+          row.push_back(soft_weights[i]);
+          soft[assignment.assign(row)].push_back(i);
+        }
+        for(size_t i=0; i<num_hard; ++i)
+        {
+          DoubleExpressionVector row;
+          row.push_back(hard_expressions[i]);
+          row.push_back(hard_lower_bounds[i]);
+          row.push_back(hard_upper_bounds[i]);
+          hard[assignment.assign(row)].push_back(i);
+        }
+        for(size_t i=0; i<num_controllables; ++i)
+        {
+          DoubleExpressionVector row;
+          row.push_back(controllable_lower_bounds[i]);
+          row.push_back(controllable_upper_bounds[i]);
+          row.push_back(controllable_weights[i]);
+          controllables[assignment.assign(row)].push_back(i);
+        }
+
+        for(size_t i=0; i<num_threads; ++i)
+        {
+          partitions_.push_back(QPPartition(controllables[i], soft[i], hard[i], num_controllables, num_hard));
+          partitions_.back().set_expressions(controllable_lower_bounds, controllable_upper_bounds,
+              controllable_weights, soft_expressions, soft_lower_bounds, soft_upper_bounds, soft_weights,
+              hard_expressions, hard_lower_bounds, hard_upper_bounds);
+        }
+
+        start_workers();
+      }
+
+      ~ParallelQPEvaluator()
+      {
+        stop_.store(true, boost::memory_order_release);
+        {
+          boost::lock_guard<boost::mutex> lock(mutex_);
+          generation_.fetch_add(1, boost::memory_order_seq_cst);
+        }
+        wake_up_.notify_all();
+        workers_.join_all();
+      }
+
+      // Returns an evaluator with the same partitions, holding deep copies of
+      // their expressions.
+      boost::shared_ptr<ParallelQPEvaluator> clone() const
+      {
+        return boost::shared_ptr<ParallelQPEvaluator>(new ParallelQPEvaluator(*this));
+      }
+
+      size_t get_num_threads() const
+      {
+        return partitions_.size();
+      }
+
+      const std::vector<QPPartition>& get_partitions() const
+      {
+        return partitions_;
+      }
+
+      // observables needs to hold all inputs of the QP.
+      void evaluate(const Eigen::Ref<const Eigen::VectorXd>& observables, const QPMatrices& out)
+      {
+        run(&observables, 0, 0, out);
+      }
+
+      // Gathers observable i from source[indices[i]], see ObservableBinding.
+      void evaluate(const double* source, const std::vector<size_t>& indices, const QPMatrices& out)
+      {
+        run(0, source, &indices, out);
+      }
+
+    private:
+      std::vector<QPPartition> partitions_;
+      boost::thread_group workers_;
+
+      // job of the current generation, written by the calling thread before
+      // generation_ is incremented
+      const Eigen::Ref<const Eigen::VectorXd>* observables_;
+      const double* source_;
+      const std::vector<size_t>* indices_;
+      const QPMatrices* out_;
+      boost::atomic<size_t> generation_, finished_, num_sleeping_;
+      boost::atomic<bool> stop_;
+
+      // idle workers block here after spinning
+      boost::mutex mutex_;
+      boost::condition_variable wake_up_;
+
+      ParallelQPEvaluator(const ParallelQPEvaluator& other)
+      {
+        for(size_t i=0; i<other.partitions_.size(); ++i)
+          partitions_.push_back(other.partitions_[i].clone());
+
+        start_workers();
+      }
+
+      // not assignable
+      ParallelQPEvaluator& operator=(const ParallelQPEvaluator&);
+
+      // how long idle workers spin before they block
+      static boost::chrono::microseconds get_spin_time()
+      {
+        return boost::chrono::microseconds(50);
+      }
+
+      void start_workers()
+      {
+        observables_ = 0;
+        source_ = 0;
+        indices_ = 0;
+        out_ = 0;
+        generation_.store(0, boost::memory_order_relaxed);
+        finished_.store(0, boost::memory_order_relaxed);
+        num_sleeping_.store(0, boost::memory_order_relaxed);
+        stop_.store(false, boost::memory_order_relaxed);
+
+        for(size_t i=1; i<partitions_.size(); ++i)
+          workers_.create_thread(boost::bind(&ParallelQPEvaluator::work, this, i));
+      }
+
+      void run(const Eigen::Ref<const Eigen::VectorXd>* observables, const double* source,
+          const std::vector<size_t>* indices, const QPMatrices& out)
+      {
+        observables_ = observables;
+        source_ = source;
+        indices_ = indices;
+        out_ = &out;
+        finished_.store(0, boost::memory_order_relaxed);
+
+        // sequentially consistent, so either a worker about to block sees the new
+        // generation, or this thread sees the worker in num_sleeping_
+        generation_.fetch_add(1, boost::memory_order_seq_cst);
+        if(num_sleeping_.load(boost::memory_order_seq_cst) > 0)
+        {
+          { boost::lock_guard<boost::mutex> lock(mutex_); }
+          wake_up_.notify_all();
+        }
+
+        partitions_[0].evaluate(observables, source, indices, out);
+
+        // spin, but let workers sharing this core finish their partitions
+        size_t num_workers = partitions_.size() - 1;
+        for(size_t i=0; finished_.load(boost::memory_order_acquire) != num_workers; ++i)
+          if(i >= 1000)
+            boost::this_thread::yield();
+      }
+
+      void work(size_t partition)
+      {
+        size_t seen = 0;
+        while(true)
+        {
+          wait_for_generation(seen);
+          if(stop_.load(boost::memory_order_acquire))
+            return;
+
+          seen = generation_.load(boost::memory_order_acquire);
+          partitions_[partition].evaluate(observables_, source_, indices_, *out_);
+          finished_.fetch_add(1, boost::memory_order_release);
+        }
+      }
+
+      void wait_for_generation(size_t seen)
+      {
+        boost::chrono::steady_clock::time_point idle_since = boost::chrono::steady_clock::now();
+        while(boost::chrono::steady_clock::now() - idle_since < get_spin_time())
+          if(generation_.load(boost::memory_order_acquire) != seen)
+            return;
+
+        num_sleeping_.fetch_add(1, boost::memory_order_seq_cst);
+        {
+          boost::unique_lock<boost::mutex> lock(mutex_);
+          while(generation_.load(boost::memory_order_seq_cst) == seen)
+            wake_up_.wait(lock);
+        }
+        num_sleeping_.fetch_sub(1, boost::memory_order_relaxed);
+      }
+  };
+
+  typedef boost::shared_ptr<ParallelQPEvaluator> ParallelQPEvaluatorPtr;
+}
+
+#endif // GISKARD_PARALLEL_EVALUATION_HPP
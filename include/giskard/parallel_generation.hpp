@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_PARALLEL_GENERATION_HPP
+#define GISKARD_PARALLEL_GENERATION_HPP
+
+#include <set>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include <giskard/expression_generation.hpp>
+#include <giskard/spec_dependencies.hpp>
+
+namespace giskard
+{
+  ///
+  /// dependency graph of the entries of a scope
+  ///
+
+  // Groups the entries of a scope into waves. Entries of one wave only
+  // reference entries of earlier waves and can be generated concurrently.
+  // Additionally, no two entries of one wave reference the same entry
+  // because the reference counts of KDL expressions are not thread-safe.
+  class ScopeGenerationPlan
+  {
+    public:
+      explicit ScopeGenerationPlan(const ScopeSpec& scope_spec) :
+        valid_(true)
+      {
+        std::map<std::string, size_t> index;
+        std::vector<size_t> level(scope_spec.size(), 0);
+        std::vector< std::set<size_t> > wave_references;
+
+        for(size_t i=0; i<scope_spec.size(); ++i)
+        {
+          if(!scope_spec[i].spec.get() || index.count(scope_spec[i].name) != 0)
+          {
+            // let sequential generation report the error
+            valid_ = false;
+            return;
+          }
+
+          SpecDependencyCollector collector;
+          collector.collect(scope_spec[i].spec);
+
+          std::set<size_t> references;
+          for(std::set<std::string>::const_iterator it = collector.get_references().begin();
+              it != collector.get_references().end(); ++it)
+          {
+            std::map<std::string, size_t>::const_iterator entry = index.find(*it);
+            if(entry == index.end())
+            {
+              valid_ = false;
+              return;
+            }
+
+            references.insert(entry->second);
+            level[i] = std::max(level[i], level[entry->second] + 1);
+          }
+
+          size_t wave = level[i];
+          while(wave < waves_.size() && !disjoint(references, wave_references[wave]))
+            ++wave;
+
+          if(wave >= waves_.size())
+          {
+            waves_.resize(wave + 1);
+            wave_references.resize(wave + 1);
+          }
+
+          waves_[wave].push_back(i);
+          wave_references[wave].insert(references.begin(), references.end());
+          level[i] = wave;
+          index[scope_spec[i].name] = i;
+        }
+      }
+
+      bool is_valid() const
+      {
+        return valid_;
+      }
+
+      const std::vector< std::vector<size_t> >& get_waves() const
+      {
+        return waves_;
+      }
+
+    private:
+      bool valid_;
+      std::vector< std::vector<size_t> > waves_;
+
+      static bool disjoint(const std::set<size_t>& a, const std::set<size_t>& b)
+      {
+        for(std::set<size_t>::const_iterator it = a.begin(); it != a.end(); ++it)
+          if(b.count(*it) != 0)
+            return false;
+
+        return true;
+      }
+  };
+
+  ///
+  /// concurrent generation of scopes on a persistent thread pool
+  ///
+
+  class ParallelScopeGenerator
+  {
+    public:
+      // The calling thread takes part in generation, i.e. num_threads - 1
+      // workers are started.
+      explicit ParallelScopeGenerator(size_t num_threads) :
+        barrier_(num_threads > 0 ? num_threads : 1), stop_(false),
+        next_(0), failed_(false), scope_spec_(0), scope_(0), wave_(0)
+      {
+        for(size_t i=1; i<num_threads; ++i)
+          workers_.create_thread(boost::bind(&ParallelScopeGenerator::run, this));
+      }
+
+      ~ParallelScopeGenerator()
+      {
+        stop_ = true;
+        barrier_.wait();
+        workers_.join_all();
+      }
+
+      size_t get_num_threads() const
+      {
+        return workers_.size() + 1;
+      }
+
+      giskard::Scope generate(const giskard::ScopeSpec& scope_spec)
+      {
+        ScopeGenerationPlan plan(scope_spec);
+        if(!plan.is_valid() || workers_.size() == 0)
+          return giskard::generate(scope_spec);
+
+        giskard::Scope scope;
+        results_.clear();
+        results_.resize(scope_spec.size());
+        scope_spec_ = &scope_spec;
+        scope_ = &scope;
+        failed_ = false;
+
+        for(size_t i=0; i<plan.get_waves().size(); ++i)
+        {
+          wave_ = &(plan.get_waves()[i]);
+          next_ = 0;
+
+          barrier_.wait();
+          work();
+          barrier_.wait();
+
+          if(failed_)
+            break;
+
+          for(size_t j=0; j<wave_->size(); ++j)
+            add(scope, (*wave_)[j]);
+        }
+
+        results_.clear();
+        scope_spec_ = 0;
+        scope_ = 0;
+        wave_ = 0;
+
+        // rerun sequentially to throw the original exception
+        if(failed_)
+          return giskard::generate(scope_spec);
+
+        return scope;
+      }
+
+    private:
+      class Result
+      {
+        public:
+          KDL::Expression<double>::Ptr double_;
+          KDL::Expression<KDL::Vector>::Ptr vector_;
+          KDL::Expression<KDL::Rotation>::Ptr rotation_;
+          KDL::Expression<KDL::Frame>::Ptr frame_;
+      };
+
+      boost::thread_group workers_;
+      boost::barrier barrier_;
+      bool stop_;
+
+      boost::atomic<size_t> next_;
+      boost::atomic<bool> failed_;
+      const giskard::ScopeSpec* scope_spec_;
+      const giskard::Scope* scope_;
+      const std::vector<size_t>* wave_;
+      std::vector<Result> results_;
+
+      void run()
+      {
+        while(true)
+        {
+          barrier_.wait();
+          if(stop_)
+            return;
+
+          work();
+          barrier_.wait();
+        }
+      }
+
+      void work()
+      {
+        for(size_t i = next_++; i < wave_->size(); i = next_++)
+        {
+          if(failed_)
+            return;
+
+          try
+          {
+            generate_entry((*wave_)[i]);
+          }
+          catch(...)
+          {
+            failed_ = true;
+          }
+        }
+      }
+
+      void generate_entry(size_t index)
+      {
+        const giskard::SpecPtr& spec = (*scope_spec_)[index].spec;
+        Result& result = results_[index];
+
+        switch(spec->get_category())
+        {
+          case giskard::DOUBLE_SPEC:
+            result.double_ = boost::static_pointer_cast<giskard::DoubleSpec>(spec)->get_expression(*scope_);
+            break;
+          case giskard::VECTOR_SPEC:
+            result.vector_ = boost::static_pointer_cast<giskard::VectorSpec>(spec)->get_expression(*scope_);
+            break;
+          case giskard::ROTATION_SPEC:
+            result.rotation_ = boost::static_pointer_cast<giskard::RotationSpec>(spec)->get_expression(*scope_);
+            break;
+          case giskard::FRAME_SPEC:
+            result.frame_ = boost::static_pointer_cast<giskard::FrameSpec>(spec)->get_expression(*scope_);
+            break;
+          default:
+            throw std::domain_error("Scope generation: found entry of non-supported type. " + spec->to_string());
+        }
+      }
+
+      void add(giskard::Scope& scope, size_t index)
+      {
+        const std::string& name = (*scope_spec_)[index].name;
+        Result& result = results_[index];
+
+        switch((*scope_spec_)[index].spec->get_category())
+        {
+          case giskard::DOUBLE_SPEC:
+            scope.add_double_expression(name, result.double_);
+            break;
+          case giskard::VECTOR_SPEC:
+            scope.add_vector_expression(name, result.vector_);
+            break;
+          case giskard::ROTATION_SPEC:
+            scope.add_rotation_expression(name, result.rotation_);
+            break;
+          case giskard::FRAME_SPEC:
+            scope.add_frame_expression(name, result.frame_);
+            break;
+        }
+      }
+
+      // not copyable
+      ParallelScopeGenerator(const ParallelScopeGenerator&);
+      ParallelScopeGenerator& operator=(const ParallelScopeGenerator&);
+  };
+
+  inline giskard::Scope generate(const giskard::ScopeSpec& scope_spec, size_t num_threads)
+  {
+    ParallelScopeGenerator generator(num_threads);
+    return generator.generate(scope_spec);
+  }
+
+  inline giskard::QPController generate(const giskard::QPControllerSpec& spec, size_t num_threads)
+  {
+    return generate(spec, generate(spec.scope_, num_threads));
+  }
+}
+
+#endif // GISKARD_PARALLEL_GENERATION_HPP
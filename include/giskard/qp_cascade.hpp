@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef GISKARD_QP_CASCADE_HPP
+#define GISKARD_QP_CASCADE_HPP
+
+#include <set>
+#include <vector>
+#include <giskard/qp_solver.hpp>
+
+namespace giskard
+{
+  // Solves the QP of a QPProblemBuilder with strict priorities between the soft
+  // constraints instead of weights orders of magnitude apart. Every priority
+  // level gets its own QP, solved from the most important level 0 downwards:
+  // the QP of a level keeps the slacks of its own soft constraints, and it
+  // contains the soft constraints of all higher levels as constraints without
+  // slack, with bounds shifted by the slacks the higher levels settled on.
+  // Lower levels therefore only move within the solutions of the higher ones,
+  // i.e. in their nullspace, while the weights inside every QP stay in the
+  // range of a single level.
+  //
+  // Every level has its own solver, which hotstarts from the QP of that level
+  // in the previous cycle. A level whose hotstart fails gets solved from scratch.
+  class QPCascade
+  {
+    public:
+      QPCascade() :
+        num_controllables_(0), num_iterations_(0), status_(QP_NOT_INITIALIZED) {}
+
+      // priorities has one entry per soft constraint of builder. The solvers of
+      // the levels are not set, see set_solver().
+      void init(const QPProblemBuilder& builder, const std::vector<size_t>& priorities)
+      {
+        if(priorities.size() != builder.num_soft_constraints())
+          throw std::invalid_argument("QPCascade: received " +
+              boost::lexical_cast<std::string>(priorities.size()) + " priorities for " +
+              boost::lexical_cast<std::string>(builder.num_soft_constraints()) + " soft constraints.");
+
+        std::set<size_t> values(priorities.begin(), priorities.end());
+        levels_.assign(values.size(), Level());
+
+        std::vector<size_t> fixed;
+        size_t level = 0;
+        for(std::set<size_t>::const_iterator it=values.begin(); it!=values.end(); ++it, ++level)
+        {
+          levels_[level].priority_ = *it;
+          levels_[level].fixed_ = fixed;
+          for(size_t i=0; i<priorities.size(); ++i)
+            if(priorities[i] == *it)
+              levels_[level].soft_.push_back(i);
+
+          levels_[level].builder_.init_sub_problem(builder, levels_[level].fixed_, levels_[level].soft_);
+          fixed.insert(fixed.end(), levels_[level].soft_.begin(), levels_[level].soft_.end());
+        }
+
+        num_controllables_ = builder.num_controllables();
+        primal_ = Eigen::VectorXd::Zero(builder.num_weights());
+        num_iterations_ = 0;
+        status_ = QP_NOT_INITIALIZED;
+      }
+
+      size_t num_levels() const
+      {
+        return levels_.size();
+      }
+
+      // priority value of the soft constraints of level
+      size_t get_priority(size_t level) const
+      {
+        return levels_[level].priority_;
+      }
+
+      // indices of the soft constraints of level
+      const std::vector<size_t>& get_soft_constraints(size_t level) const
+      {
+        return levels_[level].soft_;
+      }
+
+      const QPProblemBuilder& get_builder(size_t level) const
+      {
+        return levels_[level].builder_;
+      }
+
+      const QPSolver& get_solver(size_t level) const
+      {
+        return *levels_[level].solver_;
+      }
+
+      void set_solver(size_t level, const QPSolverPtr& solver)
+      {
+        levels_[level].solver_ = solver;
+        levels_[level].started_ = false;
+      }
+
+      // Solves all levels for the last QP of builder. Levels hotstart if hotstart
+      // is true and they have been solved before. Returns false if a level fails.
+      bool solve(const QPProblemBuilder& builder, int nWSR, bool hotstart)
+      {
+        num_iterations_ = 0;
+        for(size_t level=0; level<levels_.size(); ++level)
+          if(!solve_level(builder, levels_[level], nWSR, hotstart))
+            return false;
+
+        return true;
+      }
+
+      // Controllables followed by the slacks of all soft constraints, in the
+      // order of the builder of the full problem.
+      void get_primal_solution(Eigen::VectorXd& x) const
+      {
+        x = primal_;
+      }
+
+      // sum of the iterations of all levels in the last solve
+      int get_num_iterations() const
+      {
+        return num_iterations_;
+      }
+
+      // status of the last level solved
+      QPSolverStatus get_status() const
+      {
+        return status_;
+      }
+
+    private:
+      class Level
+      {
+        public:
+          Level() :
+            priority_(0), started_(false) {}
+
+          Level(const Level& other) :
+            priority_(other.priority_), fixed_(other.fixed_), soft_(other.soft_),
+            builder_(other.builder_), started_(other.started_)
+          {
+            if(other.solver_.get())
+              solver_ = other.solver_->clone();
+          }
+
+          Level& operator=(const Level& other)
+          {
+            if(this != &other)
+            {
+              priority_ = other.priority_;
+              fixed_ = other.fixed_;
+              soft_ = other.soft_;
+              builder_ = other.builder_;
+              solver_ = other.solver_.get() ? other.solver_->clone() : QPSolverPtr();
+              started_ = other.started_;
+            }
+            return *this;
+          }
+
+          size_t priority_;
+          // soft constraints of higher levels, and of this level
+          std::vector<size_t> fixed_, soft_;
+          QPProblemBuilder builder_;
+          QPSolverPtr solver_;
+          bool started_;
+      };
+
+      std::vector<Level> levels_;
+      size_t num_controllables_;
+      Eigen::VectorXd primal_, level_primal_, fixed_slacks_;
+      int num_iterations_;
+      QPSolverStatus status_;
+
+      bool solve_level(const QPProblemBuilder& builder, Level& level, int nWSR, bool hotstart)
+      {
+        if(!level.solver_.get())
+          throw std::runtime_error("QPCascade: level with priority " +
+              boost::lexical_cast<std::string>(level.priority_) + " has no solver.");
+
+        fixed_slacks_.resize(level.fixed_.size());
+        for(size_t i=0; i<level.fixed_.size(); ++i)
+          fixed_slacks_(i) = primal_(num_controllables_ + level.fixed_[i]);
+        level.builder_.update_sub_problem(builder, level.fixed_, fixed_slacks_, level.soft_);
+
+        bool success = false;
+        if(hotstart && level.started_)
+        {
+          success = level.solver_->hotstart(level.builder_, nWSR);
+          num_iterations_ += level.solver_->get_num_iterations();
+        }
+
+        if(!success)
+        {
+          success = level.solver_->init(level.builder_, nWSR);
+          num_iterations_ += level.solver_->get_num_iterations();
+        }
+        status_ = level.solver_->get_status();
+        level.started_ = success;
+        if(!success)
+          return false;
+
+        level.solver_->get_primal_solution(level_primal_);
+        primal_.head(num_controllables_) = level_primal_.head(num_controllables_);
+        for(size_t i=0; i<level.soft_.size(); ++i)
+          primal_(num_controllables_ + level.soft_[i]) = level_primal_(num_controllables_ + i);
+
+        return true;
+      }
+  };
+}
+
+#endif // GISKARD_QP_CASCADE_HPP
@@ -21,17 +21,129 @@
 #ifndef GISKARD_QP_CONTROLLER_HPP
 #define GISKARD_QP_CONTROLLER_HPP
 
+#include <giskard/diagonal_qp_solver.hpp>
+#include <giskard/observable_binding.hpp>
+#include <giskard/qp_cascade.hpp>
 #include <giskard/qp_problem_builder.hpp>
+#include <giskard/qp_solver.hpp>
+#include <giskard/qp_working_set.hpp>
+#include <giskard/qpoases_solver.hpp>
+#include <giskard/stopwatch.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
 #include <boost/lexical_cast.hpp>
-#include <qpOASES.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
 
 namespace giskard
 {
+  ///
+  /// selection of QP solvers
+  ///
+
+  enum QPSolverType
+  {
+    // general purpose active set solver, supports working sets
+    QPOASES_SOLVER,
+    // structure-exploiting solver for the diagonal Hessians of QPProblemBuilder
+    DIAGONAL_SOLVER
+  };
+
+  inline QPSolverPtr create_qp_solver(QPSolverType type)
+  {
+    switch(type)
+    {
+      case QPOASES_SOLVER:
+        return QPSolverPtr(new QPOASESSolver());
+      case DIAGONAL_SOLVER:
+        return QPSolverPtr(new DiagonalQPSolver());
+      default:
+        throw std::invalid_argument("Asked to create QP solver of unknown type " +
+            boost::lexical_cast<std::string>(type) + ".");
+    }
+  }
+
+  // Creates the solver for a controller once the size of its QP is known.
+  typedef boost::function<QPSolverPtr (const QPProblemBuilder&)> QPSolverFactory;
+
+  // Solver factory picking one solver type for QPs with up to max_small_weights
+  // weights, and another one for bigger QPs.
+  class QPSolverBySize
+  {
+    public:
+      QPSolverBySize(size_t max_small_weights, QPSolverType small_type, QPSolverType large_type) :
+        max_small_weights_(max_small_weights), small_type_(small_type), large_type_(large_type) {}
+
+      QPSolverPtr operator()(const QPProblemBuilder& builder) const
+      {
+        return create_qp_solver(builder.num_weights() <= max_small_weights_ ? small_type_ : large_type_);
+      }
+
+    private:
+      size_t max_small_weights_;
+      QPSolverType small_type_, large_type_;
+  };
+
+  ///
+  /// recovery from failed hotstarts
+  ///
+
+  // Configures what QPController::update() does if hotstarting the QP fails.
+  // The rungs of the recovery ladder are tried in order until one succeeds:
+  //   1. hotstart again with nWSR_factor_ times as many working set recalculations,
+  //   2. re-initialize the QP, guessing the working set from the last good solution,
+  //      if the solver provides dual solutions,
+  //   3. cold-start the QP, in a background thread if background_cold_start_ is set.
+  // While a background cold start is running, update() returns false and serves
+  // the safe command, i.e. zero velocities for all controllables.
+  class QPRecoveryOptions
+  {
+    public:
+      QPRecoveryOptions() :
+        enabled_(true), nWSR_factor_(4), background_cold_start_(true) {}
+
+      bool enabled_;
+      int nWSR_factor_;
+      bool background_cold_start_;
+  };
+
+  class QPRecoveryStatistics
+  {
+    public:
+      QPRecoveryStatistics() :
+        num_failures_(0), num_retries_(0), num_retry_successes_(0), num_resets_(0),
+        num_reset_successes_(0), num_cold_starts_(0), num_cold_start_successes_(0),
+        num_safe_commands_(0) {}
+
+      // number of failed hotstarts which triggered the recovery ladder
+      size_t num_failures_;
+      size_t num_retries_, num_retry_successes_;
+      size_t num_resets_, num_reset_successes_;
+      size_t num_cold_starts_, num_cold_start_successes_;
+      // number of calls to update() which served the safe command
+      size_t num_safe_commands_;
+  };
+
+  // Wall-clock time of the phases of one call to QPController::start() or
+  // update(). Solving includes all rungs of the recovery ladder.
+  class QPCycleTimings
+  {
+    public:
+      QPCycleTimings() :
+        evaluation_seconds_(0.0), solve_seconds_(0.0) {}
+
+      double evaluation_seconds_, solve_seconds_;
+  };
+
   class QPController
   {
     public:
       typedef typename std::vector< KDL::Expression<double>::Ptr > DoubleExpressionVector;
       typedef typename std::vector< std::string> StringVector;
+
+      QPController() :
+        solver_(QPSolverPtr(new QPOASESSolver())), has_good_solution_(false) {}
       
       bool init(const DoubleExpressionVector& controllable_lower_bounds,
           const DoubleExpressionVector& controllable_upper_bounds, const DoubleExpressionVector& controllable_weights,
@@ -46,13 +158,12 @@ namespace giskard
             soft_upper_bounds, soft_weights, hard_expressions,
             hard_lower_bounds, hard_upper_bounds);
 
-        qp_problem_ = qpOASES::SQProblem(qp_builder_.num_weights(), qp_builder_.num_constraints());
-        qpOASES::Options options;
-        options.setToMPC();
-        options.printLevel = qpOASES::PL_NONE;
-        qp_problem_.setOptions(options);
+        if(solver_factory_)
+          solver_ = solver_factory_(qp_builder_);
+        cold_start_.reset();
 
         xdot_full_.resize(qp_builder_.num_weights());
+        has_good_solution_ = false;
 
         xdot_control_.resize(qp_builder_.num_controllables());
 
@@ -63,6 +174,7 @@ namespace giskard
               " controllable names, but " + boost::lexical_cast<std::string>(qp_builder_.num_controllables()) + 
               " controllables were specified.");
         controllable_names_ = controllable_names;
+        observable_names_ = controllable_names;
 
         if( soft_names.size() != qp_builder_.num_soft_constraints() )
           throw std::runtime_error("Received " + boost::lexical_cast<std::string>(soft_names.size()) + 
@@ -70,46 +182,114 @@ namespace giskard
               " soft constraints were specified.");
         soft_constraint_names_ = soft_names;
 
+        soft_priorities_.assign(qp_builder_.num_soft_constraints(), 0);
+        cascade_ = QPCascade();
+
         return true;
       }
 
-      bool start(const Eigen::VectorXd& observables, int nWSR)
+      // observables accepts any contiguous vector, e.g. an Eigen::Map of a raw
+      // pointer into caller-owned memory.
+      bool start(const Eigen::Ref<const Eigen::VectorXd>& observables, int nWSR)
       {
-        qp_builder_.update(observables);
+        update_qp_builder(observables);
+        return record_solve_time(has_priority_levels() ? solve_cascade(nWSR, false) : init_solver(nWSR));
+      }
+
+      // Starts with observables gathered from source, see bind_observables().
+      bool start(const ObservableBinding& binding, const double* source, int nWSR)
+      {
+        update_qp_builder(binding, source);
+        return record_solve_time(has_priority_levels() ? solve_cascade(nWSR, false) : init_solver(nWSR));
+      }
 
-        qpOASES::returnValue return_value = qp_problem_.init(qp_builder_.get_H().data(), qp_builder_.get_g().data(), 
-            qp_builder_.get_A().data(), qp_builder_.get_lb().data(), qp_builder_.get_ub().data(),
-            qp_builder_.get_lbA().data(), qp_builder_.get_ubA().data(), nWSR);
+      // Starts the QP from a working set taken from this or an equally structured
+      // controller with get_working_set(), e.g. when re-entering a task. If the
+      // working set still fits, the QP converges in few working set recalculations.
+      // Not supported with priority levels.
+      bool start(const Eigen::Ref<const Eigen::VectorXd>& observables, int nWSR, const QPWorkingSet& working_set)
+      {
+        check_no_priority_levels();
+        check_working_set(working_set);
+        update_qp_builder(observables);
+        reset_solver_state();
 
-        if(return_value != qpOASES::SUCCESSFUL_RETURN)
+        if(!record_solve_time(solver_->init(qp_builder_, nWSR, working_set)))
         {
-          std::cout << "Init of QP-Problem returned without success! ERROR MESSAGE: " << 
-            qpOASES::MessageHandling::getErrorCodeMessage(return_value) << std::endl;
-          std::cout << "Printing internals." << std::endl;
-          qp_builder_.print_internals();
-          std::cout << "nWSR: " << nWSR << std::endl;
-          qp_builder_.are_internals_valid();
+          std::cout << "Warm init of QP-Problem returned without success! ERROR MESSAGE: " << 
+            solver_->get_status_message() << std::endl;
+          return false;
         }
-        
-        return return_value == qpOASES::SUCCESSFUL_RETURN;
+
+        read_solution();
+        return true;
+      }
+
+      // Snapshot of the solver state after the last successful start() or update().
+      QPWorkingSet get_working_set() const
+      {
+        check_no_priority_levels();
+        QPWorkingSet working_set;
+        if(!solver_->get_working_set(working_set))
+          throw std::runtime_error("Taking working sets is not supported by the " +
+              solver_->get_name() + " solver.");
+
+        working_set.controllable_names_ = controllable_names_;
+        working_set.soft_constraint_names_ = soft_constraint_names_;
+        return working_set;
+      }
+
+      // Number of working set recalculations the solver needed in the last call
+      // to start() or update(), summed over all priority levels.
+      int get_num_working_set_recalculations() const
+      {
+        return has_priority_levels() ? cascade_.get_num_iterations() : solver_->get_num_iterations();
+      }
+
+      // Status of the solver in the last call to start() or update(), i.e. of the
+      // last priority level solved if there are several.
+      QPSolverStatus get_solver_status() const
+      {
+        return has_priority_levels() ? cascade_.get_status() : solver_->get_status();
       }
-      
  
-      bool update(const Eigen::VectorXd& observables, int nWSR)
+      bool update(const Eigen::Ref<const Eigen::VectorXd>& observables, int nWSR)
       {
-       qp_builder_.update(observables);
+        update_qp_builder(observables);
+        return record_solve_time(has_priority_levels() ? update_cascade(nWSR) : solve(nWSR));
+      }
 
-       if( qp_problem_.hotstart(qp_builder_.get_H().data(), qp_builder_.get_g().data(), 
-           qp_builder_.get_A().data(), qp_builder_.get_lb().data(), qp_builder_.get_ub().data(),
-           qp_builder_.get_lbA().data(), qp_builder_.get_ubA().data(), nWSR)
-           != qpOASES::SUCCESSFUL_RETURN )
-          return false;
+      // Updates with observables gathered from source, see bind_observables().
+      bool update(const ObservableBinding& binding, const double* source, int nWSR)
+      {
+        update_qp_builder(binding, source);
+        return record_solve_time(has_priority_levels() ? update_cascade(nWSR) : solve(nWSR));
+      }
 
-        qp_problem_.getPrimalSolution(xdot_full_.data());
-        xdot_control_ = xdot_full_.segment(0, qp_builder_.num_controllables());
-        xdot_slack_ = xdot_full_.segment(qp_builder_.num_controllables(), qp_builder_.num_soft_constraints());
+      // Names of the observables, i.e. of the inputs of the expressions. Defaults
+      // to the controllable names, which name the first inputs.
+      const std::vector<std::string>& get_observable_names() const
+      {
+        return observable_names_;
+      }
 
-        return true;
+      void set_observable_names(const StringVector& observable_names)
+      {
+        if(observable_names.size() < qp_builder_.num_observables())
+          throw std::invalid_argument("Received " + boost::lexical_cast<std::string>(observable_names.size()) +
+              " observable names, but the controller has " +
+              boost::lexical_cast<std::string>(qp_builder_.num_observables()) + " observables.");
+        observable_names_ = observable_names;
+      }
+
+      // Resolves the observable names against the layout of a caller-owned buffer
+      // once. Pass the result together with a pointer to the buffer to start() and
+      // update() to gather the observables without an intermediate vector.
+      ObservableBinding bind_observables(const StringVector& source_names) const
+      {
+        ObservableBinding binding(get_observable_names(), source_names);
+        check_binding(binding);
+        return binding;
       }
 
       const Eigen::VectorXd& get_command() const
@@ -137,11 +317,476 @@ namespace giskard
         return soft_constraint_names_;
       }
 
+      const QPSolver& get_solver() const
+      {
+        return *solver_;
+      }
+
+      // Replaces the solver; call start() afterwards.
+      void set_solver(const QPSolverPtr& solver)
+      {
+        if(!solver.get())
+          throw std::invalid_argument("Asked to set a null QP solver.");
+
+        solver_ = solver;
+        cold_start_.reset();
+        has_good_solution_ = false;
+        init_cascade();
+      }
+
+      void set_solver_type(QPSolverType solver_type)
+      {
+        set_solver(create_qp_solver(solver_type));
+      }
+
+      // The factory chooses the solver right away and during each init(), i.e.
+      // it overrides the solver set with set_solver() before.
+      void set_solver_factory(const QPSolverFactory& solver_factory)
+      {
+        solver_factory_ = solver_factory;
+        if(solver_factory_)
+          set_solver(solver_factory_(qp_builder_));
+      }
+
+      // Assigns every soft constraint a priority level, 0 being the most important
+      // one. With more than one level, start() and update() solve a QPCascade
+      // with one QP per level instead of a single QP, each level with its own
+      // copy of the solver, or one from the solver factory. Working sets are not
+      // available then. A level that fails to hotstart is solved from scratch; if
+      // that fails too, the recovery ladder shrinks to one retry of the cascade
+      // with more working set recalculations, followed by the safe command.
+      // Call after init(), and start() afterwards.
+      void set_soft_priorities(const std::vector<size_t>& priorities)
+      {
+        if(priorities.size() != qp_builder_.num_soft_constraints())
+          throw std::invalid_argument("Received " + boost::lexical_cast<std::string>(priorities.size()) +
+              " soft constraint priorities, but " + boost::lexical_cast<std::string>(qp_builder_.num_soft_constraints()) +
+              " soft constraints were specified.");
+
+        soft_priorities_ = priorities;
+        init_cascade();
+      }
+
+      const std::vector<size_t>& get_soft_priorities() const
+      {
+        return soft_priorities_;
+      }
+
+      bool has_priority_levels() const
+      {
+        return cascade_.num_levels() > 1;
+      }
+
+      const QPCascade& get_cascade() const
+      {
+        return cascade_;
+      }
+
+      // Evaluates the expressions of the QP on num_threads threads, see
+      // QPProblemBuilder::set_num_threads(). Call after init().
+      void set_num_evaluation_threads(size_t num_threads)
+      {
+        qp_builder_.set_num_threads(num_threads);
+      }
+
+      size_t get_num_evaluation_threads() const
+      {
+        return qp_builder_.get_num_threads();
+      }
+
+      const QPRecoveryOptions& get_recovery_options() const
+      {
+        return recovery_options_;
+      }
+
+      void set_recovery_options(const QPRecoveryOptions& recovery_options)
+      {
+        recovery_options_ = recovery_options;
+      }
+
+      const QPRecoveryStatistics& get_recovery_statistics() const
+      {
+        return recovery_statistics_;
+      }
+
+      void reset_recovery_statistics()
+      {
+        recovery_statistics_ = QPRecoveryStatistics();
+      }
+
+      const QPCycleTimings& get_cycle_timings() const
+      {
+        return cycle_timings_;
+      }
+
+      // True while a background cold start is running.
+      bool is_recovering() const
+      {
+        return cold_start_.get() != 0;
+      }
+
+      // Plain copies of a QPController share their expression graphs, and evaluating
+      // those from several threads corrupts the cached values inside the graph. This
+      // returns a controller with a deep copy of the expression graph instead. The
+      // state of the QP solver is copied along, so a clone of a started controller
+      // can be updated right away without calling start() again.
+      QPController clone() const
+      {
+        QPController result(*this);
+        result.qp_builder_ = qp_builder_.clone();
+        // a running background cold start stays with the original
+        result.cold_start_.reset();
+        return result;
+      }
+
     private:
+      // Holds the solver of a controller. Copies of a controller get their own copy
+      // of the solver, so their QPs do not interfere.
+      class SolverHandle
+      {
+        public:
+          explicit SolverHandle(const QPSolverPtr& solver) : solver_(solver) {}
+
+          SolverHandle(const SolverHandle& other) : solver_(other.solver_->clone()) {}
+
+          SolverHandle& operator=(const SolverHandle& other)
+          {
+            if(this != &other)
+              solver_ = other.solver_->clone();
+            return *this;
+          }
+
+          SolverHandle& operator=(const QPSolverPtr& solver)
+          {
+            solver_ = solver;
+            return *this;
+          }
+
+          QPSolver* operator->() const
+          {
+            return solver_.get();
+          }
+
+          QPSolver& operator*() const
+          {
+            return *solver_;
+          }
+
+          const QPSolverPtr& get() const
+          {
+            return solver_;
+          }
+
+        private:
+          QPSolverPtr solver_;
+      };
+
+      // A cold start of the QP running in the background, working on its own
+      // solver and its own copy of the QP matrices.
+      class ColdStart
+      {
+        public:
+          ColdStart(const QPSolverPtr& solver, const QPProblemBuilder& builder, int nWSR) :
+            solver_(solver), builder_(builder), nWSR_(nWSR), success_(false), done_(false)
+          {
+            thread_ = boost::thread(boost::bind(&ColdStart::run, this));
+          }
+
+          ~ColdStart()
+          {
+            thread_.join();
+          }
+
+          bool is_done() const
+          {
+            return done_.load(boost::memory_order_acquire);
+          }
+
+          bool is_successful() const
+          {
+            return is_done() && success_;
+          }
+
+          const QPSolverPtr& get_solver() const
+          {
+            return solver_;
+          }
+
+        private:
+          QPSolverPtr solver_;
+          // only the matrices of this copy are used, never its expressions
+          QPProblemBuilder builder_;
+          int nWSR_;
+          bool success_;
+          boost::atomic<bool> done_;
+          boost::thread thread_;
+
+          void run()
+          {
+            success_ = solver_->init(builder_, nWSR_);
+            done_.store(true, boost::memory_order_release);
+          }
+
+          // not copyable
+          ColdStart(const ColdStart&);
+          ColdStart& operator=(const ColdStart&);
+      };
+
       giskard::QPProblemBuilder qp_builder_;
-      qpOASES::SQProblem qp_problem_;
+      SolverHandle solver_;
+      std::vector<size_t> soft_priorities_;
+      // only used with more than one priority level
+      QPCascade cascade_;
+      QPSolverFactory solver_factory_;
       Eigen::VectorXd xdot_full_, xdot_control_, xdot_slack_;
-      std::vector<std::string> controllable_names_, soft_constraint_names_;
+      std::vector<std::string> controllable_names_, soft_constraint_names_, observable_names_;
+
+      QPRecoveryOptions recovery_options_;
+      QPRecoveryStatistics recovery_statistics_;
+      // primal and dual solution of the last successful solve
+      QPWorkingSet good_solution_;
+      bool has_good_solution_;
+      boost::shared_ptr<ColdStart> cold_start_;
+
+      QPCycleTimings cycle_timings_;
+      Stopwatch cycle_stopwatch_;
+
+      void init_cascade()
+      {
+        std::set<size_t> levels(soft_priorities_.begin(), soft_priorities_.end());
+        if(levels.size() <= 1)
+        {
+          cascade_ = QPCascade();
+          return;
+        }
+
+        cascade_.init(qp_builder_, soft_priorities_);
+        for(size_t level=0; level<cascade_.num_levels(); ++level)
+          cascade_.set_solver(level, solver_factory_ ?
+              solver_factory_(cascade_.get_builder(level)) : solver_->clone());
+      }
+
+      void check_no_priority_levels() const
+      {
+        if(has_priority_levels())
+          throw std::runtime_error("Working sets are not supported for controllers with priority levels.");
+      }
+
+      bool solve_cascade(int nWSR, bool hotstart)
+      {
+        if(!cascade_.solve(qp_builder_, nWSR, hotstart))
+        {
+          std::cout << "Priority level of QP-Problem returned without success! ERROR MESSAGE: " <<
+            to_string(cascade_.get_status()) << std::endl;
+          return false;
+        }
+
+        cascade_.get_primal_solution(xdot_full_);
+        xdot_control_ = xdot_full_.segment(0, qp_builder_.num_controllables());
+        xdot_slack_ = xdot_full_.segment(qp_builder_.num_controllables(), qp_builder_.num_soft_constraints());
+        return true;
+      }
+
+      bool update_cascade(int nWSR)
+      {
+        if(solve_cascade(nWSR, true))
+          return true;
+
+        if(!recovery_options_.enabled_)
+          return false;
+
+        recovery_statistics_.num_failures_++;
+        recovery_statistics_.num_retries_++;
+        if(solve_cascade(nWSR * std::max(recovery_options_.nWSR_factor_, 1), true))
+        {
+          recovery_statistics_.num_retry_successes_++;
+          return true;
+        }
+
+        return serve_safe_command();
+      }
+
+      void reset_solver_state()
+      {
+        cold_start_.reset();
+        has_good_solution_ = false;
+      }
+
+      // The update_qp_builder() overloads time the evaluation and restart the
+      // stopwatch for record_solve_time().
+      void update_qp_builder(const Eigen::Ref<const Eigen::VectorXd>& observables)
+      {
+        cycle_stopwatch_.restart();
+        qp_builder_.update(observables);
+        cycle_timings_.evaluation_seconds_ = cycle_stopwatch_.get_elapsed_seconds();
+        cycle_stopwatch_.restart();
+      }
+
+      void update_qp_builder(const ObservableBinding& binding, const double* source)
+      {
+        check_binding(binding);
+        cycle_stopwatch_.restart();
+        qp_builder_.update(source, binding.get_indices());
+        cycle_timings_.evaluation_seconds_ = cycle_stopwatch_.get_elapsed_seconds();
+        cycle_stopwatch_.restart();
+      }
+
+      bool record_solve_time(bool success)
+      {
+        cycle_timings_.solve_seconds_ = cycle_stopwatch_.get_elapsed_seconds();
+        return success;
+      }
+
+      void check_binding(const ObservableBinding& binding) const
+      {
+        if(binding.num_observables() < qp_builder_.num_observables())
+          throw std::invalid_argument("Received a binding for " +
+              boost::lexical_cast<std::string>(binding.num_observables()) + " observables, but the controller has " +
+              boost::lexical_cast<std::string>(qp_builder_.num_observables()) + " observables.");
+      }
+
+      bool init_solver(int nWSR)
+      {
+        reset_solver_state();
+
+        if(!solver_->init(qp_builder_, nWSR))
+        {
+          std::cout << "Init of QP-Problem returned without success! ERROR MESSAGE: " << 
+            solver_->get_status_message() << std::endl;
+          std::cout << "Printing internals." << std::endl;
+          qp_builder_.print_internals();
+          std::cout << "nWSR: " << nWSR << std::endl;
+          qp_builder_.are_internals_valid();
+          return false;
+        }
+        
+        read_solution();
+        return true;
+      }
+
+      bool solve(int nWSR)
+      {
+        if(cold_start_.get())
+          return finish_cold_start(nWSR);
+
+        if(hotstart(nWSR))
+          return true;
+
+        if(!recovery_options_.enabled_)
+          return false;
+
+        return recover(nWSR);
+      }
+
+      void check_working_set(const QPWorkingSet& working_set) const
+      {
+        if(working_set.controllable_names_ != controllable_names_ ||
+           working_set.soft_constraint_names_ != soft_constraint_names_)
+          throw std::invalid_argument("Received a working set of a controller with different controllables or soft constraints.");
+
+        if(static_cast<size_t>(working_set.primal_.rows()) != qp_builder_.num_weights() ||
+           static_cast<size_t>(working_set.dual_.rows()) != qp_builder_.num_weights() + qp_builder_.num_constraints() ||
+           working_set.bounds_.size() != qp_builder_.num_weights() ||
+           working_set.constraints_.size() != qp_builder_.num_constraints())
+          throw std::invalid_argument("Received a working set with " +
+              boost::lexical_cast<std::string>(working_set.primal_.rows()) + " variables and " +
+              boost::lexical_cast<std::string>(working_set.constraints_.size()) + " constraints, but the QP has " +
+              boost::lexical_cast<std::string>(qp_builder_.num_weights()) + " variables and " +
+              boost::lexical_cast<std::string>(qp_builder_.num_constraints()) + " constraints.");
+      }
+
+      bool hotstart(int nWSR)
+      {
+        if(!solver_->hotstart(qp_builder_, nWSR))
+          return false;
+
+        read_solution();
+        return true;
+      }
+
+      void read_solution()
+      {
+        solver_->get_primal_solution(xdot_full_);
+        xdot_control_ = xdot_full_.segment(0, qp_builder_.num_controllables());
+        xdot_slack_ = xdot_full_.segment(qp_builder_.num_controllables(), qp_builder_.num_soft_constraints());
+
+        if(recovery_options_.enabled_)
+        {
+          good_solution_.primal_ = xdot_full_;
+          has_good_solution_ = solver_->get_dual_solution(good_solution_.dual_);
+        }
+      }
+
+      bool recover(int nWSR)
+      {
+        recovery_statistics_.num_failures_++;
+        int recovery_nWSR = nWSR * std::max(recovery_options_.nWSR_factor_, 1);
+
+        recovery_statistics_.num_retries_++;
+        if(hotstart(recovery_nWSR))
+        {
+          recovery_statistics_.num_retry_successes_++;
+          return true;
+        }
+
+        if(has_good_solution_)
+        {
+          recovery_statistics_.num_resets_++;
+          if(solver_->init(qp_builder_, recovery_nWSR, good_solution_))
+          {
+            recovery_statistics_.num_reset_successes_++;
+            read_solution();
+            return true;
+          }
+        }
+
+        recovery_statistics_.num_cold_starts_++;
+        has_good_solution_ = false;
+        if(recovery_options_.background_cold_start_)
+        {
+          cold_start_.reset(new ColdStart(solver_->clone(), qp_builder_, recovery_nWSR));
+          return serve_safe_command();
+        }
+
+        if(solver_->init(qp_builder_, recovery_nWSR))
+        {
+          recovery_statistics_.num_cold_start_successes_++;
+          read_solution();
+          return true;
+        }
+
+        return serve_safe_command();
+      }
+
+      bool finish_cold_start(int nWSR)
+      {
+        if(!cold_start_->is_done())
+          return serve_safe_command();
+
+        bool success = cold_start_->is_successful();
+        if(success)
+        {
+          recovery_statistics_.num_cold_start_successes_++;
+          // copies of this controller share the cold start, each takes its own solver
+          solver_ = cold_start_->get_solver()->clone();
+        }
+        cold_start_.reset();
+
+        // the cold start solved the QP of an earlier update, catch up with this one
+        if(success && hotstart(nWSR))
+          return true;
+
+        return recover(nWSR);
+      }
+
+      bool serve_safe_command()
+      {
+        recovery_statistics_.num_safe_commands_++;
+        xdot_full_.setZero();
+        xdot_control_.setZero();
+        xdot_slack_.setZero();
+        return false;
+      }
   };
 
 }
@@ -22,6 +22,7 @@
 #define GISKARD_QP_PROBLEM_BUILDER_HPP
 
 #include <giskard/expressiontree.hpp>
+#include <giskard/parallel_evaluation.hpp>
 
 namespace giskard
 {
@@ -31,6 +32,10 @@ namespace giskard
       typedef typename std::vector< KDL::Expression<double>::Ptr > DoubleExpressionVector;
       typedef typename Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> Matrix;
       typedef typename Eigen::VectorXd Vector;
+
+      QPProblemBuilder() :
+        num_controllables_(0), num_soft_constraints_(0), num_hard_constraints_(0),
+        num_observables_(0) {}
      
       void init(const DoubleExpressionVector& controllable_lower_bounds,
           const DoubleExpressionVector& controllable_upper_bounds, const DoubleExpressionVector& controllable_weights,
@@ -45,12 +50,64 @@ namespace giskard
             hard_lower_bounds, hard_upper_bounds);
  
         create_output_matrices();
+
+        if(evaluator_.get())
+          set_num_threads(evaluator_->get_num_threads());
+      }
+
+      // Accepts any contiguous vector, e.g. an Eigen::Map of a raw pointer.
+      void update(const Eigen::Ref<const Vector>& observables)
+      {
+        if(!evaluator_.get())
+        {
+          update_expressions(observables);
+          copy_values();
+          return;
+        }
+
+        check_num_observables(observables.rows());
+        evaluator_->evaluate(observables, get_matrices());
+      }
+
+      // Gathers observable i from source[indices[i]], see ObservableBinding.
+      void update(const double* source, const std::vector<size_t>& indices)
+      {
+        if(!evaluator_.get())
+        {
+          update_expressions(source, indices);
+          copy_values();
+          return;
+        }
+
+        check_num_observables(indices.size());
+        evaluator_->evaluate(source, indices, get_matrices());
       }
 
-      void update(const Vector& observables)
+      // Splits the rows of the QP over num_threads threads which evaluate them in
+      // parallel on every update, see ParallelQPEvaluator; 1 evaluates serially.
+      // Call after init(). The threads work on deep copies of the expressions, i.e.
+      // the expressions returned by the getters of this builder are not evaluated
+      // in parallel mode. Plain copies of the builder share its threads, clones
+      // get their own.
+      void set_num_threads(size_t num_threads)
       {
-        update_expressions(observables);
-        copy_values();
+        if(num_threads <= 1)
+        {
+          evaluator_.reset();
+          return;
+        }
+
+        evaluator_.reset(new ParallelQPEvaluator(num_threads,
+            controllable_lower_bounds_.get_expressions(), controllable_upper_bounds_.get_expressions(),
+            controllable_weights_.get_expressions(), soft_expressions_.get_expressions(),
+            soft_lower_bounds_.get_expressions(), soft_upper_bounds_.get_expressions(),
+            soft_weights_.get_expressions(), hard_expressions_.get_expressions(),
+            hard_lower_bounds_.get_expressions(), hard_upper_bounds_.get_expressions()));
+      }
+
+      size_t get_num_threads() const
+      {
+        return evaluator_.get() ? evaluator_->get_num_threads() : 1;
       }
 
       const Matrix& get_H() const
@@ -90,12 +147,12 @@ namespace giskard
 
       size_t num_controllables() const
       {
-        return controllable_weights_.num_expressions();
+        return num_controllables_;
       }
 
       size_t num_hard_constraints() const
       {
-        return hard_expressions_.num_expressions();
+        return num_hard_constraints_;
       }
 
       size_t num_hard_constraints_observables() const
@@ -105,7 +162,7 @@ namespace giskard
 
       size_t num_soft_constraints() const
       {
-        return soft_expressions_.num_expressions();
+        return num_soft_constraints_;
       }
 
       size_t num_soft_constraints_observables() const
@@ -113,6 +170,12 @@ namespace giskard
         return soft_expressions_.num_inputs();
       }
 
+      // number of observables the expressions of this QP depend on
+      size_t num_observables() const
+      {
+        return num_observables_;
+      }
+
       size_t num_constraints() const
       {
         return num_soft_constraints() + num_hard_constraints();
@@ -133,6 +196,11 @@ namespace giskard
         return controllable_upper_bounds_.get_expressions();
       }
 
+      const DoubleExpressionVector& get_controllable_weights() const
+      {
+        return controllable_weights_.get_expressions();
+      }
+
       const DoubleExpressionVector& get_soft_lower_bounds() const
       {
         return soft_lower_bounds_.get_expressions();
@@ -152,6 +220,21 @@ namespace giskard
       {
         return soft_weights_.get_expressions();
       }
+
+      const DoubleExpressionVector& get_hard_expressions() const
+      {
+        return hard_expressions_.get_expressions();
+      }
+
+      const DoubleExpressionVector& get_hard_lower_bounds() const
+      {
+        return hard_lower_bounds_.get_expressions();
+      }
+
+      const DoubleExpressionVector& get_hard_upper_bounds() const
+      {
+        return hard_upper_bounds_.get_expressions();
+      }
     
       void print_internals() const
       {
@@ -169,6 +252,89 @@ namespace giskard
         return are_controllables_valid();
       }
 
+      // Returns a builder with deep copies of all expressions of this builder and
+      // the last computed QP matrices, see KDL::ExpressionArray::clone(). All arrays
+      // are cloned with one memo, so nodes shared between them stay shared.
+      QPProblemBuilder clone() const
+      {
+        KDL::ExpressionCloneMemo memo;
+        QPProblemBuilder result(*this);
+        result.controllable_lower_bounds_ = controllable_lower_bounds_.clone(memo);
+        result.controllable_upper_bounds_ = controllable_upper_bounds_.clone(memo);
+        result.controllable_weights_ = controllable_weights_.clone(memo);
+        result.soft_expressions_ = soft_expressions_.clone(memo);
+        result.soft_lower_bounds_ = soft_lower_bounds_.clone(memo);
+        result.soft_upper_bounds_ = soft_upper_bounds_.clone(memo);
+        result.soft_weights_ = soft_weights_.clone(memo);
+        result.hard_expressions_ = hard_expressions_.clone(memo);
+        result.hard_lower_bounds_ = hard_lower_bounds_.clone(memo);
+        result.hard_upper_bounds_ = hard_upper_bounds_.clone(memo);
+        result.prepare_optimizer();
+        if(evaluator_.get())
+          result.evaluator_ = evaluator_->clone();
+        return result;
+      }
+
+      // Initializes this builder as a sub-problem of builder, e.g. one priority
+      // level of QPCascade. It keeps the soft constraints with the indices in
+      // soft_constraints, and turns those in fixed_soft_constraints into constraints
+      // without slack that follow the hard constraints. All other soft constraints
+      // are dropped. A sub-problem has no expressions and only takes its dimensions
+      // from builder, update_sub_problem() copies its matrices from builder instead.
+      void init_sub_problem(const QPProblemBuilder& builder, const std::vector<size_t>& fixed_soft_constraints,
+          const std::vector<size_t>& soft_constraints)
+      {
+        check_soft_constraint_indices(builder, fixed_soft_constraints);
+        check_soft_constraint_indices(builder, soft_constraints);
+
+        controllable_lower_bounds_ = controllable_upper_bounds_ = controllable_weights_ =
+            soft_expressions_ = soft_lower_bounds_ = soft_upper_bounds_ = soft_weights_ =
+            hard_expressions_ = hard_lower_bounds_ = hard_upper_bounds_ = KDL::DoubleExpressionArray();
+        optimizer_.clear();
+        evaluator_.reset();
+
+        num_controllables_ = builder.num_controllables();
+        num_hard_constraints_ = builder.num_hard_constraints() + fixed_soft_constraints.size();
+        num_soft_constraints_ = soft_constraints.size();
+        num_observables_ = 0;
+
+        create_output_matrices();
+      }
+
+      // Copies the last QP of builder into this sub-problem, see init_sub_problem().
+      // The bounds of the fixed soft constraints get shifted by fixed_slacks, i.e.
+      // their slacks stay at these values.
+      void update_sub_problem(const QPProblemBuilder& builder, const std::vector<size_t>& fixed_soft_constraints,
+          const Eigen::VectorXd& fixed_slacks, const std::vector<size_t>& soft_constraints)
+      {
+        size_t n = num_controllables(), nh = builder.num_hard_constraints(), nf = fixed_soft_constraints.size();
+
+        H_.diagonal().head(n) = builder.get_H().diagonal().head(n);
+        lb_.head(n) = builder.get_lb().head(n);
+        ub_.head(n) = builder.get_ub().head(n);
+
+        A_.topLeftCorner(nh, n) = builder.get_A().topLeftCorner(nh, n);
+        lbA_.head(nh) = builder.get_lbA().head(nh);
+        ubA_.head(nh) = builder.get_ubA().head(nh);
+
+        for(size_t i=0; i<nf; ++i)
+        {
+          size_t row = nh + fixed_soft_constraints[i];
+          A_.block(nh + i, 0, 1, n) = builder.get_A().block(row, 0, 1, n);
+          lbA_(nh + i) = builder.get_lbA()(row) - fixed_slacks(i);
+          ubA_(nh + i) = builder.get_ubA()(row) - fixed_slacks(i);
+        }
+
+        for(size_t i=0; i<soft_constraints.size(); ++i)
+        {
+          size_t row = nh + soft_constraints[i];
+          A_.block(nh + nf + i, 0, 1, n) = builder.get_A().block(row, 0, 1, n);
+          lbA_(nh + nf + i) = builder.get_lbA()(row);
+          ubA_(nh + nf + i) = builder.get_ubA()(row);
+          H_(n + i, n + i) = builder.get_H()(n + soft_constraints[i], n + soft_constraints[i]);
+        }
+      }
+
     private:
       KDL::DoubleExpressionArray controllable_lower_bounds_, controllable_upper_bounds_,
          controllable_weights_, soft_expressions_, soft_lower_bounds_, soft_upper_bounds_,
@@ -177,6 +343,34 @@ namespace giskard
       Matrix H_, A_;
       Vector g_, lb_, ub_, lbA_, ubA_;
 
+      // one optimizer for all arrays, so nodes shared between them, e.g. cached
+      // frames, get computed once per update
+      KDL::ExpressionArrayOptimizer optimizer_;
+      size_t num_controllables_, num_soft_constraints_, num_hard_constraints_, num_observables_;
+      ParallelQPEvaluatorPtr evaluator_;
+
+      QPMatrices get_matrices()
+      {
+        return QPMatrices(H_, A_, lb_, ub_, lbA_, ubA_);
+      }
+
+      void check_num_observables(size_t num_observables) const
+      {
+        if(num_observables < num_observables_)
+          throw std::invalid_argument("QP needs " + boost::lexical_cast<std::string>(num_observables_) +
+              " observables, but received " + boost::lexical_cast<std::string>(num_observables) + ".");
+      }
+
+      static void check_soft_constraint_indices(const QPProblemBuilder& builder,
+          const std::vector<size_t>& indices)
+      {
+        for(size_t i=0; i<indices.size(); ++i)
+          if(indices[i] >= builder.num_soft_constraints())
+            throw std::out_of_range("QP has " +
+                boost::lexical_cast<std::string>(builder.num_soft_constraints()) +
+                " soft constraints, but received index " + boost::lexical_cast<std::string>(indices[i]) + ".");
+      }
+
       bool are_controllables_valid() const
       {
         bool result = true;
@@ -231,6 +425,29 @@ namespace giskard
         hard_expressions_.set_expressions(hard_expressions);
         hard_lower_bounds_.set_expressions(hard_lower_bounds);
         hard_upper_bounds_.set_expressions(hard_upper_bounds);
+
+        num_controllables_ = controllable_weights_.num_expressions();
+        num_soft_constraints_ = soft_expressions_.num_expressions();
+        num_hard_constraints_ = hard_expressions_.num_expressions();
+
+        prepare_optimizer();
+        num_observables_ = optimizer_.num_inputs();
+      }
+
+      void prepare_optimizer()
+      {
+        optimizer_.clear();
+        optimizer_.add(controllable_lower_bounds_.get_expressions());
+        optimizer_.add(controllable_upper_bounds_.get_expressions());
+        optimizer_.add(controllable_weights_.get_expressions());
+        optimizer_.add(soft_expressions_.get_expressions());
+        optimizer_.add(soft_lower_bounds_.get_expressions());
+        optimizer_.add(soft_upper_bounds_.get_expressions());
+        optimizer_.add(soft_weights_.get_expressions());
+        optimizer_.add(hard_expressions_.get_expressions());
+        optimizer_.add(hard_lower_bounds_.get_expressions());
+        optimizer_.add(hard_upper_bounds_.get_expressions());
+        optimizer_.prepare();
       }
 
       void create_output_matrices()
@@ -244,24 +461,41 @@ namespace giskard
         g_ = Eigen::VectorXd::Zero(num_weights());
         lb_ = Eigen::VectorXd::Zero(num_weights());
         ub_ = Eigen::VectorXd::Zero(num_weights());
+        // TODO: try to get rid of these constants
+        lb_.segment(num_controllables(), num_soft_constraints()) = 
+            -1e+9 * Eigen::VectorXd::Ones(num_soft_constraints());
+        ub_.segment(num_controllables(), num_soft_constraints()) = 
+            1e+9 * Eigen::VectorXd::Ones(num_soft_constraints());
         lbA_ = Eigen::VectorXd::Zero(num_constraints());
         ubA_ = Eigen::VectorXd::Zero(num_constraints());
       }
 
-      void update_expressions(const Vector& observables)
+      void update_expressions(const Eigen::Ref<const Vector>& observables)
       {
-        update_expressions(controllable_lower_bounds_, observables);
-        update_expressions(controllable_upper_bounds_, observables);
-        update_expressions(controllable_weights_, observables);
+        optimizer_.set_inputs(observables);
+        read_expressions();
+      }
 
-        update_expressions(soft_expressions_, observables);
-        update_expressions(soft_lower_bounds_, observables);
-        update_expressions(soft_upper_bounds_, observables);
-        update_expressions(soft_weights_, observables);
+      void update_expressions(const double* source, const std::vector<size_t>& indices)
+      {
+        optimizer_.set_inputs(source, indices);
+        read_expressions();
+      }
+
+      void read_expressions()
+      {
+        controllable_lower_bounds_.read();
+        controllable_upper_bounds_.read();
+        controllable_weights_.read();
 
-        update_expressions(hard_expressions_, observables);
-        update_expressions(hard_lower_bounds_, observables);
-        update_expressions(hard_upper_bounds_, observables);
+        soft_expressions_.read(A_.block(num_hard_constraints(), 0, num_soft_constraints(), num_controllables()));
+        soft_lower_bounds_.read();
+        soft_upper_bounds_.read();
+        soft_weights_.read();
+
+        hard_expressions_.read(A_.block(0, 0, num_hard_constraints(), num_controllables()));
+        hard_lower_bounds_.read();
+        hard_upper_bounds_.read();
       }
 
       void copy_values()
@@ -271,31 +505,14 @@ namespace giskard
         H_.diagonal().segment(num_controllables(), num_soft_constraints()) =
             soft_weights_.get_values();
 
-        size_t cols_to_copy = std::min(num_hard_constraints_observables(), num_controllables());
-        A_.block(0, 0, num_hard_constraints(), cols_to_copy) =
-            hard_expressions_.get_derivatives().block(0, 0, num_hard_constraints(), cols_to_copy);
-        cols_to_copy = std::min(num_soft_constraints_observables(), num_controllables());
-        A_.block(num_hard_constraints(), 0, num_soft_constraints(), cols_to_copy) = 
-            soft_expressions_.get_derivatives().block(0, 0, num_soft_constraints(), cols_to_copy);
-
         lb_.segment(0, num_controllables()) = controllable_lower_bounds_.get_values();
-        // TODO: try to get rid of these constants
-        lb_.segment(num_controllables(), num_soft_constraints()) = 
-            -1e+9 * Eigen::VectorXd::Ones(num_soft_constraints());
         ub_.segment(0, num_controllables()) = controllable_upper_bounds_.get_values();
-        ub_.segment(num_controllables(), num_soft_constraints()) = 
-            1e+9 * Eigen::VectorXd::Ones(num_soft_constraints());
 
         lbA_.segment(0, num_hard_constraints()) = hard_lower_bounds_.get_values();
         lbA_.segment(num_hard_constraints(), num_soft_constraints()) = soft_lower_bounds_.get_values();
         ubA_.segment(0, num_hard_constraints()) = hard_upper_bounds_.get_values();
         ubA_.segment(num_hard_constraints(), num_soft_constraints()) = soft_upper_bounds_.get_values();
       }
-
-      void update_expressions(KDL::DoubleExpressionArray& expressions, const Vector& values) const
-      {
-        expressions.update(values.segment(0, expressions.num_inputs()));
-      }
   };
 } 
 
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_QP_SOLVER_HPP
+#define GISKARD_QP_SOLVER_HPP
+
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <giskard/qp_problem_builder.hpp>
+#include <giskard/qp_working_set.hpp>
+#include <giskard/stopwatch.hpp>
+
+namespace giskard
+{
+  enum QPSolverStatus
+  {
+    QP_NOT_INITIALIZED,
+    QP_SOLVED,
+    QP_MAX_ITERATIONS_REACHED,
+    QP_INFEASIBLE,
+    QP_FAILED
+  };
+
+  inline std::string to_string(QPSolverStatus status)
+  {
+    switch(status)
+    {
+      case QP_NOT_INITIALIZED:
+        return "not initialized";
+      case QP_SOLVED:
+        return "solved";
+      case QP_MAX_ITERATIONS_REACHED:
+        return "maximum number of iterations reached";
+      case QP_INFEASIBLE:
+        return "infeasible";
+      default:
+        return "failed";
+    }
+  }
+
+  class QPSolver;
+  typedef typename boost::shared_ptr<QPSolver> QPSolverPtr;
+
+  // Interface of the QP solvers used by QPController. Solvers work directly on
+  // the output of a QPProblemBuilder. Implementations provide do_init() and
+  // do_hotstart(); status, iteration counts and timing get recorded here.
+  class QPSolver
+  {
+    public:
+      QPSolver() :
+        status_(QP_NOT_INITIALIZED), num_iterations_(0), solve_seconds_(0.0) {}
+
+      virtual ~QPSolver() {}
+
+      virtual std::string get_name() const = 0;
+
+      // Returns an independent copy of this solver, including its current state.
+      virtual QPSolverPtr clone() const = 0;
+
+      // Solves the QP from scratch. Returns true if it was solved.
+      bool init(const QPProblemBuilder& builder, int max_iterations)
+      {
+        stopwatch_.restart();
+        return record(do_init(builder, max_iterations, 0));
+      }
+
+      // Solves the QP from scratch, starting from the given guess. Solvers may
+      // use any part of the guess, i.e. primal, dual or active sets, or ignore it.
+      bool init(const QPProblemBuilder& builder, int max_iterations, const QPWorkingSet& guess)
+      {
+        stopwatch_.restart();
+        return record(do_init(builder, max_iterations, &guess));
+      }
+
+      // Solves the QP starting from the solution of the previous one.
+      bool hotstart(const QPProblemBuilder& builder, int max_iterations)
+      {
+        if(status_ == QP_NOT_INITIALIZED)
+          return false;
+
+        stopwatch_.restart();
+        return record(do_hotstart(builder, max_iterations));
+      }
+
+      // Writes the primal solution of the last solve into x, resizing it if needed.
+      virtual void get_primal_solution(Eigen::VectorXd& x) const = 0;
+
+      // Writes the dual solution of the last solve into y, with the multipliers
+      // of the bounds followed by those of the constraints. Returns false if the
+      // solver does not provide them.
+      virtual bool get_dual_solution(Eigen::VectorXd&) const
+      {
+        return false;
+      }
+
+      // Returns false if the solver does not support working sets.
+      virtual bool get_working_set(QPWorkingSet&) const
+      {
+        return false;
+      }
+
+      QPSolverStatus get_status() const
+      {
+        return status_;
+      }
+
+      virtual std::string get_status_message() const
+      {
+        return to_string(status_);
+      }
+
+      // Iterations of the last solve; their meaning depends on the solver.
+      int get_num_iterations() const
+      {
+        return num_iterations_;
+      }
+
+      // Wall-clock time of the last solve.
+      double get_solve_seconds() const
+      {
+        return solve_seconds_;
+      }
+
+    protected:
+      virtual QPSolverStatus do_init(const QPProblemBuilder& builder, int max_iterations,
+          const QPWorkingSet* guess) = 0;
+
+      virtual QPSolverStatus do_hotstart(const QPProblemBuilder& builder, int max_iterations) = 0;
+
+      void set_num_iterations(int num_iterations)
+      {
+        num_iterations_ = num_iterations;
+      }
+
+    private:
+      QPSolverStatus status_;
+      int num_iterations_;
+      double solve_seconds_;
+      Stopwatch stopwatch_;
+
+      bool record(QPSolverStatus status)
+      {
+        status_ = status;
+        solve_seconds_ = stopwatch_.get_elapsed_seconds();
+        return status_ == QP_SOLVED;
+      }
+  };
+}
+
+#endif // GISKARD_QP_SOLVER_HPP
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_QP_WORKING_SET_HPP
+#define GISKARD_QP_WORKING_SET_HPP
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <giskard/expressiontree.hpp>
+#include <giskard/spec_serialization.hpp>
+
+namespace giskard
+{
+  // Snapshot of the solver state of a running QPController: the primal and dual
+  // solution and the status of every bound and constraint, i.e. -1 for active at
+  // the lower limit, 1 for active at the upper limit and 0 for inactive. The
+  // names of controllables and soft constraints identify the controller the
+  // snapshot belongs to.
+  class QPWorkingSet
+  {
+    public:
+      Eigen::VectorXd primal_, dual_;
+      std::vector<int> bounds_, constraints_;
+      std::vector<std::string> controllable_names_, soft_constraint_names_;
+
+      bool empty() const
+      {
+        return primal_.rows() == 0;
+      }
+
+      size_t num_active_bounds() const
+      {
+        return num_active(bounds_);
+      }
+
+      size_t num_active_constraints() const
+      {
+        return num_active(constraints_);
+      }
+
+    private:
+      static size_t num_active(const std::vector<int>& status)
+      {
+        size_t result = 0;
+        for(size_t i=0; i<status.size(); ++i)
+          if(status[i] == -1 || status[i] == 1)
+            ++result;
+        return result;
+      }
+  };
+
+  ///
+  /// binary serialization of working sets
+  ///
+
+  // The readers grow their containers while reading, like the reader of strings,
+  // so that a corrupt size runs into the end of the stream instead of
+  // allocating the claimed size up front.
+  namespace detail
+  {
+    inline void write_binary(std::ostream& os, const Eigen::VectorXd& values)
+    {
+      giskard::write_binary(os, static_cast<boost::uint64_t>(values.rows()));
+      for(size_t i=0; i<static_cast<size_t>(values.rows()); ++i)
+        giskard::write_binary(os, values(i));
+    }
+
+    inline void read_binary(std::istream& is, Eigen::VectorXd& values)
+    {
+      size_t size = read_binary_size(is);
+      values.resize(std::min<size_t>(size, 512));
+      for(size_t i=0; i<size; ++i)
+      {
+        if(i == static_cast<size_t>(values.rows()))
+          values.conservativeResize(std::min<size_t>(size, 2 * i));
+        giskard::read_binary(is, values(i));
+      }
+    }
+
+    inline void write_binary(std::ostream& os, const std::vector<int>& status)
+    {
+      giskard::write_binary(os, static_cast<boost::uint64_t>(status.size()));
+      for(size_t i=0; i<status.size(); ++i)
+        giskard::write_binary(os, static_cast<boost::uint64_t>(static_cast<boost::int64_t>(status[i])));
+    }
+
+    inline void read_binary(std::istream& is, std::vector<int>& status)
+    {
+      size_t size = read_binary_size(is);
+      status.clear();
+      for(size_t i=0; i<size; ++i)
+      {
+        boost::uint64_t value;
+        giskard::read_binary(is, value);
+        status.push_back(static_cast<int>(static_cast<boost::int64_t>(value)));
+      }
+    }
+
+    inline void write_binary(std::ostream& os, const std::vector<std::string>& names)
+    {
+      giskard::write_binary(os, static_cast<boost::uint64_t>(names.size()));
+      for(size_t i=0; i<names.size(); ++i)
+        giskard::write_binary(os, names[i]);
+    }
+
+    inline void read_binary(std::istream& is, std::vector<std::string>& names)
+    {
+      size_t size = read_binary_size(is);
+      names.clear();
+      for(size_t i=0; i<size; ++i)
+      {
+        names.push_back(std::string());
+        giskard::read_binary(is, names.back());
+      }
+    }
+  }
+
+  inline void write_binary(std::ostream& os, const QPWorkingSet& working_set)
+  {
+    detail::write_binary(os, working_set.controllable_names_);
+    detail::write_binary(os, working_set.soft_constraint_names_);
+    detail::write_binary(os, working_set.primal_);
+    detail::write_binary(os, working_set.dual_);
+    detail::write_binary(os, working_set.bounds_);
+    detail::write_binary(os, working_set.constraints_);
+  }
+
+  inline void read_binary(std::istream& is, QPWorkingSet& working_set)
+  {
+    detail::read_binary(is, working_set.controllable_names_);
+    detail::read_binary(is, working_set.soft_constraint_names_);
+    detail::read_binary(is, working_set.primal_);
+    detail::read_binary(is, working_set.dual_);
+    detail::read_binary(is, working_set.bounds_);
+    detail::read_binary(is, working_set.constraints_);
+  }
+}
+
+#endif // GISKARD_QP_WORKING_SET_HPP
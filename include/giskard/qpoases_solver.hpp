@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_QPOASES_SOLVER_HPP
+#define GISKARD_QPOASES_SOLVER_HPP
+
+#include <giskard/qp_solver.hpp>
+#include <qpOASES.hpp>
+
+namespace giskard
+{
+  // Solves QPs with the online active set strategy of qpOASES::SQProblem.
+  // max_iterations is the maximum number of working set recalculations (nWSR).
+  class QPOASESSolver : public QPSolver
+  {
+    public:
+      QPOASESSolver() :
+        num_variables_(0), num_constraints_(0), last_return_(qpOASES::SUCCESSFUL_RETURN)
+      {
+        options_.setToMPC();
+        options_.printLevel = qpOASES::PL_NONE;
+      }
+
+      explicit QPOASESSolver(const qpOASES::Options& options) :
+        options_(options), num_variables_(0), num_constraints_(0),
+        last_return_(qpOASES::SUCCESSFUL_RETURN) {}
+
+      virtual std::string get_name() const
+      {
+        return "qpOASES";
+      }
+
+      virtual QPSolverPtr clone() const
+      {
+        return QPSolverPtr(new QPOASESSolver(*this));
+      }
+
+      virtual void get_primal_solution(Eigen::VectorXd& x) const
+      {
+        x.resize(num_variables_);
+        problem_.getPrimalSolution(x.data());
+      }
+
+      virtual bool get_dual_solution(Eigen::VectorXd& y) const
+      {
+        y.resize(num_variables_ + num_constraints_);
+        return problem_.getDualSolution(y.data()) == qpOASES::SUCCESSFUL_RETURN;
+      }
+
+      virtual bool get_working_set(QPWorkingSet& working_set) const
+      {
+        get_primal_solution(working_set.primal_);
+        get_dual_solution(working_set.dual_);
+
+        qpOASES::Bounds bounds;
+        problem_.getBounds(bounds);
+        working_set.bounds_.resize(num_variables_);
+        for(size_t i=0; i<working_set.bounds_.size(); ++i)
+          working_set.bounds_[i] = bounds.getStatus(i);
+
+        qpOASES::Constraints constraints;
+        problem_.getConstraints(constraints);
+        working_set.constraints_.resize(num_constraints_);
+        for(size_t i=0; i<working_set.constraints_.size(); ++i)
+          working_set.constraints_[i] = constraints.getStatus(i);
+
+        return true;
+      }
+
+      virtual std::string get_status_message() const
+      {
+        return qpOASES::MessageHandling::getErrorCodeMessage(last_return_);
+      }
+
+      const qpOASES::Options& get_options() const
+      {
+        return options_;
+      }
+
+    protected:
+      virtual QPSolverStatus do_init(const QPProblemBuilder& builder, int max_iterations,
+          const QPWorkingSet* guess)
+      {
+        num_variables_ = builder.num_weights();
+        num_constraints_ = builder.num_constraints();
+        problem_ = qpOASES::SQProblem(num_variables_, num_constraints_);
+        problem_.setOptions(options_);
+
+        if(!guess)
+        {
+          last_return_ = problem_.init(builder.get_H().data(), builder.get_g().data(), 
+              builder.get_A().data(), builder.get_lb().data(), builder.get_ub().data(),
+              builder.get_lbA().data(), builder.get_ubA().data(), max_iterations);
+          return to_status(max_iterations);
+        }
+
+        // use the parts of the guess which fit the problem
+        bool use_bounds = guess->bounds_.size() == num_variables_;
+        qpOASES::Bounds bounds(num_variables_);
+        for(size_t i=0; use_bounds && i<guess->bounds_.size(); ++i)
+          bounds.setupBound(i, static_cast<qpOASES::SubjectToStatus>(guess->bounds_[i]));
+        bool use_constraints = guess->constraints_.size() == num_constraints_;
+        qpOASES::Constraints constraints(num_constraints_);
+        for(size_t i=0; use_constraints && i<guess->constraints_.size(); ++i)
+          constraints.setupConstraint(i, static_cast<qpOASES::SubjectToStatus>(guess->constraints_[i]));
+
+        last_return_ = problem_.init(builder.get_H().data(), builder.get_g().data(), 
+            builder.get_A().data(), builder.get_lb().data(), builder.get_ub().data(),
+            builder.get_lbA().data(), builder.get_ubA().data(), max_iterations, 0,
+            static_cast<size_t>(guess->primal_.rows()) == num_variables_ ? guess->primal_.data() : 0,
+            static_cast<size_t>(guess->dual_.rows()) == num_variables_ + num_constraints_ ? guess->dual_.data() : 0,
+            use_bounds ? &bounds : 0, use_constraints ? &constraints : 0);
+        return to_status(max_iterations);
+      }
+
+      virtual QPSolverStatus do_hotstart(const QPProblemBuilder& builder, int max_iterations)
+      {
+        last_return_ = problem_.hotstart(builder.get_H().data(), builder.get_g().data(), 
+            builder.get_A().data(), builder.get_lb().data(), builder.get_ub().data(),
+            builder.get_lbA().data(), builder.get_ubA().data(), max_iterations);
+        return to_status(max_iterations);
+      }
+
+    private:
+      qpOASES::Options options_;
+      qpOASES::SQProblem problem_;
+      size_t num_variables_, num_constraints_;
+      qpOASES::returnValue last_return_;
+
+      // qpOASES overwrites nWSR with the number of recalculations it performed
+      QPSolverStatus to_status(int nWSR)
+      {
+        set_num_iterations(nWSR);
+
+        if(last_return_ == qpOASES::SUCCESSFUL_RETURN)
+          return QP_SOLVED;
+        if(last_return_ == qpOASES::RET_MAX_NWSR_REACHED)
+          return QP_MAX_ITERATIONS_REACHED;
+        if(problem_.isInfeasible())
+          return QP_INFEASIBLE;
+        return QP_FAILED;
+      }
+  };
+}
+
+#endif // GISKARD_QPOASES_SOLVER_HPP
@@ -0,0 +1,469 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef GISKARD_RICCATI_QP_SOLVER_HPP
+#define GISKARD_RICCATI_QP_SOLVER_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Cholesky>
+#include <giskard/qp_solver.hpp>
+
+namespace giskard
+{
+  // Data of stage k of a block-banded QP over a horizon of N stages:
+  //
+  //   minimize    sum_k 1/2 v_k^T diag(r_k) v_k
+  //   subject to  x_{k+1} = x_k + B v_k,   x_0 = 0
+  //               C_k x_k + D_k v_k <= d_k
+  //
+  // with states x_k and inputs v_k. Every stage only couples to its neighbours
+  // through the dynamics, i.e. the stacked KKT system is block-tridiagonal.
+  class HorizonStage
+  {
+    public:
+      Eigen::VectorXd r_, d_;
+      Eigen::MatrixXd C_, D_;
+
+      size_t num_inputs() const
+      {
+        return r_.rows();
+      }
+
+      size_t num_inequalities() const
+      {
+        return d_.rows();
+      }
+  };
+
+  // Solves the QPs described by HorizonStage with a primal-dual interior point
+  // method (Mehrotra predictor-corrector). The Newton systems never get stacked:
+  // each one is an equality-constrained linear-quadratic problem that a backward
+  // Riccati recursion over the stages solves, followed by a forward pass. One
+  // iteration therefore costs O(N (n + m)^3) for n states and m inputs per
+  // stage, instead of O(N^3 (n + m)^3) for a dense factorization of the
+  // stacked problem. All buffers are kept between solves, i.e. solving
+  // problems of unchanged dimensions allocates no memory.
+  class RiccatiQPSolver
+  {
+    public:
+      RiccatiQPSolver() :
+        max_iterations_(100), tolerance_(1e-8), status_(QP_NOT_INITIALIZED),
+        num_iterations_(0), solve_seconds_(0.0) {}
+
+      size_t get_max_iterations() const
+      {
+        return max_iterations_;
+      }
+
+      void set_max_iterations(size_t max_iterations)
+      {
+        max_iterations_ = max_iterations;
+      }
+
+      double get_tolerance() const
+      {
+        return tolerance_;
+      }
+
+      // Iterations stop once all residuals and the duality measure are below
+      // tolerance times the scale of the problem, i.e. the largest absolute
+      // right-hand side d_ of any stage, but at least 1.
+      void set_tolerance(double tolerance)
+      {
+        tolerance_ = tolerance;
+      }
+
+      // B maps the inputs of a stage to the change of the state. Throws
+      // std::invalid_argument if the dimensions of the stages do not match B.
+      bool solve(const std::vector<HorizonStage>& stages, const Eigen::MatrixXd& B)
+      {
+        stopwatch_.restart();
+        status_ = run(stages, B);
+        solve_seconds_ = stopwatch_.get_elapsed_seconds();
+        return status_ == QP_SOLVED;
+      }
+
+      QPSolverStatus get_status() const
+      {
+        return status_;
+      }
+
+      int get_num_iterations() const
+      {
+        return num_iterations_;
+      }
+
+      double get_solve_seconds() const
+      {
+        return solve_seconds_;
+      }
+
+      size_t num_stages() const
+      {
+        return v_.size();
+      }
+
+      // inputs of stage k
+      const Eigen::VectorXd& get_inputs(size_t k) const
+      {
+        return v_[k];
+      }
+
+      // state at the beginning of stage k, k == num_stages() is the final state
+      const Eigen::VectorXd& get_state(size_t k) const
+      {
+        return x_[k];
+      }
+
+      // multipliers of the inequalities of stage k
+      const Eigen::VectorXd& get_multipliers(size_t k) const
+      {
+        return lambda_[k];
+      }
+
+    private:
+      size_t max_iterations_;
+      double tolerance_;
+      QPSolverStatus status_;
+      int num_iterations_;
+      double solve_seconds_;
+      Stopwatch stopwatch_;
+
+      // iterates; pi_[k] is the multiplier of the dynamics leading into x_k
+      std::vector<Eigen::VectorXd> x_, v_, lambda_, slack_, pi_;
+      // residuals of the KKT conditions
+      std::vector<Eigen::VectorXd> r_v_, r_x_, r_in_, r_dyn_;
+      // search directions
+      std::vector<Eigen::VectorXd> dx_, dv_, dlambda_, dslack_, dpi_;
+      // Riccati factorization of the current Newton system
+      std::vector<Eigen::LLT<Eigen::MatrixXd> > llt_;
+      std::vector<Eigen::MatrixXd> K_, P_, H_vv_, H_vx_;
+      std::vector<Eigen::VectorXd> k_, p_, w_, e_, r_c_;
+      Eigen::MatrixXd WC_, WD_, BtP_;
+      Eigen::VectorXd h_v_, Pc_;
+
+      void check_dimensions(const std::vector<HorizonStage>& stages, const Eigen::MatrixXd& B) const
+      {
+        if(stages.empty())
+          throw std::invalid_argument("RiccatiQPSolver: received no stages.");
+
+        for(size_t k=0; k<stages.size(); ++k)
+          if(stages[k].num_inputs() != static_cast<size_t>(B.cols()) || stages[k].C_.cols() != B.rows() ||
+             stages[k].D_.cols() != B.cols() || static_cast<size_t>(stages[k].C_.rows()) != stages[k].num_inequalities() ||
+             static_cast<size_t>(stages[k].D_.rows()) != stages[k].num_inequalities())
+            throw std::invalid_argument("RiccatiQPSolver: dimensions of stage " +
+                boost::lexical_cast<std::string>(k) + " do not match the dynamics.");
+      }
+
+      void prepare(const std::vector<HorizonStage>& stages, const Eigen::MatrixXd& B)
+      {
+        size_t N = stages.size(), n = B.rows(), m = B.cols();
+        resize(x_, N + 1, n);
+        resize(pi_, N + 1, n);
+        resize(r_x_, N + 1, n);
+        resize(dx_, N + 1, n);
+        resize(dpi_, N + 1, n);
+        resize(p_, N + 1, n);
+        resize(r_dyn_, N, n);
+        resize(v_, N, m);
+        resize(r_v_, N, m);
+        resize(dv_, N, m);
+        resize(k_, N, m);
+        lambda_.resize(N);
+        slack_.resize(N);
+        r_in_.resize(N);
+        dlambda_.resize(N);
+        dslack_.resize(N);
+        w_.resize(N);
+        e_.resize(N);
+        r_c_.resize(N);
+        llt_.resize(N);
+        K_.resize(N);
+        H_vv_.resize(N);
+        H_vx_.resize(N);
+        P_.resize(N + 1);
+        for(size_t k=0; k<N; ++k)
+        {
+          size_t num_inequalities = stages[k].num_inequalities();
+          lambda_[k].resize(num_inequalities);
+          slack_[k].resize(num_inequalities);
+          r_in_[k].resize(num_inequalities);
+          dlambda_[k].resize(num_inequalities);
+          dslack_[k].resize(num_inequalities);
+          w_[k].resize(num_inequalities);
+          e_[k].resize(num_inequalities);
+          r_c_[k].resize(num_inequalities);
+        }
+      }
+
+      static void resize(std::vector<Eigen::VectorXd>& vectors, size_t size, size_t rows)
+      {
+        vectors.resize(size);
+        for(size_t k=0; k<size; ++k)
+          vectors[k].resize(rows);
+      }
+
+      // Starts from zero inputs with strictly positive slacks and multipliers.
+      void initialize(const std::vector<HorizonStage>& stages)
+      {
+        x_[0].setZero();
+        for(size_t k=0; k<stages.size(); ++k)
+        {
+          v_[k].setZero();
+          x_[k + 1] = x_[k];
+          slack_[k] = (stages[k].d_ - stages[k].C_ * x_[k]).cwiseMax(1.0);
+          lambda_[k].setOnes();
+        }
+
+        for(size_t k=0; k<=stages.size(); ++k)
+          pi_[k].setZero();
+      }
+
+      QPSolverStatus run(const std::vector<HorizonStage>& stages, const Eigen::MatrixXd& B)
+      {
+        check_dimensions(stages, B);
+        prepare(stages, B);
+        initialize(stages);
+        num_iterations_ = 0;
+
+        size_t num_inequalities = 0;
+        double scale = 1.0;
+        for(size_t k=0; k<stages.size(); ++k)
+        {
+          num_inequalities += stages[k].num_inequalities();
+          if(stages[k].num_inequalities() > 0)
+            scale = std::max(scale, stages[k].d_.lpNorm<Eigen::Infinity>());
+        }
+        double tolerance = tolerance_ * scale;
+
+        for(size_t iteration=0; iteration<=max_iterations_; ++iteration)
+        {
+          double residual = compute_residuals(stages, B);
+          double mu = num_inequalities > 0 ? duality_measure(0.0) / num_inequalities : 0.0;
+          if(residual < tolerance && mu < tolerance)
+            return QP_SOLVED;
+
+          if(iteration == max_iterations_)
+            break;
+          num_iterations_ = iteration + 1;
+
+          if(!factorize(stages, B))
+            return QP_FAILED;
+
+          // predictor: pure Newton step towards the complementarity conditions
+          for(size_t k=0; k<stages.size(); ++k)
+            r_c_[k] = lambda_[k].cwiseProduct(slack_[k]);
+          solve_newton_system(stages, B);
+
+          // corrector: centering with Mehrotra's heuristic plus second-order term
+          if(num_inequalities > 0)
+          {
+            double mu_affine = duality_measure(max_step_length()) / num_inequalities;
+            double sigma = std::pow(mu_affine / mu, 3);
+            for(size_t k=0; k<stages.size(); ++k)
+              r_c_[k] = lambda_[k].cwiseProduct(slack_[k]) + dslack_[k].cwiseProduct(dlambda_[k]) -
+                  Eigen::VectorXd::Constant(lambda_[k].rows(), sigma * mu);
+            solve_newton_system(stages, B);
+          }
+
+          take_step(std::min(1.0, 0.995 * max_step_length()));
+        }
+
+        return QP_MAX_ITERATIONS_REACHED;
+      }
+
+      // Returns the largest residual of stationarity and primal feasibility.
+      double compute_residuals(const std::vector<HorizonStage>& stages, const Eigen::MatrixXd& B)
+      {
+        size_t N = stages.size();
+        double result = 0.0;
+        for(size_t k=0; k<N; ++k)
+        {
+          const HorizonStage& stage = stages[k];
+          r_v_[k] = stage.r_.cwiseProduct(v_[k]);
+          r_v_[k].noalias() += stage.D_.transpose() * lambda_[k];
+          r_v_[k].noalias() += B.transpose() * pi_[k + 1];
+          r_in_[k] = slack_[k] - stage.d_;
+          r_in_[k].noalias() += stage.C_ * x_[k];
+          r_in_[k].noalias() += stage.D_ * v_[k];
+          r_dyn_[k] = x_[k] - x_[k + 1];
+          r_dyn_[k].noalias() += B * v_[k];
+          // x_0 is fixed and has no stationarity condition
+          if(k > 0)
+          {
+            r_x_[k] = pi_[k + 1] - pi_[k];
+            r_x_[k].noalias() += stage.C_.transpose() * lambda_[k];
+            result = std::max(result, r_x_[k].lpNorm<Eigen::Infinity>());
+          }
+          result = std::max(result, std::max(r_v_[k].lpNorm<Eigen::Infinity>(),
+                std::max(r_in_[k].lpNorm<Eigen::Infinity>(), r_dyn_[k].lpNorm<Eigen::Infinity>())));
+        }
+
+        // the final state appears in the dynamics only
+        r_x_[N] = -pi_[N];
+        return std::max(result, r_x_[N].lpNorm<Eigen::Infinity>());
+      }
+
+      // sum of slack_ .* lambda_ after a step of length alpha along the search direction
+      double duality_measure(double alpha) const
+      {
+        double result = 0.0;
+        for(size_t k=0; k<slack_.size(); ++k)
+          result += (slack_[k] + alpha * dslack_[k]).dot(lambda_[k] + alpha * dlambda_[k]);
+        return result;
+      }
+
+      // largest step in (0, 1] which keeps slacks and multipliers non-negative
+      double max_step_length() const
+      {
+        double result = 1.0;
+        for(size_t k=0; k<slack_.size(); ++k)
+          for(size_t i=0; i<static_cast<size_t>(slack_[k].rows()); ++i)
+          {
+            if(dslack_[k](i) < 0.0)
+              result = std::min(result, -slack_[k](i) / dslack_[k](i));
+            if(dlambda_[k](i) < 0.0)
+              result = std::min(result, -lambda_[k](i) / dlambda_[k](i));
+          }
+        return result;
+      }
+
+      void take_step(double alpha)
+      {
+        for(size_t k=0; k<v_.size(); ++k)
+        {
+          v_[k] += alpha * dv_[k];
+          lambda_[k] += alpha * dlambda_[k];
+          slack_[k] += alpha * dslack_[k];
+        }
+        for(size_t k=0; k<x_.size(); ++k)
+        {
+          x_[k] += alpha * dx_[k];
+          pi_[k] += alpha * dpi_[k];
+        }
+      }
+
+      // Backward Riccati recursion on the Hessian of the Newton system, which
+      // only depends on the current slacks and multipliers:
+      //   Q_k = C_k^T W_k C_k, S_k = D_k^T W_k C_k, R_k = diag(r_k) + D_k^T W_k D_k
+      // with W_k = diag(lambda_k ./ slack_k). Returns false if a stage is not
+      // positive definite.
+      bool factorize(const std::vector<HorizonStage>& stages, const Eigen::MatrixXd& B)
+      {
+        size_t N = stages.size();
+        P_[N].setZero(B.rows(), B.rows());
+        for(size_t k=N; k-- > 0;)
+        {
+          const HorizonStage& stage = stages[k];
+          w_[k] = lambda_[k].cwiseQuotient(slack_[k]);
+          WC_ = w_[k].asDiagonal() * stage.C_;
+          WD_ = w_[k].asDiagonal() * stage.D_;
+
+          BtP_.noalias() = B.transpose() * P_[k + 1];
+
+          H_vv_[k].noalias() = stage.D_.transpose() * WD_;
+          H_vv_[k].noalias() += BtP_ * B;
+          H_vv_[k].diagonal() += stage.r_;
+          H_vx_[k].noalias() = stage.D_.transpose() * WC_;
+          H_vx_[k] += BtP_;
+
+          llt_[k].compute(H_vv_[k]);
+          if(llt_[k].info() != Eigen::Success)
+            return false;
+
+          K_[k] = H_vx_[k];
+          llt_[k].solveInPlace(K_[k]);
+          K_[k] *= -1.0;
+
+          P_[k].noalias() = stage.C_.transpose() * WC_;
+          P_[k] += P_[k + 1];
+          P_[k].noalias() += H_vx_[k].transpose() * K_[k];
+          symmetrize(P_[k]);
+        }
+
+        return true;
+      }
+
+      // averages P with its transpose, in place
+      static void symmetrize(Eigen::MatrixXd& P)
+      {
+        for(size_t i=0; i<static_cast<size_t>(P.rows()); ++i)
+          for(size_t j=i+1; j<static_cast<size_t>(P.cols()); ++j)
+            P(i, j) = P(j, i) = 0.5 * (P(i, j) + P(j, i));
+      }
+
+      // Computes the search direction for the complementarity residual r_c_, see
+      // factorize(). Eliminating slacks and multipliers leaves a linear-quadratic
+      // problem in dx and dv with linear terms r_v + D^T e and r_x + C^T e, where
+      // e = (lambda .* r_in - r_c) ./ slack.
+      void solve_newton_system(const std::vector<HorizonStage>& stages, const Eigen::MatrixXd& B)
+      {
+        size_t N = stages.size();
+        for(size_t k=0; k<N; ++k)
+          e_[k] = (lambda_[k].cwiseProduct(r_in_[k]) - r_c_[k]).cwiseQuotient(slack_[k]);
+
+        // backward pass on the affine terms
+        p_[N].setZero();
+        for(size_t k=N; k-- > 0;)
+        {
+          const HorizonStage& stage = stages[k];
+          Pc_ = p_[k + 1];
+          Pc_.noalias() += P_[k + 1] * r_dyn_[k];
+          h_v_ = r_v_[k];
+          h_v_.noalias() += stage.D_.transpose() * e_[k];
+          h_v_.noalias() += B.transpose() * Pc_;
+
+          k_[k] = h_v_;
+          llt_[k].solveInPlace(k_[k]);
+          k_[k] *= -1.0;
+
+          p_[k] = Pc_;
+          p_[k].noalias() += K_[k].transpose() * h_v_;
+          if(k > 0)
+          {
+            p_[k] += r_x_[k];
+            p_[k].noalias() += stage.C_.transpose() * e_[k];
+          }
+        }
+
+        // forward pass
+        dx_[0].setZero();
+        dpi_[0].setZero();
+        for(size_t k=0; k<N; ++k)
+        {
+          const HorizonStage& stage = stages[k];
+          dv_[k] = k_[k];
+          dv_[k].noalias() += K_[k] * dx_[k];
+          dx_[k + 1] = dx_[k] + r_dyn_[k];
+          dx_[k + 1].noalias() += B * dv_[k];
+          dpi_[k + 1] = p_[k + 1];
+          dpi_[k + 1].noalias() += P_[k + 1] * dx_[k + 1];
+
+          dslack_[k] = -r_in_[k];
+          dslack_[k].noalias() -= stage.C_ * dx_[k];
+          dslack_[k].noalias() -= stage.D_ * dv_[k];
+          dlambda_[k] = e_[k] - w_[k].cwiseProduct(dslack_[k] + r_in_[k]);
+        }
+      }
+  };
+}
+
+#endif // GISKARD_RICCATI_QP_SOLVER_HPP
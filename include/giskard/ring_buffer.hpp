@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_RING_BUFFER_HPP
+#define GISKARD_RING_BUFFER_HPP
+
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace giskard
+{
+  // Lock-free queue of a fixed number of preallocated slots between exactly one
+  // writer thread and exactly one reader thread. The writer fills the slot
+  // returned by get_back() and publishes it, the reader processes the slot
+  // returned by get_front() and pops it. Neither side ever waits for the other:
+  // get_back() returns 0 while all slots are taken, and get_front() returns 0
+  // while none is published.
+  template<typename T>
+  class RingBuffer : boost::noncopyable
+  {
+    public:
+      // One more slot than capacity, so that a full queue differs from an empty one.
+      explicit RingBuffer(size_t capacity, const T& value = T()) :
+        slots_(capacity + 1, value), head_(0), tail_(0) {}
+
+      size_t capacity() const
+      {
+        return slots_.size() - 1;
+      }
+
+      // Returns true if no slot is published. Exact only if called by one of
+      // the two threads while the other one is idle.
+      bool empty() const
+      {
+        return head_.load(boost::memory_order_acquire) == tail_.load(boost::memory_order_acquire);
+      }
+
+      /// writer interface
+
+      T* get_back()
+      {
+        size_t tail = tail_.load(boost::memory_order_relaxed);
+        if(next(tail) == head_.load(boost::memory_order_acquire))
+          return 0;
+
+        return &slots_[tail];
+      }
+
+      void publish()
+      {
+        tail_.store(next(tail_.load(boost::memory_order_relaxed)), boost::memory_order_release);
+      }
+
+      /// reader interface
+
+      T* get_front()
+      {
+        size_t head = head_.load(boost::memory_order_relaxed);
+        if(head == tail_.load(boost::memory_order_acquire))
+          return 0;
+
+        return &slots_[head];
+      }
+
+      void pop()
+      {
+        head_.store(next(head_.load(boost::memory_order_relaxed)), boost::memory_order_release);
+      }
+
+    private:
+      std::vector<T> slots_;
+      boost::atomic<size_t> head_, tail_;
+
+      size_t next(size_t index) const
+      {
+        return (index + 1) % slots_.size();
+      }
+  };
+}
+
+#endif // GISKARD_RING_BUFFER_HPP
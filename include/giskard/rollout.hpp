@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_ROLLOUT_HPP
+#define GISKARD_ROLLOUT_HPP
+
+#include <giskard/qp_controller.hpp>
+
+namespace giskard
+{
+  class RolloutOptions
+  {
+    public:
+      RolloutOptions() :
+        num_steps_(100), dt_(1.0), nWSR_(100), record_every_(1),
+        stop_on_convergence_(false), convergence_tolerance_(1e-6), stationary_tolerance_(0.0) {}
+
+      size_t num_steps_;
+      // integration time step, the command of the controller is a velocity
+      double dt_;
+      int nWSR_;
+      // keep every n-th step in the trajectory; the first and the last state
+      // are always kept
+      size_t record_every_;
+      // stop once all soft constraints are fulfilled up to convergence_tolerance_,
+      // or, if stationary_tolerance_ is positive, once all entries of the command
+      // have become smaller than stationary_tolerance_
+      bool stop_on_convergence_;
+      double convergence_tolerance_, stationary_tolerance_;
+  };
+
+  class RolloutTrajectory
+  {
+    public:
+      RolloutTrajectory() :
+        num_samples_(0), num_steps_(0), success_(false), converged_(false) {}
+
+      // one column per sample; commands_ holds the command issued at each sample,
+      // i.e. the last column of commands_ is zero if the rollout ran to its end
+      Eigen::MatrixXd states_, commands_;
+      Eigen::VectorXd times_;
+      size_t num_samples_, num_steps_;
+      bool success_, converged_;
+
+      Eigen::VectorXd get_final_state() const
+      {
+        return states_.col(num_samples_ - 1);
+      }
+  };
+
+  // Simulates a controller in closed loop with single-integrator dynamics: the
+  // command is integrated into the first num_controllables() observables while
+  // all remaining observables stay constant. Buffers are kept between runs, so
+  // repeated rollouts of controllers with equal dimensions do not allocate.
+  class Rollout
+  {
+    public:
+      explicit Rollout(const RolloutOptions& options) :
+        options_(options), last_recorded_step_(0)
+      {
+        if(options_.record_every_ == 0)
+          throw std::invalid_argument("Rollout: record_every_ must be at least 1.");
+      }
+
+      const RolloutOptions& get_options() const
+      {
+        return options_;
+      }
+
+      const RolloutTrajectory& run(QPController& controller, const Eigen::VectorXd& initial_state)
+      {
+        const QPProblemBuilder& builder = controller.get_qp_builder();
+        if(static_cast<size_t>(initial_state.rows()) < builder.num_controllables())
+          throw std::invalid_argument("Rollout: initial state has " +
+              boost::lexical_cast<std::string>(initial_state.rows()) + " entries, but the controller has " +
+              boost::lexical_cast<std::string>(builder.num_controllables()) + " controllables.");
+
+        prepare(initial_state.rows(), builder.num_controllables());
+        state_ = initial_state;
+
+        trajectory_.success_ = controller.start(state_, options_.nWSR_);
+        if(!trajectory_.success_)
+          return trajectory_;
+
+        size_t step = 0;
+        for(; step<options_.num_steps_; ++step)
+        {
+          if(!controller.update(state_, options_.nWSR_))
+          {
+            trajectory_.success_ = false;
+            break;
+          }
+
+          if(options_.stop_on_convergence_ && is_converged(controller))
+          {
+            trajectory_.converged_ = true;
+            break;
+          }
+
+          if(step % options_.record_every_ == 0)
+            record(step, controller.get_command());
+
+          state_.head(builder.num_controllables()).noalias() += options_.dt_ * controller.get_command();
+        }
+
+        trajectory_.num_steps_ = step;
+        zero_command_.setZero(builder.num_controllables());
+        record(step, zero_command_);
+
+        return trajectory_;
+      }
+
+      const RolloutTrajectory& get_trajectory() const
+      {
+        return trajectory_;
+      }
+
+    private:
+      RolloutOptions options_;
+      RolloutTrajectory trajectory_;
+      Eigen::VectorXd state_, zero_command_;
+      size_t last_recorded_step_;
+
+      void prepare(size_t num_observables, size_t num_controllables)
+      {
+        size_t max_samples = options_.num_steps_ / options_.record_every_ + 2;
+        if(static_cast<size_t>(trajectory_.states_.rows()) != num_observables || static_cast<size_t>(trajectory_.states_.cols()) != max_samples)
+          trajectory_.states_.resize(num_observables, max_samples);
+        if(static_cast<size_t>(trajectory_.commands_.rows()) != num_controllables || static_cast<size_t>(trajectory_.commands_.cols()) != max_samples)
+          trajectory_.commands_.resize(num_controllables, max_samples);
+        if(static_cast<size_t>(trajectory_.times_.rows()) != max_samples)
+          trajectory_.times_.resize(max_samples);
+
+        trajectory_.num_samples_ = 0;
+        trajectory_.num_steps_ = 0;
+        trajectory_.success_ = false;
+        trajectory_.converged_ = false;
+      }
+
+      void record(size_t step, const Eigen::VectorXd& command)
+      {
+        size_t sample = trajectory_.num_samples_;
+        // the final state may coincide with the last recorded one
+        if(sample > 0 && last_recorded_step_ == step)
+          --sample;
+        last_recorded_step_ = step;
+
+        trajectory_.states_.col(sample) = state_;
+        trajectory_.commands_.col(sample) = command;
+        trajectory_.times_(sample) = step * options_.dt_;
+        trajectory_.num_samples_ = sample + 1;
+      }
+
+      bool is_converged(const QPController& controller) const
+      {
+        if(options_.stationary_tolerance_ > 0.0 &&
+           controller.get_command().cwiseAbs().maxCoeff() < options_.stationary_tolerance_)
+          return true;
+
+        // soft constraint i is fulfilled if lbA_i <= 0 <= ubA_i
+        const QPProblemBuilder& builder = controller.get_qp_builder();
+        size_t offset = builder.num_hard_constraints();
+        for(size_t i=0; i<builder.num_soft_constraints(); ++i)
+          if(builder.get_lbA()(offset + i) > options_.convergence_tolerance_ ||
+             builder.get_ubA()(offset + i) < -options_.convergence_tolerance_)
+            return false;
+
+        return true;
+      }
+  };
+
+  inline RolloutTrajectory rollout(QPController& controller, const Eigen::VectorXd& initial_state,
+      const RolloutOptions& options)
+  {
+    Rollout rollout(options);
+    return rollout.run(controller, initial_state);
+  }
+}
+
+#endif // GISKARD_ROLLOUT_HPP
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef GISKARD_SHARED_EXPRESSION_HPP
+#define GISKARD_SHARED_EXPRESSION_HPP
+
+#include <map>
+#include <set>
+#include <string>
+#include <kdl/expressiontree.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace KDL
+{
+  // Maps the shared nodes of expression graphs to their clones, so that a
+  // node reached from several expressions is cloned only once, see
+  // ScopedCloneMemo.
+  class ExpressionCloneMemo
+  {
+    public:
+      typedef std::map<const ExpressionBase*, ExpressionBase::Ptr> Clones;
+
+      template<typename T>
+      typename Expression<T>::Ptr find(const Expression<T>* original) const
+      {
+        Clones::const_iterator it = clones_.find(original);
+        if(it == clones_.end())
+          return typename Expression<T>::Ptr();
+
+        return boost::static_pointer_cast< Expression<T> >(it->second);
+      }
+
+      void insert(const ExpressionBase* original, const ExpressionBase::Ptr& clone)
+      {
+        clones_[original] = clone;
+      }
+
+      size_t size() const
+      {
+        return clones_.size();
+      }
+
+      // shared nodes met so far, mapped to their clones
+      const Clones& get_clones() const
+      {
+        return clones_;
+      }
+
+    private:
+      Clones clones_;
+  };
+
+  // Makes memo the memo of all clone() calls of the current thread during its
+  // lifetime. Scopes nest, the innermost one is active.
+  class ScopedCloneMemo
+  {
+    public:
+      explicit ScopedCloneMemo(ExpressionCloneMemo& memo) :
+        previous_(active().get())
+      {
+        active().reset(&memo);
+      }
+
+      ~ScopedCloneMemo()
+      {
+        active().reset(previous_);
+      }
+
+      // Returns 0 outside of any scope.
+      static ExpressionCloneMemo* get_active()
+      {
+        return active().get();
+      }
+
+    private:
+      ExpressionCloneMemo* previous_;
+
+      // the memos are owned by the scopes, not by the thread
+      static void release(ExpressionCloneMemo*) {}
+
+      static boost::thread_specific_ptr<ExpressionCloneMemo>& active()
+      {
+        static boost::thread_specific_ptr<ExpressionCloneMemo> memo(&ScopedCloneMemo::release);
+        return memo;
+      }
+
+      // not copyable
+      ScopedCloneMemo(const ScopedCloneMemo&);
+      ScopedCloneMemo& operator=(const ScopedCloneMemo&);
+  };
+
+  // Remembers the shared nodes registered with an optimizer during its lifetime,
+  // so that a node reached from several expressions is registered, and thus
+  // computed, only once per update of the optimizer. Scopes nest like
+  // ScopedCloneMemo.
+  class ScopedOptimizerRegistration
+  {
+    public:
+      ScopedOptimizerRegistration() :
+        previous_(active().get())
+      {
+        active().reset(&registered_);
+      }
+
+      ~ScopedOptimizerRegistration()
+      {
+        active().reset(previous_);
+      }
+
+      // Returns false if node was registered before in the active scope, and
+      // true outside of any scope.
+      static bool register_node(const ExpressionBase* node)
+      {
+        std::set<const ExpressionBase*>* registered = active().get();
+        return !registered || registered->insert(node).second;
+      }
+
+    private:
+      std::set<const ExpressionBase*> registered_;
+      std::set<const ExpressionBase*>* previous_;
+
+      // the sets are owned by the scopes, not by the thread
+      static void release(std::set<const ExpressionBase*>*) {}
+
+      static boost::thread_specific_ptr< std::set<const ExpressionBase*> >& active()
+      {
+        static boost::thread_specific_ptr< std::set<const ExpressionBase*> > registered(
+            &ScopedOptimizerRegistration::release);
+        return registered;
+      }
+
+      // not copyable
+      ScopedOptimizerRegistration(const ScopedOptimizerRegistration&);
+      ScopedOptimizerRegistration& operator=(const ScopedOptimizerRegistration&);
+  };
+
+  // Marks a node which several expressions share, e.g. a cached frame, and
+  // evaluates to it. The graph below the node is cloned only once per active
+  // ExpressionCloneMemo, so clones share their copy of the node just like the
+  // originals share the node. Without a memo, clone() copies as usual. Likewise,
+  // the graph below the node is registered only once per
+  // ScopedOptimizerRegistration.
+  template<typename T>
+  class SharedExpression : public UnaryExpression<T, T>
+  {
+    public:
+      typedef typename AutoDiffTrait<T>::DerivType DerivType;
+
+      explicit SharedExpression(const typename Expression<T>::Ptr& argument) :
+        UnaryExpression<T, T>("shared", argument) {}
+
+      virtual T value()
+      {
+        return this->argument->value();
+      }
+
+      virtual DerivType derivative(int i)
+      {
+        return this->argument->derivative(i);
+      }
+
+      virtual typename Expression<DerivType>::Ptr derivativeExpression(int i)
+      {
+        return this->argument->derivativeExpression(i);
+      }
+
+      virtual void addToOptimizer(ExpressionOptimizer& optimizer)
+      {
+        if(ScopedOptimizerRegistration::register_node(this))
+          this->argument->addToOptimizer(optimizer);
+      }
+
+      virtual typename Expression<T>::Ptr clone()
+      {
+        ExpressionCloneMemo* memo = ScopedCloneMemo::get_active();
+        if(!memo)
+          return typename Expression<T>::Ptr(new SharedExpression<T>(this->argument->clone()));
+
+        typename Expression<T>::Ptr result = memo->template find<T>(this);
+        if(!result.get())
+        {
+          result.reset(new SharedExpression<T>(this->argument->clone()));
+          memo->insert(this, result);
+        }
+        return result;
+      }
+  };
+
+  template<typename T>
+  inline typename Expression<T>::Ptr shared(const typename Expression<T>::Ptr& expression)
+  {
+    return typename Expression<T>::Ptr(new SharedExpression<T>(expression));
+  }
+}
+
+#endif // GISKARD_SHARED_EXPRESSION_HPP
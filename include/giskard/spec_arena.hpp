@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_SPEC_ARENA_HPP
+#define GISKARD_SPEC_ARENA_HPP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <stdexcept>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace giskard
+{
+  ///
+  /// monotonic memory of an arena, shared by all nodes allocated from it
+  ///
+
+  class SpecArenaStorage
+  {
+    public:
+      explicit SpecArenaStorage(size_t block_size) :
+        block_size_(block_size), used_(0), capacity_(0), total_(0) 
+      {
+        if(block_size_ == 0)
+          throw std::invalid_argument("SpecArena: block size must be positive.");
+      }
+
+      ~SpecArenaStorage()
+      {
+        for(size_t i=0; i<blocks_.size(); ++i)
+          ::operator delete(blocks_[i]);
+      }
+
+      void* allocate(size_t bytes)
+      {
+        // keep every allocation aligned to the strictest fundamental alignment
+        const size_t alignment = sizeof(long double) > sizeof(void*) ?
+            sizeof(long double) : sizeof(void*);
+        bytes = (bytes + alignment - 1) / alignment * alignment;
+
+        if(used_ + bytes > capacity_)
+        {
+          size_t size = bytes > block_size_ ? bytes : block_size_;
+          blocks_.push_back(static_cast<char*>(::operator new(size)));
+          used_ = 0;
+          capacity_ = size;
+        }
+
+        void* result = blocks_.back() + used_;
+        used_ += bytes;
+        total_ += bytes;
+        return result;
+      }
+
+      size_t get_num_blocks() const
+      {
+        return blocks_.size();
+      }
+
+      size_t get_allocated_bytes() const
+      {
+        return total_;
+      }
+
+    private:
+      size_t block_size_, used_, capacity_, total_;
+      std::vector<char*> blocks_;
+
+      // not copyable
+      SpecArenaStorage(const SpecArenaStorage&);
+      SpecArenaStorage& operator=(const SpecArenaStorage&);
+  };
+
+  typedef typename boost::shared_ptr<SpecArenaStorage> SpecArenaStoragePtr;
+
+  ///
+  /// standard allocator handing out memory of an arena, deallocation is a no-op
+  ///
+
+  template<class T>
+  class SpecArenaAllocator
+  {
+    public:
+      typedef T value_type;
+      typedef T* pointer;
+      typedef const T* const_pointer;
+      typedef T& reference;
+      typedef const T& const_reference;
+      typedef std::size_t size_type;
+      typedef std::ptrdiff_t difference_type;
+
+      template<class U>
+      struct rebind
+      {
+        typedef SpecArenaAllocator<U> other;
+      };
+
+      explicit SpecArenaAllocator(const SpecArenaStoragePtr& storage) :
+        storage_(storage) {}
+
+      template<class U>
+      SpecArenaAllocator(const SpecArenaAllocator<U>& other) :
+        storage_(other.get_storage()) {}
+
+      const SpecArenaStoragePtr& get_storage() const
+      {
+        return storage_;
+      }
+
+      pointer allocate(size_type n, const void* = 0)
+      {
+        return static_cast<pointer>(storage_->allocate(n * sizeof(T)));
+      }
+
+      void deallocate(pointer, size_type)
+      {
+        // memory is released together with the whole arena
+      }
+
+      void construct(pointer p, const T& value)
+      {
+        new(static_cast<void*>(p)) T(value);
+      }
+
+      void destroy(pointer p)
+      {
+        p->~T();
+      }
+
+      size_type max_size() const
+      {
+        return static_cast<size_type>(-1) / sizeof(T);
+      }
+
+      pointer address(reference x) const
+      {
+        return &x;
+      }
+
+      const_pointer address(const_reference x) const
+      {
+        return &x;
+      }
+
+    private:
+      SpecArenaStoragePtr storage_;
+  };
+
+  template<class T, class U>
+  inline bool operator==(const SpecArenaAllocator<T>& lhs, const SpecArenaAllocator<U>& rhs)
+  {
+    return lhs.get_storage() == rhs.get_storage();
+  }
+
+  template<class T, class U>
+  inline bool operator!=(const SpecArenaAllocator<T>& lhs, const SpecArenaAllocator<U>& rhs)
+  {
+    return !(lhs == rhs);
+  }
+
+  ///
+  /// arena for specification trees
+  ///
+
+  // Allocates spec nodes together with their reference counts contiguously
+  // in large blocks. The blocks are released in one shot once the arena and
+  // all nodes allocated from it are gone, i.e. nodes may safely outlive the
+  // arena object. An arena is not thread-safe; use one arena per thread.
+  class SpecArena
+  {
+    public:
+      explicit SpecArena(size_t block_size = 64 * 1024) :
+        storage_(new SpecArenaStorage(block_size)) {}
+
+      template<class T>
+      boost::shared_ptr<T> create()
+      {
+        return boost::allocate_shared<T>(SpecArenaAllocator<T>(storage_));
+      }
+
+      size_t get_num_blocks() const
+      {
+        return storage_->get_num_blocks();
+      }
+
+      size_t get_allocated_bytes() const
+      {
+        return storage_->get_allocated_bytes();
+      }
+
+    private:
+      SpecArenaStoragePtr storage_;
+  };
+
+  inline void no_spec_arena_cleanup(SpecArena*)
+  {
+    // the current arena is not owned by the thread
+  }
+
+  inline boost::thread_specific_ptr<SpecArena>& current_spec_arena()
+  {
+    static boost::thread_specific_ptr<SpecArena> arena(&no_spec_arena_cleanup);
+    return arena;
+  }
+
+  // Makes an arena the target of all specs created by the calling thread
+  // during the lifetime of the guard, e.g. while parsing a YAML file.
+  class ScopedSpecArena
+  {
+    public:
+      explicit ScopedSpecArena(SpecArena& arena) :
+        previous_(current_spec_arena().get())
+      {
+        current_spec_arena().reset(&arena);
+      }
+
+      ~ScopedSpecArena()
+      {
+        current_spec_arena().reset(previous_);
+      }
+
+    private:
+      SpecArena* previous_;
+
+      // not copyable
+      ScopedSpecArena(const ScopedSpecArena&);
+      ScopedSpecArena& operator=(const ScopedSpecArena&);
+  };
+
+  // Creates a default-constructed spec node in the current arena of this
+  // thread. Without an arena, node and reference count still share a single
+  // heap allocation.
+  template<class T>
+  inline boost::shared_ptr<T> make_spec()
+  {
+    SpecArena* arena = current_spec_arena().get();
+    if(arena)
+      return arena->create<T>();
+    else
+      return boost::make_shared<T>();
+  }
+}
+
+#endif // GISKARD_SPEC_ARENA_HPP
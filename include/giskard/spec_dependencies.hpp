@@ -0,0 +1,333 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_SPEC_DEPENDENCIES_HPP
+#define GISKARD_SPEC_DEPENDENCIES_HPP
+
+#include <set>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <giskard/specifications.hpp>
+
+namespace giskard
+{
+  ///
+  /// direct dependencies of specifications
+  ///
+
+  // Collects the input numbers and scope references a specification uses
+  // directly, i.e. without resolving the references.
+  class SpecDependencyCollector : public SpecVisitor
+  {
+    public:
+      const std::set<size_t>& get_inputs() const
+      {
+        return inputs_;
+      }
+
+      const std::set<std::string>& get_references() const
+      {
+        return references_;
+      }
+
+      void clear()
+      {
+        inputs_.clear();
+        references_.clear();
+      }
+
+      void collect(const SpecPtr& spec)
+      {
+        if(spec.get())
+          spec->accept(*this);
+      }
+
+      template<class T>
+      void collect(const std::vector< boost::shared_ptr<T> >& specs)
+      {
+        for(size_t i=0; i<specs.size(); ++i)
+          collect(specs[i]);
+      }
+
+      virtual void visit(const DoubleConstSpec&) {}
+
+      virtual void visit(const DoubleInputSpec& spec)
+      {
+        inputs_.insert(spec.get_input_num());
+      }
+
+      virtual void visit(const DoubleReferenceSpec& spec)
+      {
+        references_.insert(spec.get_reference_name());
+      }
+
+      virtual void visit(const DoubleAdditionSpec& spec)
+      {
+        collect(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleSubtractionSpec& spec)
+      {
+        collect(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleNormOfSpec& spec)
+      {
+        collect(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleMultiplicationSpec& spec)
+      {
+        collect(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleDivisionSpec& spec)
+      {
+        collect(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleXCoordOfSpec& spec)
+      {
+        collect(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleYCoordOfSpec& spec)
+      {
+        collect(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleZCoordOfSpec& spec)
+      {
+        collect(spec.get_vector());
+      }
+
+      virtual void visit(const VectorDotSpec& spec)
+      {
+        collect(spec.get_lhs());
+        collect(spec.get_rhs());
+      }
+
+      virtual void visit(const VectorCachedSpec& spec)
+      {
+        collect(spec.get_vector());
+      }
+
+      virtual void visit(const VectorConstructorSpec& spec)
+      {
+        collect(spec.get_x());
+        collect(spec.get_y());
+        collect(spec.get_z());
+      }
+
+      virtual void visit(const VectorAdditionSpec& spec)
+      {
+        collect(spec.get_inputs());
+      }
+
+      virtual void visit(const VectorSubtractionSpec& spec)
+      {
+        collect(spec.get_inputs());
+      }
+
+      virtual void visit(const VectorReferenceSpec& spec)
+      {
+        references_.insert(spec.get_reference_name());
+      }
+
+      virtual void visit(const VectorOriginOfSpec& spec)
+      {
+        collect(spec.get_frame());
+      }
+
+      virtual void visit(const VectorFrameMultiplicationSpec& spec)
+      {
+        collect(spec.get_frame());
+        collect(spec.get_vector());
+      }
+
+      virtual void visit(const VectorDoubleMultiplicationSpec& spec)
+      {
+        collect(spec.get_double());
+        collect(spec.get_vector());
+      }
+
+      virtual void visit(const VectorRotationVectorSpec& spec)
+      {
+        collect(spec.get_rotation());
+      }
+
+      virtual void visit(const RotationQuaternionConstructorSpec&) {}
+
+      virtual void visit(const AxisAngleSpec& spec)
+      {
+        collect(spec.get_axis());
+        collect(spec.get_angle());
+      }
+
+      virtual void visit(const RotationReferenceSpec& spec)
+      {
+        references_.insert(spec.get_reference_name());
+      }
+
+      virtual void visit(const InverseRotationSpec& spec)
+      {
+        collect(spec.get_rotation());
+      }
+
+      virtual void visit(const RotationMultiplicationSpec& spec)
+      {
+        collect(spec.get_inputs());
+      }
+
+      virtual void visit(const FrameCachedSpec& spec)
+      {
+        collect(spec.get_frame());
+      }
+
+      virtual void visit(const FrameConstructorSpec& spec)
+      {
+        collect(spec.get_translation());
+        collect(spec.get_rotation());
+      }
+
+      virtual void visit(const OrientationOfSpec& spec)
+      {
+        collect(spec.get_frame());
+      }
+
+      virtual void visit(const FrameMultiplicationSpec& spec)
+      {
+        collect(spec.get_inputs());
+      }
+
+      virtual void visit(const FrameReferenceSpec& spec)
+      {
+        references_.insert(spec.get_reference_name());
+      }
+
+    private:
+      std::set<size_t> inputs_;
+      std::set<std::string> references_;
+  };
+
+  ///
+  /// input dependencies resolved through a scope
+  ///
+
+  // Resolves the inputs every entry of a scope depends on, following
+  // references to earlier entries of the scope.
+  class ScopeDependencies
+  {
+    public:
+      explicit ScopeDependencies(const ScopeSpec& scope_spec)
+      {
+        for(size_t i=0; i<scope_spec.size(); ++i)
+          inputs_[scope_spec[i].name] = get_inputs(scope_spec[i].spec);
+      }
+
+      std::set<size_t> get_inputs(const SpecPtr& spec) const
+      {
+        SpecDependencyCollector collector;
+        collector.collect(spec);
+
+        std::set<size_t> result = collector.get_inputs();
+        for(std::set<std::string>::const_iterator it = collector.get_references().begin();
+            it != collector.get_references().end(); ++it)
+        {
+          std::map< std::string, std::set<size_t> >::const_iterator entry = inputs_.find(*it);
+          if(entry == inputs_.end())
+            throw std::invalid_argument("Could not find scope entry with name: " + *it);
+
+          result.insert(entry->second.begin(), entry->second.end());
+        }
+
+        return result;
+      }
+
+      const std::set<size_t>& get_inputs(const std::string& name) const
+      {
+        std::map< std::string, std::set<size_t> >::const_iterator entry = inputs_.find(name);
+        if(entry == inputs_.end())
+          throw std::invalid_argument("Could not find scope entry with name: " + name);
+
+        return entry->second;
+      }
+
+    private:
+      std::map< std::string, std::set<size_t> > inputs_;
+  };
+
+  ///
+  /// removal of unused scope entries
+  ///
+
+  // Returns a copy of the specification without the scope entries that no
+  // constraint refers to, neither directly nor through other scope entries.
+  // These entries would be generated without ever being evaluated.
+  inline QPControllerSpec remove_unused_scope_entries(const QPControllerSpec& spec)
+  {
+    SpecDependencyCollector collector;
+    for(size_t i=0; i<spec.controllable_constraints_.size(); ++i)
+    {
+      collector.collect(spec.controllable_constraints_[i].lower_);
+      collector.collect(spec.controllable_constraints_[i].upper_);
+      collector.collect(spec.controllable_constraints_[i].weight_);
+    }
+    for(size_t i=0; i<spec.soft_constraints_.size(); ++i)
+    {
+      collector.collect(spec.soft_constraints_[i].expression_);
+      collector.collect(spec.soft_constraints_[i].lower_);
+      collector.collect(spec.soft_constraints_[i].upper_);
+      collector.collect(spec.soft_constraints_[i].weight_);
+    }
+    for(size_t i=0; i<spec.hard_constraints_.size(); ++i)
+    {
+      collector.collect(spec.hard_constraints_[i].expression_);
+      collector.collect(spec.hard_constraints_[i].lower_);
+      collector.collect(spec.hard_constraints_[i].upper_);
+    }
+
+    // entries only refer to earlier entries, so one backward pass finds all uses
+    std::set<std::string> used = collector.get_references();
+    std::vector<bool> keep(spec.scope_.size(), false);
+    for(size_t i=spec.scope_.size(); i-- > 0; )
+    {
+      if(used.find(spec.scope_[i].name) == used.end())
+        continue;
+
+      keep[i] = true;
+      collector.clear();
+      collector.collect(spec.scope_[i].spec);
+      used.insert(collector.get_references().begin(), collector.get_references().end());
+    }
+
+    QPControllerSpec result = spec;
+    result.scope_.clear();
+    for(size_t i=0; i<spec.scope_.size(); ++i)
+      if(keep[i])
+        result.scope_.push_back(spec.scope_[i]);
+
+    return result;
+  }
+}
+
+#endif // GISKARD_SPEC_DEPENDENCIES_HPP
@@ -0,0 +1,292 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_SPEC_FOLDING_HPP
+#define GISKARD_SPEC_FOLDING_HPP
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include <giskard/specifications.hpp>
+
+namespace giskard
+{
+  ///
+  /// evaluation of constant double specifications
+  ///
+
+  // Evaluates double specifications which depend neither on inputs nor on
+  // non-constant scope entries. Vectors are only looked into when built by
+  // a VectorConstructorSpec.
+  class ConstantEvaluator : public SpecVisitor
+  {
+    public:
+      void set_constant(const std::string& name, double value)
+      {
+        constants_[name] = value;
+      }
+
+      bool evaluate(const DoubleSpecPtr& spec, double& value)
+      {
+        if(!spec.get())
+          return false;
+
+        spec->accept(*this);
+        value = value_;
+        return constant_;
+      }
+
+      virtual void visit(const DoubleConstSpec& spec)
+      {
+        set_result(true, spec.get_value());
+      }
+
+      virtual void visit(const DoubleInputSpec&)
+      {
+        set_result(false);
+      }
+
+      virtual void visit(const DoubleReferenceSpec& spec)
+      {
+        std::map<std::string, double>::const_iterator it = 
+            constants_.find(spec.get_reference_name());
+        if(it == constants_.end())
+          set_result(false);
+        else
+          set_result(true, it->second);
+      }
+
+      virtual void visit(const DoubleAdditionSpec& spec)
+      {
+        double result = 0.0, value;
+        for(size_t i=0; i<spec.get_inputs().size(); ++i)
+          if(evaluate(spec.get_inputs()[i], value))
+            result += value;
+          else
+            return set_result(false);
+
+        set_result(true, result);
+      }
+
+      virtual void visit(const DoubleSubtractionSpec& spec)
+      {
+        const std::vector<DoubleSpecPtr>& inputs = spec.get_inputs();
+        double result, value;
+        if(inputs.empty() || !evaluate(inputs[0], result))
+          return set_result(false);
+
+        if(inputs.size() == 1)
+          return set_result(true, -result);
+
+        for(size_t i=1; i<inputs.size(); ++i)
+          if(evaluate(inputs[i], value))
+            result -= value;
+          else
+            return set_result(false);
+
+        set_result(true, result);
+      }
+
+      virtual void visit(const DoubleNormOfSpec& spec)
+      {
+        double x, y, z;
+        if(evaluate(spec.get_vector(), x, y, z))
+          set_result(true, std::sqrt(x*x + y*y + z*z));
+        else
+          set_result(false);
+      }
+
+      virtual void visit(const DoubleMultiplicationSpec& spec)
+      {
+        double result = 1.0, value;
+        for(size_t i=0; i<spec.get_inputs().size(); ++i)
+          if(evaluate(spec.get_inputs()[i], value))
+            result *= value;
+          else
+            return set_result(false);
+
+        set_result(true, result);
+      }
+
+      virtual void visit(const DoubleDivisionSpec& spec)
+      {
+        const std::vector<DoubleSpecPtr>& inputs = spec.get_inputs();
+        double dividend, divisor = 1.0, value;
+        if(inputs.empty() || !evaluate(inputs[0], dividend))
+          return set_result(false);
+
+        if(inputs.size() == 1)
+        {
+          divisor = dividend;
+          dividend = 1.0;
+        }
+
+        for(size_t i=1; i<inputs.size(); ++i)
+          if(evaluate(inputs[i], value))
+            divisor *= value;
+          else
+            return set_result(false);
+
+        // leave divisions by zero to the expression graph
+        if(divisor == 0.0)
+          return set_result(false);
+
+        set_result(true, dividend / divisor);
+      }
+
+      virtual void visit(const DoubleXCoordOfSpec& spec)
+      {
+        double x, y, z;
+        if(evaluate(spec.get_vector(), x, y, z))
+          set_result(true, x);
+        else
+          set_result(false);
+      }
+
+      virtual void visit(const DoubleYCoordOfSpec& spec)
+      {
+        double x, y, z;
+        if(evaluate(spec.get_vector(), x, y, z))
+          set_result(true, y);
+        else
+          set_result(false);
+      }
+
+      virtual void visit(const DoubleZCoordOfSpec& spec)
+      {
+        double x, y, z;
+        if(evaluate(spec.get_vector(), x, y, z))
+          set_result(true, z);
+        else
+          set_result(false);
+      }
+
+      virtual void visit(const VectorDotSpec& spec)
+      {
+        double x1, y1, z1, x2, y2, z2;
+        if(evaluate(spec.get_lhs(), x1, y1, z1) && evaluate(spec.get_rhs(), x2, y2, z2))
+          set_result(true, x1*x2 + y1*y2 + z1*z2);
+        else
+          set_result(false);
+      }
+
+      // non-double specifications are never folded
+      virtual void visit(const VectorCachedSpec&) { set_result(false); }
+      virtual void visit(const VectorConstructorSpec&) { set_result(false); }
+      virtual void visit(const VectorAdditionSpec&) { set_result(false); }
+      virtual void visit(const VectorSubtractionSpec&) { set_result(false); }
+      virtual void visit(const VectorReferenceSpec&) { set_result(false); }
+      virtual void visit(const VectorOriginOfSpec&) { set_result(false); }
+      virtual void visit(const VectorFrameMultiplicationSpec&) { set_result(false); }
+      virtual void visit(const VectorDoubleMultiplicationSpec&) { set_result(false); }
+      virtual void visit(const VectorRotationVectorSpec&) { set_result(false); }
+      virtual void visit(const RotationQuaternionConstructorSpec&) { set_result(false); }
+      virtual void visit(const AxisAngleSpec&) { set_result(false); }
+      virtual void visit(const RotationReferenceSpec&) { set_result(false); }
+      virtual void visit(const InverseRotationSpec&) { set_result(false); }
+      virtual void visit(const RotationMultiplicationSpec&) { set_result(false); }
+      virtual void visit(const FrameCachedSpec&) { set_result(false); }
+      virtual void visit(const FrameConstructorSpec&) { set_result(false); }
+      virtual void visit(const OrientationOfSpec&) { set_result(false); }
+      virtual void visit(const FrameMultiplicationSpec&) { set_result(false); }
+      virtual void visit(const FrameReferenceSpec&) { set_result(false); }
+
+    private:
+      std::map<std::string, double> constants_;
+      bool constant_;
+      double value_;
+
+      void set_result(bool constant, double value = 0.0)
+      {
+        constant_ = constant;
+        value_ = value;
+      }
+
+      bool evaluate(const VectorSpecPtr& spec, double& x, double& y, double& z)
+      {
+        if(!spec.get() || spec->get_type() != VECTOR_CONSTRUCTOR_SPEC)
+          return false;
+
+        const VectorConstructorSpec& v = static_cast<const VectorConstructorSpec&>(*spec);
+        return evaluate(v.get_x(), x) && evaluate(v.get_y(), y) && evaluate(v.get_z(), z);
+      }
+  };
+
+  ///
+  /// constant folding of controller specifications
+  ///
+
+  inline void fold_constant(ConstantEvaluator& evaluator, DoubleSpecPtr& spec)
+  {
+    double value;
+    if(spec.get() && spec->get_type() != DOUBLE_CONST_SPEC && evaluator.evaluate(spec, value))
+      spec = double_const_spec(value);
+  }
+
+  // Returns a copy of the specification in which every double valued scope
+  // entry and constraint term without inputs is replaced by its value. The
+  // nodes of the original specification are shared, not modified.
+  inline QPControllerSpec fold_constants(const QPControllerSpec& spec)
+  {
+    QPControllerSpec result = spec;
+    ConstantEvaluator evaluator;
+
+    for(size_t i=0; i<result.scope_.size(); ++i)
+    {
+      ScopeEntry& entry = result.scope_[i];
+      if(!entry.spec.get() || entry.spec->get_category() != DOUBLE_SPEC)
+        continue;
+
+      DoubleSpecPtr double_spec = boost::static_pointer_cast<DoubleSpec>(entry.spec);
+      double value;
+      if(evaluator.evaluate(double_spec, value))
+      {
+        evaluator.set_constant(entry.name, value);
+        if(double_spec->get_type() != DOUBLE_CONST_SPEC)
+          entry.spec = double_const_spec(value);
+      }
+    }
+
+    for(size_t i=0; i<result.controllable_constraints_.size(); ++i)
+    {
+      fold_constant(evaluator, result.controllable_constraints_[i].lower_);
+      fold_constant(evaluator, result.controllable_constraints_[i].upper_);
+      fold_constant(evaluator, result.controllable_constraints_[i].weight_);
+    }
+
+    for(size_t i=0; i<result.soft_constraints_.size(); ++i)
+    {
+      fold_constant(evaluator, result.soft_constraints_[i].lower_);
+      fold_constant(evaluator, result.soft_constraints_[i].upper_);
+      fold_constant(evaluator, result.soft_constraints_[i].weight_);
+    }
+
+    for(size_t i=0; i<result.hard_constraints_.size(); ++i)
+    {
+      fold_constant(evaluator, result.hard_constraints_[i].lower_);
+      fold_constant(evaluator, result.hard_constraints_[i].upper_);
+    }
+
+    return result;
+  }
+}
+
+#endif // GISKARD_SPEC_FOLDING_HPP
@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_SPEC_GENERATOR_HPP
+#define GISKARD_SPEC_GENERATOR_HPP
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <yaml-cpp/yaml.h>
+#include <giskard/spec_arena.hpp>
+#include <giskard/specifications.hpp>
+#include <giskard/yaml_parser.hpp>
+
+namespace giskard
+{
+  // Parameters of a synthetic controller specification. The kinematic tree
+  // has num_joints_ revolute joints. With more than one branch, a trunk
+  // carries num_branches_ chains, and the frame at its tip is cached. Every
+  // constraint restricts one coordinate of a randomly picked link. Shared
+  // constraints refer to the link frames of the scope, the others spell out
+  // their kinematic chain again.
+  class SyntheticSpecOptions
+  {
+    public:
+      SyntheticSpecOptions() :
+        num_joints_(7), num_branches_(1), num_constraints_(10),
+        hard_constraint_ratio_(0.2), sharing_(1.0), num_priority_levels_(1), seed_(0) {}
+
+      size_t num_joints_, num_branches_;
+
+      // soft plus hard constraints, without the controllable constraints
+      size_t num_constraints_;
+
+      // fractions of hard and of shared constraints, from 0 to 1
+      double hard_constraint_ratio_, sharing_;
+
+      // soft constraints take turns in getting priorities 0 to num_priority_levels_ - 1
+      size_t num_priority_levels_;
+
+      // seeds the choice of links and goals
+      unsigned int seed_;
+  };
+
+  class SyntheticSpecGenerator
+  {
+    public:
+      static inline QPControllerSpec generate(const SyntheticSpecOptions& options)
+      {
+        check(options);
+
+        SyntheticSpecGenerator generator(options);
+        generator.add_tree();
+        generator.add_constraints();
+        return generator.spec_;
+      }
+
+      static inline std::string generate_yaml(const SyntheticSpecOptions& options)
+      {
+        YAML::Node node;
+        node = generate(options);
+
+        YAML::Emitter out;
+        out << node;
+        return out.c_str();
+      }
+
+    private:
+      SyntheticSpecOptions options_;
+      boost::random::mt19937 random_;
+      QPControllerSpec spec_;
+      // parent joint of every joint, -1 for children of the root
+      std::vector<int> parents_;
+
+      explicit SyntheticSpecGenerator(const SyntheticSpecOptions& options) :
+        options_(options), random_(options.seed_) {}
+
+      static inline void check(const SyntheticSpecOptions& options)
+      {
+        if(options.num_joints_ == 0 || options.num_branches_ == 0)
+          throw std::invalid_argument("Synthetic spec generation: need at least one joint and one branch.");
+
+        if(options.num_branches_ > options.num_joints_)
+          throw std::invalid_argument("Synthetic spec generation: asked for more branches than joints.");
+
+        if(options.hard_constraint_ratio_ < 0.0 || options.hard_constraint_ratio_ > 1.0 ||
+           options.sharing_ < 0.0 || options.sharing_ > 1.0)
+          throw std::invalid_argument("Synthetic spec generation: ratios need to be between 0 and 1.");
+
+        if(options.num_priority_levels_ == 0)
+          throw std::invalid_argument("Synthetic spec generation: need at least one priority level.");
+      }
+
+      // Spreads a share of ratio over a sequence, e.g. every second element
+      // for 0.5. The first element is selected only for a ratio of 1.
+      static inline bool is_selected(size_t index, double ratio)
+      {
+        return std::floor((index + 1) * ratio) > std::floor(index * ratio);
+      }
+
+      void add_tree()
+      {
+        size_t num_branches = options_.num_branches_;
+        size_t trunk_length = (num_branches == 1) ? options_.num_joints_ :
+            std::max<size_t>(1, options_.num_joints_ / (num_branches + 1));
+
+        std::vector<int> branch_tips(num_branches, trunk_length - 1);
+        for(size_t i=0; i<options_.num_joints_; ++i)
+        {
+          if(i < trunk_length)
+            parents_.push_back(static_cast<int>(i) - 1);
+          else
+          {
+            size_t branch = (i - trunk_length) % num_branches;
+            parents_.push_back(branch_tips[branch]);
+            branch_tips[branch] = i;
+          }
+        }
+
+        for(size_t i=0; i<options_.num_joints_; ++i)
+        {
+          DoubleInputSpecPtr input = make_spec<DoubleInputSpec>();
+          input->set_input_num(i);
+          add_entry(joint_name(i), input);
+        }
+
+        for(size_t i=0; i<options_.num_joints_; ++i)
+        {
+          std::vector<FrameSpecPtr> inputs;
+          if(parents_[i] >= 0)
+            inputs.push_back(frame_reference(link_name(parents_[i])));
+          inputs.push_back(joint_transform(i));
+
+          FrameSpecPtr frame = frame_multiplication(inputs);
+          if(num_branches > 1 && i == trunk_length - 1)
+          {
+            FrameCachedSpecPtr cached = make_spec<FrameCachedSpec>();
+            cached->set_frame(frame);
+            frame = cached;
+          }
+          add_entry(link_name(i), frame);
+        }
+      }
+
+      void add_constraints()
+      {
+        for(size_t i=0; i<options_.num_joints_; ++i)
+        {
+          ControllableConstraintSpec controllable;
+          controllable.lower_ = double_const_spec(-0.5);
+          controllable.upper_ = double_const_spec(0.5);
+          controllable.weight_ = double_const_spec(0.01);
+          controllable.input_number_ = i;
+          controllable.name_ = joint_name(i);
+          spec_.controllable_constraints_.push_back(controllable);
+        }
+
+        boost::random::uniform_int_distribution<size_t> links(0, options_.num_joints_ - 1);
+        boost::random::uniform_real_distribution<double> goals(-0.5, 0.5);
+
+        // hard limits which every configuration of the tree satisfies
+        double limit = 1.0 + 0.1 * options_.num_joints_;
+
+        for(size_t i=0; i<options_.num_constraints_; ++i)
+        {
+          size_t link = links(random_);
+          std::string name = "constraint_" + boost::lexical_cast<std::string>(i);
+          add_entry(name, coordinate(i % 3, link, is_selected(i, options_.sharing_)));
+
+          if(is_selected(i, options_.hard_constraint_ratio_))
+          {
+            HardConstraintSpec hard;
+            hard.expression_ = double_reference(name);
+            hard.lower_ = difference(-limit, name);
+            hard.upper_ = difference(limit, name);
+            spec_.hard_constraints_.push_back(hard);
+          }
+          else
+          {
+            double goal = goals(random_);
+            SoftConstraintSpec soft;
+            soft.expression_ = double_reference(name);
+            soft.lower_ = difference(goal - 0.01, name);
+            soft.upper_ = difference(goal + 0.01, name);
+            soft.weight_ = double_const_spec(10.0);
+            soft.name_ = name;
+            soft.priority_ = spec_.soft_constraints_.size() % options_.num_priority_levels_;
+            spec_.soft_constraints_.push_back(soft);
+          }
+        }
+      }
+
+      // x, y or z coordinate of the origin of a link
+      DoubleSpecPtr coordinate(size_t axis, size_t link, bool shared)
+      {
+        FrameSpecPtr frame;
+        if(shared)
+          frame = frame_reference(link_name(link));
+        else
+        {
+          std::vector<FrameSpecPtr> chain;
+          for(int i=link; i>=0; i=parents_[i])
+            chain.insert(chain.begin(), joint_transform(i));
+          frame = frame_multiplication(chain);
+        }
+
+        VectorOriginOfSpecPtr origin = make_spec<VectorOriginOfSpec>();
+        origin->set_frame(frame);
+
+        switch(axis)
+        {
+          case 0:
+          {
+            DoubleXCoordOfSpecPtr result = make_spec<DoubleXCoordOfSpec>();
+            result->set_vector(origin);
+            return result;
+          }
+          case 1:
+          {
+            DoubleYCoordOfSpecPtr result = make_spec<DoubleYCoordOfSpec>();
+            result->set_vector(origin);
+            return result;
+          }
+          default:
+          {
+            DoubleZCoordOfSpecPtr result = make_spec<DoubleZCoordOfSpec>();
+            result->set_vector(origin);
+            return result;
+          }
+        }
+      }
+
+      // rotation about the x, y or z axis, followed by a link of 0.1m along
+      // the next axis
+      FrameSpecPtr joint_transform(size_t joint)
+      {
+        std::vector<double> axis(3, 0.0), offset(3, 0.0);
+        axis[joint % 3] = 1.0;
+        offset[(joint + 1) % 3] = 0.1;
+
+        AxisAngleSpecPtr rotation = make_spec<AxisAngleSpec>();
+        rotation->set_axis(vector3(axis));
+        rotation->set_angle(double_reference(joint_name(joint)));
+
+        return frame_constructor_spec(vector3(offset), rotation);
+      }
+
+      DoubleSpecPtr difference(double lhs, const std::string& rhs)
+      {
+        std::vector<DoubleSpecPtr> inputs;
+        inputs.push_back(double_const_spec(lhs));
+        inputs.push_back(double_reference(rhs));
+
+        DoubleSubtractionSpecPtr result = make_spec<DoubleSubtractionSpec>();
+        result->swap_inputs(inputs);
+        return result;
+      }
+
+      void add_entry(const std::string& name, const SpecPtr& spec)
+      {
+        ScopeEntry entry;
+        entry.name = name;
+        entry.spec = spec;
+        spec_.scope_.push_back(entry);
+      }
+
+      static inline std::string joint_name(size_t joint)
+      {
+        return "joint_" + boost::lexical_cast<std::string>(joint);
+      }
+
+      static inline std::string link_name(size_t joint)
+      {
+        return "link_" + boost::lexical_cast<std::string>(joint);
+      }
+
+      static inline VectorSpecPtr vector3(const std::vector<double>& values)
+      {
+        return vector_constructor_spec(double_const_spec(values[0]),
+            double_const_spec(values[1]), double_const_spec(values[2]));
+      }
+
+      static inline DoubleReferenceSpecPtr double_reference(const std::string& name)
+      {
+        DoubleReferenceSpecPtr spec = make_spec<DoubleReferenceSpec>();
+        spec->set_reference_name(name);
+        return spec;
+      }
+
+      static inline FrameReferenceSpecPtr frame_reference(const std::string& name)
+      {
+        FrameReferenceSpecPtr spec = make_spec<FrameReferenceSpec>();
+        spec->set_reference_name(name);
+        return spec;
+      }
+
+      static inline FrameMultiplicationSpecPtr frame_multiplication(std::vector<FrameSpecPtr>& inputs)
+      {
+        FrameMultiplicationSpecPtr spec = make_spec<FrameMultiplicationSpec>();
+        spec->swap_inputs(inputs);
+        return spec;
+      }
+  };
+}
+
+#endif // GISKARD_SPEC_GENERATOR_HPP
@@ -0,0 +1,670 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_SPEC_SERIALIZATION_HPP
+#define GISKARD_SPEC_SERIALIZATION_HPP
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <boost/cstdint.hpp>
+#include <boost/lexical_cast.hpp>
+#include <giskard/specifications.hpp>
+#include <giskard/spec_arena.hpp>
+
+namespace giskard
+{
+  ///
+  /// binary primitives, written in host byte order
+  ///
+
+  inline void write_binary(std::ostream& os, boost::uint64_t value)
+  {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  inline void write_binary(std::ostream& os, double value)
+  {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  inline void write_binary(std::ostream& os, const std::string& value)
+  {
+    write_binary(os, static_cast<boost::uint64_t>(value.size()));
+    os.write(value.data(), value.size());
+  }
+
+  inline void read_binary(std::istream& is, boost::uint64_t& value)
+  {
+    if(!is.read(reinterpret_cast<char*>(&value), sizeof(value)))
+      throw std::runtime_error("Spec deserialization: unexpected end of stream.");
+  }
+
+  inline void read_binary(std::istream& is, double& value)
+  {
+    if(!is.read(reinterpret_cast<char*>(&value), sizeof(value)))
+      throw std::runtime_error("Spec deserialization: unexpected end of stream.");
+  }
+
+  inline void read_binary(std::istream& is, std::string& value)
+  {
+    boost::uint64_t size;
+    read_binary(is, size);
+
+    // reads in chunks, so that a corrupt size runs into the end of the stream
+    // instead of allocating the claimed size up front
+    value.clear();
+    char chunk[4096];
+    while(size > 0)
+    {
+      std::streamsize count = static_cast<std::streamsize>(std::min<boost::uint64_t>(size, sizeof(chunk)));
+      if(!is.read(chunk, count))
+        throw std::runtime_error("Spec deserialization: unexpected end of stream.");
+      value.append(chunk, count);
+      size -= count;
+    }
+  }
+
+  inline size_t read_binary_size(std::istream& is)
+  {
+    boost::uint64_t size;
+    read_binary(is, size);
+    return static_cast<size_t>(size);
+  }
+
+  ///
+  /// writing specifications
+  ///
+
+  // Writes every node as its type tag followed by its fields and children
+  // in pre-order. Null children are written as the tag NULL_SPEC_TAG.
+  const boost::uint64_t NULL_SPEC_TAG = static_cast<boost::uint64_t>(-1);
+
+  class SpecWriter : public SpecVisitor
+  {
+    public:
+      explicit SpecWriter(std::ostream& os) : os_(os) {}
+
+      void write(const SpecPtr& spec)
+      {
+        if(spec.get())
+          spec->accept(*this);
+        else
+          write_binary(os_, NULL_SPEC_TAG);
+      }
+
+      template<class T>
+      void write(const std::vector< boost::shared_ptr<T> >& specs)
+      {
+        write_binary(os_, static_cast<boost::uint64_t>(specs.size()));
+        for(size_t i=0; i<specs.size(); ++i)
+          write(specs[i]);
+      }
+
+      virtual void visit(const DoubleConstSpec& spec)
+      {
+        write_tag(spec);
+        write_binary(os_, spec.get_value());
+      }
+
+      virtual void visit(const DoubleInputSpec& spec)
+      {
+        write_tag(spec);
+        write_binary(os_, static_cast<boost::uint64_t>(spec.get_input_num()));
+      }
+
+      virtual void visit(const DoubleReferenceSpec& spec)
+      {
+        write_tag(spec);
+        write_binary(os_, spec.get_reference_name());
+      }
+
+      virtual void visit(const DoubleAdditionSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleSubtractionSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleNormOfSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleMultiplicationSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleDivisionSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleXCoordOfSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleYCoordOfSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleZCoordOfSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_vector());
+      }
+
+      virtual void visit(const VectorDotSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_lhs());
+        write(spec.get_rhs());
+      }
+
+      virtual void visit(const VectorCachedSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_vector());
+      }
+
+      virtual void visit(const VectorConstructorSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_x());
+        write(spec.get_y());
+        write(spec.get_z());
+      }
+
+      virtual void visit(const VectorAdditionSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_inputs());
+      }
+
+      virtual void visit(const VectorSubtractionSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_inputs());
+      }
+
+      virtual void visit(const VectorReferenceSpec& spec)
+      {
+        write_tag(spec);
+        write_binary(os_, spec.get_reference_name());
+      }
+
+      virtual void visit(const VectorOriginOfSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_frame());
+      }
+
+      virtual void visit(const VectorFrameMultiplicationSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_frame());
+        write(spec.get_vector());
+      }
+
+      virtual void visit(const VectorDoubleMultiplicationSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_double());
+        write(spec.get_vector());
+      }
+
+      virtual void visit(const VectorRotationVectorSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_rotation());
+      }
+
+      virtual void visit(const RotationQuaternionConstructorSpec& spec)
+      {
+        write_tag(spec);
+        write_binary(os_, spec.get_x());
+        write_binary(os_, spec.get_y());
+        write_binary(os_, spec.get_z());
+        write_binary(os_, spec.get_w());
+      }
+
+      virtual void visit(const AxisAngleSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_axis());
+        write(spec.get_angle());
+      }
+
+      virtual void visit(const RotationReferenceSpec& spec)
+      {
+        write_tag(spec);
+        write_binary(os_, spec.get_reference_name());
+      }
+
+      virtual void visit(const InverseRotationSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_rotation());
+      }
+
+      virtual void visit(const RotationMultiplicationSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_inputs());
+      }
+
+      virtual void visit(const FrameCachedSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_frame());
+      }
+
+      virtual void visit(const FrameConstructorSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_translation());
+        write(spec.get_rotation());
+      }
+
+      virtual void visit(const OrientationOfSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_frame());
+      }
+
+      virtual void visit(const FrameMultiplicationSpec& spec)
+      {
+        write_tag(spec);
+        write(spec.get_inputs());
+      }
+
+      virtual void visit(const FrameReferenceSpec& spec)
+      {
+        write_tag(spec);
+        write_binary(os_, spec.get_reference_name());
+      }
+
+    private:
+      std::ostream& os_;
+
+      void write_tag(const Spec& spec)
+      {
+        write_binary(os_, static_cast<boost::uint64_t>(spec.get_type()));
+      }
+  };
+
+  ///
+  /// reading specifications
+  ///
+
+  // Reads specifications written by SpecWriter. Nodes are created with
+  // make_spec(), i.e. they end up in the current arena of the thread.
+  class SpecReader
+  {
+    public:
+      explicit SpecReader(std::istream& is) : is_(is) {}
+
+      SpecPtr read()
+      {
+        boost::uint64_t tag;
+        read_binary(is_, tag);
+
+        if(tag == NULL_SPEC_TAG)
+          return SpecPtr();
+
+        switch(tag)
+        {
+          case DOUBLE_CONST_SPEC:
+          {
+            DoubleConstSpecPtr spec = make_spec<DoubleConstSpec>();
+            double value;
+            read_binary(is_, value);
+            spec->set_value(value);
+            return spec;
+          }
+          case DOUBLE_INPUT_SPEC:
+          {
+            DoubleInputSpecPtr spec = make_spec<DoubleInputSpec>();
+            spec->set_input_num(read_binary_size(is_));
+            return spec;
+          }
+          case DOUBLE_REFERENCE_SPEC:
+          {
+            DoubleReferenceSpecPtr spec = make_spec<DoubleReferenceSpec>();
+            std::string name;
+            read_binary(is_, name);
+            spec->set_reference_name(name);
+            return spec;
+          }
+          case DOUBLE_ADDITION_SPEC:
+            return read_inputs<DoubleAdditionSpec, DoubleSpec>();
+          case DOUBLE_SUBTRACTION_SPEC:
+            return read_inputs<DoubleSubtractionSpec, DoubleSpec>();
+          case DOUBLE_NORM_OF_SPEC:
+          {
+            DoubleNormOfSpecPtr spec = make_spec<DoubleNormOfSpec>();
+            spec->set_vector(read<VectorSpec>());
+            return spec;
+          }
+          case DOUBLE_MULTIPLICATION_SPEC:
+            return read_inputs<DoubleMultiplicationSpec, DoubleSpec>();
+          case DOUBLE_DIVISION_SPEC:
+            return read_inputs<DoubleDivisionSpec, DoubleSpec>();
+          case DOUBLE_X_COORD_OF_SPEC:
+          {
+            DoubleXCoordOfSpecPtr spec = make_spec<DoubleXCoordOfSpec>();
+            spec->set_vector(read<VectorSpec>());
+            return spec;
+          }
+          case DOUBLE_Y_COORD_OF_SPEC:
+          {
+            DoubleYCoordOfSpecPtr spec = make_spec<DoubleYCoordOfSpec>();
+            spec->set_vector(read<VectorSpec>());
+            return spec;
+          }
+          case DOUBLE_Z_COORD_OF_SPEC:
+          {
+            DoubleZCoordOfSpecPtr spec = make_spec<DoubleZCoordOfSpec>();
+            spec->set_vector(read<VectorSpec>());
+            return spec;
+          }
+          case VECTOR_DOT_SPEC:
+          {
+            VectorDotSpecPtr spec = make_spec<VectorDotSpec>();
+            spec->set_lhs(read<VectorSpec>());
+            spec->set_rhs(read<VectorSpec>());
+            return spec;
+          }
+          case VECTOR_CACHED_SPEC:
+          {
+            VectorCachedSpecPtr spec = make_spec<VectorCachedSpec>();
+            spec->set_vector(read<VectorSpec>());
+            return spec;
+          }
+          case VECTOR_CONSTRUCTOR_SPEC:
+          {
+            VectorConstructorSpecPtr spec = make_spec<VectorConstructorSpec>();
+            spec->set_x(read<DoubleSpec>());
+            spec->set_y(read<DoubleSpec>());
+            spec->set_z(read<DoubleSpec>());
+            return spec;
+          }
+          case VECTOR_ADDITION_SPEC:
+            return read_inputs<VectorAdditionSpec, VectorSpec>();
+          case VECTOR_SUBTRACTION_SPEC:
+            return read_inputs<VectorSubtractionSpec, VectorSpec>();
+          case VECTOR_REFERENCE_SPEC:
+          {
+            VectorReferenceSpecPtr spec = make_spec<VectorReferenceSpec>();
+            std::string name;
+            read_binary(is_, name);
+            spec->set_reference_name(name);
+            return spec;
+          }
+          case VECTOR_ORIGIN_OF_SPEC:
+          {
+            VectorOriginOfSpecPtr spec = make_spec<VectorOriginOfSpec>();
+            spec->set_frame(read<FrameSpec>());
+            return spec;
+          }
+          case VECTOR_FRAME_MULTIPLICATION_SPEC:
+          {
+            VectorFrameMultiplicationSpecPtr spec = make_spec<VectorFrameMultiplicationSpec>();
+            spec->set_frame(read<FrameSpec>());
+            spec->set_vector(read<VectorSpec>());
+            return spec;
+          }
+          case VECTOR_DOUBLE_MULTIPLICATION_SPEC:
+          {
+            VectorDoubleMultiplicationSpecPtr spec = make_spec<VectorDoubleMultiplicationSpec>();
+            spec->set_double(read<DoubleSpec>());
+            spec->set_vector(read<VectorSpec>());
+            return spec;
+          }
+          case VECTOR_ROTATION_VECTOR_SPEC:
+          {
+            VectorRotationVectorSpecPtr spec = make_spec<VectorRotationVectorSpec>();
+            spec->set_rotation(read<RotationSpec>());
+            return spec;
+          }
+          case ROTATION_QUATERNION_CONSTRUCTOR_SPEC:
+          {
+            RotationQuaternionConstructorSpecPtr spec = 
+                make_spec<RotationQuaternionConstructorSpec>();
+            double x, y, z, w;
+            read_binary(is_, x);
+            read_binary(is_, y);
+            read_binary(is_, z);
+            read_binary(is_, w);
+            spec->set_x(x);
+            spec->set_y(y);
+            spec->set_z(z);
+            spec->set_w(w);
+            return spec;
+          }
+          case AXIS_ANGLE_SPEC:
+          {
+            AxisAngleSpecPtr spec = make_spec<AxisAngleSpec>();
+            spec->set_axis(read<VectorSpec>());
+            spec->set_angle(read<DoubleSpec>());
+            return spec;
+          }
+          case ROTATION_REFERENCE_SPEC:
+          {
+            RotationReferenceSpecPtr spec = make_spec<RotationReferenceSpec>();
+            std::string name;
+            read_binary(is_, name);
+            spec->set_reference_name(name);
+            return spec;
+          }
+          case INVERSE_ROTATION_SPEC:
+          {
+            InverseRotationSpecPtr spec = make_spec<InverseRotationSpec>();
+            spec->set_rotation(read<RotationSpec>());
+            return spec;
+          }
+          case ROTATION_MULTIPLICATION_SPEC:
+            return read_inputs<RotationMultiplicationSpec, RotationSpec>();
+          case FRAME_CACHED_SPEC:
+          {
+            FrameCachedSpecPtr spec = make_spec<FrameCachedSpec>();
+            spec->set_frame(read<FrameSpec>());
+            return spec;
+          }
+          case FRAME_CONSTRUCTOR_SPEC:
+          {
+            FrameConstructorSpecPtr spec = make_spec<FrameConstructorSpec>();
+            spec->set_translation(read<VectorSpec>());
+            spec->set_rotation(read<RotationSpec>());
+            return spec;
+          }
+          case ORIENTATION_OF_SPEC:
+          {
+            OrientationOfSpecPtr spec = make_spec<OrientationOfSpec>();
+            spec->set_frame(read<FrameSpec>());
+            return spec;
+          }
+          case FRAME_MULTIPLICATION_SPEC:
+            return read_inputs<FrameMultiplicationSpec, FrameSpec>();
+          case FRAME_REFERENCE_SPEC:
+          {
+            FrameReferenceSpecPtr spec = make_spec<FrameReferenceSpec>();
+            std::string name;
+            read_binary(is_, name);
+            spec->set_reference_name(name);
+            return spec;
+          }
+          default:
+            throw std::runtime_error("Spec deserialization: unknown type tag " +
+                boost::lexical_cast<std::string>(tag) + ".");
+        }
+      }
+
+      template<class T>
+      boost::shared_ptr<T> read()
+      {
+        SpecPtr spec = read();
+        if(spec.get() && spec->get_category() != category_of(static_cast<T*>(0)))
+          throw std::runtime_error("Spec deserialization: found spec of unexpected category.");
+
+        return boost::static_pointer_cast<T>(spec);
+      }
+
+    private:
+      std::istream& is_;
+
+      static SpecCategory category_of(const DoubleSpec*) { return DOUBLE_SPEC; }
+      static SpecCategory category_of(const VectorSpec*) { return VECTOR_SPEC; }
+      static SpecCategory category_of(const RotationSpec*) { return ROTATION_SPEC; }
+      static SpecCategory category_of(const FrameSpec*) { return FRAME_SPEC; }
+
+      template<class T, class InputType>
+      boost::shared_ptr<T> read_inputs()
+      {
+        boost::shared_ptr<T> spec = make_spec<T>();
+        // grows while reading, so that a corrupt size runs into the end of the stream
+        size_t size = read_binary_size(is_);
+        std::vector< boost::shared_ptr<InputType> > inputs;
+        for(size_t i=0; i<size; ++i)
+          inputs.push_back(read<InputType>());
+        spec->swap_inputs(inputs);
+        return spec;
+      }
+  };
+
+  ///
+  /// serialization of whole controller specifications
+  ///
+
+  inline void write_binary(std::ostream& os, const QPControllerSpec& spec)
+  {
+    SpecWriter writer(os);
+
+    write_binary(os, static_cast<boost::uint64_t>(spec.scope_.size()));
+    for(size_t i=0; i<spec.scope_.size(); ++i)
+    {
+      write_binary(os, spec.scope_[i].name);
+      writer.write(spec.scope_[i].spec);
+    }
+
+    write_binary(os, static_cast<boost::uint64_t>(spec.controllable_constraints_.size()));
+    for(size_t i=0; i<spec.controllable_constraints_.size(); ++i)
+    {
+      const ControllableConstraintSpec& c = spec.controllable_constraints_[i];
+      writer.write(c.lower_);
+      writer.write(c.upper_);
+      writer.write(c.weight_);
+      write_binary(os, static_cast<boost::uint64_t>(c.input_number_));
+      write_binary(os, c.name_);
+    }
+
+    write_binary(os, static_cast<boost::uint64_t>(spec.soft_constraints_.size()));
+    for(size_t i=0; i<spec.soft_constraints_.size(); ++i)
+    {
+      const SoftConstraintSpec& c = spec.soft_constraints_[i];
+      writer.write(c.expression_);
+      writer.write(c.lower_);
+      writer.write(c.upper_);
+      writer.write(c.weight_);
+      write_binary(os, c.name_);
+      write_binary(os, static_cast<boost::uint64_t>(c.priority_));
+    }
+
+    write_binary(os, static_cast<boost::uint64_t>(spec.hard_constraints_.size()));
+    for(size_t i=0; i<spec.hard_constraints_.size(); ++i)
+    {
+      const HardConstraintSpec& c = spec.hard_constraints_[i];
+      writer.write(c.expression_);
+      writer.write(c.lower_);
+      writer.write(c.upper_);
+    }
+  }
+
+  // Like the readers of strings and inputs, this grows all lists while reading
+  // instead of resizing them to the sizes in the stream.
+  inline void read_binary(std::istream& is, QPControllerSpec& spec)
+  {
+    SpecReader reader(is);
+
+    size_t size = read_binary_size(is);
+    spec.scope_.clear();
+    for(size_t i=0; i<size; ++i)
+    {
+      spec.scope_.push_back(ScopeEntry());
+      read_binary(is, spec.scope_.back().name);
+      spec.scope_.back().spec = reader.read();
+    }
+
+    size = read_binary_size(is);
+    spec.controllable_constraints_.clear();
+    for(size_t i=0; i<size; ++i)
+    {
+      spec.controllable_constraints_.push_back(ControllableConstraintSpec());
+      ControllableConstraintSpec& c = spec.controllable_constraints_.back();
+      c.lower_ = reader.read<DoubleSpec>();
+      c.upper_ = reader.read<DoubleSpec>();
+      c.weight_ = reader.read<DoubleSpec>();
+      c.input_number_ = read_binary_size(is);
+      read_binary(is, c.name_);
+    }
+
+    size = read_binary_size(is);
+    spec.soft_constraints_.clear();
+    for(size_t i=0; i<size; ++i)
+    {
+      spec.soft_constraints_.push_back(SoftConstraintSpec());
+      SoftConstraintSpec& c = spec.soft_constraints_.back();
+      c.expression_ = reader.read<DoubleSpec>();
+      c.lower_ = reader.read<DoubleSpec>();
+      c.upper_ = reader.read<DoubleSpec>();
+      c.weight_ = reader.read<DoubleSpec>();
+      read_binary(is, c.name_);
+      c.priority_ = read_binary_size(is);
+    }
+
+    size = read_binary_size(is);
+    spec.hard_constraints_.clear();
+    for(size_t i=0; i<size; ++i)
+    {
+      spec.hard_constraints_.push_back(HardConstraintSpec());
+      HardConstraintSpec& c = spec.hard_constraints_.back();
+      c.expression_ = reader.read<DoubleSpec>();
+      c.lower_ = reader.read<DoubleSpec>();
+      c.upper_ = reader.read<DoubleSpec>();
+    }
+  }
+}
+
+#endif // GISKARD_SPEC_SERIALIZATION_HPP
@@ -25,11 +25,129 @@
 #include <iostream>
 #include <map>
 #include <boost/lexical_cast.hpp>
+#include <boost/functional/hash.hpp>
 #include <giskard/expressiontree.hpp>
 #include <giskard/scope.hpp>
 
 namespace giskard
 {
+  ///
+  /// type tags and visitor interface of all specifications
+  ///
+
+  class DoubleConstSpec;
+  class DoubleInputSpec;
+  class DoubleReferenceSpec;
+  class DoubleAdditionSpec;
+  class DoubleSubtractionSpec;
+  class DoubleNormOfSpec;
+  class DoubleMultiplicationSpec;
+  class DoubleDivisionSpec;
+  class DoubleXCoordOfSpec;
+  class DoubleYCoordOfSpec;
+  class DoubleZCoordOfSpec;
+  class VectorDotSpec;
+  class VectorCachedSpec;
+  class VectorConstructorSpec;
+  class VectorAdditionSpec;
+  class VectorSubtractionSpec;
+  class VectorReferenceSpec;
+  class VectorOriginOfSpec;
+  class VectorFrameMultiplicationSpec;
+  class VectorDoubleMultiplicationSpec;
+  class VectorRotationVectorSpec;
+  class RotationQuaternionConstructorSpec;
+  class AxisAngleSpec;
+  class RotationReferenceSpec;
+  class InverseRotationSpec;
+  class RotationMultiplicationSpec;
+  class FrameCachedSpec;
+  class FrameConstructorSpec;
+  class OrientationOfSpec;
+  class FrameMultiplicationSpec;
+  class FrameReferenceSpec;
+
+  enum SpecCategory
+  {
+    DOUBLE_SPEC,
+    VECTOR_SPEC,
+    ROTATION_SPEC,
+    FRAME_SPEC
+  };
+
+  enum SpecType
+  {
+    DOUBLE_CONST_SPEC,
+    DOUBLE_INPUT_SPEC,
+    DOUBLE_REFERENCE_SPEC,
+    DOUBLE_ADDITION_SPEC,
+    DOUBLE_SUBTRACTION_SPEC,
+    DOUBLE_NORM_OF_SPEC,
+    DOUBLE_MULTIPLICATION_SPEC,
+    DOUBLE_DIVISION_SPEC,
+    DOUBLE_X_COORD_OF_SPEC,
+    DOUBLE_Y_COORD_OF_SPEC,
+    DOUBLE_Z_COORD_OF_SPEC,
+    VECTOR_DOT_SPEC,
+    VECTOR_CACHED_SPEC,
+    VECTOR_CONSTRUCTOR_SPEC,
+    VECTOR_ADDITION_SPEC,
+    VECTOR_SUBTRACTION_SPEC,
+    VECTOR_REFERENCE_SPEC,
+    VECTOR_ORIGIN_OF_SPEC,
+    VECTOR_FRAME_MULTIPLICATION_SPEC,
+    VECTOR_DOUBLE_MULTIPLICATION_SPEC,
+    VECTOR_ROTATION_VECTOR_SPEC,
+    ROTATION_QUATERNION_CONSTRUCTOR_SPEC,
+    AXIS_ANGLE_SPEC,
+    ROTATION_REFERENCE_SPEC,
+    INVERSE_ROTATION_SPEC,
+    ROTATION_MULTIPLICATION_SPEC,
+    FRAME_CACHED_SPEC,
+    FRAME_CONSTRUCTOR_SPEC,
+    ORIENTATION_OF_SPEC,
+    FRAME_MULTIPLICATION_SPEC,
+    FRAME_REFERENCE_SPEC
+  };
+
+  class SpecVisitor
+  {
+    public:
+      virtual ~SpecVisitor() {}
+
+      virtual void visit(const DoubleConstSpec& spec) = 0;
+      virtual void visit(const DoubleInputSpec& spec) = 0;
+      virtual void visit(const DoubleReferenceSpec& spec) = 0;
+      virtual void visit(const DoubleAdditionSpec& spec) = 0;
+      virtual void visit(const DoubleSubtractionSpec& spec) = 0;
+      virtual void visit(const DoubleNormOfSpec& spec) = 0;
+      virtual void visit(const DoubleMultiplicationSpec& spec) = 0;
+      virtual void visit(const DoubleDivisionSpec& spec) = 0;
+      virtual void visit(const DoubleXCoordOfSpec& spec) = 0;
+      virtual void visit(const DoubleYCoordOfSpec& spec) = 0;
+      virtual void visit(const DoubleZCoordOfSpec& spec) = 0;
+      virtual void visit(const VectorDotSpec& spec) = 0;
+      virtual void visit(const VectorCachedSpec& spec) = 0;
+      virtual void visit(const VectorConstructorSpec& spec) = 0;
+      virtual void visit(const VectorAdditionSpec& spec) = 0;
+      virtual void visit(const VectorSubtractionSpec& spec) = 0;
+      virtual void visit(const VectorReferenceSpec& spec) = 0;
+      virtual void visit(const VectorOriginOfSpec& spec) = 0;
+      virtual void visit(const VectorFrameMultiplicationSpec& spec) = 0;
+      virtual void visit(const VectorDoubleMultiplicationSpec& spec) = 0;
+      virtual void visit(const VectorRotationVectorSpec& spec) = 0;
+      virtual void visit(const RotationQuaternionConstructorSpec& spec) = 0;
+      virtual void visit(const AxisAngleSpec& spec) = 0;
+      virtual void visit(const RotationReferenceSpec& spec) = 0;
+      virtual void visit(const InverseRotationSpec& spec) = 0;
+      virtual void visit(const RotationMultiplicationSpec& spec) = 0;
+      virtual void visit(const FrameCachedSpec& spec) = 0;
+      virtual void visit(const FrameConstructorSpec& spec) = 0;
+      virtual void visit(const OrientationOfSpec& spec) = 0;
+      virtual void visit(const FrameMultiplicationSpec& spec) = 0;
+      virtual void visit(const FrameReferenceSpec& spec) = 0;
+  };
+
   ///
   /// base of all specifications of expressions
   ///
@@ -37,6 +155,14 @@ namespace giskard
   class Spec
   { 
     public:
+      virtual ~Spec() {}
+
+      virtual SpecType get_type() const = 0;
+
+      virtual SpecCategory get_category() const = 0;
+
+      virtual void accept(SpecVisitor& visitor) const = 0;
+
       virtual bool equals(const Spec& other) const = 0;
 
       // TODO: extend this with a parameter for indention
@@ -68,6 +194,11 @@ namespace giskard
   class DoubleSpec : public Spec
   {
     public:
+      virtual SpecCategory get_category() const
+      {
+        return DOUBLE_SPEC;
+      }
+
       virtual bool equals(const Spec& other) const = 0;
 
       virtual std::string to_string() const = 0;
@@ -80,6 +211,11 @@ namespace giskard
   class VectorSpec : public Spec
   {
     public:
+      virtual SpecCategory get_category() const
+      {
+        return VECTOR_SPEC;
+      }
+
       virtual bool equals(const Spec& other) const = 0;
 
       virtual std::string to_string() const = 0;
@@ -92,6 +228,11 @@ namespace giskard
   class RotationSpec : public Spec
   {
     public:
+      virtual SpecCategory get_category() const
+      {
+        return ROTATION_SPEC;
+      }
+
       virtual bool equals(const Spec& other) const = 0;
 
       virtual std::string to_string() const = 0;
@@ -104,6 +245,11 @@ namespace giskard
   class FrameSpec : public Spec
   {
     public:
+      virtual SpecCategory get_category() const
+      {
+        return FRAME_SPEC;
+      }
+
       virtual bool equals(const Spec& other) const = 0;
 
       virtual std::string to_string() const = 0;
@@ -135,13 +281,23 @@ namespace giskard
         value_ = value;
       } 
 
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_CONST_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleConstSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
         return KDL::epsilon >
-            std::abs(dynamic_cast<const DoubleConstSpec*>(&other)->get_value() - this->get_value());
+            std::abs(static_cast<const DoubleConstSpec*>(&other)->get_value() - this->get_value());
       }
 
       virtual std::string to_string() const
@@ -178,12 +334,22 @@ namespace giskard
         input_num_ = input_num;
       }
 
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_INPUT_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleInputSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return dynamic_cast<const DoubleInputSpec*>(&other)->get_input_num() == this->get_input_num();
+        return static_cast<const DoubleInputSpec*>(&other)->get_input_num() == this->get_input_num();
       }
 
       virtual std::string to_string() const
@@ -215,12 +381,22 @@ namespace giskard
         reference_name_ = reference_name;
       }
 
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_REFERENCE_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleReferenceSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return (dynamic_cast<const DoubleReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
+        return (static_cast<const DoubleReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
       }
 
       virtual std::string to_string() const
@@ -252,12 +428,27 @@ namespace giskard
         inputs_ = inputs;
       }
 
+      void swap_inputs(std::vector<DoubleSpecPtr>& inputs)
+      {
+        inputs_.swap(inputs);
+      }
+
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_ADDITION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleAdditionSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const DoubleAdditionSpec* other_p = dynamic_cast<const DoubleAdditionSpec*>(&other);
+        const DoubleAdditionSpec* other_p = static_cast<const DoubleAdditionSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -315,12 +506,27 @@ namespace giskard
         inputs_ = inputs;
       }
 
+      void swap_inputs(std::vector<DoubleSpecPtr>& inputs)
+      {
+        inputs_.swap(inputs);
+      }
+
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_SUBTRACTION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleSubtractionSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const DoubleSubtractionSpec* other_p = dynamic_cast<const DoubleSubtractionSpec*>(&other);
+        const DoubleSubtractionSpec* other_p = static_cast<const DoubleSubtractionSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -392,12 +598,22 @@ namespace giskard
         vector_ = vector;
       }
 
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_NORM_OF_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleNormOfSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return dynamic_cast<const DoubleNormOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
+        return static_cast<const DoubleNormOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
       }
 
       virtual std::string to_string() const
@@ -429,12 +645,27 @@ namespace giskard
         inputs_ = inputs;
       }
 
+      void swap_inputs(std::vector<DoubleSpecPtr>& inputs)
+      {
+        inputs_.swap(inputs);
+      }
+
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_MULTIPLICATION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleMultiplicationSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const DoubleMultiplicationSpec* other_p = dynamic_cast<const DoubleMultiplicationSpec*>(&other);
+        const DoubleMultiplicationSpec* other_p = static_cast<const DoubleMultiplicationSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -494,12 +725,27 @@ namespace giskard
         inputs_ = inputs;
       }
 
+      void swap_inputs(std::vector<DoubleSpecPtr>& inputs)
+      {
+        inputs_.swap(inputs);
+      }
+
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_DIVISION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleDivisionSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const DoubleDivisionSpec* other_p = dynamic_cast<const DoubleDivisionSpec*>(&other);
+        const DoubleDivisionSpec* other_p = static_cast<const DoubleDivisionSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -571,12 +817,22 @@ namespace giskard
         vector_ = vector;
       }
 
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_X_COORD_OF_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleXCoordOfSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return dynamic_cast<const DoubleXCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
+        return static_cast<const DoubleXCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
       }
 
       virtual std::string to_string() const
@@ -608,12 +864,22 @@ namespace giskard
         vector_ = vector;
       }
 
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_Y_COORD_OF_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleYCoordOfSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return dynamic_cast<const DoubleYCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
+        return static_cast<const DoubleYCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
       }
 
       virtual std::string to_string() const
@@ -645,12 +911,22 @@ namespace giskard
         vector_ = vector;
       }
 
+      virtual SpecType get_type() const
+      {
+        return DOUBLE_Z_COORD_OF_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const DoubleZCoordOfSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return dynamic_cast<const DoubleZCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
+        return static_cast<const DoubleZCoordOfSpec*>(&other)->get_vector()->equals(*(this->get_vector()));
       }
 
       virtual std::string to_string() const
@@ -692,12 +968,22 @@ namespace giskard
         rhs_ = rhs;
       }
 
+      virtual SpecType get_type() const
+      {
+        return VECTOR_DOT_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorDotSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const VectorDotSpec* other_p = dynamic_cast<const VectorDotSpec*>(&other);
+        const VectorDotSpec* other_p = static_cast<const VectorDotSpec*>(&other);
 
         return get_lhs().get() && get_rhs().get() &&
             other_p->get_lhs().get() && other_p->get_rhs().get() &&
@@ -739,12 +1025,22 @@ namespace giskard
         vector_ = vector;
       }
 
+      virtual SpecType get_type() const
+      {
+        return VECTOR_CACHED_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorCachedSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const VectorCachedSpec* other_p = dynamic_cast<const VectorCachedSpec*>(&other);
+        const VectorCachedSpec* other_p = static_cast<const VectorCachedSpec*>(&other);
 
         return get_vector().get() && other_p->get_vector().get() &&
             get_vector()->equals(*(other_p->get_vector()));
@@ -758,7 +1054,8 @@ namespace giskard
 
       virtual KDL::Expression<KDL::Vector>::Ptr get_expression(const giskard::Scope& scope)
       {
-        return KDL::cached<KDL::Vector>(get_vector()->get_expression(scope));
+        // marked as shared to stay cached in deep copies, see KDL::SharedExpression
+        return KDL::shared<KDL::Vector>(KDL::cached<KDL::Vector>(get_vector()->get_expression(scope)));
       }
 
     private:
@@ -816,12 +1113,22 @@ namespace giskard
         set_z(z);
       }
 
+      virtual SpecType get_type() const
+      {
+        return VECTOR_CONSTRUCTOR_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorConstructorSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const VectorConstructorSpec* other_p = dynamic_cast<const VectorConstructorSpec*>(&other);
+        const VectorConstructorSpec* other_p = static_cast<const VectorConstructorSpec*>(&other);
         
         if(!members_valid() || !other_p->members_valid())
           return false;
@@ -875,12 +1182,27 @@ namespace giskard
         inputs_ = inputs;
       }
 
+      void swap_inputs(std::vector<VectorSpecPtr>& inputs)
+      {
+        inputs_.swap(inputs);
+      }
+
+      virtual SpecType get_type() const
+      {
+        return VECTOR_ADDITION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorAdditionSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const VectorAdditionSpec* other_p = dynamic_cast<const VectorAdditionSpec*>(&other);
+        const VectorAdditionSpec* other_p = static_cast<const VectorAdditionSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -941,12 +1263,27 @@ namespace giskard
         inputs_ = inputs;
       }
 
+      void swap_inputs(std::vector<VectorSpecPtr>& inputs)
+      {
+        inputs_.swap(inputs);
+      }
+
+      virtual SpecType get_type() const
+      {
+        return VECTOR_SUBTRACTION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorSubtractionSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const VectorSubtractionSpec* other_p = dynamic_cast<const VectorSubtractionSpec*>(&other);
+        const VectorSubtractionSpec* other_p = static_cast<const VectorSubtractionSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -1018,12 +1355,22 @@ namespace giskard
         reference_name_ = reference_name;
       }
 
+      virtual SpecType get_type() const
+      {
+        return VECTOR_REFERENCE_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorReferenceSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return (dynamic_cast<const VectorReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
+        return (static_cast<const VectorReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
       }
 
       virtual std::string to_string() const
@@ -1055,12 +1402,22 @@ namespace giskard
         frame_ = frame;
       }
 
+      virtual SpecType get_type() const
+      {
+        return VECTOR_ORIGIN_OF_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorOriginOfSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return dynamic_cast<const VectorOriginOfSpec*>(&other)->get_frame()->equals(*(this->get_frame()));
+        return static_cast<const VectorOriginOfSpec*>(&other)->get_frame()->equals(*(this->get_frame()));
       }
 
       virtual std::string to_string() const
@@ -1102,12 +1459,22 @@ namespace giskard
         frame_ = frame;
       }
 
+      virtual SpecType get_type() const
+      {
+        return VECTOR_FRAME_MULTIPLICATION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorFrameMultiplicationSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const VectorFrameMultiplicationSpec* other_p = dynamic_cast<const VectorFrameMultiplicationSpec*>(&other);
+        const VectorFrameMultiplicationSpec* other_p = static_cast<const VectorFrameMultiplicationSpec*>(&other);
 
         return get_frame().get() && get_vector().get() && 
             get_frame()->equals(*(other_p->get_frame())) &&
@@ -1157,13 +1524,23 @@ namespace giskard
         double_ = new_double;
       }
 
+      virtual SpecType get_type() const
+      {
+        return VECTOR_DOUBLE_MULTIPLICATION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorDoubleMultiplicationSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
         const VectorDoubleMultiplicationSpec* other_p = 
-            dynamic_cast<const VectorDoubleMultiplicationSpec*>(&other);
+            static_cast<const VectorDoubleMultiplicationSpec*>(&other);
 
         return get_double().get() && get_vector().get() && 
             get_double()->equals(*(other_p->get_double())) &&
@@ -1203,12 +1580,22 @@ namespace giskard
         rotation_ = rotation;
       }
 
+      virtual SpecType get_type() const
+      {
+        return VECTOR_ROTATION_VECTOR_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const VectorRotationVectorSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return dynamic_cast<const VectorRotationVectorSpec*>(&other)->get_rotation()->equals(*(this->get_rotation()));
+        return static_cast<const VectorRotationVectorSpec*>(&other)->get_rotation()->equals(*(this->get_rotation()));
       }
 
       virtual std::string to_string() const
@@ -1282,13 +1669,23 @@ namespace giskard
         w_ = w;
       }
 
+      virtual SpecType get_type() const
+      {
+        return ROTATION_QUATERNION_CONSTRUCTOR_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const RotationQuaternionConstructorSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return (KDL::epsilon > std::abs(dynamic_cast<const RotationQuaternionConstructorSpec*>(&other)->get_x() - this->get_x())) &&
-            (KDL::epsilon > std::abs(dynamic_cast<const RotationQuaternionConstructorSpec*>(&other)->get_y() - this->get_y())) && (KDL::epsilon > std::abs(dynamic_cast<const RotationQuaternionConstructorSpec*>(&other)->get_z() - this->get_z())) && (KDL::epsilon > std::abs(dynamic_cast<const RotationQuaternionConstructorSpec*>(&other)->get_w() - this->get_w()));
+        return (KDL::epsilon > std::abs(static_cast<const RotationQuaternionConstructorSpec*>(&other)->get_x() - this->get_x())) &&
+            (KDL::epsilon > std::abs(static_cast<const RotationQuaternionConstructorSpec*>(&other)->get_y() - this->get_y())) && (KDL::epsilon > std::abs(static_cast<const RotationQuaternionConstructorSpec*>(&other)->get_z() - this->get_z())) && (KDL::epsilon > std::abs(static_cast<const RotationQuaternionConstructorSpec*>(&other)->get_w() - this->get_w()));
       }
 
       virtual std::string to_string() const
@@ -1341,12 +1738,22 @@ namespace giskard
         return get_axis().get() && get_angle().get();
       }
 
+      virtual SpecType get_type() const
+      {
+        return AXIS_ANGLE_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const AxisAngleSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const AxisAngleSpec* other_p = dynamic_cast<const AxisAngleSpec*>(&other);
+        const AxisAngleSpec* other_p = static_cast<const AxisAngleSpec*>(&other);
 
         if(!members_valid() || !other_p->members_valid())
           return false;
@@ -1393,12 +1800,22 @@ namespace giskard
         reference_name_ = reference_name;
       }
 
+      virtual SpecType get_type() const
+      {
+        return ROTATION_REFERENCE_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const RotationReferenceSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return (dynamic_cast<const RotationReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
+        return (static_cast<const RotationReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
       }
 
       virtual std::string to_string() const
@@ -1438,12 +1855,22 @@ namespace giskard
         rotation_ = rotation;
       }
 
+      virtual SpecType get_type() const
+      {
+        return INVERSE_ROTATION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const InverseRotationSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return dynamic_cast<const InverseRotationSpec*>(&other)->get_rotation()->equals(*(this->get_rotation()));
+        return static_cast<const InverseRotationSpec*>(&other)->get_rotation()->equals(*(this->get_rotation()));
       }
 
       virtual std::string to_string() const
@@ -1488,13 +1915,28 @@ namespace giskard
         inputs_ = inputs;
       }
 
+      void swap_inputs(std::vector<RotationSpecPtr>& inputs)
+      {
+        inputs_.swap(inputs);
+      }
+
+      virtual SpecType get_type() const
+      {
+        return ROTATION_MULTIPLICATION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const RotationMultiplicationSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
         const RotationMultiplicationSpec* other_p = 
-          dynamic_cast<const RotationMultiplicationSpec*>(&other);
+          static_cast<const RotationMultiplicationSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -1562,12 +2004,22 @@ namespace giskard
         frame_ = frame;
       }
 
+      virtual SpecType get_type() const
+      {
+        return FRAME_CACHED_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const FrameCachedSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const FrameCachedSpec* other_p = dynamic_cast<const FrameCachedSpec*>(&other);
+        const FrameCachedSpec* other_p = static_cast<const FrameCachedSpec*>(&other);
 
         return get_frame().get() && other_p->get_frame().get() &&
             get_frame()->equals(*(other_p->get_frame()));
@@ -1581,7 +2033,8 @@ namespace giskard
 
       virtual KDL::Expression<KDL::Frame>::Ptr get_expression(const giskard::Scope& scope)
       {
-        return KDL::cached<KDL::Frame>(get_frame()->get_expression(scope));
+        // marked as shared to stay cached in deep copies, see KDL::SharedExpression
+        return KDL::shared<KDL::Frame>(KDL::cached<KDL::Frame>(get_frame()->get_expression(scope)));
       }
 
     private:
@@ -1621,12 +2074,22 @@ namespace giskard
         rotation_ = rotation;
       }
 
+      virtual SpecType get_type() const
+      {
+        return FRAME_CONSTRUCTOR_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const FrameConstructorSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const FrameConstructorSpec* other_p = dynamic_cast<const FrameConstructorSpec*>(&other);
+        const FrameConstructorSpec* other_p = static_cast<const FrameConstructorSpec*>(&other);
 
         if(!members_valid() || !other_p->members_valid())
           return false;
@@ -1690,12 +2153,22 @@ namespace giskard
         frame_ = frame;
       }
 
+      virtual SpecType get_type() const
+      {
+        return ORIENTATION_OF_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const OrientationOfSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return dynamic_cast<const OrientationOfSpec*>(&other)->get_frame()->equals(*(this->get_frame()));
+        return static_cast<const OrientationOfSpec*>(&other)->get_frame()->equals(*(this->get_frame()));
       }
 
       virtual std::string to_string() const
@@ -1732,12 +2205,27 @@ namespace giskard
         inputs_ = inputs;
       }
 
+      void swap_inputs(std::vector<FrameSpecPtr>& inputs)
+      {
+        inputs_.swap(inputs);
+      }
+
+      virtual SpecType get_type() const
+      {
+        return FRAME_MULTIPLICATION_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const FrameMultiplicationSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        const FrameMultiplicationSpec* other_p = dynamic_cast<const FrameMultiplicationSpec*>(&other);
+        const FrameMultiplicationSpec* other_p = static_cast<const FrameMultiplicationSpec*>(&other);
 
         if(get_inputs().size() != other_p->get_inputs().size())
           return false;
@@ -1800,12 +2288,22 @@ namespace giskard
         reference_name_ = reference_name;
       }
 
+      virtual SpecType get_type() const
+      {
+        return FRAME_REFERENCE_SPEC;
+      }
+
+      virtual void accept(SpecVisitor& visitor) const
+      {
+        visitor.visit(*this);
+      }
+
       virtual bool equals(const Spec& other) const
       {
-        if(!dynamic_cast<const FrameReferenceSpec*>(&other))
+        if(other.get_type() != get_type())
           return false;
 
-        return (dynamic_cast<const FrameReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
+        return (static_cast<const FrameReferenceSpec*>(&other)->get_reference_name().compare(this->get_reference_name()) == 0);
       }
 
       virtual std::string to_string() const
@@ -1824,6 +2322,258 @@ namespace giskard
 
   typedef typename boost::shared_ptr<FrameReferenceSpec> FrameReferenceSpecPtr;
 
+  ///
+  /// structural hashing of specifications
+  ///
+
+  // Hashes a specification tree such that equal trees yield equal hashes.
+  // NOTE: Doubles are hashed bitwise while equals() compares them with a
+  //       tolerance of KDL::epsilon. Hence, two specifications differing
+  //       by less than that tolerance are equal but may hash differently.
+  class SpecHasher : public SpecVisitor
+  {
+    public:
+      SpecHasher() : seed_(0) {}
+
+      std::size_t get_hash() const
+      {
+        return seed_;
+      }
+
+      std::size_t& seed()
+      {
+        return seed_;
+      }
+
+      void hash(const SpecPtr& spec)
+      {
+        if(spec.get())
+          spec->accept(*this);
+        else
+          boost::hash_combine(seed_, static_cast<std::size_t>(0));
+      }
+
+      template<class T>
+      void hash(const std::vector< boost::shared_ptr<T> >& specs)
+      {
+        boost::hash_combine(seed_, specs.size());
+        for(size_t i=0; i<specs.size(); ++i)
+          hash(specs[i]);
+      }
+
+      virtual void visit(const DoubleConstSpec& spec)
+      {
+        combine(spec);
+        boost::hash_combine(seed_, spec.get_value());
+      }
+
+      virtual void visit(const DoubleInputSpec& spec)
+      {
+        combine(spec);
+        boost::hash_combine(seed_, spec.get_input_num());
+      }
+
+      virtual void visit(const DoubleReferenceSpec& spec)
+      {
+        combine(spec);
+        boost::hash_combine(seed_, spec.get_reference_name());
+      }
+
+      virtual void visit(const DoubleAdditionSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleSubtractionSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleNormOfSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleMultiplicationSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleDivisionSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_inputs());
+      }
+
+      virtual void visit(const DoubleXCoordOfSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleYCoordOfSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_vector());
+      }
+
+      virtual void visit(const DoubleZCoordOfSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_vector());
+      }
+
+      virtual void visit(const VectorDotSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_lhs());
+        hash(spec.get_rhs());
+      }
+
+      virtual void visit(const VectorCachedSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_vector());
+      }
+
+      virtual void visit(const VectorConstructorSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_x());
+        hash(spec.get_y());
+        hash(spec.get_z());
+      }
+
+      virtual void visit(const VectorAdditionSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_inputs());
+      }
+
+      virtual void visit(const VectorSubtractionSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_inputs());
+      }
+
+      virtual void visit(const VectorReferenceSpec& spec)
+      {
+        combine(spec);
+        boost::hash_combine(seed_, spec.get_reference_name());
+      }
+
+      virtual void visit(const VectorOriginOfSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_frame());
+      }
+
+      virtual void visit(const VectorFrameMultiplicationSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_frame());
+        hash(spec.get_vector());
+      }
+
+      virtual void visit(const VectorDoubleMultiplicationSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_double());
+        hash(spec.get_vector());
+      }
+
+      virtual void visit(const VectorRotationVectorSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_rotation());
+      }
+
+      virtual void visit(const RotationQuaternionConstructorSpec& spec)
+      {
+        combine(spec);
+        boost::hash_combine(seed_, spec.get_x());
+        boost::hash_combine(seed_, spec.get_y());
+        boost::hash_combine(seed_, spec.get_z());
+        boost::hash_combine(seed_, spec.get_w());
+      }
+
+      virtual void visit(const AxisAngleSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_axis());
+        hash(spec.get_angle());
+      }
+
+      virtual void visit(const RotationReferenceSpec& spec)
+      {
+        combine(spec);
+        boost::hash_combine(seed_, spec.get_reference_name());
+      }
+
+      virtual void visit(const InverseRotationSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_rotation());
+      }
+
+      virtual void visit(const RotationMultiplicationSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_inputs());
+      }
+
+      virtual void visit(const FrameCachedSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_frame());
+      }
+
+      virtual void visit(const FrameConstructorSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_translation());
+        hash(spec.get_rotation());
+      }
+
+      virtual void visit(const OrientationOfSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_frame());
+      }
+
+      virtual void visit(const FrameMultiplicationSpec& spec)
+      {
+        combine(spec);
+        hash(spec.get_inputs());
+      }
+
+      virtual void visit(const FrameReferenceSpec& spec)
+      {
+        combine(spec);
+        boost::hash_combine(seed_, spec.get_reference_name());
+      }
+
+    private:
+      std::size_t seed_;
+
+      void combine(const Spec& spec)
+      {
+        // offset tags by one to keep them apart from null children
+        boost::hash_combine(seed_, static_cast<std::size_t>(spec.get_type()) + 1);
+      }
+  };
+
+  inline std::size_t hash_value(const Spec& spec)
+  {
+    SpecHasher hasher;
+    spec.accept(hasher);
+    return hasher.get_hash();
+  }
+
   ///
   /// Specification of a Scope
   ///
@@ -1850,8 +2600,14 @@ namespace giskard
   class SoftConstraintSpec
   {
     public:
+      SoftConstraintSpec() :
+        priority_(0) {}
+
       giskard::DoubleSpecPtr expression_, lower_, upper_, weight_;
       std::string name_;
+      // Priority level, 0 is the most important one. Constraints of a level are
+      // only traded off against each other and never against other levels.
+      size_t priority_;
   };
 
   typedef typename boost::shared_ptr<SoftConstraintSpec> SoftConstraintSpecPtr;
@@ -1872,6 +2628,49 @@ namespace giskard
       std::vector< giskard::SoftConstraintSpec > soft_constraints_;
       std::vector< giskard::HardConstraintSpec > hard_constraints_;
   };
+
+  inline std::size_t hash_value(const QPControllerSpec& spec)
+  {
+    SpecHasher hasher;
+
+    boost::hash_combine(hasher.seed(), spec.scope_.size());
+    for(size_t i=0; i<spec.scope_.size(); ++i)
+    {
+      boost::hash_combine(hasher.seed(), spec.scope_[i].name);
+      hasher.hash(spec.scope_[i].spec);
+    }
+
+    boost::hash_combine(hasher.seed(), spec.controllable_constraints_.size());
+    for(size_t i=0; i<spec.controllable_constraints_.size(); ++i)
+    {
+      hasher.hash(spec.controllable_constraints_[i].lower_);
+      hasher.hash(spec.controllable_constraints_[i].upper_);
+      hasher.hash(spec.controllable_constraints_[i].weight_);
+      boost::hash_combine(hasher.seed(), spec.controllable_constraints_[i].input_number_);
+      boost::hash_combine(hasher.seed(), spec.controllable_constraints_[i].name_);
+    }
+
+    boost::hash_combine(hasher.seed(), spec.soft_constraints_.size());
+    for(size_t i=0; i<spec.soft_constraints_.size(); ++i)
+    {
+      hasher.hash(spec.soft_constraints_[i].expression_);
+      hasher.hash(spec.soft_constraints_[i].lower_);
+      hasher.hash(spec.soft_constraints_[i].upper_);
+      hasher.hash(spec.soft_constraints_[i].weight_);
+      boost::hash_combine(hasher.seed(), spec.soft_constraints_[i].name_);
+      boost::hash_combine(hasher.seed(), spec.soft_constraints_[i].priority_);
+    }
+
+    boost::hash_combine(hasher.seed(), spec.hard_constraints_.size());
+    for(size_t i=0; i<spec.hard_constraints_.size(); ++i)
+    {
+      hasher.hash(spec.hard_constraints_[i].expression_);
+      hasher.hash(spec.hard_constraints_[i].lower_);
+      hasher.hash(spec.hard_constraints_[i].upper_);
+    }
+
+    return hasher.get_hash();
+  }
 }
 
 #endif // GISKARD_SPECIFICATIONS_HPP
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_STOPWATCH_HPP
+#define GISKARD_STOPWATCH_HPP
+
+#include <boost/chrono.hpp>
+
+namespace giskard
+{
+  // Measures wall-clock time on a monotonic clock.
+  class Stopwatch
+  {
+    public:
+      Stopwatch() : start_(boost::chrono::steady_clock::now()) {}
+
+      void restart()
+      {
+        start_ = boost::chrono::steady_clock::now();
+      }
+
+      double get_elapsed_seconds() const
+      {
+        return boost::chrono::duration<double>(
+            boost::chrono::steady_clock::now() - start_).count();
+      }
+
+      double get_elapsed_microseconds() const
+      {
+        return boost::chrono::duration<double, boost::micro>(
+            boost::chrono::steady_clock::now() - start_).count();
+      }
+
+    private:
+      boost::chrono::steady_clock::time_point start_;
+  };
+}
+
+#endif // GISKARD_STOPWATCH_HPP
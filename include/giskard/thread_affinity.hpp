@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_THREAD_AFFINITY_HPP
+#define GISKARD_THREAD_AFFINITY_HPP
+
+#include <boost/thread.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace giskard
+{
+  // Pins a thread to a single CPU. Returns false if the platform does not
+  // support pinning or the CPU is not available; a negative cpu is a no-op.
+  inline bool set_thread_affinity(boost::thread& thread, int cpu)
+  {
+    if(cpu < 0)
+      return true;
+
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu % CPU_SETSIZE, &cpu_set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpu_set) == 0;
+#else
+    return false;
+#endif
+  }
+}
+
+#endif // GISKARD_THREAD_AFFINITY_HPP
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef GISKARD_TRIPLE_BUFFER_HPP
+#define GISKARD_TRIPLE_BUFFER_HPP
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace giskard
+{
+  // Lock-free exchange of the latest value between exactly one writer thread
+  // and exactly one reader thread. The writer fills the back slot and publishes
+  // it, the reader picks up the most recently published slot. Neither side ever
+  // waits for the other; values published in between two reads are dropped.
+  template<typename T>
+  class TripleBuffer : boost::noncopyable
+  {
+    public:
+      TripleBuffer() :
+        back_(0), front_(2), middle_(1) {}
+
+      explicit TripleBuffer(const T& value) :
+        back_(0), front_(2), middle_(1)
+      {
+        reset(value);
+      }
+
+      // Sets all slots to value and forgets about pending values. Not thread-safe,
+      // only call this while neither reader nor writer are active.
+      void reset(const T& value)
+      {
+        for(size_t i=0; i<3; ++i)
+          slots_[i] = value;
+        middle_.store(middle_.load() & INDEX);
+      }
+
+      /// writer interface
+
+      T& get_back()
+      {
+        return slots_[back_];
+      }
+
+      void publish()
+      {
+        back_ = middle_.exchange(back_ | DIRTY, boost::memory_order_acq_rel) & INDEX;
+      }
+
+      /// reader interface
+
+      // Returns true if a new value was published since the last call.
+      bool update()
+      {
+        if((middle_.load(boost::memory_order_relaxed) & DIRTY) == 0)
+          return false;
+
+        front_ = middle_.exchange(front_, boost::memory_order_acq_rel) & INDEX;
+        return true;
+      }
+
+      const T& get_front() const
+      {
+        return slots_[front_];
+      }
+
+      T& get_front()
+      {
+        return slots_[front_];
+      }
+
+    private:
+      static const unsigned int INDEX = 3;
+      static const unsigned int DIRTY = 4;
+
+      T slots_[3];
+      unsigned int back_, front_;
+      boost::atomic<unsigned int> middle_;
+  };
+}
+
+#endif // GISKARD_TRIPLE_BUFFER_HPP
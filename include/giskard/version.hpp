@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#ifndef GISKARD_VERSION_HPP
+#define GISKARD_VERSION_HPP
+
+// GISKARD_VERSION is the version from package.xml. The build defines it, and
+// exports the definition to dependent packages, see cmake/giskard-extras.cmake.in.
+// Users building without that configuration get a placeholder; controller
+// caches and cycle logs then cannot tell their giskard versions apart.
+#ifndef GISKARD_VERSION
+#define GISKARD_VERSION "unknown"
+#endif
+
+#endif // GISKARD_VERSION_HPP
@@ -23,6 +23,7 @@
 
 #include <yaml-cpp/yaml.h>
 #include <vector>
+#include <giskard/spec_arena.hpp>
 #include <giskard/specifications.hpp>
 
 namespace YAML {
@@ -63,7 +64,7 @@ namespace YAML {
       if(!is_const_double(node))
         return false;
   
-      rhs = giskard::DoubleConstSpecPtr(new giskard::DoubleConstSpec());
+      rhs = giskard::make_spec<giskard::DoubleConstSpec>();
       rhs->set_value(node.as<double>());
 
       return true;
@@ -92,7 +93,7 @@ namespace YAML {
       if(!is_input(node))
         return false;
   
-      rhs = giskard::DoubleInputSpecPtr(new giskard::DoubleInputSpec());
+      rhs = giskard::make_spec<giskard::DoubleInputSpec>();
       rhs->set_input_num(node["input-var"].as<size_t>());
 
       return true;
@@ -131,7 +132,7 @@ namespace YAML {
       if(!is_double_reference(node))
         return false;
  
-      rhs = giskard::DoubleReferenceSpecPtr(new giskard::DoubleReferenceSpec());
+      rhs = giskard::make_spec<giskard::DoubleReferenceSpec>();
       rhs->set_reference_name(node.as<std::string>());
 
       return true;
@@ -159,8 +160,9 @@ namespace YAML {
       if(!is_double_addition(node))
         return false;
 
-      rhs = giskard::DoubleAdditionSpecPtr(new giskard::DoubleAdditionSpec()); 
-      rhs->set_inputs(node["double-add"].as< std::vector<giskard::DoubleSpecPtr> >());
+      rhs = giskard::make_spec<giskard::DoubleAdditionSpec>();
+      std::vector<giskard::DoubleSpecPtr> inputs = node["double-add"].as< std::vector<giskard::DoubleSpecPtr> >();
+      rhs->swap_inputs(inputs);
 
       return true;
     }
@@ -187,8 +189,9 @@ namespace YAML {
       if(!is_double_subtraction(node))
         return false;
 
-      rhs = giskard::DoubleSubtractionSpecPtr(new giskard::DoubleSubtractionSpec()); 
-      rhs->set_inputs(node["double-sub"].as< std::vector<giskard::DoubleSpecPtr> >());
+      rhs = giskard::make_spec<giskard::DoubleSubtractionSpec>();
+      std::vector<giskard::DoubleSpecPtr> inputs = node["double-sub"].as< std::vector<giskard::DoubleSpecPtr> >();
+      rhs->swap_inputs(inputs);
 
       return true;
     }
@@ -215,7 +218,7 @@ namespace YAML {
       if(!is_double_norm_of(node))
         return false;
   
-      rhs = giskard::DoubleNormOfSpecPtr(new giskard::DoubleNormOfSpec());
+      rhs = giskard::make_spec<giskard::DoubleNormOfSpec>();
       rhs->set_vector(node["vector-norm"].as<giskard::VectorSpecPtr>());
 
       return true;
@@ -243,8 +246,9 @@ namespace YAML {
       if(!is_double_multiplication(node))
         return false;
 
-      rhs = giskard::DoubleMultiplicationSpecPtr(new giskard::DoubleMultiplicationSpec()); 
-      rhs->set_inputs(node["double-mul"].as< std::vector<giskard::DoubleSpecPtr> >());
+      rhs = giskard::make_spec<giskard::DoubleMultiplicationSpec>();
+      std::vector<giskard::DoubleSpecPtr> inputs = node["double-mul"].as< std::vector<giskard::DoubleSpecPtr> >();
+      rhs->swap_inputs(inputs);
 
       return true;
     }
@@ -271,8 +275,9 @@ namespace YAML {
       if(!is_double_division(node))
         return false;
 
-      rhs = giskard::DoubleDivisionSpecPtr(new giskard::DoubleDivisionSpec()); 
-      rhs->set_inputs(node["double-div"].as< std::vector<giskard::DoubleSpecPtr> >());
+      rhs = giskard::make_spec<giskard::DoubleDivisionSpec>();
+      std::vector<giskard::DoubleSpecPtr> inputs = node["double-div"].as< std::vector<giskard::DoubleSpecPtr> >();
+      rhs->swap_inputs(inputs);
 
       return true;
     }
@@ -298,7 +303,7 @@ namespace YAML {
       if(!is_x_coord_of(node))
         return false;
 
-      rhs = giskard::DoubleXCoordOfSpecPtr(new giskard::DoubleXCoordOfSpec()); 
+      rhs = giskard::make_spec<giskard::DoubleXCoordOfSpec>();
       rhs->set_vector(node["x-coord"].as< giskard::VectorSpecPtr >());
 
       return true;
@@ -325,7 +330,7 @@ namespace YAML {
       if(!is_y_coord_of(node))
         return false;
 
-      rhs = giskard::DoubleYCoordOfSpecPtr(new giskard::DoubleYCoordOfSpec()); 
+      rhs = giskard::make_spec<giskard::DoubleYCoordOfSpec>();
       rhs->set_vector(node["y-coord"].as< giskard::VectorSpecPtr >());
 
       return true;
@@ -352,7 +357,7 @@ namespace YAML {
       if(!is_z_coord_of(node))
         return false;
 
-      rhs = giskard::DoubleZCoordOfSpecPtr(new giskard::DoubleZCoordOfSpec()); 
+      rhs = giskard::make_spec<giskard::DoubleZCoordOfSpec>();
       rhs->set_vector(node["z-coord"].as< giskard::VectorSpecPtr >());
 
       return true;
@@ -381,7 +386,7 @@ namespace YAML {
       if(!is_vector_dot(node))
         return false;
 
-      rhs = giskard::VectorDotSpecPtr(new giskard::VectorDotSpec()); 
+      rhs = giskard::make_spec<giskard::VectorDotSpec>();
       rhs->set_lhs(node["vector-dot"][0].as< giskard::VectorSpecPtr >());
       rhs->set_rhs(node["vector-dot"][1].as< giskard::VectorSpecPtr >());
 
@@ -397,77 +402,49 @@ namespace YAML {
     {
       Node node;
 
-      if(boost::dynamic_pointer_cast<giskard::DoubleConstSpec>(rhs).get())
-      {
-        giskard::DoubleConstSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleConstSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::DoubleInputSpec>(rhs).get())
-      {
-        giskard::DoubleInputSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleInputSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::DoubleReferenceSpec>(rhs).get())
-      {
-        giskard::DoubleReferenceSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleReferenceSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::DoubleAdditionSpec>(rhs).get())
-      {
-        giskard::DoubleAdditionSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleAdditionSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::DoubleSubtractionSpec>(rhs).get())
-      {
-        giskard::DoubleSubtractionSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleSubtractionSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::DoubleNormOfSpec>(rhs).get())
-      {
-        giskard::DoubleNormOfSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleNormOfSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::DoubleMultiplicationSpec>(rhs).get())
-      {
-        giskard::DoubleMultiplicationSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleMultiplicationSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::DoubleDivisionSpec>(rhs).get())
-      {
-        giskard::DoubleDivisionSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleDivisionSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::DoubleXCoordOfSpec>(rhs).get())
-      {
-        giskard::DoubleXCoordOfSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleXCoordOfSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::DoubleYCoordOfSpec>(rhs).get())
-      {
-        giskard::DoubleYCoordOfSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleYCoordOfSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::DoubleZCoordOfSpec>(rhs).get())
-      {
-        giskard::DoubleZCoordOfSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::DoubleZCoordOfSpec>(rhs);
-        node = p;
-      }
-      else if(boost::dynamic_pointer_cast<giskard::VectorDotSpec>(rhs).get())
+      if(!rhs.get())
+        return node;
+
+      switch(rhs->get_type())
       {
-        giskard::VectorDotSpecPtr p = 
-            boost::dynamic_pointer_cast<giskard::VectorDotSpec>(rhs);
-        node = p;
+        case giskard::DOUBLE_CONST_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleConstSpec>(rhs);
+          break;
+        case giskard::DOUBLE_INPUT_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleInputSpec>(rhs);
+          break;
+        case giskard::DOUBLE_REFERENCE_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleReferenceSpec>(rhs);
+          break;
+        case giskard::DOUBLE_ADDITION_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleAdditionSpec>(rhs);
+          break;
+        case giskard::DOUBLE_SUBTRACTION_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleSubtractionSpec>(rhs);
+          break;
+        case giskard::DOUBLE_NORM_OF_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleNormOfSpec>(rhs);
+          break;
+        case giskard::DOUBLE_MULTIPLICATION_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleMultiplicationSpec>(rhs);
+          break;
+        case giskard::DOUBLE_DIVISION_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleDivisionSpec>(rhs);
+          break;
+        case giskard::DOUBLE_X_COORD_OF_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleXCoordOfSpec>(rhs);
+          break;
+        case giskard::DOUBLE_Y_COORD_OF_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleYCoordOfSpec>(rhs);
+          break;
+        case giskard::DOUBLE_Z_COORD_OF_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleZCoordOfSpec>(rhs);
+          break;
+        case giskard::VECTOR_DOT_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorDotSpec>(rhs);
+          break;
+        default:
+          break;
       }
 
       return node;
@@ -565,7 +542,7 @@ namespace YAML {
       if(!is_cached_vector(node))
         return false;
 
-      rhs = giskard::VectorCachedSpecPtr(new giskard::VectorCachedSpec()); 
+      rhs = giskard::make_spec<giskard::VectorCachedSpec>();
       rhs->set_vector(node["cached-vector"].as<giskard::VectorSpecPtr>());
 
       return true;
@@ -595,7 +572,7 @@ namespace YAML {
       if(!is_constructor_vector(node))
         return false;
 
-      rhs = giskard::VectorConstructorSpecPtr(new giskard::VectorConstructorSpec()); 
+      rhs = giskard::make_spec<giskard::VectorConstructorSpec>();
       rhs->set_x(node["vector3"][0].as<giskard::DoubleSpecPtr>());
       rhs->set_y(node["vector3"][1].as<giskard::DoubleSpecPtr>());
       rhs->set_z(node["vector3"][2].as<giskard::DoubleSpecPtr>());
@@ -636,7 +613,7 @@ namespace YAML {
       if(!is_vector_reference(node))
         return false;
   
-      rhs = giskard::VectorReferenceSpecPtr(new giskard::VectorReferenceSpec());
+      rhs = giskard::make_spec<giskard::VectorReferenceSpec>();
       rhs->set_reference_name(node.as<std::string>());
 
       return true;
@@ -664,7 +641,7 @@ namespace YAML {
       if(!is_vector_origin_of(node))
         return false;
   
-      rhs = giskard::VectorOriginOfSpecPtr(new giskard::VectorOriginOfSpec());
+      rhs = giskard::make_spec<giskard::VectorOriginOfSpec>();
       rhs->set_frame(node["origin-of"].as<giskard::FrameSpecPtr>());
 
       return true;
@@ -692,8 +669,9 @@ namespace YAML {
       if(!is_vector_addition(node))
         return false;
 
-      rhs = giskard::VectorAdditionSpecPtr(new giskard::VectorAdditionSpec()); 
-      rhs->set_inputs(node["vector-add"].as< std::vector<giskard::VectorSpecPtr> >());
+      rhs = giskard::make_spec<giskard::VectorAdditionSpec>();
+      std::vector<giskard::VectorSpecPtr> inputs = node["vector-add"].as< std::vector<giskard::VectorSpecPtr> >();
+      rhs->swap_inputs(inputs);
 
       return true;
     }
@@ -720,8 +698,9 @@ namespace YAML {
       if(!is_vector_subtraction(node))
         return false;
 
-      rhs = giskard::VectorSubtractionSpecPtr(new giskard::VectorSubtractionSpec()); 
-      rhs->set_inputs(node["vector-sub"].as< std::vector<giskard::VectorSpecPtr> >());
+      rhs = giskard::make_spec<giskard::VectorSubtractionSpec>();
+      std::vector<giskard::VectorSpecPtr> inputs = node["vector-sub"].as< std::vector<giskard::VectorSpecPtr> >();
+      rhs->swap_inputs(inputs);
 
       return true;
     }
@@ -749,7 +728,7 @@ namespace YAML {
       if(!is_vector_frame_multiplication(node))
         return false;
 
-      rhs = giskard::VectorFrameMultiplicationSpecPtr(new giskard::VectorFrameMultiplicationSpec()); 
+      rhs = giskard::make_spec<giskard::VectorFrameMultiplicationSpec>();
       rhs->set_frame(node["transform-vector"][0].as< giskard::FrameSpecPtr >());
       rhs->set_vector(node["transform-vector"][1].as< giskard::VectorSpecPtr >());
 
@@ -779,7 +758,7 @@ namespace YAML {
       if(!is_vector_double_multiplication(node))
         return false;
 
-      rhs = giskard::VectorDoubleMultiplicationSpecPtr(new giskard::VectorDoubleMultiplicationSpec()); 
+      rhs = giskard::make_spec<giskard::VectorDoubleMultiplicationSpec>();
       rhs->set_double(node["scale-vector"][0].as< giskard::DoubleSpecPtr >());
       rhs->set_vector(node["scale-vector"][1].as< giskard::VectorSpecPtr >());
 
@@ -808,7 +787,7 @@ namespace YAML {
       if(!is_vector_rotation_vector(node))
         return false;
   
-      rhs = giskard::VectorRotationVectorSpecPtr(new giskard::VectorRotationVectorSpec());
+      rhs = giskard::make_spec<giskard::VectorRotationVectorSpec>();
       rhs->set_rotation(node["rot-vector"].as<giskard::RotationSpecPtr>());
 
       return true;
@@ -822,24 +801,41 @@ namespace YAML {
     {
       Node node;
 
-      if(boost::dynamic_pointer_cast<giskard::VectorCachedSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::VectorCachedSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::VectorConstructorSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::VectorConstructorSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::VectorReferenceSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::VectorReferenceSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::VectorOriginOfSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::VectorOriginOfSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::VectorAdditionSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::VectorAdditionSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::VectorSubtractionSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::VectorSubtractionSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::VectorFrameMultiplicationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::VectorFrameMultiplicationSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::VectorDoubleMultiplicationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::VectorDoubleMultiplicationSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::VectorRotationVectorSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::VectorRotationVectorSpec>(rhs);
+      if(!rhs.get())
+        return node;
+
+      switch(rhs->get_type())
+      {
+        case giskard::VECTOR_CACHED_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorCachedSpec>(rhs);
+          break;
+        case giskard::VECTOR_CONSTRUCTOR_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorConstructorSpec>(rhs);
+          break;
+        case giskard::VECTOR_REFERENCE_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorReferenceSpec>(rhs);
+          break;
+        case giskard::VECTOR_ORIGIN_OF_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorOriginOfSpec>(rhs);
+          break;
+        case giskard::VECTOR_ADDITION_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorAdditionSpec>(rhs);
+          break;
+        case giskard::VECTOR_SUBTRACTION_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorSubtractionSpec>(rhs);
+          break;
+        case giskard::VECTOR_FRAME_MULTIPLICATION_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorFrameMultiplicationSpec>(rhs);
+          break;
+        case giskard::VECTOR_DOUBLE_MULTIPLICATION_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorDoubleMultiplicationSpec>(rhs);
+          break;
+        case giskard::VECTOR_ROTATION_VECTOR_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorRotationVectorSpec>(rhs);
+          break;
+        default:
+          break;
+      }
 
       return node;
     }
@@ -925,7 +921,7 @@ namespace YAML {
       if(!is_quaternion_constructor(node))
         return false;
 
-      rhs = giskard::RotationQuaternionConstructorSpecPtr(new giskard::RotationQuaternionConstructorSpec());
+      rhs = giskard::make_spec<giskard::RotationQuaternionConstructorSpec>();
       rhs->set_x(node["quaternion"][0].as<double>());
       rhs->set_y(node["quaternion"][1].as<double>());
       rhs->set_z(node["quaternion"][2].as<double>());
@@ -957,7 +953,7 @@ namespace YAML {
       if(!is_axis_angle(node))
         return false;
 
-      rhs = giskard::AxisAngleSpecPtr(new giskard::AxisAngleSpec()); 
+      rhs = giskard::make_spec<giskard::AxisAngleSpec>();
       rhs->set_axis(node["axis-angle"][0].as<giskard::VectorSpecPtr>());
       rhs->set_angle(node["axis-angle"][1].as<giskard::DoubleSpecPtr>());
 
@@ -986,7 +982,7 @@ namespace YAML {
       if(!is_orientation_of(node))
         return false;
   
-      rhs = giskard::OrientationOfSpecPtr(new giskard::OrientationOfSpec());
+      rhs = giskard::make_spec<giskard::OrientationOfSpec>();
       rhs->set_frame(node["orientation-of"].as<giskard::FrameSpecPtr>());
 
       return true;
@@ -1025,7 +1021,7 @@ namespace YAML {
       if(!is_rotation_reference(node))
         return false;
  
-      rhs = giskard::RotationReferenceSpecPtr(new giskard::RotationReferenceSpec());
+      rhs = giskard::make_spec<giskard::RotationReferenceSpec>();
       rhs->set_reference_name(node.as<std::string>());
 
       return true;
@@ -1053,7 +1049,7 @@ namespace YAML {
       if(!is_inverse_rotation(node))
         return false;
 
-      rhs = giskard::InverseRotationSpecPtr(new giskard::InverseRotationSpec());
+      rhs = giskard::make_spec<giskard::InverseRotationSpec>();
       rhs->set_rotation(node["inverse-rotation"].as<giskard::RotationSpecPtr>());
 
       return true;
@@ -1081,8 +1077,9 @@ namespace YAML {
       if(!is_rotation_multiplication(node))
         return false;
 
-      rhs = giskard::RotationMultiplicationSpecPtr(new giskard::RotationMultiplicationSpec()); 
-      rhs->set_inputs(node["rotation-mul"].as< std::vector<giskard::RotationSpecPtr> >());
+      rhs = giskard::make_spec<giskard::RotationMultiplicationSpec>();
+      std::vector<giskard::RotationSpecPtr> inputs = node["rotation-mul"].as< std::vector<giskard::RotationSpecPtr> >();
+      rhs->swap_inputs(inputs);
 
       return true;
     }
@@ -1095,18 +1092,32 @@ namespace YAML {
     {
       Node node;
 
-      if(boost::dynamic_pointer_cast<giskard::AxisAngleSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::AxisAngleSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::RotationQuaternionConstructorSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::RotationQuaternionConstructorSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::OrientationOfSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::OrientationOfSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::RotationReferenceSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::RotationReferenceSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::InverseRotationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::InverseRotationSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::RotationMultiplicationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::RotationMultiplicationSpec>(rhs);
+      if(!rhs.get())
+        return node;
+
+      switch(rhs->get_type())
+      {
+        case giskard::AXIS_ANGLE_SPEC:
+          node = boost::static_pointer_cast<giskard::AxisAngleSpec>(rhs);
+          break;
+        case giskard::ROTATION_QUATERNION_CONSTRUCTOR_SPEC:
+          node = boost::static_pointer_cast<giskard::RotationQuaternionConstructorSpec>(rhs);
+          break;
+        case giskard::ORIENTATION_OF_SPEC:
+          node = boost::static_pointer_cast<giskard::OrientationOfSpec>(rhs);
+          break;
+        case giskard::ROTATION_REFERENCE_SPEC:
+          node = boost::static_pointer_cast<giskard::RotationReferenceSpec>(rhs);
+          break;
+        case giskard::INVERSE_ROTATION_SPEC:
+          node = boost::static_pointer_cast<giskard::InverseRotationSpec>(rhs);
+          break;
+        case giskard::ROTATION_MULTIPLICATION_SPEC:
+          node = boost::static_pointer_cast<giskard::RotationMultiplicationSpec>(rhs);
+          break;
+        default:
+          break;
+      }
 
       return node;
     }
@@ -1172,7 +1183,7 @@ namespace YAML {
       if(!is_cached_frame(node))
         return false;
 
-      rhs = giskard::FrameCachedSpecPtr(new giskard::FrameCachedSpec()); 
+      rhs = giskard::make_spec<giskard::FrameCachedSpec>();
       rhs->set_frame(node["cached-frame"].as<giskard::FrameSpecPtr>());
 
       return true;
@@ -1201,7 +1212,7 @@ namespace YAML {
       if(!is_constructor_frame(node))
         return false;
 
-      rhs = giskard::FrameConstructorSpecPtr(new giskard::FrameConstructorSpec()); 
+      rhs = giskard::make_spec<giskard::FrameConstructorSpec>();
       rhs->set_rotation(node["frame"][0].as<giskard::RotationSpecPtr>());
       rhs->set_translation(node["frame"][1].as<giskard::VectorSpecPtr>());
 
@@ -1230,8 +1241,9 @@ namespace YAML {
       if(!is_frame_multiplication(node))
         return false;
 
-      rhs = giskard::FrameMultiplicationSpecPtr(new giskard::FrameMultiplicationSpec()); 
-      rhs->set_inputs(node["frame-mul"].as< std::vector<giskard::FrameSpecPtr> >());
+      rhs = giskard::make_spec<giskard::FrameMultiplicationSpec>();
+      std::vector<giskard::FrameSpecPtr> inputs = node["frame-mul"].as< std::vector<giskard::FrameSpecPtr> >();
+      rhs->swap_inputs(inputs);
 
       return true;
     }
@@ -1269,7 +1281,7 @@ namespace YAML {
       if(!is_frame_reference(node))
         return false;
   
-      rhs = giskard::FrameReferenceSpecPtr(new giskard::FrameReferenceSpec());
+      rhs = giskard::make_spec<giskard::FrameReferenceSpec>();
       rhs->set_reference_name(node.as<std::string>());
 
       return true;
@@ -1283,14 +1295,26 @@ namespace YAML {
     {
       Node node;
 
-      if(boost::dynamic_pointer_cast<giskard::FrameCachedSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::FrameCachedSpec>(rhs);
-      else if(boost::dynamic_pointer_cast<giskard::FrameConstructorSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::FrameConstructorSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard::FrameMultiplicationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::FrameMultiplicationSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard::FrameReferenceSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::FrameReferenceSpec>(rhs);
+      if(!rhs.get())
+        return node;
+
+      switch(rhs->get_type())
+      {
+        case giskard::FRAME_CACHED_SPEC:
+          node = boost::static_pointer_cast<giskard::FrameCachedSpec>(rhs);
+          break;
+        case giskard::FRAME_CONSTRUCTOR_SPEC:
+          node = boost::static_pointer_cast<giskard::FrameConstructorSpec>(rhs);
+          break;
+        case giskard::FRAME_MULTIPLICATION_SPEC:
+          node = boost::static_pointer_cast<giskard::FrameMultiplicationSpec>(rhs);
+          break;
+        case giskard::FRAME_REFERENCE_SPEC:
+          node = boost::static_pointer_cast<giskard::FrameReferenceSpec>(rhs);
+          break;
+        default:
+          break;
+      }
 
       return node;
     }
@@ -1364,14 +1388,26 @@ namespace YAML {
     {
       Node node;
 
-      if(boost::dynamic_pointer_cast<giskard::FrameSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::FrameSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard::VectorSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::VectorSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard::RotationSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::RotationSpec>(rhs);
-      else if (boost::dynamic_pointer_cast<giskard::DoubleSpec>(rhs).get())
-        node = boost::dynamic_pointer_cast<giskard::DoubleSpec>(rhs);
+      if(!rhs.get())
+        return node;
+
+      switch(rhs->get_category())
+      {
+        case giskard::DOUBLE_SPEC:
+          node = boost::static_pointer_cast<giskard::DoubleSpec>(rhs);
+          break;
+        case giskard::VECTOR_SPEC:
+          node = boost::static_pointer_cast<giskard::VectorSpec>(rhs);
+          break;
+        case giskard::ROTATION_SPEC:
+          node = boost::static_pointer_cast<giskard::RotationSpec>(rhs);
+          break;
+        case giskard::FRAME_SPEC:
+          node = boost::static_pointer_cast<giskard::FrameSpec>(rhs);
+          break;
+        default:
+          break;
+      }
 
       return node;
     }
@@ -1476,7 +1512,8 @@ namespace YAML {
   inline bool is_soft_constraint_spec(const Node& node)
   {
     return node.IsMap() && (node.size() == 1) && node["soft-constraint"] &&
-        node["soft-constraint"].IsSequence() && (node["soft-constraint"].size() == 5);
+        node["soft-constraint"].IsSequence() && (node["soft-constraint"].size() == 5 ||
+        node["soft-constraint"].size() == 6);
   }
 
   template<>
@@ -1491,6 +1528,9 @@ namespace YAML {
       node["soft-constraint"][2] = rhs.weight_;
       node["soft-constraint"][3] = rhs.expression_;
       node["soft-constraint"][4] = rhs.name_;
+      // the priority level is optional and defaults to 0
+      if(rhs.priority_ != 0)
+        node["soft-constraint"][5] = rhs.priority_;
 
       return node;
     }
@@ -1505,6 +1545,8 @@ namespace YAML {
       rhs.weight_ = node["soft-constraint"][2].as<giskard::DoubleSpecPtr>();
       rhs.expression_ = node["soft-constraint"][3].as<giskard::DoubleSpecPtr>();
       rhs.name_ = node["soft-constraint"][4].as<std::string>();
+      rhs.priority_ = (node["soft-constraint"].size() == 6) ?
+          node["soft-constraint"][5].as<size_t>() : 0;
 
       return true;
     }
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <yaml-cpp/yaml.h>
+#include <giskard/giskard.hpp>
+#include <giskard/cost_model.hpp>
+
+// Prints graph statistics and a static cost estimate of a controller
+// specification. Given a cycle time budget, exits with 1 if the estimate
+// exceeds it, so that it can be used as a check in continuous integration.
+
+int main(int argc, char **argv)
+{
+  if (argc < 2 || argc > 4)
+  {
+    std::cout << "Usage: rosrun giskard analyze_controller <controller.yaml> (optional <cycle_time_seconds> <flops_per_second>)" << std::endl;
+    return 0;
+  }
+
+  YAML::Node node = YAML::LoadFile(argv[1]);
+  giskard::SpecStatistics statistics = giskard::analyze(node.as<giskard::QPControllerSpec>());
+  giskard::print_statistics(std::cout, statistics);
+
+  if (argc == 2)
+    return 0;
+
+  giskard::CostBudget budget(std::atof(argv[2]));
+  if (argc == 4)
+    budget.flops_per_second_ = std::atof(argv[3]);
+
+  double cycle_time = giskard::estimate_cycle_time(statistics, budget.flops_per_second_);
+  std::cout << "estimated cycle time: " << cycle_time << " s, budget: " << budget.cycle_time_ << " s" << std::endl;
+  if (!giskard::is_within_budget(statistics, budget))
+  {
+    std::cout << "Estimated cycle time exceeds the budget." << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
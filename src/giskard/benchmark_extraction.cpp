@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <yaml-cpp/yaml.h>
+#include <giskard/giskard.hpp>
+#include <giskard/stopwatch.hpp>
+
+// Compares extracting forward kinematics expressions through YAML with the
+// direct extraction of scope specifications.
+
+static KDL::Expression<KDL::Frame>::Ptr via_yaml(const std::string& start_link, 
+    const std::string& end_link, const KDL::Tree& tree)
+{
+  YAML::Node node = giskard::ExpressionExtractor::extract(start_link, end_link, tree);
+  giskard::ScopeSpec scope_spec = node.as<giskard::ScopeSpec>();
+  return giskard::generate(scope_spec).find_frame_expression("fk");
+}
+
+static KDL::Expression<KDL::Frame>::Ptr direct(const std::string& start_link, 
+    const std::string& end_link, const KDL::Tree& tree)
+{
+  return giskard::ExpressionExtractor::extract_fk(start_link, end_link, tree);
+}
+
+static void report(const std::string& name, double seconds, size_t runs)
+{
+  std::cout << name << ": " << 1e3 * seconds / runs << " ms per run" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 4 && argc != 5)
+  {
+    std::cout << "Usage: rosrun giskard benchmark_extraction <start_link> <end_link> <urdf> (optional <runs>)" << std::endl;
+    return 0;
+  }
+  std::string start_link = argv[1];
+  std::string end_link = argv[2];
+  std::string urdf_path = argv[3];
+  size_t runs = (argc == 5) ? std::atoi(argv[4]) : 100;
+  if (runs == 0)
+    runs = 1;
+
+  urdf::Model urdf;
+  if (!urdf.initFile(urdf_path))
+    throw giskard::InvalidUrdf(urdf_path);
+
+  KDL::Tree tree;
+  if (!kdl_parser::treeFromUrdfModel(urdf, tree))
+    throw giskard::InvalidUrdf(urdf_path);
+
+  // complete pipelines, starting from the urdf file
+  giskard::Stopwatch stopwatch;
+  for (size_t i = 0; i < runs; ++i)
+  {
+    YAML::Node node = giskard::ExpressionExtractor::extract(start_link, end_link, urdf_path);
+    giskard::generate(node.as<giskard::ScopeSpec>()).find_frame_expression("fk");
+  }
+  report("urdf file -> yaml -> expression", stopwatch.get_elapsed_seconds(), runs);
+
+  stopwatch.restart();
+  for (size_t i = 0; i < runs; ++i)
+    giskard::generate(giskard::ExpressionExtractor::extract_scope(start_link, end_link, 
+          urdf_path)).find_frame_expression("fk");
+  report("urdf file -> scope spec -> expression", stopwatch.get_elapsed_seconds(), runs);
+
+  // extraction only, starting from the parsed tree
+  stopwatch.restart();
+  for (size_t i = 0; i < runs; ++i)
+    via_yaml(start_link, end_link, tree);
+  report("tree -> yaml -> expression", stopwatch.get_elapsed_seconds(), runs);
+
+  stopwatch.restart();
+  for (size_t i = 0; i < runs; ++i)
+    direct(start_link, end_link, tree);
+  report("tree -> scope spec -> expression", stopwatch.get_elapsed_seconds(), runs);
+
+  stopwatch.restart();
+  for (size_t i = 0; i < runs; ++i)
+  {
+    giskard::SpecArena arena;
+    giskard::ScopedSpecArena guard(arena);
+    direct(start_link, end_link, tree);
+  }
+  report("tree -> scope spec in arena -> expression", stopwatch.get_elapsed_seconds(), runs);
+
+  // sanity check of the results
+  std::vector<double> q(via_yaml(start_link, end_link, tree)->number_of_derivatives(), 0.1);
+  KDL::Expression<KDL::Frame>::Ptr e1 = via_yaml(start_link, end_link, tree);
+  KDL::Expression<KDL::Frame>::Ptr e2 = direct(start_link, end_link, tree);
+  e1->setInputValues(q);
+  e2->setInputValues(q);
+  if (!KDL::Equal(e1->value(), e2->value()))
+  {
+    std::cerr << "Results of both extraction paths differ." << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
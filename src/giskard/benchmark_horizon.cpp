@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <iostream>
+#include <cstdlib>
+#include <giskard/giskard.hpp>
+
+// Measures how the cycle time of HorizonQPController grows with the number of
+// stages, for a synthetic 7 joint, 10 constraint controller. The time per stage
+// should stay roughly constant. Prints CSV, one line per horizon length.
+
+int main(int argc, char **argv)
+{
+  if (argc > 2)
+  {
+    std::cout << "Usage: rosrun giskard benchmark_horizon (optional <runs>)" << std::endl;
+    return 0;
+  }
+  size_t runs = (argc == 2) ? std::atoi(argv[1]) : 100;
+  if (runs == 0)
+    runs = 1;
+
+  giskard::QPControllerSpec spec = giskard::SyntheticSpecGenerator::generate(giskard::SyntheticSpecOptions());
+
+  std::cout << "stages, evaluation us, solve us, us per stage, iterations, failures" << std::endl;
+
+  size_t stages[] = {1, 2, 5, 10, 20, 40};
+  for (size_t i = 0; i < 6; ++i)
+  {
+    giskard::HorizonOptions options;
+    options.num_stages_ = stages[i];
+    options.dt_ = 0.01;
+    giskard::HorizonQPController controller = giskard::generate_horizon(spec, options);
+
+    Eigen::VectorXd state = Eigen::VectorXd::Zero(controller.num_observables());
+    size_t failures = controller.start(state) ? 0 : 1;
+    double evaluation_seconds = 0.0, solve_seconds = 0.0;
+    size_t iterations = 0;
+    for (size_t j = 0; j < runs; ++j)
+    {
+      if (!controller.update(state))
+        ++failures;
+      evaluation_seconds += controller.get_cycle_timings().evaluation_seconds_;
+      solve_seconds += controller.get_cycle_timings().solve_seconds_;
+      iterations += controller.get_solver().get_num_iterations();
+      state.head(controller.num_controllables()) += options.dt_ * controller.get_command();
+    }
+
+    std::cout << stages[i] << ", " << 1e6 * evaluation_seconds / runs << ", " << 1e6 * solve_seconds / runs <<
+      ", " << 1e6 * (evaluation_seconds + solve_seconds) / (runs * stages[i]) << ", " <<
+      static_cast<double>(iterations) / runs << ", " << failures << std::endl;
+  }
+
+  return 0;
+}
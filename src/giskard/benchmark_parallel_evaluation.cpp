@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <yaml-cpp/yaml.h>
+#include <boost/thread/thread.hpp>
+#include <giskard/giskard.hpp>
+#include <giskard/stopwatch.hpp>
+
+// Measures how the expression evaluation of a controller scales with the number
+// of threads, from 1 up to the number of hardware threads or the given maximum.
+// Instead of a YAML file, "synthetic" selects a generated 50 joint tree with
+// four branches whose 200 constraints all refer to the link frames of the
+// tree and thus share the cached frame at the tip of its trunk, i.e. a
+// controller whose rows share a large subgraph.
+
+int main(int argc, char **argv)
+{
+  if (argc < 2 || argc > 4)
+  {
+    std::cout << "Usage: rosrun giskard benchmark_parallel_evaluation <controller.yaml|synthetic> (optional <max_threads> <runs>)" << std::endl;
+    return 0;
+  }
+  size_t max_threads = (argc >= 3) ? std::atoi(argv[2]) : boost::thread::hardware_concurrency();
+  size_t runs = (argc == 4) ? std::atoi(argv[3]) : 1000;
+  if (max_threads == 0)
+    max_threads = 1;
+  if (runs == 0)
+    runs = 1;
+
+  giskard::QPControllerSpec spec;
+  if (std::string(argv[1]) == "synthetic")
+  {
+    giskard::SyntheticSpecOptions options;
+    options.num_joints_ = 50;
+    options.num_branches_ = 4;
+    options.num_constraints_ = 200;
+    options.sharing_ = 1.0;
+    spec = giskard::SyntheticSpecGenerator::generate(options);
+  }
+  else
+    spec = YAML::LoadFile(argv[1]).as<giskard::QPControllerSpec>();
+
+  giskard::QPController controller = giskard::generate(spec);
+  const giskard::QPProblemBuilder& builder = controller.get_qp_builder();
+  std::cout << builder.num_controllables() << " controllables, " << builder.num_soft_constraints() <<
+    " soft constraints, " << builder.num_hard_constraints() << " hard constraints, " <<
+    builder.num_observables() << " observables" << std::endl;
+
+  Eigen::VectorXd state = Eigen::VectorXd::Zero(builder.num_observables());
+  for(size_t i=0; i<state.rows(); ++i)
+    state(i) = 0.01 * (i % 7);
+
+  std::cout << "threads, us per update, speedup" << std::endl;
+  double serial_microseconds = 0.0;
+  for(size_t num_threads=1; num_threads<=max_threads; ++num_threads)
+  {
+    giskard::QPProblemBuilder parallel = builder.clone();
+    parallel.set_num_threads(num_threads);
+
+    // warm up the workers
+    for(size_t i=0; i<10; ++i)
+      parallel.update(state);
+
+    giskard::Stopwatch stopwatch;
+    for(size_t i=0; i<runs; ++i)
+    {
+      state(0) += 1e-6;
+      parallel.update(state);
+    }
+    double microseconds = 1e6 * stopwatch.get_elapsed_seconds() / runs;
+    if(num_threads == 1)
+      serial_microseconds = microseconds;
+
+    std::cout << num_threads << ", " << microseconds << ", " << serial_microseconds / microseconds << std::endl;
+  }
+
+  return 0;
+}
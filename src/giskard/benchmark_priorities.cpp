@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <giskard/giskard.hpp>
+
+// Compares strict priority levels, solved as a QP cascade, against encoding the
+// same levels as weight ratios in a single QP, for a synthetic 7 joint, 12
+// constraint controller. Prints CSV, one line per number of levels and encoding.
+
+// Scales the soft weights by ratio^(levels - 1 - priority) and drops the priorities.
+giskard::QPControllerSpec encode_as_weights(const giskard::QPControllerSpec& spec,
+    size_t levels, double ratio)
+{
+  giskard::QPControllerSpec result = spec;
+  for (size_t i = 0; i < result.soft_constraints_.size(); ++i)
+  {
+    giskard::SoftConstraintSpec& soft = result.soft_constraints_[i];
+    std::vector<giskard::DoubleSpecPtr> inputs;
+    inputs.push_back(giskard::double_const_spec(std::pow(ratio, static_cast<double>(levels - 1 - soft.priority_))));
+    inputs.push_back(soft.weight_);
+    giskard::DoubleMultiplicationSpecPtr weight = giskard::make_spec<giskard::DoubleMultiplicationSpec>();
+    weight->set_inputs(inputs);
+    soft.weight_ = weight;
+    soft.priority_ = 0;
+  }
+  return result;
+}
+
+void run(const std::string& encoding, size_t levels, const giskard::QPControllerSpec& spec, size_t runs)
+{
+  int nWSR = 1000;
+  giskard::QPController controller = giskard::generate(spec);
+
+  Eigen::VectorXd state = Eigen::VectorXd::Zero(controller.get_qp_builder().num_observables());
+  size_t failures = controller.start(state, nWSR) ? 0 : 1;
+  double cycle_seconds = 0.0;
+  size_t iterations = 0, max_iterations = 0;
+  for (size_t j = 0; j < runs; ++j)
+  {
+    if (!controller.update(state, nWSR))
+      ++failures;
+    cycle_seconds += controller.get_cycle_timings().evaluation_seconds_ +
+      controller.get_cycle_timings().solve_seconds_;
+    size_t cycle_iterations = static_cast<size_t>(controller.get_num_working_set_recalculations());
+    iterations += cycle_iterations;
+    max_iterations = std::max(max_iterations, cycle_iterations);
+    state += 0.01 * controller.get_command();
+  }
+
+  std::cout << levels << ", " << encoding << ", " << 1e6 * cycle_seconds / runs << ", " <<
+    static_cast<double>(iterations) / runs << ", " << max_iterations << ", " << failures << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 2)
+  {
+    std::cout << "Usage: rosrun giskard benchmark_priorities (optional <runs>)" << std::endl;
+    return 0;
+  }
+  size_t runs = (argc == 2) ? std::atoi(argv[1]) : 100;
+  if (runs == 0)
+    runs = 1;
+
+  std::cout << "levels, encoding, cycle us, iterations, max iterations, failures" << std::endl;
+
+  for (size_t levels = 1; levels <= 4; ++levels)
+  {
+    giskard::SyntheticSpecOptions options;
+    options.num_constraints_ = 12;
+    options.num_priority_levels_ = levels;
+    giskard::QPControllerSpec spec = giskard::SyntheticSpecGenerator::generate(options);
+
+    run("cascade", levels, spec, runs);
+    run("weights", levels, encode_as_weights(spec, levels, 1e3), runs);
+  }
+
+  return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <yaml-cpp/yaml.h>
+#include <giskard/giskard.hpp>
+#include <giskard/stopwatch.hpp>
+
+// Sweeps the parameters of synthetic controller specifications one at a
+// time, starting from a 50 joint, 200 constraint controller, and measures
+// how long parsing the YAML, generating the controller and updating it take.
+// Prints CSV, one line per point, for plotting.
+
+static void measure(const std::string& axis, double value, const giskard::SyntheticSpecOptions& options,
+    size_t runs)
+{
+  std::string yaml = giskard::SyntheticSpecGenerator::generate_yaml(options);
+
+  giskard::Stopwatch stopwatch;
+  giskard::QPControllerSpec spec = YAML::Load(yaml).as<giskard::QPControllerSpec>();
+  double parse_seconds = stopwatch.get_elapsed_seconds();
+
+  stopwatch.restart();
+  giskard::QPController controller = giskard::generate(spec);
+  double generate_seconds = stopwatch.get_elapsed_seconds();
+
+  Eigen::VectorXd state = Eigen::VectorXd::Zero(controller.get_qp_builder().num_observables());
+  int nWSR = 1000;
+  bool started = controller.start(state, nWSR);
+
+  stopwatch.restart();
+  size_t failures = started ? 0 : 1;
+  for (size_t i = 0; i < runs; ++i)
+  {
+    if (!controller.update(state, nWSR))
+      ++failures;
+    state += 0.01 * controller.get_command();
+  }
+  double update_seconds = stopwatch.get_elapsed_seconds() / runs;
+
+  std::cout << axis << ", " << value << ", " << yaml.size() << ", " << 1e3 * parse_seconds << ", " <<
+    1e3 * generate_seconds << ", " << 1e6 * update_seconds << ", " << failures << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc > 2)
+  {
+    std::cout << "Usage: rosrun giskard benchmark_scaling (optional <runs>)" << std::endl;
+    return 0;
+  }
+  size_t runs = (argc == 2) ? std::atoi(argv[1]) : 100;
+  if (runs == 0)
+    runs = 1;
+
+  giskard::SyntheticSpecOptions defaults;
+  defaults.num_joints_ = 50;
+  defaults.num_branches_ = 2;
+  defaults.num_constraints_ = 200;
+  defaults.hard_constraint_ratio_ = 0.2;
+  defaults.sharing_ = 0.5;
+
+  std::cout << "axis, value, yaml bytes, parse ms, generate ms, update us, failures" << std::endl;
+
+  size_t joints[] = {10, 25, 50, 100};
+  for (size_t i = 0; i < 4; ++i)
+  {
+    giskard::SyntheticSpecOptions options = defaults;
+    options.num_joints_ = joints[i];
+    measure("joints", joints[i], options, runs);
+  }
+
+  size_t constraints[] = {50, 100, 200, 400};
+  for (size_t i = 0; i < 4; ++i)
+  {
+    giskard::SyntheticSpecOptions options = defaults;
+    options.num_constraints_ = constraints[i];
+    measure("constraints", constraints[i], options, runs);
+  }
+
+  double ratios[] = {0.0, 0.25, 0.5, 0.75};
+  for (size_t i = 0; i < 4; ++i)
+  {
+    giskard::SyntheticSpecOptions options = defaults;
+    options.hard_constraint_ratio_ = ratios[i];
+    measure("hard ratio", ratios[i], options, runs);
+  }
+
+  for (size_t i = 0; i < 4; ++i)
+  {
+    giskard::SyntheticSpecOptions options = defaults;
+    options.sharing_ = ratios[i] + 0.25;
+    measure("sharing", options.sharing_, options, runs);
+  }
+
+  return 0;
+}
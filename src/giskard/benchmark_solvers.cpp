@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <yaml-cpp/yaml.h>
+#include <giskard/giskard.hpp>
+
+// Compares QP solver backends in closed loop on a controller specification.
+// A qpOASES controller drives the loop; after each of its updates, every
+// backend solves the very same QPProblemBuilder output.
+
+class SolverStatistics
+{
+  public:
+    SolverStatistics(const giskard::QPSolverPtr& solver) :
+      solver_(solver), total_microseconds_(0.0), max_microseconds_(0.0), num_solves_(0),
+      num_failures_(0), total_iterations_(0), max_deviation_(0.0) {}
+
+    void add(const Eigen::VectorXd& reference)
+    {
+      double microseconds = 1e6 * solver_->get_solve_seconds();
+      total_microseconds_ += microseconds;
+      max_microseconds_ = std::max(max_microseconds_, microseconds);
+      total_iterations_ += solver_->get_num_iterations();
+      num_solves_++;
+
+      if(solver_->get_status() != giskard::QP_SOLVED)
+      {
+        num_failures_++;
+        return;
+      }
+
+      solver_->get_primal_solution(solution_);
+      max_deviation_ = std::max(max_deviation_, (solution_ - reference).cwiseAbs().maxCoeff());
+    }
+
+    void report(double start_microseconds) const
+    {
+      size_t num_solves = std::max(num_solves_, size_t(1));
+      std::cout << solver_->get_name() << ": start " << start_microseconds << " us, update " <<
+        total_microseconds_ / num_solves << " us mean, " << max_microseconds_ << " us max, " <<
+        double(total_iterations_) / num_solves << " iterations mean, " << num_failures_ <<
+        " failures, max deviation " << max_deviation_ << std::endl;
+    }
+
+    const giskard::QPSolverPtr& get_solver() const
+    {
+      return solver_;
+    }
+
+  private:
+    giskard::QPSolverPtr solver_;
+    double total_microseconds_, max_microseconds_;
+    size_t num_solves_, num_failures_, total_iterations_;
+    double max_deviation_;
+    Eigen::VectorXd solution_;
+};
+
+static size_t num_observables(const giskard::QPProblemBuilder& builder)
+{
+  return std::max(builder.num_controllables(), std::max(builder.num_soft_constraints_observables(),
+        builder.num_hard_constraints_observables()));
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2 || argc > 4)
+  {
+    std::cout << "Usage: rosrun giskard benchmark_solvers <controller.yaml> (optional <steps> <dt>)" << std::endl;
+    return 0;
+  }
+  size_t steps = (argc >= 3) ? std::atoi(argv[2]) : 300;
+  double dt = (argc == 4) ? std::atof(argv[3]) : 0.01;
+  int nWSR = 100;
+
+  YAML::Node node = YAML::LoadFile(argv[1]);
+  giskard::QPController controller = giskard::generate(node.as<giskard::QPControllerSpec>());
+  const giskard::QPProblemBuilder& builder = controller.get_qp_builder();
+  std::cout << builder.num_controllables() << " controllables, " << builder.num_soft_constraints() <<
+    " soft constraints, " << builder.num_hard_constraints() << " hard constraints" << std::endl;
+
+  std::vector<SolverStatistics> backends;
+  backends.push_back(SolverStatistics(giskard::create_qp_solver(giskard::QPOASES_SOLVER)));
+  backends.push_back(SolverStatistics(giskard::create_qp_solver(giskard::DIAGONAL_SOLVER)));
+
+  Eigen::VectorXd state = Eigen::VectorXd::Zero(num_observables(builder));
+  for(size_t i=0; i<state.rows(); ++i)
+    state(i) = 0.01 * (i % 7);
+
+  if(!controller.start(state, nWSR))
+  {
+    std::cerr << "Driving controller failed to start." << std::endl;
+    return 1;
+  }
+
+  std::vector<double> start_microseconds;
+  for(size_t i=0; i<backends.size(); ++i)
+  {
+    backends[i].get_solver()->init(builder, nWSR);
+    start_microseconds.push_back(1e6 * backends[i].get_solver()->get_solve_seconds());
+  }
+
+  Eigen::VectorXd reference;
+  for(size_t i=0; i<steps; ++i)
+  {
+    if(!controller.update(state, nWSR))
+    {
+      std::cerr << "Driving controller failed in step " << i << "." << std::endl;
+      return 1;
+    }
+    controller.get_solver().get_primal_solution(reference);
+
+    for(size_t j=0; j<backends.size(); ++j)
+    {
+      backends[j].get_solver()->hotstart(builder, nWSR);
+      backends[j].add(reference);
+    }
+
+    state.segment(0, builder.num_controllables()) += dt * controller.get_command();
+  }
+
+  for(size_t i=0; i<backends.size(); ++i)
+    backends[i].report(start_microseconds[i]);
+
+  return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <giskard/giskard.hpp>
+#include <giskard/stopwatch.hpp>
+
+// Measures the startup time of synthetic controllers of growing size with
+// and without a ControllerCache: parsing and generating the YAML directly,
+// a cache miss, and a cache hit, which reads the binary artefact instead of
+// parsing the YAML. Prints CSV in milliseconds, one line per size.
+
+int main(int argc, char **argv)
+{
+  if (argc > 2)
+  {
+    std::cout << "Usage: rosrun giskard benchmark_startup (optional <runs>)" << std::endl;
+    return 0;
+  }
+  size_t runs = (argc == 2) ? std::atoi(argv[1]) : 10;
+  if (runs == 0)
+    runs = 1;
+
+  char dir_template[] = "/tmp/giskard_startup_XXXXXX";
+  if (!mkdtemp(dir_template))
+  {
+    std::cerr << "Could not create a cache directory." << std::endl;
+    return 1;
+  }
+
+  std::cout << "joints, constraints, yaml bytes, direct ms, miss ms, hit load ms, hit generate ms" << std::endl;
+
+  size_t sizes[] = {10, 50, 100, 200};
+  for (size_t i = 0; i < 4; ++i)
+  {
+    giskard::SyntheticSpecOptions options;
+    options.num_joints_ = sizes[i];
+    options.num_constraints_ = 4 * sizes[i];
+    std::string yaml = giskard::SyntheticSpecGenerator::generate_yaml(options);
+
+    giskard::ControllerCache cache(dir_template);
+    double direct_seconds = 0.0, miss_seconds = 0.0, load_seconds = 0.0, generate_seconds = 0.0;
+    for (size_t j = 0; j < runs; ++j)
+    {
+      giskard::Stopwatch stopwatch;
+      giskard::QPController direct = giskard::generate(YAML::Load(yaml).as<giskard::QPControllerSpec>());
+      direct_seconds += stopwatch.get_elapsed_seconds();
+
+      std::remove(cache.get_path(yaml).c_str());
+      stopwatch.restart();
+      giskard::QPController miss = giskard::generate_from_yaml(yaml, cache);
+      miss_seconds += stopwatch.get_elapsed_seconds();
+
+      stopwatch.restart();
+      giskard::ControllerArtefact artefact = cache.get_artefact(yaml);
+      load_seconds += stopwatch.get_elapsed_seconds();
+      stopwatch.restart();
+      giskard::QPController hit = giskard::generate(artefact.spec_);
+      generate_seconds += stopwatch.get_elapsed_seconds();
+    }
+    std::remove(cache.get_path(yaml).c_str());
+
+    std::cout << sizes[i] << ", " << options.num_constraints_ << ", " << yaml.size() << ", " <<
+      1e3 * direct_seconds / runs << ", " << 1e3 * miss_seconds / runs << ", " <<
+      1e3 * load_seconds / runs << ", " << 1e3 * generate_seconds / runs << std::endl;
+  }
+
+  std::remove(dir_template);
+  return 0;
+}
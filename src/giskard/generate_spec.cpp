@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <iostream>
+#include <cstdlib>
+#include <giskard/giskard.hpp>
+
+// Prints the YAML of a synthetic controller specification, see
+// giskard::SyntheticSpecOptions for the meaning of the parameters.
+
+int main(int argc, char **argv)
+{
+  if (argc < 3 || argc > 7)
+  {
+    std::cout << "Usage: rosrun giskard generate_spec <num_joints> <num_constraints> (optional <hard_constraint_ratio> <sharing> <num_branches> <seed>)" << std::endl;
+    return 0;
+  }
+
+  giskard::SyntheticSpecOptions options;
+  options.num_joints_ = std::atoi(argv[1]);
+  options.num_constraints_ = std::atoi(argv[2]);
+  if (argc >= 4)
+    options.hard_constraint_ratio_ = std::atof(argv[3]);
+  if (argc >= 5)
+    options.sharing_ = std::atof(argv[4]);
+  if (argc >= 6)
+    options.num_branches_ = std::atoi(argv[5]);
+  if (argc == 7)
+    options.seed_ = std::atoi(argv[6]);
+
+  std::cout << giskard::SyntheticSpecGenerator::generate_yaml(options) << std::endl;
+
+  return 0;
+}
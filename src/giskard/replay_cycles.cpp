@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <giskard/giskard.hpp>
+
+// Replays a session recorded with giskard::CycleRecorder against this build
+// of giskard. Prints the recorded and replayed timing distributions and the
+// deviations of the outputs. Given a tolerance, exits with 1 if any command
+// or slack deviates by more, or if a cycle succeeds in only one of the runs.
+
+static void report(const std::string& name, const giskard::TimingDistribution& timings)
+{
+  std::cout << name << ", " << 1e6 * timings.mean_ << ", " << 1e6 * timings.min_ << ", " <<
+    1e6 * timings.median_ << ", " << 1e6 * timings.p90_ << ", " << 1e6 * timings.p99_ << ", " <<
+    1e6 * timings.max_ << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc != 2 && argc != 3)
+  {
+    std::cout << "Usage: rosrun giskard replay_cycles <session.log> (optional <tolerance>)" << std::endl;
+    return 0;
+  }
+
+  std::ifstream is(argv[1], std::ios::binary);
+  if (!is)
+  {
+    std::cout << "Could not open " << argv[1] << std::endl;
+    return 1;
+  }
+
+  giskard::RecordedSession session;
+  giskard::read_binary(is, session);
+  std::cout << session.cycles_.size() << " cycles recorded with giskard " << session.version_ <<
+    ", replaying with giskard " << GISKARD_VERSION << std::endl;
+  if (session.truncated_)
+    std::cout << "The recording is truncated after its last complete cycle." << std::endl;
+
+  giskard::ReplayResult result = giskard::replay(session);
+
+  std::cout << "phase, mean us, min us, median us, p90 us, p99 us, max us" << std::endl;
+  report("recorded evaluation", result.recorded_evaluation_);
+  report("replayed evaluation", result.replayed_evaluation_);
+  report("recorded solve", result.recorded_solve_);
+  report("replayed solve", result.replayed_solve_);
+
+  std::cout << "max command deviation: " << result.get_max_command_deviation() << std::endl;
+  std::cout << "max slack deviation: " << result.get_max_slack_deviation() << std::endl;
+  std::cout << "success mismatches: " << result.num_success_mismatches_ << std::endl;
+
+  if (argc == 3)
+  {
+    double tolerance = std::atof(argv[2]);
+    for (size_t i = 0; i < session.cycles_.size(); ++i)
+      if (result.command_deviations_[i] > tolerance || result.slack_deviations_[i] > tolerance)
+      {
+        std::cout << "First deviation beyond " << tolerance << " in cycle " << i << "." << std::endl;
+        return 1;
+      }
+
+    if (result.num_success_mismatches_ > 0)
+      return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+#include <giskard/stopwatch.hpp>
+
+void write_pairs(giskard::TripleBuffer< std::pair<size_t, size_t> >& buffer, size_t num_writes)
+{
+  for(size_t i=1; i<=num_writes; ++i)
+  {
+    buffer.get_back() = std::make_pair(i, i);
+    buffer.publish();
+  }
+}
+
+class AsyncQPControllerTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      nWSR = 100;
+
+      std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
+          controllable_weights, soft_expressions, soft_lower, soft_upper, soft_weights,
+          hard_expressions, hard_lower, hard_upper;
+      std::vector<std::string> soft_names, controllable_names;
+
+      for(size_t i=0; i<2; ++i)
+      {
+        KDL::Expression<double>::Ptr exp = KDL::cached<double>(KDL::input(i));
+        controllable_lower.push_back(KDL::Constant(-0.1));
+        controllable_upper.push_back(KDL::Constant(0.1));
+        controllable_weights.push_back(KDL::Constant(0.1));
+        controllable_names.push_back("dof " + boost::lexical_cast<std::string>(i));
+
+        using KDL::operator-;
+        soft_expressions.push_back(exp);
+        soft_lower.push_back(KDL::Constant(1.0) - exp);
+        soft_upper.push_back(KDL::Constant(1.0) - exp);
+        soft_weights.push_back(KDL::Constant(10.0));
+        soft_names.push_back("dof " + boost::lexical_cast<std::string>(i) + " goal");
+      }
+
+      ASSERT_TRUE(controller.init(controllable_lower, controllable_upper, controllable_weights,
+            controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights,
+            soft_names, hard_expressions, hard_lower, hard_upper));
+
+      state = Eigen::VectorXd::Zero(2);
+    }
+
+    virtual void TearDown(){}
+
+    const giskard::AsyncCommand& wait_for_command(giskard::AsyncQPController& c, size_t sequence)
+    {
+      giskard::Stopwatch stopwatch;
+      while(c.get_command().sequence_ < sequence && stopwatch.get_elapsed_seconds() < 5.0)
+        boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+      return c.get_command();
+    }
+
+    giskard::QPController controller;
+    Eigen::VectorXd state;
+    int nWSR;
+};
+
+TEST_F(AsyncQPControllerTest, TripleBuffer)
+{
+  giskard::TripleBuffer<int> buffer(0);
+  EXPECT_FALSE(buffer.update());
+  EXPECT_EQ(0, buffer.get_front());
+
+  buffer.get_back() = 1;
+  buffer.publish();
+  EXPECT_TRUE(buffer.update());
+  EXPECT_EQ(1, buffer.get_front());
+  EXPECT_FALSE(buffer.update());
+  EXPECT_EQ(1, buffer.get_front());
+
+  // only the latest value survives
+  buffer.get_back() = 2;
+  buffer.publish();
+  buffer.get_back() = 3;
+  buffer.publish();
+  EXPECT_TRUE(buffer.update());
+  EXPECT_EQ(3, buffer.get_front());
+  EXPECT_FALSE(buffer.update());
+}
+
+TEST_F(AsyncQPControllerTest, TripleBufferThreaded)
+{
+  giskard::TripleBuffer< std::pair<size_t, size_t> > buffer(std::make_pair(0, 0));
+  boost::thread writer(boost::bind(&write_pairs, boost::ref(buffer), 100000));
+
+  size_t last = 0;
+  while(last < 100000)
+    if(buffer.update())
+    {
+      // writes never tear and never go back in time
+      ASSERT_EQ(buffer.get_front().first, buffer.get_front().second);
+      ASSERT_LT(last, buffer.get_front().first);
+      last = buffer.get_front().first;
+    }
+
+  writer.join();
+}
+
+TEST_F(AsyncQPControllerTest, FreshCommands)
+{
+  giskard::QPController reference = controller.clone();
+  ASSERT_TRUE(reference.start(state, nWSR));
+
+  giskard::AsyncQPController c(controller, nWSR);
+  EXPECT_FALSE(c.is_running());
+  ASSERT_TRUE(c.start(state, 0));
+  EXPECT_TRUE(c.is_running());
+  EXPECT_EQ(0, c.get_command().sequence_);
+  EXPECT_FALSE(c.get_command().success_);
+  EXPECT_EQ(2, c.get_command().command_.rows());
+
+  for(size_t i=1; i<=20; ++i)
+  {
+    c.set_observables(state);
+    const giskard::AsyncCommand& command = wait_for_command(c, i);
+    ASSERT_EQ(i, command.sequence_);
+    ASSERT_TRUE(command.success_);
+    EXPECT_LE(command.stamp_, command.solved_);
+    EXPECT_LE(0.0, c.get_command_age());
+
+    ASSERT_TRUE(reference.update(state, nWSR));
+    ASSERT_EQ(reference.get_command().rows(), command.command_.rows());
+    for(size_t j=0; j<2; ++j)
+      EXPECT_DOUBLE_EQ(reference.get_command()(j), command.command_(j));
+
+    state += command.command_;
+  }
+
+  EXPECT_NEAR(1.0, state(0), 1e-3);
+  EXPECT_NEAR(1.0, state(1), 1e-3);
+
+  c.stop();
+  EXPECT_FALSE(c.is_running());
+  EXPECT_EQ(20, c.get_num_solved());
+  EXPECT_EQ(0, c.get_num_failed());
+}
+
+TEST_F(AsyncQPControllerTest, DropsStaleObservables)
+{
+  giskard::AsyncQPController c(controller, nWSR);
+  ASSERT_TRUE(c.start(state));
+
+  for(size_t i=0; i<1000; ++i)
+    c.set_observables(state);
+
+  EXPECT_EQ(1000, wait_for_command(c, 1000).sequence_);
+  c.stop();
+  EXPECT_GE(1000, c.get_num_solved());
+}
+
+TEST_F(AsyncQPControllerTest, RejectsWrongSizedObservables)
+{
+  giskard::AsyncQPController c(controller, nWSR);
+  EXPECT_EQ(2, c.num_observables());
+  ASSERT_TRUE(c.start(state));
+
+  EXPECT_THROW(c.set_observables(Eigen::VectorXd::Zero(1)), std::invalid_argument);
+
+  // the worker keeps running and solving valid observables
+  c.set_observables(state);
+  EXPECT_EQ(1, wait_for_command(c, 1).sequence_);
+  EXPECT_TRUE(c.is_running());
+}
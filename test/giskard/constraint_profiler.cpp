@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+#include <sstream>
+
+class ConstraintProfilerTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      std::string s = "scope: [{q: {input-var: 0}}, {e: {double-mul: [2.0, q]}}, "
+          "{v: {cached-vector: {vector3: [q, 0, 0]}}}, {x: {x-coord: v}}, {y: {x-coord: v}}]\n"
+          "controllable-constraints: [{controllable-constraint: [-0.1, 0.1, 1.0, 0, joint]}]\n"
+          "soft-constraints: [{soft-constraint: [{double-sub: [1.0, e]}, {double-sub: [1.0, e]}, 1.0, e, goal]}, "
+          "{soft-constraint: [-0.1, 0.1, 1.0, x, position]}]\n"
+          "hard-constraints: [{hard-constraint: [-1.0, 1.0, y]}]";
+      spec = YAML::Load(s).as<giskard::QPControllerSpec>();
+      observables = Eigen::VectorXd::Constant(1, 0.2);
+    }
+
+    virtual void TearDown(){}
+
+    giskard::QPControllerSpec spec;
+    Eigen::VectorXd observables;
+};
+
+TEST_F(ConstraintProfilerTest, Attribution)
+{
+  giskard::ConstraintProfiler profiler(spec);
+  ASSERT_EQ(1, profiler.num_observables());
+  profiler.profile(observables, 10);
+
+  const std::vector<giskard::ConstraintProfile>& profiles = profiler.get_profiles();
+  ASSERT_EQ(4, profiles.size());
+  EXPECT_EQ("controllable", profiles[0].group_);
+  EXPECT_EQ("joint", profiles[0].name_);
+  EXPECT_EQ("soft", profiles[1].group_);
+  EXPECT_EQ("goal", profiles[1].name_);
+  EXPECT_EQ("position", profiles[2].name_);
+  EXPECT_EQ("hard", profiles[3].group_);
+  EXPECT_EQ("0", profiles[3].name_);
+
+  // constants only
+  ASSERT_EQ(1, profiles[0].frames_.size());
+  EXPECT_DOUBLE_EQ(3.0, profiles[0].node_visits_);
+
+  // hard constraint: value and one derivative of the expression, values of
+  // the bounds, the cached v is shared with the second soft constraint
+  const giskard::ConstraintProfile& hard = profiles[3];
+  ASSERT_EQ(4, hard.frames_.size());
+  EXPECT_EQ("", hard.frames_[0].name_);
+  EXPECT_EQ("q", hard.frames_[1].name_);
+  EXPECT_EQ("v", hard.frames_[2].name_);
+  EXPECT_EQ("y", hard.frames_[3].name_);
+  EXPECT_DOUBLE_EQ(4.0, hard.frames_[0].node_visits_);
+  EXPECT_DOUBLE_EQ(2.0, hard.frames_[1].node_visits_);
+  EXPECT_DOUBLE_EQ(5.0, hard.frames_[2].node_visits_);
+  EXPECT_DOUBLE_EQ(4.0, hard.frames_[3].node_visits_);
+  EXPECT_DOUBLE_EQ(15.0, hard.node_visits_);
+  EXPECT_DOUBLE_EQ(hard.frames_[2].node_visits_, profiles[2].frames_[2].node_visits_);
+
+  for(size_t i=0; i<profiles.size(); ++i)
+  {
+    EXPECT_LE(0.0, profiles[i].seconds_);
+    double seconds = 0.0;
+    for(size_t j=0; j<profiles[i].frames_.size(); ++j)
+      seconds += profiles[i].frames_[j].seconds_;
+    EXPECT_NEAR(profiles[i].seconds_, seconds, 1e-12);
+  }
+}
+
+TEST_F(ConstraintProfilerTest, FoldedOutput)
+{
+  giskard::ConstraintProfiler profiler(spec);
+  profiler.profile(observables, 1);
+
+  std::stringstream folded;
+  profiler.write_folded(folded, giskard::PROFILE_NODE_VISITS);
+  EXPECT_NE(std::string::npos, folded.str().find("controllable;joint 3\n"));
+  EXPECT_NE(std::string::npos, folded.str().find("hard;0;v 5\n"));
+  EXPECT_NE(std::string::npos, folded.str().find("soft;goal;e "));
+}
+
+TEST_F(ConstraintProfilerTest, TooFewObservables)
+{
+  giskard::ConstraintProfiler profiler(spec);
+  EXPECT_THROW(profiler.profile(Eigen::VectorXd(), 1), std::invalid_argument);
+  EXPECT_THROW(profiler.profile(observables, 0), std::invalid_argument);
+}
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+#include <giskard/controller_cache.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+class ControllerCacheTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      std::ifstream file("pr2_qp_position_control.yaml");
+      std::stringstream buffer;
+      buffer << file.rdbuf();
+      source = buffer.str();
+      spec = YAML::Load(source).as<giskard::QPControllerSpec>();
+
+      char dir_template[] = "/tmp/giskard_cache_XXXXXX";
+      ASSERT_TRUE(mkdtemp(dir_template));
+      cache_dir = dir_template;
+    }
+
+    virtual void TearDown()
+    {
+      std::remove(giskard::ControllerCache(cache_dir).get_path(source).c_str());
+      std::remove(cache_dir.c_str());
+    }
+
+    std::string source;
+    giskard::QPControllerSpec spec;
+    std::string cache_dir;
+};
+
+static bool equal_specs(const giskard::QPControllerSpec& a, const giskard::QPControllerSpec& b)
+{
+  std::ostringstream sa, sb;
+  giskard::write_binary(sa, a);
+  giskard::write_binary(sb, b);
+  return sa.str() == sb.str();
+}
+
+TEST_F(ControllerCacheTest, BinaryRoundtrip)
+{
+  std::stringstream stream;
+  giskard::write_binary(stream, spec);
+
+  giskard::QPControllerSpec spec2;
+  ASSERT_NO_THROW(giskard::read_binary(stream, spec2));
+
+  ASSERT_EQ(spec.scope_.size(), spec2.scope_.size());
+  for(size_t i=0; i<spec.scope_.size(); ++i)
+  {
+    EXPECT_STREQ(spec.scope_[i].name.c_str(), spec2.scope_[i].name.c_str());
+    EXPECT_TRUE(*(spec.scope_[i].spec) == *(spec2.scope_[i].spec));
+  }
+  EXPECT_EQ(giskard::hash_value(spec), giskard::hash_value(spec2));
+
+  std::stringstream truncated(stream.str().substr(0, stream.str().size() / 2));
+  EXPECT_THROW(giskard::read_binary(truncated, spec2), std::runtime_error);
+
+  // a corrupt size must not allocate what it claims
+  std::string corrupt = stream.str();
+  corrupt.replace(0, 8, std::string(8, char(0x7f)));
+  std::stringstream corrupted(corrupt);
+  EXPECT_THROW(giskard::read_binary(corrupted, spec2), std::runtime_error);
+}
+
+TEST_F(ControllerCacheTest, Keys)
+{
+  EXPECT_EQ(giskard::ControllerCache::get_key(source), giskard::ControllerCache::get_key(std::string(source)));
+  EXPECT_NE(giskard::ControllerCache::get_key(source), giskard::ControllerCache::get_key(source + " "));
+  EXPECT_NE(giskard::ControllerCache(cache_dir).get_path(source),
+      giskard::ControllerCache(cache_dir).get_path(source + " "));
+}
+
+TEST_F(ControllerCacheTest, ConstantFolding)
+{
+  std::string s = "scope: [{a: {double-mul: [2.0, 3.0]}}, {b: {double-add: [a, 1.0]}}, "
+      "{c: {input-var: 0}}, {d: {double-add: [a, c]}}]\n"
+      "controllable-constraints: [{controllable-constraint: [{double-sub: [b]}, b, a, 0, c]}]\n"
+      "soft-constraints: [{soft-constraint: [{double-div: [a, 2.0]}, b, 1.0, d, goal]}]\n"
+      "hard-constraints: []";
+  giskard::QPControllerSpec s1 = YAML::Load(s).as<giskard::QPControllerSpec>();
+  giskard::QPControllerSpec s2 = giskard::fold_constants(s1);
+
+  ASSERT_EQ(giskard::DOUBLE_CONST_SPEC, s2.scope_[0].spec->get_type());
+  ASSERT_EQ(giskard::DOUBLE_CONST_SPEC, s2.scope_[1].spec->get_type());
+  EXPECT_EQ(giskard::DOUBLE_INPUT_SPEC, s2.scope_[2].spec->get_type());
+  EXPECT_EQ(giskard::DOUBLE_ADDITION_SPEC, s2.scope_[3].spec->get_type());
+  EXPECT_DOUBLE_EQ(7.0, boost::static_pointer_cast<giskard::DoubleConstSpec>(
+      s2.scope_[1].spec)->get_value());
+
+  ASSERT_EQ(giskard::DOUBLE_CONST_SPEC, s2.controllable_constraints_[0].lower_->get_type());
+  EXPECT_DOUBLE_EQ(-7.0, boost::static_pointer_cast<giskard::DoubleConstSpec>(
+      s2.controllable_constraints_[0].lower_)->get_value());
+  ASSERT_EQ(giskard::DOUBLE_CONST_SPEC, s2.soft_constraints_[0].lower_->get_type());
+  EXPECT_DOUBLE_EQ(3.0, boost::static_pointer_cast<giskard::DoubleConstSpec>(
+      s2.soft_constraints_[0].lower_)->get_value());
+
+  // the original spec remains untouched
+  EXPECT_EQ(giskard::DOUBLE_MULTIPLICATION_SPEC, s1.scope_[0].spec->get_type());
+}
+
+TEST_F(ControllerCacheTest, UnusedScopeEntries)
+{
+  std::string s = "scope: [{a: {input-var: 0}}, {b: {double-add: [a, 1.0]}}, "
+      "{c: {input-var: 1}}, {d: {double-mul: [c, c]}}, {e: {double-add: [b, 2.0]}}]\n"
+      "controllable-constraints: [{controllable-constraint: [-1.0, 1.0, 1.0, 0, a]}]\n"
+      "soft-constraints: [{soft-constraint: [0.0, 0.0, 1.0, e, goal]}]\n"
+      "hard-constraints: []";
+  giskard::QPControllerSpec s1 = YAML::Load(s).as<giskard::QPControllerSpec>();
+  giskard::QPControllerSpec s2 = giskard::remove_unused_scope_entries(s1);
+
+  ASSERT_EQ(3, s2.scope_.size());
+  EXPECT_EQ("a", s2.scope_[0].name);
+  EXPECT_EQ("b", s2.scope_[1].name);
+  EXPECT_EQ("e", s2.scope_[2].name);
+  EXPECT_EQ(5, s1.scope_.size());
+
+  ASSERT_NO_THROW(giskard::generate(s2));
+}
+
+TEST_F(ControllerCacheTest, HitAndMiss)
+{
+  giskard::ControllerCache cache(cache_dir);
+  giskard::ControllerArtefact artefact;
+  EXPECT_FALSE(cache.load(source, artefact));
+
+  giskard::ControllerArtefact a1 = cache.get_artefact(source);
+  EXPECT_EQ(0, cache.get_hits());
+  EXPECT_EQ(1, cache.get_misses());
+
+  giskard::ControllerArtefact a2 = cache.get_artefact(source);
+  EXPECT_EQ(1, cache.get_hits());
+  EXPECT_EQ(1, cache.get_misses());
+
+  EXPECT_TRUE(equal_specs(a1.spec_, a2.spec_));
+  EXPECT_EQ(8, a2.get_num_controllables());
+  EXPECT_EQ(1, a2.get_num_soft_constraints());
+  EXPECT_EQ(6, a2.get_num_hard_constraints());
+  EXPECT_LE(a2.spec_.scope_.size(), spec.scope_.size());
+
+  // corrupt artefacts are treated as misses
+  std::ofstream file(cache.get_path(source).c_str(), std::ios::binary | std::ios::trunc);
+  file << "garbage";
+  file.close();
+  EXPECT_FALSE(cache.load(source, artefact));
+}
+
+static void store_repeatedly(const giskard::ControllerCache* cache, const std::string* source,
+    const giskard::ControllerArtefact* artefact, boost::atomic<size_t>* failures)
+{
+  for(size_t i=0; i<20; ++i)
+  {
+    try
+    {
+      cache->store(*source, *artefact);
+    }
+    catch(const giskard::WriteError&)
+    {
+      ++(*failures);
+    }
+  }
+}
+
+TEST_F(ControllerCacheTest, ConcurrentStores)
+{
+  // writers which miss on the same key at once must not share a temporary file
+  giskard::ControllerCache cache(cache_dir);
+  giskard::ControllerArtefact artefact = giskard::build_artefact(spec);
+  boost::atomic<size_t> failures(0);
+  boost::thread_group writers;
+  for(size_t i=0; i<4; ++i)
+    writers.create_thread(boost::bind(&store_repeatedly, &cache, &source, &artefact, &failures));
+  writers.join_all();
+
+  EXPECT_EQ(0, failures.load());
+  giskard::ControllerArtefact loaded;
+  ASSERT_TRUE(cache.load(source, loaded));
+  EXPECT_TRUE(equal_specs(artefact.spec_, loaded.spec_));
+}
+
+TEST_F(ControllerCacheTest, Directories)
+{
+  // missing directories get created
+  std::string nested_dir = cache_dir + "/a/b";
+  giskard::ControllerCache nested(nested_dir);
+  nested.get_artefact(source);
+  giskard::ControllerArtefact artefact;
+  EXPECT_TRUE(nested.load(source, artefact));
+  std::remove(nested.get_path(source).c_str());
+  std::remove(nested_dir.c_str());
+  std::remove((cache_dir + "/a").c_str());
+
+  // failing to store an artefact still returns it
+  std::string file_path = cache_dir + "/file";
+  std::ofstream(file_path.c_str()) << "not a directory";
+  giskard::ControllerCache unwritable(file_path + "/cache");
+  EXPECT_THROW(unwritable.store(source, artefact), giskard::WriteError);
+  EXPECT_EQ(8, unwritable.get_artefact(source).get_num_controllables());
+  EXPECT_EQ(1, unwritable.get_misses());
+  std::remove(file_path.c_str());
+}
+
+TEST_F(ControllerCacheTest, Generate)
+{
+  giskard::ControllerCache cache(cache_dir);
+  Eigen::VectorXd state(8);
+  using Eigen::operator<<;
+  state << 0.02, 0.0, 0.0, 0.0, -0.16, 0.0, -0.11, 0.0;
+  int nWSR = 10;
+
+  giskard::QPController c1 = giskard::generate(spec);
+  ASSERT_NO_THROW(giskard::generate_from_yaml(source, cache));
+  giskard::QPController c2 = giskard::generate_from_yaml(source, cache);
+  EXPECT_EQ(1, cache.get_hits());
+
+  ASSERT_TRUE(c1.start(state, nWSR));
+  ASSERT_TRUE(c2.start(state, nWSR));
+  for(size_t i=0; i<c1.get_command().rows(); ++i)
+    EXPECT_NEAR(c1.get_command()(i), c2.get_command()(i), 1e-9);
+}
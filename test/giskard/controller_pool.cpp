@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+
+class ControllerPoolTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      nWSR = 100;
+      num_controllers = 10;
+
+      // controllers with different numbers of dofs and different goals
+      for(size_t i=0; i<num_controllers; ++i)
+      {
+        controllers.push_back(make_controller(1 + i % 3, 0.1 * i));
+        states.push_back(Eigen::VectorXd::Zero(1 + i % 3));
+      }
+    }
+
+    virtual void TearDown(){}
+
+    giskard::QPController make_controller(size_t num_dofs, double goal)
+    {
+      std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
+          controllable_weights, soft_expressions, soft_lower, soft_upper, soft_weights,
+          hard_expressions, hard_lower, hard_upper;
+      std::vector<std::string> soft_names, controllable_names;
+
+      for(size_t i=0; i<num_dofs; ++i)
+      {
+        KDL::Expression<double>::Ptr exp = KDL::cached<double>(KDL::input(i));
+        controllable_lower.push_back(KDL::Constant(-0.1));
+        controllable_upper.push_back(KDL::Constant(0.1));
+        controllable_weights.push_back(KDL::Constant(0.1));
+        controllable_names.push_back("dof " + boost::lexical_cast<std::string>(i));
+
+        using KDL::operator-;
+        soft_expressions.push_back(exp);
+        soft_lower.push_back(KDL::Constant(goal) - exp);
+        soft_upper.push_back(KDL::Constant(goal) - exp);
+        soft_weights.push_back(KDL::Constant(10.0));
+        soft_names.push_back("dof " + boost::lexical_cast<std::string>(i) + " goal");
+      }
+
+      giskard::QPController controller;
+      controller.init(controllable_lower, controllable_upper, controllable_weights,
+            controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights,
+            soft_names, hard_expressions, hard_lower, hard_upper);
+      return controller;
+    }
+
+    std::vector<giskard::QPController> controllers;
+    std::vector<Eigen::VectorXd> states;
+    size_t num_controllers;
+    int nWSR;
+};
+
+TEST_F(ControllerPoolTest, Constructor)
+{
+  giskard::ControllerPool pool(3);
+  EXPECT_EQ(3, pool.get_num_threads());
+  EXPECT_EQ(0, pool.num_controllers());
+  EXPECT_TRUE(pool.tick());
+  EXPECT_EQ(1, pool.get_statistics().num_ticks_);
+  EXPECT_EQ(0, pool.get_statistics().num_updates_);
+
+  giskard::ControllerPool single_pool(0);
+  EXPECT_EQ(1, single_pool.get_num_threads());
+}
+
+TEST_F(ControllerPoolTest, AddController)
+{
+  giskard::ControllerPool pool(2);
+  for(size_t i=0; i<num_controllers; ++i)
+    EXPECT_EQ(i, pool.add_controller(controllers[i], nWSR));
+  EXPECT_EQ(num_controllers, pool.num_controllers());
+  EXPECT_EQ(num_controllers, pool.add_controller(controllers[0], nWSR, 1));
+
+  EXPECT_THROW(pool.add_controller(controllers[0], nWSR, 2), std::invalid_argument);
+  EXPECT_THROW(pool.get_command(num_controllers + 1), std::out_of_range);
+}
+
+TEST_F(ControllerPoolTest, MatchesSequentialUpdates)
+{
+  giskard::ControllerPool pool(3);
+  for(size_t i=0; i<num_controllers; ++i)
+    pool.add_controller(controllers[i], nWSR);
+
+  std::vector<Eigen::VectorXd> reference_states = states;
+  for(size_t i=0; i<num_controllers; ++i)
+    ASSERT_TRUE(controllers[i].start(reference_states[i], nWSR));
+
+  for(size_t tick=0; tick<20; ++tick)
+  {
+    for(size_t i=0; i<num_controllers; ++i)
+      pool.set_observables(i, states[i]);
+
+    ASSERT_TRUE(pool.tick());
+
+    for(size_t i=0; i<num_controllers; ++i)
+    {
+      ASSERT_TRUE(pool.get_success(i));
+      ASSERT_TRUE(controllers[i].update(reference_states[i], nWSR));
+      ASSERT_EQ(controllers[i].get_command().rows(), pool.get_command(i).rows());
+      for(size_t j=0; j<pool.get_command(i).rows(); ++j)
+        EXPECT_DOUBLE_EQ(controllers[i].get_command()(j), pool.get_command(i)(j));
+
+      states[i] += pool.get_command(i);
+      reference_states[i] += controllers[i].get_command();
+    }
+  }
+
+  for(size_t i=0; i<num_controllers; ++i)
+    for(size_t j=0; j<states[i].rows(); ++j)
+      EXPECT_NEAR(0.1 * i, states[i](j), 1e-3);
+
+  const giskard::ControllerPoolStatistics& statistics = pool.get_statistics();
+  EXPECT_EQ(20, statistics.num_ticks_);
+  EXPECT_EQ(20 * num_controllers, statistics.num_updates_);
+  EXPECT_EQ(0, statistics.num_failures_);
+  EXPECT_LT(0.0, statistics.get_throughput());
+
+  pool.reset_statistics();
+  EXPECT_EQ(0, pool.get_statistics().num_updates_);
+  EXPECT_DOUBLE_EQ(0.0, pool.get_statistics().get_throughput());
+}
+
+TEST_F(ControllerPoolTest, StealsFromBusyThreads)
+{
+  // home all controllers on the calling thread; the idle workers steal
+  giskard::ControllerPool pool(4, true);
+  for(size_t r=0; r<20; ++r)
+    for(size_t i=0; i<num_controllers; ++i)
+      pool.add_controller(controllers[i], nWSR, 0);
+
+  for(size_t i=0; i<pool.num_controllers(); ++i)
+    pool.set_observables(i, states[i % num_controllers]);
+
+  for(size_t tick=0; tick<5; ++tick)
+    ASSERT_TRUE(pool.tick());
+
+  EXPECT_EQ(5 * pool.num_controllers(), pool.get_statistics().num_updates_);
+}
+
+TEST_F(ControllerPoolTest, MissingObservables)
+{
+  giskard::ControllerPool pool(2);
+  pool.add_controller(controllers[0], nWSR, 0);
+  pool.add_controller(controllers[1], nWSR, 1);
+
+  EXPECT_THROW(pool.set_observables(0, Eigen::VectorXd()), std::invalid_argument);
+  EXPECT_THROW(pool.set_observables(1, Eigen::VectorXd::Zero(states[1].rows() - 1)), std::invalid_argument);
+
+  // neither controller has observables, the tick fails on both threads instead of throwing
+  EXPECT_FALSE(pool.tick());
+  EXPECT_FALSE(pool.get_success(0));
+  EXPECT_FALSE(pool.get_success(1));
+  EXPECT_EQ(2, pool.get_statistics().num_failures_);
+
+  pool.set_observables(0, states[0]);
+  pool.set_observables(1, states[1]);
+  EXPECT_TRUE(pool.tick());
+  EXPECT_TRUE(pool.get_success(0));
+  EXPECT_TRUE(pool.get_success(1));
+}
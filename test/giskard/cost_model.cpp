@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+#include <sstream>
+
+class CostModelTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      std::string s = "scope: [{q: {input-var: 0}}, {e: {double-mul: [2.0, q]}}, "
+          "{f: {double-add: [e, e]}}, {v: {cached-vector: {vector3: [q, 0, 0]}}}, "
+          "{x: {x-coord: v}}, {y: {x-coord: v}}]\n"
+          "controllable-constraints: [{controllable-constraint: [-0.1, 0.1, 1.0, 0, joint]}]\n"
+          "soft-constraints: [{soft-constraint: [{double-sub: [1.0, f]}, {double-sub: [1.0, f]}, 1.0, f, goal]}, "
+          "{soft-constraint: [-0.1, 0.1, 1.0, x, position]}]\n"
+          "hard-constraints: [{hard-constraint: [-1.0, 1.0, y]}]";
+      spec = YAML::Load(s).as<giskard::QPControllerSpec>();
+    }
+
+    virtual void TearDown(){}
+
+    giskard::QPControllerSpec spec;
+};
+
+TEST_F(CostModelTest, GraphStatistics)
+{
+  giskard::SpecStatistics statistics = giskard::analyze(spec);
+
+  EXPECT_EQ(34, statistics.num_nodes_);
+  EXPECT_EQ(1, statistics.node_counts_[giskard::DOUBLE_INPUT_SPEC]);
+  EXPECT_EQ(1, statistics.node_counts_[giskard::VECTOR_CACHED_SPEC]);
+  EXPECT_EQ(2, statistics.node_counts_[giskard::DOUBLE_X_COORD_OF_SPEC]);
+  EXPECT_EQ(2, statistics.node_counts_[giskard::DOUBLE_SUBTRACTION_SPEC]);
+  EXPECT_EQ(6, statistics.num_scope_entries_);
+
+  // subtraction -> reference f -> addition -> reference e -> multiplication
+  // -> reference q -> input
+  EXPECT_EQ(7, statistics.max_depth_);
+  EXPECT_EQ(3, statistics.max_fan_out_);
+  EXPECT_DOUBLE_EQ(11.0 / 6.0, statistics.mean_fan_out_);
+
+  // v is cached, e and f are evaluated again for every use
+  EXPECT_EQ(1, statistics.num_shared_entries_);
+  EXPECT_EQ(2, statistics.num_duplicated_entries_);
+
+  // y spells out x again, and so do the bounds of the first soft constraint
+  EXPECT_EQ(2, statistics.num_duplicated_subtrees_);
+
+  EXPECT_LT(0.0, statistics.node_visits_);
+  EXPECT_LT(0.0, statistics.expression_flops_);
+  EXPECT_LT(0.0, statistics.derivative_flops_);
+  EXPECT_LT(statistics.expression_flops_ + statistics.derivative_flops_,
+      statistics.get_total_flops());
+
+  std::stringstream report;
+  giskard::print_statistics(report, statistics);
+  EXPECT_NE(std::string::npos, report.str().find("VectorCached: 1"));
+}
+
+TEST_F(CostModelTest, QPStatistics)
+{
+  giskard::QPStatistics from_spec = giskard::analyze(spec).qp_;
+  giskard::QPStatistics from_controller = giskard::analyze(giskard::generate(spec));
+
+  EXPECT_EQ(1, from_spec.num_controllables_);
+  EXPECT_EQ(2, from_spec.num_soft_constraints_);
+  EXPECT_EQ(1, from_spec.num_hard_constraints_);
+  EXPECT_EQ(1, from_spec.num_observables_);
+  EXPECT_EQ(3, from_spec.num_variables());
+  EXPECT_EQ(3, from_spec.num_constraints());
+  EXPECT_EQ(3, from_spec.jacobian_nonzeros_);
+
+  EXPECT_EQ(from_spec.num_controllables_, from_controller.num_controllables_);
+  EXPECT_EQ(from_spec.num_soft_constraints_, from_controller.num_soft_constraints_);
+  EXPECT_EQ(from_spec.num_hard_constraints_, from_controller.num_hard_constraints_);
+  EXPECT_EQ(from_spec.num_observables_, from_controller.num_observables_);
+  EXPECT_EQ(from_spec.soft_derivative_columns_, from_controller.soft_derivative_columns_);
+  EXPECT_EQ(from_spec.hard_derivative_columns_, from_controller.hard_derivative_columns_);
+  EXPECT_DOUBLE_EQ(from_spec.estimate_flops(), from_controller.estimate_flops());
+}
+
+TEST_F(CostModelTest, Budget)
+{
+  giskard::SpecStatistics statistics = giskard::analyze(spec);
+  double cycle_time = giskard::estimate_cycle_time(statistics, 1e9);
+
+  EXPECT_DOUBLE_EQ(statistics.get_total_flops() / 1e9, cycle_time);
+  EXPECT_TRUE(giskard::is_within_budget(statistics, giskard::CostBudget(2.0 * cycle_time)));
+  EXPECT_FALSE(giskard::is_within_budget(statistics, giskard::CostBudget(0.5 * cycle_time)));
+  EXPECT_THROW(giskard::estimate_cycle_time(statistics, 0.0), std::invalid_argument);
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+#include <sstream>
+
+class CycleRecorderTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      // a single joint moving towards a goal, which is the second observable
+      std::string s = "scope: [{joint: {input-var: 0}}, {goal: {input-var: 1}}, "
+          "{error: {double-sub: [goal, joint]}}]\n"
+          "controllable-constraints: [{controllable-constraint: [-0.5, 0.5, 1.0, 0, joint]}]\n"
+          "soft-constraints: [{soft-constraint: [error, error, 10.0, joint, reach]}]\n"
+          "hard-constraints: []";
+      spec = YAML::Load(s).as<giskard::QPControllerSpec>();
+      nWSR = 10;
+      num_cycles = 5;
+    }
+
+    virtual void TearDown(){}
+
+    // runs the controller in closed loop and records every cycle
+    void record(std::ostream& os)
+    {
+      giskard::QPController controller = giskard::generate(spec);
+      giskard::CycleRecorder recorder(os, spec, controller);
+
+      Eigen::VectorXd observables(2);
+      observables << 0.0, 0.3;
+      for(size_t i=0; i<num_cycles; ++i)
+      {
+        giskard::CycleKind kind = (i == 0) ? giskard::START_CYCLE : giskard::UPDATE_CYCLE;
+        bool success = (i == 0) ? controller.start(observables, nWSR) :
+            controller.update(observables, nWSR);
+        recorder.record(controller, kind, observables, nWSR, success);
+        observables(0) += 0.1 * controller.get_command()(0);
+      }
+      EXPECT_EQ(num_cycles, recorder.num_cycles());
+    }
+
+    giskard::QPControllerSpec spec;
+    int nWSR;
+    size_t num_cycles;
+};
+
+TEST_F(CycleRecorderTest, RecordAndRead)
+{
+  std::stringstream log;
+  record(log);
+
+  giskard::RecordedSession session;
+  giskard::read_binary(log, session);
+
+  EXPECT_FALSE(session.truncated_);
+  EXPECT_EQ(GISKARD_VERSION, session.version_);
+  EXPECT_EQ(giskard::hash_value(spec), giskard::hash_value(session.spec_));
+  ASSERT_EQ(num_cycles, session.cycles_.size());
+  EXPECT_EQ(giskard::START_CYCLE, session.cycles_[0].kind_);
+  EXPECT_EQ(giskard::UPDATE_CYCLE, session.cycles_[1].kind_);
+
+  for(size_t i=0; i<session.cycles_.size(); ++i)
+  {
+    const giskard::RecordedCycle& cycle = session.cycles_[i];
+    EXPECT_TRUE(cycle.success_);
+    EXPECT_EQ(giskard::QP_SOLVED, cycle.status_);
+    EXPECT_EQ(nWSR, cycle.nWSR_);
+    ASSERT_EQ(2, cycle.observables_.rows());
+    EXPECT_DOUBLE_EQ(0.3, cycle.observables_(1));
+    EXPECT_EQ(1, cycle.command_.rows());
+    EXPECT_EQ(1, cycle.slack_.rows());
+    EXPECT_LE(0.0, cycle.timings_.evaluation_seconds_);
+    EXPECT_LE(0.0, cycle.timings_.solve_seconds_);
+  }
+}
+
+TEST_F(CycleRecorderTest, Truncated)
+{
+  std::stringstream log;
+  record(log);
+
+  // drop the last few bytes, as if the recorder died mid-cycle
+  std::string bytes = log.str();
+  std::stringstream truncated(bytes.substr(0, bytes.size() - 3));
+
+  giskard::RecordedSession session;
+  giskard::read_binary(truncated, session);
+  EXPECT_TRUE(session.truncated_);
+  EXPECT_EQ(num_cycles - 1, session.cycles_.size());
+
+  // a corrupt size of the slack of the last cycle must not allocate what it claims
+  std::string corrupt = bytes;
+  corrupt.replace(corrupt.size() - 16, 8, std::string(8, char(0x7f)));
+  std::stringstream corrupted(corrupt);
+  giskard::read_binary(corrupted, session);
+  EXPECT_TRUE(session.truncated_);
+  EXPECT_EQ(num_cycles - 1, session.cycles_.size());
+
+  std::stringstream garbage("not a cycle log");
+  EXPECT_THROW(giskard::read_binary(garbage, session), std::runtime_error);
+}
+
+// a stream buffer whose writes wait while it is closed, like a slow disk
+class GatedBuffer : public std::stringbuf
+{
+  public:
+    GatedBuffer() :
+      closed(false) {}
+
+    boost::atomic<bool> closed;
+
+  protected:
+    virtual std::streamsize xsputn(const char* s, std::streamsize n)
+    {
+      while(closed.load())
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+      return std::stringbuf::xsputn(s, n);
+    }
+};
+
+TEST_F(CycleRecorderTest, DropsInsteadOfBlocking)
+{
+  GatedBuffer buffer;
+  std::ostream os(&buffer);
+  {
+    giskard::QPController controller = giskard::generate(spec);
+    giskard::CycleRecorder recorder(os, spec, controller, 2);
+    EXPECT_EQ(2, recorder.capacity());
+
+    Eigen::VectorXd observables(2);
+    observables << 0.0, 0.3;
+    ASSERT_TRUE(controller.start(observables, nWSR));
+
+    // the writer blocks on the first cycle, which keeps its slot until written
+    buffer.closed.store(true);
+    for(size_t i=0; i<num_cycles; ++i)
+      EXPECT_EQ(i < 2, recorder.record(controller, giskard::UPDATE_CYCLE, observables, nWSR, true));
+    EXPECT_EQ(2, recorder.num_cycles());
+    EXPECT_EQ(num_cycles - 2, recorder.num_dropped());
+    buffer.closed.store(false);
+  }
+
+  std::stringstream log(buffer.str());
+  giskard::RecordedSession session;
+  giskard::read_binary(log, session);
+  EXPECT_FALSE(session.truncated_);
+  EXPECT_EQ(2, session.cycles_.size());
+}
+
+TEST_F(CycleRecorderTest, Replay)
+{
+  std::stringstream log;
+  record(log);
+
+  giskard::RecordedSession session;
+  giskard::read_binary(log, session);
+
+  giskard::ReplayResult result = giskard::replay(session);
+  ASSERT_EQ(num_cycles, result.command_deviations_.size());
+  EXPECT_EQ(0, result.num_success_mismatches_);
+  EXPECT_NEAR(0.0, result.get_max_command_deviation(), 1e-12);
+  EXPECT_NEAR(0.0, result.get_max_slack_deviation(), 1e-12);
+  EXPECT_LE(result.recorded_solve_.min_, result.recorded_solve_.median_);
+  EXPECT_LE(result.replayed_solve_.median_, result.replayed_solve_.max_);
+}
+
+TEST_F(CycleRecorderTest, TimingDistribution)
+{
+  std::vector<double> seconds;
+  for(size_t i=100; i>0; --i)
+    seconds.push_back(i);
+
+  giskard::TimingDistribution distribution = giskard::summarize_timings(seconds);
+  EXPECT_DOUBLE_EQ(1.0, distribution.min_);
+  EXPECT_DOUBLE_EQ(50.0, distribution.median_);
+  EXPECT_DOUBLE_EQ(90.0, distribution.p90_);
+  EXPECT_DOUBLE_EQ(99.0, distribution.p99_);
+  EXPECT_DOUBLE_EQ(100.0, distribution.max_);
+  EXPECT_DOUBLE_EQ(50.5, distribution.mean_);
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+
+class DiagonalQPSolverTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      nWSR = 100;
+    }
+
+    virtual void TearDown(){}
+
+    void compare_solvers(const giskard::QPController& controller, const Eigen::VectorXd& initial_state,
+        size_t iterations, double dt)
+    {
+      giskard::QPController reference = controller.clone();
+      giskard::QPController diagonal = controller.clone();
+      diagonal.set_solver_type(giskard::DIAGONAL_SOLVER);
+      EXPECT_EQ("diagonal", diagonal.get_solver().get_name());
+
+      Eigen::VectorXd state = initial_state;
+      ASSERT_TRUE(reference.start(state, nWSR));
+      ASSERT_TRUE(diagonal.start(state, nWSR));
+      for(size_t i=0; i<iterations; ++i)
+      {
+        ASSERT_TRUE(reference.update(state, nWSR));
+        ASSERT_TRUE(diagonal.update(state, nWSR));
+        ASSERT_EQ(reference.get_command().rows(), diagonal.get_command().rows());
+        for(size_t j=0; j<reference.get_command().rows(); ++j)
+          EXPECT_NEAR(reference.get_command()(j), diagonal.get_command()(j), 1e-6);
+        for(size_t j=0; j<reference.get_slack().rows(); ++j)
+          EXPECT_NEAR(reference.get_slack()(j), diagonal.get_slack()(j), 1e-6);
+
+        state.segment(0, reference.get_command().rows()) += dt * reference.get_command();
+      }
+    }
+
+    int nWSR;
+};
+
+TEST_F(DiagonalQPSolverTest, SoftAndHardConstraints)
+{
+  using KDL::operator-;
+  using KDL::operator*;
+  std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
+      controllable_weights, soft_expressions, soft_lower, soft_upper, soft_weights,
+      hard_expressions, hard_lower, hard_upper;
+  std::vector<std::string> controllable_names, soft_names;
+
+  controllable_lower.push_back(KDL::Constant(-0.1));
+  controllable_lower.push_back(KDL::Constant(-0.3));
+  controllable_upper.push_back(KDL::Constant(0.1));
+  controllable_upper.push_back(KDL::Constant(0.3));
+  controllable_weights.push_back(KDL::Constant(0.66));
+  controllable_weights.push_back(KDL::Constant(0.72));
+  controllable_names.push_back("dof 1");
+  controllable_names.push_back("dof 2");
+
+  KDL::Expression<double>::Ptr exp1 = KDL::cached<double>(KDL::input(0));
+  KDL::Expression<double>::Ptr exp2 = KDL::cached<double>(KDL::input(1));
+  KDL::Expression<double>::Ptr exp3 = KDL::cached<double>(KDL::Constant(2.0)*exp1 + exp2);
+  soft_expressions.push_back(exp1);
+  soft_expressions.push_back(exp2);
+  soft_expressions.push_back(exp3);
+  soft_lower.push_back(KDL::Constant(2.0) * (KDL::Constant(0.75) - exp1));
+  soft_lower.push_back(KDL::Constant(2.0) * (KDL::Constant(-1.5) - exp2));
+  soft_lower.push_back(KDL::Constant(2.0) * (KDL::Constant(0.3) - exp3));
+  soft_upper.push_back(KDL::Constant(2.0) * (KDL::Constant(1.1) - exp1));
+  soft_upper.push_back(KDL::Constant(2.0) * (KDL::Constant(-1.3) - exp2));
+  soft_upper.push_back(KDL::Constant(2.0) * (KDL::Constant(0.35) - exp3));
+  soft_weights.push_back(KDL::Constant(11.6));
+  soft_weights.push_back(KDL::Constant(12.6));
+  soft_weights.push_back(KDL::Constant(13.6));
+  soft_names.push_back("dof 1 goal");
+  soft_names.push_back("dof 2 goal");
+  soft_names.push_back("dof 1 and 2 combined goal");
+
+  hard_expressions.push_back(exp1);
+  hard_expressions.push_back(exp2);
+  hard_lower.push_back(KDL::Constant(-3.0) - exp1);
+  hard_lower.push_back(KDL::Constant(-3.1) - exp2);
+  hard_upper.push_back(KDL::Constant(3.0) - exp1);
+  hard_upper.push_back(KDL::Constant(3.1) - exp2);
+
+  giskard::QPController controller;
+  ASSERT_TRUE(controller.init(controllable_lower, controllable_upper, controllable_weights,
+        controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights,
+        soft_names, hard_expressions, hard_lower, hard_upper));
+
+  Eigen::VectorXd state(2);
+  using Eigen::operator<<;
+  state << -1.77, 2.5;
+  compare_solvers(controller, state, 36, 1.0);
+}
+
+TEST_F(DiagonalQPSolverTest, PR2PositionControl)
+{
+  YAML::Node node = YAML::LoadFile("pr2_qp_position_control.yaml");
+  giskard::QPController controller = giskard::generate(node.as<giskard::QPControllerSpec>());
+
+  Eigen::VectorXd state(8);
+  using Eigen::operator<<;
+  state << 0.02, 0.0, 0.0, 0.0, -0.16, 0.0, -0.11, 0.0;
+  compare_solvers(controller, state, 300, 0.01);
+}
+
+TEST_F(DiagonalQPSolverTest, Failures)
+{
+  using KDL::operator-;
+  std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
+      controllable_weights, soft_expressions, soft_lower, soft_upper, soft_weights,
+      hard_expressions, hard_lower, hard_upper;
+  std::vector<std::string> controllable_names, soft_names;
+
+  // weight of the dof is the first observable, the hard constraint is
+  // infeasible for a second observable bigger than 1.1
+  KDL::Expression<double>::Ptr exp = KDL::cached<double>(KDL::input(0));
+  controllable_lower.push_back(KDL::Constant(-0.1));
+  controllable_upper.push_back(KDL::Constant(0.1));
+  controllable_weights.push_back(KDL::input(2));
+  controllable_names.push_back("dof");
+  hard_expressions.push_back(exp);
+  hard_lower.push_back(KDL::input(1) - KDL::Constant(1.0));
+  hard_upper.push_back(KDL::input(1) + KDL::Constant(1.0));
+
+  giskard::QPController controller;
+  ASSERT_TRUE(controller.init(controllable_lower, controllable_upper, controllable_weights,
+        controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights,
+        soft_names, hard_expressions, hard_lower, hard_upper));
+  boost::shared_ptr<giskard::DiagonalQPSolver> solver(new giskard::DiagonalQPSolver());
+  solver->set_sweeps_per_iteration(5);
+  controller.set_solver(solver);
+  giskard::QPRecoveryOptions recovery;
+  recovery.enabled_ = false;
+  controller.set_recovery_options(recovery);
+
+  Eigen::VectorXd state(3);
+  using Eigen::operator<<;
+  state << 0.0, 0.0, 1.0;
+  ASSERT_TRUE(controller.start(state, nWSR));
+  EXPECT_EQ(giskard::QP_SOLVED, controller.get_solver().get_status());
+  EXPECT_LE(1, controller.get_solver().get_num_iterations());
+
+  state << 0.0, 2.0, 1.0;
+  EXPECT_FALSE(controller.update(state, nWSR));
+  EXPECT_EQ(giskard::QP_MAX_ITERATIONS_REACHED, controller.get_solver().get_status());
+  EXPECT_EQ(500, controller.get_solver().get_num_iterations());
+
+  state << 0.0, 0.0, 0.0;
+  EXPECT_FALSE(controller.update(state, nWSR));
+  EXPECT_EQ(giskard::QP_FAILED, controller.get_solver().get_status());
+
+  // a fresh start forgets the diverged multipliers
+  state << 0.0, 1.05, 1.0;
+  ASSERT_TRUE(controller.start(state, nWSR));
+  ASSERT_TRUE(controller.update(state, nWSR));
+  EXPECT_NEAR(0.05, controller.get_command()(0), 1e-9);
+
+  EXPECT_THROW(controller.get_working_set(), std::runtime_error);
+}
+
+TEST_F(DiagonalQPSolverTest, Infeasibility)
+{
+  using KDL::operator+;
+  using KDL::operator*;
+  std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
+      controllable_weights, soft_expressions, soft_lower, soft_upper, soft_weights,
+      hard_expressions, hard_lower, hard_upper;
+  std::vector<std::string> controllable_names, soft_names;
+
+  // the hard constraint has a zero row in A, so its value is always 0
+  controllable_lower.push_back(KDL::Constant(-0.1));
+  controllable_upper.push_back(KDL::input(2));
+  controllable_weights.push_back(KDL::Constant(1.0));
+  controllable_names.push_back("dof");
+  hard_expressions.push_back(KDL::Constant(0.0) * KDL::input(0));
+  hard_lower.push_back(KDL::input(1));
+  hard_upper.push_back(KDL::input(1) + KDL::Constant(1.0));
+
+  giskard::QPController controller;
+  ASSERT_TRUE(controller.init(controllable_lower, controllable_upper, controllable_weights,
+        controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights,
+        soft_names, hard_expressions, hard_lower, hard_upper));
+  controller.set_solver_type(giskard::DIAGONAL_SOLVER);
+  giskard::QPRecoveryOptions recovery;
+  recovery.enabled_ = false;
+  controller.set_recovery_options(recovery);
+
+  Eigen::VectorXd state(3);
+  using Eigen::operator<<;
+  state << 0.0, -0.5, 0.1;
+  ASSERT_TRUE(controller.start(state, nWSR));
+  EXPECT_EQ(giskard::QP_SOLVED, controller.get_solver().get_status());
+
+  state << 0.0, 0.5, 0.1;
+  EXPECT_FALSE(controller.update(state, nWSR));
+  EXPECT_EQ(giskard::QP_INFEASIBLE, controller.get_solver().get_status());
+  EXPECT_EQ(0, controller.get_solver().get_num_iterations());
+
+  // crossed bounds of a controllable
+  state << 0.0, -0.5, -0.2;
+  EXPECT_FALSE(controller.update(state, nWSR));
+  EXPECT_EQ(giskard::QP_INFEASIBLE, controller.get_solver().get_status());
+
+  // the iteration budget follows nWSR
+  boost::shared_ptr<giskard::DiagonalQPSolver> solver(new giskard::DiagonalQPSolver());
+  EXPECT_EQ(100, solver->get_sweeps_per_iteration());
+  solver->set_sweeps_per_iteration(0);
+  EXPECT_EQ(1, solver->get_sweeps_per_iteration());
+}
+
+TEST_F(DiagonalQPSolverTest, SolverBySize)
+{
+  YAML::Node node = YAML::LoadFile("pr2_qp_position_control.yaml");
+  giskard::QPController controller = giskard::generate(node.as<giskard::QPControllerSpec>());
+  size_t num_weights = controller.get_qp_builder().num_weights();
+
+  Eigen::VectorXd state(8);
+  using Eigen::operator<<;
+  state << 0.02, 0.0, 0.0, 0.0, -0.16, 0.0, -0.11, 0.0;
+
+  controller.set_solver_factory(giskard::QPSolverBySize(num_weights,
+        giskard::DIAGONAL_SOLVER, giskard::QPOASES_SOLVER));
+  ASSERT_TRUE(controller.start(state, nWSR));
+  EXPECT_EQ("diagonal", controller.get_solver().get_name());
+
+  controller.set_solver_factory(giskard::QPSolverBySize(num_weights - 1,
+        giskard::DIAGONAL_SOLVER, giskard::QPOASES_SOLVER));
+  ASSERT_TRUE(controller.start(state, nWSR));
+  EXPECT_EQ("qpOASES", controller.get_solver().get_name());
+}
@@ -246,3 +246,216 @@ TEST_F(ExpressionArrayTest, DerivativeExpressions)
   EXPECT_DOUBLE_EQ(deriv_exps[2]->value(), 6.0);
   EXPECT_DOUBLE_EQ(deriv_exps[3]->value(), 7.0);
 }
+
+TEST_F(ExpressionArrayTest, Clone)
+{
+  DoubleExpressionArray a;
+  a.set_expressions(exps);
+  a.update(vector_state);
+
+  DoubleExpressionArray b = a.clone();
+  ASSERT_EQ(a.num_expressions(), b.num_expressions());
+  EXPECT_EQ(a.num_inputs(), b.num_inputs());
+  for(size_t i=0; i<num_exps; ++i)
+  {
+    EXPECT_NE(a.get_expression(i), b.get_expression(i));
+    EXPECT_DOUBLE_EQ(a.get_values()(i), b.get_values()(i));
+  }
+
+  b.update(eigen_state);
+  EXPECT_DOUBLE_EQ(3.0, a.get_values()(0));
+  EXPECT_DOUBLE_EQ(7.0, a.get_values()(1));
+  EXPECT_DOUBLE_EQ(18.0, a.get_values()(2));
+  EXPECT_DOUBLE_EQ(3.0, exp1->value());
+  EXPECT_DOUBLE_EQ(6.0, b.get_values()(0));
+  EXPECT_DOUBLE_EQ(14.0, b.get_values()(1));
+  EXPECT_DOUBLE_EQ(36.0, b.get_values()(2));
+  EXPECT_DOUBLE_EQ(3.0, b.get_derivatives()(1, 3));
+  EXPECT_DOUBLE_EQ(7.0, b.get_derivatives()(2, 3));
+}
+
+TEST_F(ExpressionArrayTest, CloneSharedNodes)
+{
+  Expression<double>::Ptr shared_exp = KDL::shared<double>(KDL::input(0) * KDL::input(1));
+  std::vector< Expression<double>::Ptr > expressions;
+  expressions.push_back(shared_exp);
+  expressions.push_back(shared_exp);
+  expressions.push_back(exp1);
+
+  DoubleExpressionArray a, b;
+  a.set_expressions(expressions);
+  b.set_expressions(expressions);
+
+  // shared nodes are cloned once per memo
+  DoubleExpressionArray c = a.clone();
+  EXPECT_EQ(c.get_expression(0), c.get_expression(1));
+  EXPECT_NE(a.get_expression(0), c.get_expression(0));
+
+  KDL::ExpressionCloneMemo memo;
+  DoubleExpressionArray d = a.clone(memo);
+  DoubleExpressionArray e = b.clone(memo);
+  EXPECT_EQ(1, memo.size());
+  EXPECT_EQ(d.get_expression(0), e.get_expression(1));
+  EXPECT_NE(c.get_expression(0), d.get_expression(0));
+
+  d.update(eigen_state);
+  EXPECT_DOUBLE_EQ(eigen_state(0) * eigen_state(1), d.get_values()(0));
+  EXPECT_DOUBLE_EQ(eigen_state(1), d.get_derivatives()(1, 0));
+  EXPECT_DOUBLE_EQ(eigen_state(0), d.get_derivatives()(1, 1));
+}
+
+TEST_F(ExpressionArrayTest, DerivativeTarget)
+{
+  DoubleExpressionArray a;
+  a.set_expressions(exps);
+
+  ASSERT_EQ(2, a.get_dependencies(0).size());
+  EXPECT_EQ(0, a.get_dependencies(0)[0]);
+  EXPECT_EQ(1, a.get_dependencies(0)[1]);
+  ASSERT_EQ(2, a.get_dependencies(1).size());
+  EXPECT_EQ(3, a.get_dependencies(1)[0]);
+  EXPECT_EQ(4, a.get_dependencies(1)[1]);
+  ASSERT_EQ(3, a.get_dependencies(2).size());
+  EXPECT_EQ(1, a.get_dependencies(2)[0]);
+  EXPECT_EQ(2, a.get_dependencies(2)[1]);
+  EXPECT_EQ(3, a.get_dependencies(2)[2]);
+
+  // write into the middle rows of a bigger row-major matrix, skipping column 4
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> target =
+      Eigen::MatrixXd::Zero(num_exps + 2, num_derivs + 1);
+  target(0, 4) = 42.0;
+  target(num_exps + 1, num_derivs) = 42.0;
+  a.update(eigen_state, target.block(1, 0, num_exps, num_derivs - 1));
+
+  using Eigen::operator<<;
+  Eigen::MatrixXd expected(num_exps + 2, num_derivs + 1);
+  expected << 0, 0, 0, 0, 42, 0,
+              1, 2, 0, 0, 0, 0,
+              0, 0, 0, 3, 0, 0,
+              0, 5, 6, 7, 0, 0,
+              0, 0, 0, 0, 0, 42;
+  for(size_t i=0; i<expected.rows(); ++i)
+    for(size_t j=0; j<expected.cols(); ++j)
+      EXPECT_DOUBLE_EQ(expected(i, j), target(i, j));
+
+  EXPECT_DOUBLE_EQ(6.0, a.get_values()(0));
+  EXPECT_DOUBLE_EQ(14.0, a.get_values()(1));
+  EXPECT_DOUBLE_EQ(36.0, a.get_values()(2));
+}
+
+TEST_F(ExpressionArrayTest, TypedArrays)
+{
+  // planar arm with a prismatic and two revolute joints sharing the base frame
+  Expression<Frame>::Ptr base = cached<Frame>(frame(rot_z(input(0)),
+        vector(input(1), Constant(0.0), Constant(0.0))));
+  Expression<Frame>::Ptr tip = cached<Frame>(base * frame(rot_z(input(2)),
+        vector(Constant(1.0), Constant(0.0), Constant(0.0))));
+
+  std::vector< Expression<Frame>::Ptr > frames;
+  frames.push_back(base);
+  frames.push_back(tip);
+  FrameExpressionArray a;
+  a.set_expressions(frames);
+
+  VectorExpressionArray b;
+  b.push_expression(origin(tip));
+  RotationExpressionArray c;
+  c.push_expression(rotation(tip));
+
+  Eigen::VectorXd state(3);
+  using Eigen::operator<<;
+  state << M_PI / 2.0, 0.5, 0.0;
+  a.update(state);
+  b.update(state);
+  c.update(state);
+
+  ASSERT_EQ(2, a.get_values().size());
+  EXPECT_TRUE(Equal(Frame(Rotation::RotZ(M_PI / 2.0), Vector(0.5, 0.0, 0.0)), a.get_values()[0]));
+  EXPECT_TRUE(Equal(Frame(Rotation::RotZ(M_PI / 2.0), Vector(0.5, 1.0, 0.0)), a.get_values()[1]));
+  ASSERT_EQ(1, b.get_values().size());
+  EXPECT_TRUE(Equal(Vector(0.5, 1.0, 0.0), b.get_values()[0]));
+  ASSERT_EQ(1, c.get_values().size());
+  EXPECT_TRUE(Equal(Rotation::RotZ(M_PI / 2.0), c.get_values()[0]));
+
+  // stacked twist jacobians, translational velocity first
+  EXPECT_EQ(6, FrameExpressionArray::derivative_rows());
+  Eigen::MatrixXd jacobians(12, 3);
+  jacobians << 0, 1, 0,
+               0, 0, 0,
+               0, 0, 0,
+               0, 0, 0,
+               0, 0, 0,
+               1, 0, 0,
+              -1, 1, 0,
+               0, 0, 0,
+               0, 0, 0,
+               0, 0, 0,
+               0, 0, 0,
+               1, 0, 1;
+  ASSERT_EQ(jacobians.rows(), a.get_derivatives().rows());
+  ASSERT_EQ(jacobians.cols(), a.get_derivatives().cols());
+  for(size_t i=0; i<jacobians.rows(); ++i)
+    for(size_t j=0; j<jacobians.cols(); ++j)
+      EXPECT_NEAR(jacobians(i, j), a.get_derivatives()(i, j), 1e-12);
+
+  EXPECT_EQ(3, VectorExpressionArray::derivative_rows());
+  ASSERT_EQ(3, b.get_derivatives().rows());
+  for(size_t i=0; i<3; ++i)
+    for(size_t j=0; j<3; ++j)
+      EXPECT_NEAR(jacobians(6 + i, j), b.get_derivatives()(i, j), 1e-12);
+
+  EXPECT_EQ(3, RotationExpressionArray::derivative_rows());
+  ASSERT_EQ(3, c.get_derivatives().rows());
+  for(size_t i=0; i<3; ++i)
+    for(size_t j=0; j<3; ++j)
+      EXPECT_NEAR(jacobians(9 + i, j), c.get_derivatives()(i, j), 1e-12);
+}
+
+TEST_F(ExpressionArrayTest, SharedOptimizer)
+{
+  Expression<Frame>::Ptr base = shared<Frame>(cached<Frame>(frame(rot_z(input(0)),
+        vector(input(1), Constant(0.0), Constant(0.0)))));
+  Expression<Frame>::Ptr tip = shared<Frame>(cached<Frame>(base * frame(rot_z(input(2)),
+        vector(Constant(1.0), Constant(0.0), Constant(0.0)))));
+
+  FrameExpressionArray a;
+  a.push_expression(tip);
+  VectorExpressionArray b;
+  b.push_expression(origin(tip));
+  DoubleExpressionArray c;
+  c.set_expressions(exps);
+
+  ExpressionArrayOptimizer optimizer;
+  optimizer.add(a.get_expressions());
+  optimizer.add(b.get_expressions());
+  optimizer.add(c.get_expressions());
+  EXPECT_EQ(5, optimizer.num_inputs());
+  EXPECT_THROW(optimizer.set_inputs(Eigen::VectorXd::Zero(3)), std::invalid_argument);
+
+  Eigen::VectorXd state(5);
+  using Eigen::operator<<;
+  state << M_PI / 2.0, 0.5, 0.0, 1.0, 2.0;
+  optimizer.set_inputs(state);
+  a.read();
+  b.read();
+  c.read();
+
+  ASSERT_EQ(1, a.get_values().size());
+  EXPECT_TRUE(Equal(Frame(Rotation::RotZ(M_PI / 2.0), Vector(0.5, 1.0, 0.0)), a.get_values()[0]));
+  ASSERT_EQ(1, b.get_values().size());
+  EXPECT_TRUE(Equal(Vector(0.5, 1.0, 0.0), b.get_values()[0]));
+  EXPECT_NEAR(-1.0, b.get_derivatives()(0, 0), 1e-12);
+
+  ASSERT_EQ(3, c.get_values().size());
+  EXPECT_DOUBLE_EQ(M_PI / 2.0 + 1.0, c.get_values()(0));
+  EXPECT_DOUBLE_EQ(11.0, c.get_values()(1));
+  EXPECT_DOUBLE_EQ(9.5, c.get_values()(2));
+  EXPECT_DOUBLE_EQ(2.0, c.get_derivatives()(0, 1));
+
+  // the same values as with the own optimizers of the arrays
+  DoubleExpressionArray d;
+  d.set_expressions(exps);
+  d.update(state);
+  for(size_t i=0; i<3; ++i)
+    EXPECT_DOUBLE_EQ(d.get_values()(i), c.get_values()(i));
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+
+class FixedSizeQPControllerTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      nWSR = 10;
+      YAML::Node node = YAML::LoadFile("flying_cup_approach_motion.yaml");
+      spec = node.as<giskard::QPControllerSpec>();
+    }
+
+    virtual void TearDown(){}
+
+    int nWSR;
+    giskard::QPControllerSpec spec;
+};
+
+TEST_F(FixedSizeQPControllerTest, FlyingCup)
+{
+  EXPECT_TRUE((giskard::has_fixed_size<6, 2, 0>(spec)));
+  giskard::QPController reference = giskard::generate(spec);
+  giskard::FixedSizeQPController<6, 2, 0> controller = giskard::generate_fixed_size<6, 2, 0>(spec);
+
+  EXPECT_EQ(8, controller.get_qp_builder().num_weights());
+  EXPECT_EQ(2, controller.get_qp_builder().num_constraints());
+  EXPECT_EQ(12, controller.get_qp_builder().num_observables());
+  ASSERT_EQ(reference.get_controllable_names(), controller.get_controllable_names());
+  ASSERT_EQ(reference.get_soft_constraint_names(), controller.get_soft_constraint_names());
+
+  Eigen::VectorXd state(12);
+  using Eigen::operator<<;
+  state << 0.2, 0.1, 1.855, 0.01, 0.01, 0, 0.3, 0.4, 0.89, 0, 0, 0;
+
+  ASSERT_TRUE(reference.start(state, nWSR));
+  ASSERT_TRUE(controller.start(state, nWSR));
+  for(size_t i=0; i<50; ++i)
+  {
+    ASSERT_TRUE(reference.update(state, nWSR));
+    // any contiguous vector will do
+    ASSERT_TRUE(controller.update(Eigen::Map<const Eigen::VectorXd>(state.data(), state.rows()), nWSR));
+
+    const giskard::QPProblemBuilder& reference_builder = reference.get_qp_builder();
+    for(size_t j=0; j<8; ++j)
+      for(size_t k=0; k<8; ++k)
+        EXPECT_DOUBLE_EQ(reference_builder.get_H()(j,k), controller.get_qp_builder().get_H()(j,k));
+    for(size_t j=0; j<2; ++j)
+    {
+      for(size_t k=0; k<8; ++k)
+        EXPECT_DOUBLE_EQ(reference_builder.get_A()(j,k), controller.get_qp_builder().get_A()(j,k));
+      EXPECT_DOUBLE_EQ(reference_builder.get_lbA()(j), controller.get_qp_builder().get_lbA()(j));
+      EXPECT_DOUBLE_EQ(reference_builder.get_ubA()(j), controller.get_qp_builder().get_ubA()(j));
+    }
+
+    for(size_t j=0; j<6; ++j)
+      EXPECT_NEAR(reference.get_command()(j), controller.get_command()(j), 1e-9);
+    for(size_t j=0; j<2; ++j)
+      EXPECT_NEAR(reference.get_slack()(j), controller.get_slack()(j), 1e-9);
+
+    state.segment(0, 6) += 0.01 * controller.get_command();
+  }
+}
+
+TEST_F(FixedSizeQPControllerTest, WrongSizes)
+{
+  EXPECT_FALSE((giskard::has_fixed_size<6, 2, 1>(spec)));
+  EXPECT_THROW((giskard::generate_fixed_size<6, 2, 1>(spec)), std::invalid_argument);
+  EXPECT_THROW((giskard::generate_fixed_size<5, 2, 0>(spec)), std::invalid_argument);
+
+  giskard::FixedSizeQPController<6, 2, 0> controller = giskard::generate_fixed_size<6, 2, 0>(spec);
+  EXPECT_THROW(controller.start(Eigen::VectorXd::Zero(11), nWSR), std::invalid_argument);
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+
+class HorizonQPControllerTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      using KDL::operator-;
+      for(size_t i=0; i<2; ++i)
+      {
+        KDL::Expression<double>::Ptr exp = KDL::cached<double>(KDL::input(i));
+        controllable_lower.push_back(KDL::Constant(-0.1));
+        controllable_upper.push_back(KDL::Constant(0.1));
+        controllable_weights.push_back(KDL::Constant(0.1));
+        controllable_names.push_back("dof " + boost::lexical_cast<std::string>(i));
+
+        soft_expressions.push_back(exp);
+        soft_lower.push_back(KDL::Constant(0.9) - exp);
+        soft_upper.push_back(KDL::Constant(1.0) - exp);
+        soft_weights.push_back(KDL::Constant(10.0));
+        soft_names.push_back("dof " + boost::lexical_cast<std::string>(i) + " goal");
+      }
+
+      // the first dof may not run ahead of the second one by more than 0.02
+      hard_expressions.push_back(KDL::input(0) - KDL::input(1));
+      hard_lower.push_back(KDL::Constant(-1.0));
+      hard_upper.push_back(KDL::Constant(0.02) - (KDL::input(0) - KDL::input(1)));
+
+      // third observable is not controllable
+      state = Eigen::VectorXd::Zero(3);
+      state(1) = 0.5;
+      state(2) = 42.0;
+
+      options.dt_ = 0.5;
+    }
+
+    virtual void TearDown(){}
+
+    template<typename ControllerType>
+    void init(ControllerType& controller)
+    {
+      ASSERT_TRUE(controller.init(controllable_lower, controllable_upper, controllable_weights,
+            controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights,
+            soft_names, hard_expressions, hard_lower, hard_upper));
+    }
+
+    std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
+        controllable_weights, soft_expressions, soft_lower, soft_upper, soft_weights,
+        hard_expressions, hard_lower, hard_upper;
+    std::vector<std::string> soft_names, controllable_names;
+    giskard::HorizonOptions options;
+    Eigen::VectorXd state;
+};
+
+TEST_F(HorizonQPControllerTest, SingleStageMatchesQPController)
+{
+  giskard::QPController reference;
+  init(reference);
+  reference.set_solver_type(giskard::DIAGONAL_SOLVER);
+
+  options.num_stages_ = 1;
+  // much tighter than the default, to match the exact solution of an active set solver
+  options.tolerance_ = 1e-12;
+  giskard::HorizonQPController controller;
+  controller.set_options(options);
+  init(controller);
+
+  ASSERT_TRUE(reference.start(state, 100));
+  ASSERT_TRUE(controller.start(state));
+  for(size_t i=0; i<20; ++i)
+  {
+    ASSERT_TRUE(reference.update(state, 100));
+    ASSERT_TRUE(controller.update(state));
+    ASSERT_EQ(2, controller.get_command().rows());
+    // interior point iterates approach weakly active constraints only up to
+    // about the square root of the tolerance
+    for(size_t j=0; j<2; ++j)
+    {
+      EXPECT_NEAR(reference.get_command()(j), controller.get_command()(j), 1e-5);
+      EXPECT_NEAR(reference.get_slack()(j), controller.get_stage_slack(0)(j), 1e-5);
+    }
+
+    state.head(2) += options.dt_ * controller.get_command();
+  }
+}
+
+TEST_F(HorizonQPControllerTest, PlanFulfillsConstraints)
+{
+  options.num_stages_ = 30;
+  giskard::HorizonQPController controller;
+  controller.set_options(options);
+  init(controller);
+
+  ASSERT_TRUE(controller.start(state));
+  EXPECT_EQ(giskard::QP_SOLVED, controller.get_solver().get_status());
+  ASSERT_EQ(30, controller.get_stages().size());
+  EXPECT_EQ(30, controller.get_solver().num_stages());
+  EXPECT_EQ(2, controller.num_observables());
+
+  for(size_t k=0; k<options.num_stages_; ++k)
+  {
+    Eigen::VectorXd command = controller.get_stage_command(k);
+    const Eigen::VectorXd& displacement = controller.get_predicted_displacement(k);
+    for(size_t j=0; j<2; ++j)
+    {
+      EXPECT_LE(-0.1 - 1e-6, command(j));
+      EXPECT_LE(command(j), 0.1 + 1e-6);
+      EXPECT_NEAR(displacement(j) + options.dt_ * command(j),
+          controller.get_predicted_displacement(k + 1)(j), 1e-9);
+    }
+
+    double lead = state(0) + displacement(0) - state(1) - displacement(1);
+    EXPECT_LE(command(0) - command(1), 0.02 - lead + 1e-6);
+  }
+
+  // the plan ends close to the goal of both dofs
+  const Eigen::VectorXd& final_displacement = controller.get_predicted_displacement(options.num_stages_);
+  for(size_t j=0; j<2; ++j)
+  {
+    EXPECT_LE(0.9 - 1e-2, state(j) + final_displacement(j));
+    EXPECT_LE(state(j) + final_displacement(j), 1.0 + 1e-2);
+  }
+}
+
+TEST_F(HorizonQPControllerTest, RecedingHorizonConverges)
+{
+  options.num_stages_ = 10;
+  giskard::HorizonQPController controller;
+  controller.set_options(options);
+  init(controller);
+
+  ASSERT_TRUE(controller.start(state));
+  for(size_t i=0; i<40; ++i)
+  {
+    ASSERT_TRUE(controller.update(state));
+    EXPECT_LE(controller.get_cycle_timings().evaluation_seconds_, 1.0);
+    state.head(2) += options.dt_ * controller.get_command();
+    EXPECT_LE(state(0) - state(1), 0.02 + 1e-6);
+  }
+
+  for(size_t j=0; j<2; ++j)
+  {
+    EXPECT_LE(0.9 - 1e-4, state(j));
+    EXPECT_LE(state(j), 1.0 + 1e-4);
+  }
+  EXPECT_DOUBLE_EQ(42.0, state(2));
+}
+
+TEST_F(HorizonQPControllerTest, InvalidOptions)
+{
+  giskard::HorizonQPController controller;
+  options.num_stages_ = 0;
+  EXPECT_ANY_THROW(controller.set_options(options));
+
+  options.num_stages_ = 5;
+  options.dt_ = 0.0;
+  EXPECT_ANY_THROW(controller.set_options(options));
+}
+
+TEST_F(HorizonQPControllerTest, TooFewObservables)
+{
+  giskard::HorizonQPController controller;
+  init(controller);
+  EXPECT_ANY_THROW(controller.start(Eigen::VectorXd::Zero(1)));
+}
+
+TEST_F(HorizonQPControllerTest, LargeBoundsConverge)
+{
+  // three inputs per stage with lower bounds of up to 1e4 and loose limits on
+  // the states, i.e. the lower bounds are active at the optimum
+  size_t n = 3, m = 3;
+  std::srand(1);
+  std::vector<giskard::HorizonStage> stages(10);
+  std::vector<Eigen::VectorXd> lower(stages.size());
+  for(size_t k=0; k<stages.size(); ++k)
+  {
+    lower[k] = 1e4 * Eigen::VectorXd::Random(m).cwiseAbs();
+    stages[k].r_ = Eigen::VectorXd::Random(m).cwiseAbs() + Eigen::VectorXd::Constant(m, 0.1);
+    stages[k].C_ = Eigen::MatrixXd::Zero(2*m + n, n);
+    stages[k].C_.bottomRows(n).setIdentity();
+    stages[k].D_ = Eigen::MatrixXd::Zero(2*m + n, m);
+    stages[k].D_.topRows(m).setIdentity();
+    stages[k].D_.middleRows(m, m) = -Eigen::MatrixXd::Identity(m, m);
+    stages[k].d_.resize(2*m + n);
+    stages[k].d_ << lower[k] + Eigen::VectorXd::Constant(m, 1e4), -lower[k],
+        Eigen::VectorXd::Constant(n, 5e4);
+  }
+
+  // the tolerance is relative to the bounds, so iterations do not chase
+  // residuals below the round-off of the data
+  giskard::RiccatiQPSolver solver;
+  ASSERT_TRUE(solver.solve(stages, Eigen::MatrixXd::Identity(n, m)));
+  EXPECT_LT(solver.get_num_iterations(), solver.get_max_iterations());
+  for(size_t k=0; k<stages.size(); ++k)
+    for(size_t i=0; i<m; ++i)
+      EXPECT_NEAR(lower[k](i), solver.get_inputs(k)(i), 1e-3);
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+#include <giskard/parallel_generation.hpp>
+
+class ParallelGenerationTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      spec = YAML::LoadFile("pr2_qp_position_control.yaml").as<giskard::QPControllerSpec>();
+
+      state.push_back(0.02);
+      state.push_back(0.1);
+      state.push_back(-0.2);
+      state.push_back(0.3);
+      state.push_back(-0.16);
+      state.push_back(0.4);
+      state.push_back(-0.11);
+      state.push_back(0.5);
+    }
+
+    virtual void TearDown(){}
+
+    giskard::QPControllerSpec spec;
+    std::vector<double> state;
+};
+
+TEST_F(ParallelGenerationTest, Plan)
+{
+  giskard::ScopeGenerationPlan plan(spec.scope_);
+  ASSERT_TRUE(plan.is_valid());
+
+  std::map<std::string, size_t> wave_of;
+  size_t num_entries = 0;
+  for(size_t i=0; i<plan.get_waves().size(); ++i)
+    for(size_t j=0; j<plan.get_waves()[i].size(); ++j)
+    {
+      wave_of[spec.scope_[plan.get_waves()[i][j]].name] = i;
+      ++num_entries;
+    }
+
+  EXPECT_EQ(spec.scope_.size(), num_entries);
+  EXPECT_LT(plan.get_waves().size(), spec.scope_.size());
+
+  // independent entries share the first wave
+  EXPECT_EQ(0, wave_of["unit_x"]);
+  EXPECT_EQ(0, wave_of["torso_lift_joint"]);
+  EXPECT_EQ(0, wave_of["l_wrist_roll_joint"]);
+
+  // entries come after everything they reference
+  EXPECT_LT(wave_of["torso_lift"], wave_of["pr2_fk"]);
+  EXPECT_LT(wave_of["l_wrist_roll"], wave_of["pr2_fk"]);
+  EXPECT_LT(wave_of["pr2_fk"], wave_of["pr2_fk_pos"]);
+  EXPECT_LT(wave_of["pr2_fk_error"], wave_of["pr2_fk_control_law"]);
+
+  // unit_x is used by several joint transforms which end up in different waves
+  EXPECT_NE(wave_of["torso_lift"], wave_of["l_upper_arm_roll"]);
+}
+
+TEST_F(ParallelGenerationTest, SameResultAsSequential)
+{
+  giskard::Scope s1 = giskard::generate(spec.scope_);
+
+  for(size_t num_threads=1; num_threads<=4; ++num_threads)
+  {
+    ASSERT_NO_THROW(giskard::generate(spec.scope_, num_threads));
+    giskard::Scope s2 = giskard::generate(spec.scope_, num_threads);
+
+    KDL::Expression<KDL::Frame>::Ptr f1 = s1.find_frame_expression("pr2_fk");
+    KDL::Expression<KDL::Frame>::Ptr f2 = s2.find_frame_expression("pr2_fk");
+    f1->setInputValues(state);
+    f2->setInputValues(state);
+    EXPECT_TRUE(KDL::Equal(f1->value(), f2->value()));
+
+    KDL::Expression<double>::Ptr e1 = s1.find_double_expression("pr2_fk_control_law");
+    KDL::Expression<double>::Ptr e2 = s2.find_double_expression("pr2_fk_control_law");
+    e1->setInputValues(state);
+    e2->setInputValues(state);
+    EXPECT_DOUBLE_EQ(e1->value(), e2->value());
+    for(size_t i=0; i<state.size(); ++i)
+      EXPECT_DOUBLE_EQ(e1->derivative(i), e2->derivative(i));
+  }
+}
+
+TEST_F(ParallelGenerationTest, ReusedGenerator)
+{
+  giskard::ParallelScopeGenerator generator(3);
+  EXPECT_EQ(3, generator.get_num_threads());
+
+  for(size_t i=0; i<3; ++i)
+  {
+    giskard::Scope scope = generator.generate(spec.scope_);
+    EXPECT_TRUE(scope.has_double_expression("pr2_fk_control_law"));
+  }
+
+  ASSERT_NO_THROW(giskard::generate(spec, 3));
+}
+
+TEST_F(ParallelGenerationTest, Errors)
+{
+  giskard::ScopeSpec unknown = spec.scope_;
+  unknown[unknown.size() - 1].spec = 
+      YAML::Load("{double-mul: [-10.0, not_defined]}").as<giskard::SpecPtr>();
+  EXPECT_FALSE(giskard::ScopeGenerationPlan(unknown).is_valid());
+  EXPECT_THROW(giskard::generate(unknown, 4), std::invalid_argument);
+
+  giskard::ScopeSpec duplicate = spec.scope_;
+  duplicate.push_back(duplicate[0]);
+  EXPECT_FALSE(giskard::ScopeGenerationPlan(duplicate).is_valid());
+  EXPECT_THROW(giskard::generate(duplicate, 4), std::invalid_argument);
+}
@@ -23,6 +23,7 @@
 #include <urdf/model.h>
 #include <kdl_parser/kdl_parser.hpp>
 #include <kdl/chainfksolverpos_recursive.hpp>
+#include <kdl/treefksolverpos_recursive.hpp>
 
 class PR2FKTest : public ::testing::Test
 {
@@ -231,6 +232,102 @@ TEST_F(PR2FKTest, CamToBase)
   TestFrameExpression(exp, tip, base);
 }
 
+TEST_F(PR2FKTest, DirectFromTree)
+{
+  std::string base = "base_link";
+  std::string tip = "l_wrist_roll_link";
+
+  ASSERT_NO_THROW(giskard::ExpressionExtractor::extract_scope(base, tip, tree));
+  giskard::ScopeSpec scope_spec = giskard::ExpressionExtractor::extract_scope(base, tip, tree);
+
+  // same specification as the YAML round trip
+  giskard::ScopeSpec yaml_spec = 
+      giskard::extract_expression(base, tip, tree).as<giskard::ScopeSpec>();
+  ASSERT_EQ(yaml_spec.size(), scope_spec.size());
+  for(size_t i=0; i<yaml_spec.size(); ++i)
+  {
+    EXPECT_STREQ(yaml_spec[i].name.c_str(), scope_spec[i].name.c_str());
+    EXPECT_TRUE(*(yaml_spec[i].spec) == *(scope_spec[i].spec));
+  }
+
+  TestFrameExpression(giskard::ExpressionExtractor::extract_fk(base, tip, tree), base, tip);
+}
+
+TEST_F(PR2FKTest, DirectFromUrdf)
+{
+  urdf::Model urdf;
+  ASSERT_TRUE(urdf.initFile("pr2.urdf"));
+
+  std::string base = "l_forearm_cam_frame";
+  std::string tip = "base_link";
+  ASSERT_NO_THROW(giskard::ExpressionExtractor::extract_fk(tip, base, urdf));
+  TestFrameExpression(giskard::ExpressionExtractor::extract_fk(tip, base, urdf), tip, base);
+
+  EXPECT_THROW(giskard::ExpressionExtractor::extract_scope("base_link", "no_link", urdf), 
+      giskard::InvalidChain);
+}
+
+TEST_F(PR2FKTest, WholeTree)
+{
+  std::vector<std::string> tips;
+  tips.push_back("l_wrist_roll_link");
+  tips.push_back("r_wrist_roll_link");
+  tips.push_back("head_mount_kinect_rgb_optical_frame");
+  tips.push_back("torso_lift_link");
+
+  ASSERT_NO_THROW(giskard::ExpressionExtractor::extract_scope(tree, tips));
+  giskard::ScopeSpec scope_spec = giskard::ExpressionExtractor::extract_scope(tree, tips);
+
+  // every link frame is defined once, shared prefixes are cached
+  size_t num_frames = 0, num_cached = 0;
+  for(size_t i=0; i<scope_spec.size(); ++i)
+    if(scope_spec[i].spec->get_category() == giskard::FRAME_SPEC)
+    {
+      ++num_frames;
+      if(scope_spec[i].spec->get_type() == giskard::FRAME_CACHED_SPEC)
+        ++num_cached;
+    }
+  EXPECT_EQ(1, num_cached);
+  EXPECT_GT(tree.getNrOfSegments(), num_frames);
+
+  giskard::Scope scope = giskard::generate(scope_spec);
+
+  // map the inputs of the scope to the joint numbers of the tree
+  std::map<std::string, unsigned int> q_nr;
+  const KDL::SegmentMap& segments = tree.getSegments();
+  for(KDL::SegmentMap::const_iterator it=segments.begin(); it!=segments.end(); ++it)
+    q_nr[it->second.segment.getJoint().getName() + "_var"] = it->second.q_nr;
+
+  KDL::TreeFkSolverPos_recursive fk_solver(tree);
+  for(int i=0; i<5; ++i)
+  {
+    KDL::JntArray solver_in(tree.getNrOfJoints());
+    std::vector<double> exp_in;
+    for(size_t j=0; j<scope_spec.size(); ++j)
+      if(scope_spec[j].spec->get_type() == giskard::DOUBLE_INPUT_SPEC)
+      {
+        double value = 0.1 * i + 0.01 * j;
+        exp_in.push_back(value);
+        ASSERT_EQ(1, q_nr.count(scope_spec[j].name));
+        solver_in(q_nr[scope_spec[j].name]) = value;
+      }
+
+    for(size_t j=0; j<tips.size(); ++j)
+    {
+      ASSERT_TRUE(scope.has_frame_expression(tips[j] + "_frame"));
+      KDL::Expression<KDL::Frame>::Ptr exp = scope.find_frame_expression(tips[j] + "_frame");
+      exp->setInputValues(exp_in);
+
+      KDL::Frame solver_frame;
+      ASSERT_GE(fk_solver.JntToCart(solver_in, solver_frame, tips[j]), 0);
+      EXPECT_TRUE(KDL::Equal(exp->value(), solver_frame));
+    }
+  }
+
+  tips.push_back("no_link");
+  EXPECT_THROW(giskard::ExpressionExtractor::extract_scope(tree, tips), giskard::InvalidChain);
+}
+
 TEST_F(PR2FKTest, QPPositionControl)
 {
   YAML::Node node = YAML::LoadFile("pr2_qp_position_control.yaml");
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+
+class QPCascadeTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      // reaching 0.5 with dof a is more important than holding it at 0
+      std::string s = "scope: [{a: {input-var: 0}}, {b: {input-var: 1}}]\n"
+          "controllable-constraints: [{controllable-constraint: [-1.0, 1.0, 0.01, 0, dof a]}, "
+          "{controllable-constraint: [-1.0, 1.0, 0.01, 1, dof b]}]\n"
+          "soft-constraints: [{soft-constraint: [{double-sub: [0.5, a]}, {double-sub: [0.5, a]}, 1.0, a, reach]}, "
+          "{soft-constraint: [{double-sub: [a]}, {double-sub: [a]}, 1.0, a, hold, 1]}, "
+          "{soft-constraint: [0.3, 0.3, 1.0, b, move, 1]}]\n"
+          "hard-constraints: []";
+      spec = YAML::Load(s).as<giskard::QPControllerSpec>();
+      state = Eigen::VectorXd::Zero(2);
+      nWSR = 100;
+    }
+
+    virtual void TearDown(){}
+
+    void check_strict_priorities(giskard::QPController& controller)
+    {
+      EXPECT_TRUE(controller.has_priority_levels());
+      ASSERT_EQ(2, controller.get_cascade().num_levels());
+      ASSERT_EQ(1, controller.get_cascade().get_soft_constraints(0).size());
+      ASSERT_EQ(2, controller.get_cascade().get_soft_constraints(1).size());
+      EXPECT_EQ(1, controller.get_cascade().get_builder(1).num_hard_constraints());
+      EXPECT_EQ(2, controller.get_cascade().get_builder(1).num_soft_constraints());
+
+      ASSERT_TRUE(controller.start(state, nWSR));
+      ASSERT_TRUE(controller.update(state, nWSR));
+
+      // holding dof a does not pull against reaching, moving dof b is free
+      EXPECT_NEAR(0.5 / 1.01, controller.get_command()(0), 1e-6);
+      EXPECT_NEAR(0.3 / 1.01, controller.get_command()(1), 1e-6);
+      ASSERT_EQ(3, controller.get_slack().rows());
+      EXPECT_NEAR(0.5 - 0.5 / 1.01, controller.get_slack()(0), 1e-6);
+      EXPECT_NEAR(-0.5 / 1.01, controller.get_slack()(1), 1e-6);
+      EXPECT_NEAR(0.3 - 0.3 / 1.01, controller.get_slack()(2), 1e-6);
+    }
+
+    giskard::QPControllerSpec spec;
+    Eigen::VectorXd state;
+    int nWSR;
+};
+
+TEST_F(QPCascadeTest, StrictPriorities)
+{
+  giskard::QPController controller = giskard::generate(spec);
+  check_strict_priorities(controller);
+}
+
+TEST_F(QPCascadeTest, StrictPrioritiesDiagonalSolver)
+{
+  giskard::QPController controller = giskard::generate(spec);
+  controller.set_solver_type(giskard::DIAGONAL_SOLVER);
+  EXPECT_EQ("diagonal", controller.get_cascade().get_solver(0).get_name());
+  EXPECT_EQ("diagonal", controller.get_cascade().get_solver(1).get_name());
+  check_strict_priorities(controller);
+}
+
+TEST_F(QPCascadeTest, WeightsTradeOff)
+{
+  giskard::QPController controller = giskard::generate(spec);
+  controller.set_soft_priorities(std::vector<size_t>(3, 0));
+  EXPECT_FALSE(controller.has_priority_levels());
+
+  ASSERT_TRUE(controller.start(state, nWSR));
+  EXPECT_NEAR(0.5 / 2.01, controller.get_command()(0), 1e-6);
+  EXPECT_NEAR(0.3 / 1.01, controller.get_command()(1), 1e-6);
+}
+
+TEST_F(QPCascadeTest, Hotstart)
+{
+  giskard::QPController controller = giskard::generate(spec);
+  controller.set_solver_type(giskard::DIAGONAL_SOLVER);
+  ASSERT_TRUE(controller.start(state, nWSR));
+
+  for(size_t i=0; i<20; ++i)
+  {
+    ASSERT_TRUE(controller.update(state, nWSR));
+    EXPECT_LE(0, controller.get_num_working_set_recalculations());
+    EXPECT_EQ(giskard::QP_SOLVED, controller.get_solver_status());
+    state += 0.5 * controller.get_command();
+
+    giskard::QPController copy = controller.clone();
+    ASSERT_TRUE(copy.update(state, nWSR));
+    ASSERT_TRUE(controller.update(state, nWSR));
+    for(size_t j=0; j<2; ++j)
+      EXPECT_NEAR(controller.get_command()(j), copy.get_command()(j), 1e-9);
+  }
+
+  // dof a converges to the goal of the higher level
+  EXPECT_NEAR(0.5, state(0), 1e-2);
+}
+
+TEST_F(QPCascadeTest, Recovery)
+{
+  // the third observable prescribes the velocity of dof a, beyond its limits
+  // the QP of every level becomes infeasible
+  std::string s = "scope: [{a: {input-var: 0}}, {b: {input-var: 1}}, {c: {input-var: 2}}]\n"
+      "controllable-constraints: [{controllable-constraint: [-1.0, 1.0, 0.01, 0, dof a]}, "
+      "{controllable-constraint: [-1.0, 1.0, 0.01, 1, dof b]}]\n"
+      "soft-constraints: [{soft-constraint: [-0.1, 0.1, 1.0, a, hold]}, "
+      "{soft-constraint: [0.3, 0.3, 1.0, b, move, 1]}]\n"
+      "hard-constraints: [{hard-constraint: [c, c, a]}]";
+  spec = YAML::Load(s).as<giskard::QPControllerSpec>();
+
+  giskard::QPController controller = giskard::generate(spec);
+  ASSERT_TRUE(controller.has_priority_levels());
+  Eigen::VectorXd feasible = Eigen::VectorXd::Zero(3);
+  Eigen::VectorXd infeasible = feasible;
+  infeasible(2) = 2.0;
+
+  ASSERT_TRUE(controller.start(feasible, nWSR));
+  ASSERT_TRUE(controller.update(feasible, nWSR));
+  EXPECT_LT(0.0, controller.get_command()(1));
+
+  // a failed cascade serves the safe command like a failed single QP
+  EXPECT_FALSE(controller.update(infeasible, nWSR));
+  EXPECT_NE(giskard::QP_SOLVED, controller.get_solver_status());
+  EXPECT_DOUBLE_EQ(0.0, controller.get_command()(0));
+  EXPECT_DOUBLE_EQ(0.0, controller.get_command()(1));
+  const giskard::QPRecoveryStatistics& statistics = controller.get_recovery_statistics();
+  EXPECT_EQ(1, statistics.num_failures_);
+  EXPECT_EQ(1, statistics.num_retries_);
+  EXPECT_EQ(0, statistics.num_retry_successes_);
+  EXPECT_EQ(1, statistics.num_safe_commands_);
+
+  ASSERT_TRUE(controller.update(feasible, nWSR));
+  EXPECT_LT(0.0, controller.get_command()(1));
+
+  giskard::QPRecoveryOptions options;
+  options.enabled_ = false;
+  controller.set_recovery_options(options);
+  EXPECT_FALSE(controller.update(infeasible, nWSR));
+  EXPECT_EQ(1, controller.get_recovery_statistics().num_failures_);
+  EXPECT_EQ(1, controller.get_recovery_statistics().num_safe_commands_);
+}
+
+TEST_F(QPCascadeTest, Errors)
+{
+  giskard::QPController controller = giskard::generate(spec);
+  EXPECT_THROW(controller.set_soft_priorities(std::vector<size_t>(2, 0)), std::invalid_argument);
+  EXPECT_THROW(controller.get_working_set(), std::runtime_error);
+
+  EXPECT_THROW(controller.start(state, nWSR, giskard::QPWorkingSet()), std::runtime_error);
+  EXPECT_THROW((giskard::generate_fixed_size<2, 3, 0>(spec)), std::invalid_argument);
+
+  spec.soft_constraints_[1].priority_ = 0;
+  spec.soft_constraints_[2].priority_ = 0;
+  EXPECT_NO_THROW((giskard::generate_fixed_size<2, 3, 0>(spec)));
+}
@@ -20,6 +20,7 @@
 
 #include <gtest/gtest.h>
 #include <giskard/giskard.hpp>
+#include <sstream>
 
 class QPControllerTest : public ::testing::Test
 {
@@ -144,3 +145,322 @@ TEST_F(QPControllerTest, Update)
    for(size_t i=0; i<hard_upper.size(); ++i)
      EXPECT_LE(0.0, hard_upper[i]->value());
 }
+
+TEST_F(QPControllerTest, Clone)
+{
+   giskard::QPController c;
+   ASSERT_TRUE(c.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+   ASSERT_TRUE(c.start(initial_state, nWSR));
+
+   giskard::QPController d = c.clone();
+   EXPECT_EQ(c.get_controllable_names(), d.get_controllable_names());
+   EXPECT_EQ(c.get_soft_constraint_names(), d.get_soft_constraint_names());
+   ASSERT_EQ(c.get_qp_builder().get_soft_expressions().size(),
+       d.get_qp_builder().get_soft_expressions().size());
+   for(size_t i=0; i<c.get_qp_builder().get_soft_expressions().size(); ++i)
+     EXPECT_NE(c.get_qp_builder().get_soft_expressions()[i],
+         d.get_qp_builder().get_soft_expressions()[i]);
+
+   // interleave updates of original and clone with different states
+   Eigen::VectorXd state_c = initial_state;
+   Eigen::VectorXd state_d = initial_state;
+   state_d(0) += 0.5;
+   for(size_t i=0; i<36; ++i)
+   {
+     ASSERT_TRUE(c.update(state_c, nWSR));
+     ASSERT_TRUE(d.update(state_d, nWSR));
+     state_c += c.get_command();
+     state_d += d.get_command();
+   }
+
+   // the original's expressions only ever saw the original's states
+   for(size_t i=0; i<soft_lower.size(); ++i)
+     EXPECT_LE(soft_lower[i]->value(), 0.0);
+   for(size_t i=0; i<soft_upper.size(); ++i)
+     EXPECT_LE(0.0, soft_upper[i]->value());
+   EXPECT_DOUBLE_EQ(state_c(0), soft_expressions[0]->value());
+   EXPECT_DOUBLE_EQ(state_c(1), soft_expressions[1]->value());
+
+   // ...and the clone's expressions only ever saw the clone's states
+   EXPECT_DOUBLE_EQ(state_d(0), d.get_qp_builder().get_soft_expressions()[0]->value());
+   EXPECT_DOUBLE_EQ(state_d(1), d.get_qp_builder().get_soft_expressions()[1]->value());
+}
+
+class QPControllerRecoveryTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
+          controllable_weights, soft_expressions, soft_lower, soft_upper, soft_weights,
+          hard_expressions, hard_lower, hard_upper;
+      std::vector<std::string> soft_names, controllable_names;
+
+      using KDL::operator-;
+      using KDL::operator+;
+      KDL::Expression<double>::Ptr exp = KDL::cached<double>(KDL::input(0));
+      controllable_lower.push_back(KDL::Constant(-0.1));
+      controllable_upper.push_back(KDL::Constant(0.1));
+      controllable_weights.push_back(KDL::Constant(0.1));
+      controllable_names.push_back("dof");
+
+      soft_expressions.push_back(exp);
+      soft_lower.push_back(KDL::Constant(1.0) - exp);
+      soft_upper.push_back(KDL::Constant(1.0) - exp);
+      soft_weights.push_back(KDL::Constant(10.0));
+      soft_names.push_back("dof goal");
+
+      // the second observable shifts the hard constraint: for values bigger
+      // than the velocity limit of the dof the QP becomes infeasible
+      hard_expressions.push_back(exp);
+      hard_lower.push_back(KDL::input(1) - KDL::Constant(1.0));
+      hard_upper.push_back(KDL::input(1) + KDL::Constant(1.0));
+
+      ASSERT_TRUE(controller.init(controllable_lower, controllable_upper, controllable_weights,
+            controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights,
+            soft_names, hard_expressions, hard_lower, hard_upper));
+
+      feasible = Eigen::VectorXd::Zero(2);
+      infeasible = Eigen::VectorXd::Zero(2);
+      infeasible(1) = 2.0;
+      nWSR = 100;
+    }
+
+    virtual void TearDown(){}
+
+    giskard::QPController controller;
+    Eigen::VectorXd feasible, infeasible;
+    int nWSR;
+};
+
+TEST_F(QPControllerRecoveryTest, Disabled)
+{
+  giskard::QPRecoveryOptions options;
+  options.enabled_ = false;
+  controller.set_recovery_options(options);
+  EXPECT_FALSE(controller.get_recovery_options().enabled_);
+
+  ASSERT_TRUE(controller.start(feasible, nWSR));
+  ASSERT_TRUE(controller.update(feasible, nWSR));
+  EXPECT_FALSE(controller.update(infeasible, nWSR));
+  EXPECT_FALSE(controller.is_recovering());
+  EXPECT_EQ(0, controller.get_recovery_statistics().num_failures_);
+  EXPECT_EQ(0, controller.get_recovery_statistics().num_safe_commands_);
+}
+
+TEST_F(QPControllerRecoveryTest, BackgroundColdStart)
+{
+  ASSERT_TRUE(controller.start(feasible, nWSR));
+  ASSERT_TRUE(controller.update(feasible, nWSR));
+  EXPECT_LT(0.0, controller.get_command()(0));
+
+  // every rung of the ladder fails on an infeasible QP
+  EXPECT_FALSE(controller.update(infeasible, nWSR));
+  EXPECT_TRUE(controller.is_recovering());
+  EXPECT_DOUBLE_EQ(0.0, controller.get_command()(0));
+  const giskard::QPRecoveryStatistics& statistics = controller.get_recovery_statistics();
+  EXPECT_EQ(1, statistics.num_failures_);
+  EXPECT_EQ(1, statistics.num_retries_);
+  EXPECT_EQ(0, statistics.num_retry_successes_);
+  EXPECT_EQ(1, statistics.num_resets_);
+  EXPECT_EQ(0, statistics.num_reset_successes_);
+  EXPECT_EQ(1, statistics.num_cold_starts_);
+  EXPECT_EQ(1, statistics.num_safe_commands_);
+
+  // the controller recovers on its own once the QP is feasible again
+  bool recovered = false;
+  for(size_t i=0; i<1000 && !recovered; ++i)
+  {
+    recovered = controller.update(feasible, nWSR);
+    if(!recovered)
+    {
+      EXPECT_DOUBLE_EQ(0.0, controller.get_command()(0));
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    }
+  }
+  ASSERT_TRUE(recovered);
+  EXPECT_FALSE(controller.is_recovering());
+  EXPECT_LT(0.0, controller.get_command()(0));
+  ASSERT_TRUE(controller.update(feasible, nWSR));
+
+  controller.reset_recovery_statistics();
+  EXPECT_EQ(0, controller.get_recovery_statistics().num_failures_);
+}
+
+// Fails all hotstarts while *fail_ is set, so the recovery ladder ends in a
+// cold start which succeeds.
+class HotstartFailingSolver : public giskard::DiagonalQPSolver
+{
+  public:
+    explicit HotstartFailingSolver(const boost::shared_ptr<bool>& fail) : fail_(fail) {}
+
+    virtual giskard::QPSolverPtr clone() const
+    {
+      return giskard::QPSolverPtr(new HotstartFailingSolver(*this));
+    }
+
+  protected:
+    virtual giskard::QPSolverStatus do_hotstart(const giskard::QPProblemBuilder& builder, int max_iterations)
+    {
+      return *fail_ ? giskard::QP_FAILED : giskard::DiagonalQPSolver::do_hotstart(builder, max_iterations);
+    }
+
+    boost::shared_ptr<bool> fail_;
+};
+
+TEST_F(QPControllerRecoveryTest, CopyDuringColdStart)
+{
+  boost::shared_ptr<bool> fail(new bool(false));
+  controller.set_solver(giskard::QPSolverPtr(new HotstartFailingSolver(fail)));
+  ASSERT_TRUE(controller.start(feasible, nWSR));
+
+  *fail = true;
+  EXPECT_FALSE(controller.update(feasible, nWSR));
+  ASSERT_TRUE(controller.is_recovering());
+  *fail = false;
+
+  // both copies finish the same cold start, but each takes its own solver
+  giskard::QPController copy = controller;
+  ASSERT_TRUE(copy.is_recovering());
+  bool recovered = false, copy_recovered = false;
+  for(size_t i=0; i<1000 && !(recovered && copy_recovered); ++i)
+  {
+    recovered = recovered || controller.update(feasible, nWSR);
+    copy_recovered = copy_recovered || copy.update(feasible, nWSR);
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(recovered);
+  ASSERT_TRUE(copy_recovered);
+  EXPECT_EQ(1, controller.get_recovery_statistics().num_cold_start_successes_);
+  EXPECT_EQ(1, copy.get_recovery_statistics().num_cold_start_successes_);
+  EXPECT_NE(&controller.get_solver(), &copy.get_solver());
+}
+
+TEST_F(QPControllerRecoveryTest, SynchronousColdStart)
+{
+  giskard::QPRecoveryOptions options;
+  options.background_cold_start_ = false;
+  controller.set_recovery_options(options);
+
+  ASSERT_TRUE(controller.start(feasible, nWSR));
+  ASSERT_TRUE(controller.update(feasible, nWSR));
+  EXPECT_FALSE(controller.update(infeasible, nWSR));
+  EXPECT_FALSE(controller.is_recovering());
+  EXPECT_EQ(1, controller.get_recovery_statistics().num_cold_starts_);
+  EXPECT_EQ(0, controller.get_recovery_statistics().num_cold_start_successes_);
+  EXPECT_EQ(1, controller.get_recovery_statistics().num_safe_commands_);
+
+  ASSERT_TRUE(controller.update(feasible, nWSR));
+  EXPECT_LT(0.0, controller.get_command()(0));
+}
+
+TEST_F(QPControllerTest, WorkingSet)
+{
+   giskard::QPController c;
+   ASSERT_TRUE(c.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+   giskard::QPController warm = c.clone();
+   giskard::QPController cold = c.clone();
+
+   ASSERT_TRUE(c.start(initial_state, nWSR));
+   Eigen::VectorXd state = initial_state;
+   for(size_t i=0; i<36; ++i)
+   {
+     ASSERT_TRUE(c.update(state, nWSR));
+     state += c.get_command();
+   }
+   ASSERT_TRUE(c.update(state, nWSR));
+
+   giskard::QPWorkingSet working_set = c.get_working_set();
+   EXPECT_FALSE(working_set.empty());
+   EXPECT_EQ(c.get_qp_builder().num_weights(), working_set.primal_.rows());
+   EXPECT_EQ(c.get_qp_builder().num_weights() + c.get_qp_builder().num_constraints(),
+       working_set.dual_.rows());
+   EXPECT_EQ(c.get_qp_builder().num_weights(), working_set.bounds_.size());
+   EXPECT_EQ(c.get_qp_builder().num_constraints(), working_set.constraints_.size());
+
+   // round-trip through the binary format
+   std::stringstream stream;
+   giskard::write_binary(stream, working_set);
+   giskard::QPWorkingSet restored;
+   giskard::read_binary(stream, restored);
+   EXPECT_EQ(working_set.controllable_names_, restored.controllable_names_);
+   EXPECT_EQ(working_set.soft_constraint_names_, restored.soft_constraint_names_);
+   EXPECT_EQ(working_set.bounds_, restored.bounds_);
+   EXPECT_EQ(working_set.constraints_, restored.constraints_);
+   ASSERT_EQ(working_set.primal_.rows(), restored.primal_.rows());
+   for(size_t i=0; i<working_set.primal_.rows(); ++i)
+     EXPECT_DOUBLE_EQ(working_set.primal_(i), restored.primal_(i));
+   ASSERT_EQ(working_set.dual_.rows(), restored.dual_.rows());
+   for(size_t i=0; i<working_set.dual_.rows(); ++i)
+     EXPECT_DOUBLE_EQ(working_set.dual_(i), restored.dual_(i));
+
+   // re-entering the task with the snapshot needs no more work than a cold start
+   ASSERT_TRUE(cold.start(state, nWSR));
+   ASSERT_TRUE(warm.start(state, nWSR, restored));
+   EXPECT_LE(warm.get_num_working_set_recalculations(), cold.get_num_working_set_recalculations());
+
+   ASSERT_TRUE(warm.update(state, nWSR));
+   ASSERT_TRUE(cold.update(state, nWSR));
+   for(size_t i=0; i<2; ++i)
+     EXPECT_NEAR(cold.get_command()(i), warm.get_command()(i), 1e-9);
+
+   // snapshots only fit controllers with the same structure
+   giskard::QPWorkingSet wrong_names = working_set;
+   wrong_names.controllable_names_[0] = "other dof";
+   EXPECT_THROW(warm.start(state, nWSR, wrong_names), std::invalid_argument);
+   giskard::QPWorkingSet wrong_size = working_set;
+   wrong_size.bounds_.pop_back();
+   EXPECT_THROW(warm.start(state, nWSR, wrong_size), std::invalid_argument);
+}
+
+TEST_F(QPControllerTest, ObservableBinding)
+{
+   giskard::QPController c;
+   ASSERT_TRUE(c.init(controllable_lower, controllable_upper, controllable_weights, 
+         controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights, 
+         soft_names, hard_expressions, hard_lower, hard_upper));
+   giskard::QPController reference = c.clone();
+   EXPECT_EQ(controllable_names, c.get_observable_names());
+
+   // caller-owned buffer in its own order, with an unrelated entry
+   std::vector<std::string> source_names;
+   source_names.push_back("dof 2");
+   source_names.push_back("gripper");
+   source_names.push_back("dof 1");
+   giskard::ObservableBinding binding = c.bind_observables(source_names);
+   ASSERT_EQ(2, binding.num_observables());
+   EXPECT_EQ(3, binding.num_sources());
+   EXPECT_EQ(2, binding.get_indices()[0]);
+   EXPECT_EQ(0, binding.get_indices()[1]);
+
+   double buffer[3] = {initial_state(1), 42.0, initial_state(0)};
+   ASSERT_TRUE(c.start(binding, buffer, nWSR));
+   ASSERT_TRUE(reference.start(Eigen::Map<const Eigen::VectorXd>(initial_state.data(), 2), nWSR));
+   for(size_t i=0; i<36; ++i)
+   {
+     ASSERT_TRUE(c.update(binding, buffer, nWSR));
+     Eigen::VectorXd state(2);
+     using Eigen::operator<<;
+     state << buffer[2], buffer[0];
+     ASSERT_TRUE(reference.update(state, nWSR));
+     for(size_t j=0; j<2; ++j)
+       EXPECT_NEAR(reference.get_command()(j), c.get_command()(j), 1e-9);
+
+     buffer[2] += c.get_command()(0);
+     buffer[0] += c.get_command()(1);
+   }
+   EXPECT_DOUBLE_EQ(42.0, buffer[1]);
+
+   // names need to resolve, and need to cover all observables
+   source_names[0] = "dof 3";
+   EXPECT_THROW(c.bind_observables(source_names), std::invalid_argument);
+   source_names[0] = "dof 1";
+   EXPECT_THROW(c.bind_observables(source_names), std::invalid_argument);
+   EXPECT_THROW(c.set_observable_names(std::vector<std::string>(1, "dof 1")), std::invalid_argument);
+   giskard::ObservableBinding too_small(std::vector<std::string>(1, "dof 1"), source_names);
+   EXPECT_THROW(c.update(too_small, buffer, nWSR), std::invalid_argument);
+}
@@ -221,3 +221,106 @@ TEST_F(QPProblemBuilderTest, Update)
   ubA << 3.0, 3.1, 1.1, -1.3, 0.35;
   CompareVectors(lbA, b.get_lbA());
 }
+
+TEST_F(QPProblemBuilderTest, CloneSharedNodes)
+{
+  // a node shared by a soft and a hard constraint
+  KDL::Expression<double>::Ptr shared_exp = KDL::shared<double>(KDL::input(0) - KDL::input(1));
+  soft_expressions[0] = shared_exp;
+  hard_expressions[1] = shared_exp;
+
+  giskard::QPProblemBuilder b;
+  b.init(controllable_lower, controllable_upper, controllable_weights, soft_expressions,
+      soft_lower, soft_upper, soft_weights, hard_expressions, hard_lower, hard_upper);
+  b.update(initial_state);
+
+  giskard::QPProblemBuilder clone = b.clone();
+  EXPECT_NE(shared_exp, clone.get_soft_expressions()[0]);
+  EXPECT_EQ(clone.get_soft_expressions()[0], clone.get_hard_expressions()[1]);
+
+  clone.update(initial_state);
+  CompareMatrices(b.get_A(), clone.get_A());
+  CompareVectors(b.get_lbA(), clone.get_lbA());
+}
+
+TEST_F(QPProblemBuilderTest, ParallelUpdate)
+{
+  // a node shared by rows which may end up in different partitions
+  KDL::Expression<double>::Ptr shared_exp = KDL::shared<double>(KDL::cached<double>(KDL::input(0) - KDL::input(1)));
+  soft_expressions[0] = shared_exp;
+  hard_expressions[1] = shared_exp;
+
+  giskard::QPProblemBuilder serial;
+  serial.init(controllable_lower, controllable_upper, controllable_weights, soft_expressions,
+      soft_lower, soft_upper, soft_weights, hard_expressions, hard_lower, hard_upper);
+  EXPECT_EQ(1, serial.get_num_threads());
+
+  Eigen::VectorXd state = initial_state;
+  for(size_t num_threads=2; num_threads<=6; ++num_threads)
+  {
+    giskard::QPProblemBuilder parallel = serial.clone();
+    parallel.set_num_threads(num_threads);
+    EXPECT_EQ(num_threads, parallel.get_num_threads());
+
+    for(size_t i=0; i<10; ++i)
+    {
+      state(0) += 0.1;
+      serial.update(state);
+      parallel.update(state);
+
+      CompareMatrices(serial.get_H(), parallel.get_H());
+      CompareMatrices(serial.get_A(), parallel.get_A());
+      CompareVectors(serial.get_lb(), parallel.get_lb());
+      CompareVectors(serial.get_ub(), parallel.get_ub());
+      CompareVectors(serial.get_lbA(), parallel.get_lbA());
+      CompareVectors(serial.get_ubA(), parallel.get_ubA());
+    }
+
+    // clones get their own threads and expressions
+    giskard::QPProblemBuilder clone = parallel.clone();
+    EXPECT_EQ(num_threads, clone.get_num_threads());
+    clone.update(state);
+    CompareMatrices(serial.get_A(), clone.get_A());
+
+    EXPECT_THROW(parallel.update(Eigen::VectorXd::Zero(1)), std::invalid_argument);
+  }
+
+  serial.set_num_threads(1);
+  EXPECT_EQ(1, serial.get_num_threads());
+}
+
+TEST_F(QPProblemBuilderTest, RowAssignment)
+{
+  using KDL::operator*;
+  using KDL::operator+;
+
+  // two chains of ten inputs, each shared by every second row
+  KDL::Expression<double>::Ptr chain_a = KDL::input(0), chain_b = KDL::input(10);
+  for(size_t i=1; i<10; ++i)
+  {
+    chain_a = chain_a * KDL::input(i);
+    chain_b = chain_b * KDL::input(10 + i);
+  }
+  KDL::Expression<double>::Ptr a = KDL::shared<double>(KDL::cached<double>(chain_a));
+  KDL::Expression<double>::Ptr b = KDL::shared<double>(KDL::cached<double>(chain_b));
+
+  // the rows of each chain go to one partition, instead of both chains being
+  // evaluated by both partitions
+  giskard::QPRowAssignment assignment(2);
+  for(size_t i=0; i<6; ++i)
+  {
+    giskard::QPRowAssignment::DoubleExpressionVector row(1,
+        KDL::Constant(double(i)) + ((i % 2 == 0) ? a : b));
+    EXPECT_EQ(i % 2, assignment.assign(row));
+  }
+  ASSERT_EQ(2, assignment.get_loads().size());
+  EXPECT_DOUBLE_EQ(13.0, assignment.get_loads()[0]);
+  EXPECT_DOUBLE_EQ(13.0, assignment.get_loads()[1]);
+
+  // rows without shared nodes spread evenly
+  for(size_t i=0; i<4; ++i)
+  {
+    giskard::QPRowAssignment::DoubleExpressionVector row(1, KDL::input(i));
+    EXPECT_EQ(i % 2, assignment.assign(row));
+  }
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+
+class RolloutTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      std::vector< KDL::Expression<double>::Ptr > controllable_lower, controllable_upper,
+          controllable_weights, soft_expressions, soft_lower, soft_upper, soft_weights,
+          hard_expressions, hard_lower, hard_upper;
+      std::vector<std::string> soft_names, controllable_names;
+
+      for(size_t i=0; i<2; ++i)
+      {
+        KDL::Expression<double>::Ptr exp = KDL::cached<double>(KDL::input(i));
+        controllable_lower.push_back(KDL::Constant(-0.1));
+        controllable_upper.push_back(KDL::Constant(0.1));
+        controllable_weights.push_back(KDL::Constant(0.1));
+        controllable_names.push_back("dof " + boost::lexical_cast<std::string>(i));
+
+        using KDL::operator-;
+        soft_expressions.push_back(exp);
+        soft_lower.push_back(KDL::Constant(0.9) - exp);
+        soft_upper.push_back(KDL::Constant(1.0) - exp);
+        soft_weights.push_back(KDL::Constant(10.0));
+        soft_names.push_back("dof " + boost::lexical_cast<std::string>(i) + " goal");
+      }
+
+      ASSERT_TRUE(controller.init(controllable_lower, controllable_upper, controllable_weights,
+            controllable_names, soft_expressions, soft_lower, soft_upper, soft_weights,
+            soft_names, hard_expressions, hard_lower, hard_upper));
+
+      // third observable is not controllable
+      initial_state = Eigen::VectorXd::Zero(3);
+      initial_state(2) = 42.0;
+
+      options.num_steps_ = 40;
+      options.dt_ = 0.5;
+    }
+
+    virtual void TearDown(){}
+
+    giskard::QPController controller;
+    giskard::RolloutOptions options;
+    Eigen::VectorXd initial_state;
+};
+
+TEST_F(RolloutTest, MatchesManualLoop)
+{
+  giskard::QPController reference = controller.clone();
+  Eigen::VectorXd state = initial_state;
+  ASSERT_TRUE(reference.start(state, options.nWSR_));
+
+  giskard::RolloutTrajectory trajectory = giskard::rollout(controller, initial_state, options);
+  ASSERT_TRUE(trajectory.success_);
+  EXPECT_FALSE(trajectory.converged_);
+  EXPECT_EQ(options.num_steps_, trajectory.num_steps_);
+  ASSERT_EQ(options.num_steps_ + 1, trajectory.num_samples_);
+  ASSERT_EQ(3, trajectory.states_.rows());
+  ASSERT_EQ(2, trajectory.commands_.rows());
+
+  for(size_t i=0; i<options.num_steps_; ++i)
+  {
+    EXPECT_DOUBLE_EQ(i * options.dt_, trajectory.times_(i));
+    for(size_t j=0; j<3; ++j)
+      EXPECT_DOUBLE_EQ(state(j), trajectory.states_(j, i));
+
+    ASSERT_TRUE(reference.update(state, options.nWSR_));
+    for(size_t j=0; j<2; ++j)
+      EXPECT_DOUBLE_EQ(reference.get_command()(j), trajectory.commands_(j, i));
+    state.segment(0, 2) += options.dt_ * reference.get_command();
+  }
+
+  for(size_t j=0; j<3; ++j)
+    EXPECT_DOUBLE_EQ(state(j), trajectory.get_final_state()(j));
+  EXPECT_DOUBLE_EQ(42.0, trajectory.get_final_state()(2));
+  EXPECT_LE(0.9 - 1e-6, trajectory.get_final_state()(0));
+  EXPECT_LE(trajectory.get_final_state()(0), 1.0 + 1e-6);
+}
+
+TEST_F(RolloutTest, StopOnConvergence)
+{
+  options.stop_on_convergence_ = true;
+  giskard::RolloutTrajectory trajectory = giskard::rollout(controller, initial_state, options);
+  ASSERT_TRUE(trajectory.success_);
+  EXPECT_TRUE(trajectory.converged_);
+  EXPECT_LT(trajectory.num_steps_, options.num_steps_);
+  EXPECT_EQ(trajectory.num_steps_ + 1, trajectory.num_samples_);
+  for(size_t j=0; j<2; ++j)
+  {
+    EXPECT_LE(0.9 - options.convergence_tolerance_, trajectory.get_final_state()(j));
+    EXPECT_LE(trajectory.get_final_state()(j), 1.0 + options.convergence_tolerance_);
+    EXPECT_DOUBLE_EQ(0.0, trajectory.commands_(j, trajectory.num_samples_ - 1));
+  }
+}
+
+TEST_F(RolloutTest, Decimation)
+{
+  options.record_every_ = 7;
+  giskard::Rollout rollout(options);
+
+  // run twice on the same buffers
+  for(size_t run=0; run<2; ++run)
+  {
+    const giskard::RolloutTrajectory& trajectory = rollout.run(controller, initial_state);
+    ASSERT_TRUE(trajectory.success_);
+    // steps 0, 7, ..., 35 plus the final state
+    ASSERT_EQ(7, trajectory.num_samples_);
+    EXPECT_DOUBLE_EQ(0.0, trajectory.times_(0));
+    EXPECT_DOUBLE_EQ(35 * options.dt_, trajectory.times_(5));
+    EXPECT_DOUBLE_EQ(40 * options.dt_, trajectory.times_(6));
+    EXPECT_DOUBLE_EQ(0.0, trajectory.states_(0, 0));
+  }
+
+  options.record_every_ = 0;
+  EXPECT_THROW(giskard::Rollout invalid(options), std::invalid_argument);
+  EXPECT_THROW(rollout.run(controller, Eigen::VectorXd::Zero(1)), std::invalid_argument);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+#include <giskard/spec_arena.hpp>
+
+class SpecArenaTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      node = YAML::LoadFile("pr2_left_arm_scope.yaml");
+    }
+
+    virtual void TearDown(){}
+
+    YAML::Node node;
+};
+
+TEST_F(SpecArenaTest, ParsingIntoArena)
+{
+  giskard::ScopeSpec heap_spec = node.as<giskard::ScopeSpec>();
+
+  giskard::SpecArena arena;
+  EXPECT_EQ(0, arena.get_allocated_bytes());
+
+  giskard::ScopeSpec arena_spec;
+  {
+    giskard::ScopedSpecArena guard(arena);
+    arena_spec = node.as<giskard::ScopeSpec>();
+  }
+
+  EXPECT_LT(0, arena.get_allocated_bytes());
+  EXPECT_EQ(1, arena.get_num_blocks());
+
+  ASSERT_EQ(heap_spec.size(), arena_spec.size());
+  for(size_t i=0; i<heap_spec.size(); ++i)
+  {
+    EXPECT_STREQ(heap_spec[i].name.c_str(), arena_spec[i].name.c_str());
+    EXPECT_TRUE(*(heap_spec[i].spec) == *(arena_spec[i].spec));
+  }
+
+  // specs created outside of the guard do not touch the arena
+  size_t bytes = arena.get_allocated_bytes();
+  node.as<giskard::ScopeSpec>();
+  EXPECT_EQ(bytes, arena.get_allocated_bytes());
+}
+
+TEST_F(SpecArenaTest, NodesOutliveArena)
+{
+  giskard::ScopeSpec scope_spec;
+  {
+    giskard::SpecArena arena(128);
+    giskard::ScopedSpecArena guard(arena);
+    scope_spec = node.as<giskard::ScopeSpec>();
+    EXPECT_LT(1, arena.get_num_blocks());
+  }
+
+  ASSERT_NO_THROW(giskard::generate(scope_spec));
+  giskard::Scope scope = giskard::generate(scope_spec);
+  EXPECT_TRUE(scope.has_frame_expression("pr2_fk"));
+}
+
+TEST_F(SpecArenaTest, NestedGuards)
+{
+  giskard::SpecArena outer, inner;
+
+  EXPECT_EQ(0, giskard::current_spec_arena().get());
+  {
+    giskard::ScopedSpecArena outer_guard(outer);
+    EXPECT_EQ(&outer, giskard::current_spec_arena().get());
+    {
+      giskard::ScopedSpecArena inner_guard(inner);
+      EXPECT_EQ(&inner, giskard::current_spec_arena().get());
+      giskard::make_spec<giskard::DoubleConstSpec>();
+    }
+    EXPECT_EQ(&outer, giskard::current_spec_arena().get());
+  }
+  EXPECT_EQ(0, giskard::current_spec_arena().get());
+
+  EXPECT_EQ(0, outer.get_allocated_bytes());
+  EXPECT_LT(0, inner.get_allocated_bytes());
+}
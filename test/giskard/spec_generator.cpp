@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+
+class SpecGeneratorTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      options.num_joints_ = 12;
+      options.num_branches_ = 3;
+      options.num_constraints_ = 20;
+      options.hard_constraint_ratio_ = 0.25;
+      options.sharing_ = 0.5;
+    }
+
+    virtual void TearDown(){}
+
+    giskard::SyntheticSpecOptions options;
+};
+
+TEST_F(SpecGeneratorTest, Dimensions)
+{
+  giskard::QPControllerSpec spec = giskard::SyntheticSpecGenerator::generate(options);
+
+  EXPECT_EQ(12, spec.controllable_constraints_.size());
+  EXPECT_EQ(15, spec.soft_constraints_.size());
+  EXPECT_EQ(5, spec.hard_constraints_.size());
+  // inputs, link frames and constraint expressions
+  EXPECT_EQ(12 + 12 + 20, spec.scope_.size());
+
+  giskard::SpecStatistics statistics = giskard::analyze(spec);
+  EXPECT_GE(12, statistics.qp_.num_observables_);
+  // the tip of the trunk
+  EXPECT_EQ(1, statistics.node_counts_[giskard::FRAME_CACHED_SPEC]);
+}
+
+TEST_F(SpecGeneratorTest, YamlRoundTrip)
+{
+  giskard::QPControllerSpec spec = giskard::SyntheticSpecGenerator::generate(options);
+  giskard::QPControllerSpec parsed =
+      YAML::Load(giskard::SyntheticSpecGenerator::generate_yaml(options)).as<giskard::QPControllerSpec>();
+
+  EXPECT_EQ(giskard::hash_value(spec), giskard::hash_value(parsed));
+
+  options.seed_ = 1;
+  EXPECT_NE(giskard::hash_value(spec),
+      giskard::hash_value(giskard::SyntheticSpecGenerator::generate(options)));
+}
+
+TEST_F(SpecGeneratorTest, Sharing)
+{
+  options.sharing_ = 0.0;
+  giskard::SpecStatistics unshared = giskard::analyze(giskard::SyntheticSpecGenerator::generate(options));
+  options.sharing_ = 1.0;
+  giskard::SpecStatistics shared = giskard::analyze(giskard::SyntheticSpecGenerator::generate(options));
+
+  EXPECT_GT(unshared.num_nodes_, shared.num_nodes_);
+  EXPECT_GT(unshared.num_duplicated_subtrees_, shared.num_duplicated_subtrees_);
+  EXPECT_EQ(unshared.qp_.jacobian_nonzeros_, shared.qp_.jacobian_nonzeros_);
+}
+
+TEST_F(SpecGeneratorTest, Controller)
+{
+  giskard::QPController controller =
+      giskard::generate(giskard::SyntheticSpecGenerator::generate(options));
+
+  Eigen::VectorXd state = Eigen::VectorXd::Zero(options.num_joints_);
+  ASSERT_TRUE(controller.start(state, 100));
+  for(size_t i=0; i<10; ++i)
+  {
+    ASSERT_TRUE(controller.update(state, 100));
+    state += 0.01 * controller.get_command();
+  }
+}
+
+TEST_F(SpecGeneratorTest, PriorityLevels)
+{
+  options.num_priority_levels_ = 3;
+  giskard::QPControllerSpec spec = giskard::SyntheticSpecGenerator::generate(options);
+  for(size_t i=0; i<spec.soft_constraints_.size(); ++i)
+    EXPECT_EQ(i % 3, spec.soft_constraints_[i].priority_);
+
+  giskard::QPControllerSpec parsed =
+      YAML::Load(giskard::SyntheticSpecGenerator::generate_yaml(options)).as<giskard::QPControllerSpec>();
+  EXPECT_EQ(giskard::hash_value(spec), giskard::hash_value(parsed));
+
+  giskard::QPController controller = giskard::generate(spec);
+  EXPECT_TRUE(controller.has_priority_levels());
+  EXPECT_EQ(3, controller.get_cascade().num_levels());
+
+  Eigen::VectorXd state = Eigen::VectorXd::Zero(options.num_joints_);
+  ASSERT_TRUE(controller.start(state, 100));
+  for(size_t i=0; i<10; ++i)
+  {
+    ASSERT_TRUE(controller.update(state, 100));
+    state += 0.01 * controller.get_command();
+  }
+}
+
+TEST_F(SpecGeneratorTest, InvalidOptions)
+{
+  options.sharing_ = 1.5;
+  EXPECT_THROW(giskard::SyntheticSpecGenerator::generate(options), std::invalid_argument);
+
+  options.sharing_ = 0.5;
+  options.num_branches_ = 13;
+  EXPECT_THROW(giskard::SyntheticSpecGenerator::generate(options), std::invalid_argument);
+
+  options.num_branches_ = 3;
+  options.num_priority_levels_ = 0;
+  EXPECT_THROW(giskard::SyntheticSpecGenerator::generate(options), std::invalid_argument);
+}
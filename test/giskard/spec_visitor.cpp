@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2015 Georg Bartels <georg.bartels@cs.uni-bremen.de>
+ * 
+ * This file is part of giskard.
+ * 
+ * giskard is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <gtest/gtest.h>
+#include <giskard/giskard.hpp>
+#include <boost/functional/hash.hpp>
+
+class SpecVisitorTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+      scope_spec = YAML::LoadFile("pr2_left_arm_scope.yaml").as<giskard::ScopeSpec>();
+    }
+
+    virtual void TearDown(){}
+
+    giskard::ScopeSpec scope_spec;
+};
+
+class InputCounter : public giskard::SpecVisitor
+{
+  public:
+    InputCounter() : inputs(0), nodes(0) {}
+
+    size_t inputs, nodes;
+
+    void count(const giskard::SpecPtr& spec)
+    {
+      if(spec.get())
+        spec->accept(*this);
+    }
+
+    template<class T>
+    void count(const std::vector< boost::shared_ptr<T> >& specs)
+    {
+      for(size_t i=0; i<specs.size(); ++i)
+        count(specs[i]);
+    }
+
+    virtual void visit(const giskard::DoubleConstSpec& spec) { ++nodes; }
+    virtual void visit(const giskard::DoubleInputSpec& spec) { ++nodes; ++inputs; }
+    virtual void visit(const giskard::DoubleReferenceSpec& spec) { ++nodes; }
+    virtual void visit(const giskard::DoubleAdditionSpec& spec) { ++nodes; count(spec.get_inputs()); }
+    virtual void visit(const giskard::DoubleSubtractionSpec& spec) { ++nodes; count(spec.get_inputs()); }
+    virtual void visit(const giskard::DoubleNormOfSpec& spec) { ++nodes; count(spec.get_vector()); }
+    virtual void visit(const giskard::DoubleMultiplicationSpec& spec) { ++nodes; count(spec.get_inputs()); }
+    virtual void visit(const giskard::DoubleDivisionSpec& spec) { ++nodes; count(spec.get_inputs()); }
+    virtual void visit(const giskard::DoubleXCoordOfSpec& spec) { ++nodes; count(spec.get_vector()); }
+    virtual void visit(const giskard::DoubleYCoordOfSpec& spec) { ++nodes; count(spec.get_vector()); }
+    virtual void visit(const giskard::DoubleZCoordOfSpec& spec) { ++nodes; count(spec.get_vector()); }
+    virtual void visit(const giskard::VectorDotSpec& spec) { ++nodes; count(spec.get_lhs()); count(spec.get_rhs()); }
+    virtual void visit(const giskard::VectorCachedSpec& spec) { ++nodes; count(spec.get_vector()); }
+    virtual void visit(const giskard::VectorConstructorSpec& spec) { ++nodes; count(spec.get_x()); count(spec.get_y()); count(spec.get_z()); }
+    virtual void visit(const giskard::VectorAdditionSpec& spec) { ++nodes; count(spec.get_inputs()); }
+    virtual void visit(const giskard::VectorSubtractionSpec& spec) { ++nodes; count(spec.get_inputs()); }
+    virtual void visit(const giskard::VectorReferenceSpec& spec) { ++nodes; }
+    virtual void visit(const giskard::VectorOriginOfSpec& spec) { ++nodes; count(spec.get_frame()); }
+    virtual void visit(const giskard::VectorFrameMultiplicationSpec& spec) { ++nodes; count(spec.get_frame()); count(spec.get_vector()); }
+    virtual void visit(const giskard::VectorDoubleMultiplicationSpec& spec) { ++nodes; count(spec.get_double()); count(spec.get_vector()); }
+    virtual void visit(const giskard::VectorRotationVectorSpec& spec) { ++nodes; count(spec.get_rotation()); }
+    virtual void visit(const giskard::RotationQuaternionConstructorSpec& spec) { ++nodes; }
+    virtual void visit(const giskard::AxisAngleSpec& spec) { ++nodes; count(spec.get_axis()); count(spec.get_angle()); }
+    virtual void visit(const giskard::RotationReferenceSpec& spec) { ++nodes; }
+    virtual void visit(const giskard::InverseRotationSpec& spec) { ++nodes; count(spec.get_rotation()); }
+    virtual void visit(const giskard::RotationMultiplicationSpec& spec) { ++nodes; count(spec.get_inputs()); }
+    virtual void visit(const giskard::FrameCachedSpec& spec) { ++nodes; count(spec.get_frame()); }
+    virtual void visit(const giskard::FrameConstructorSpec& spec) { ++nodes; count(spec.get_translation()); count(spec.get_rotation()); }
+    virtual void visit(const giskard::OrientationOfSpec& spec) { ++nodes; count(spec.get_frame()); }
+    virtual void visit(const giskard::FrameMultiplicationSpec& spec) { ++nodes; count(spec.get_inputs()); }
+    virtual void visit(const giskard::FrameReferenceSpec& spec) { ++nodes; }
+};
+
+TEST_F(SpecVisitorTest, TypeTags)
+{
+  giskard::DoubleSpecPtr d = giskard::double_const_spec(1.0);
+  EXPECT_EQ(giskard::DOUBLE_CONST_SPEC, d->get_type());
+  EXPECT_EQ(giskard::DOUBLE_SPEC, d->get_category());
+
+  giskard::VectorSpecPtr v = giskard::vector_constructor_spec(d, d, d);
+  EXPECT_EQ(giskard::VECTOR_CONSTRUCTOR_SPEC, v->get_type());
+  EXPECT_EQ(giskard::VECTOR_SPEC, v->get_category());
+
+  giskard::RotationSpecPtr r = giskard::inverse_rotation_spec(
+      giskard::quaternion_spec(0.0, 0.0, 0.0, 1.0));
+  EXPECT_EQ(giskard::INVERSE_ROTATION_SPEC, r->get_type());
+  EXPECT_EQ(giskard::ROTATION_SPEC, r->get_category());
+
+  giskard::FrameSpecPtr f = giskard::frame_constructor_spec(v, r);
+  EXPECT_EQ(giskard::FRAME_CONSTRUCTOR_SPEC, f->get_type());
+  EXPECT_EQ(giskard::FRAME_SPEC, f->get_category());
+
+  giskard::RotationSpecPtr o = giskard::orientation_of_spec(f);
+  EXPECT_EQ(giskard::ORIENTATION_OF_SPEC, o->get_type());
+  EXPECT_EQ(giskard::ROTATION_SPEC, o->get_category());
+}
+
+TEST_F(SpecVisitorTest, Traversal)
+{
+  InputCounter counter;
+  for(size_t i=0; i<scope_spec.size(); ++i)
+    counter.count(scope_spec[i].spec);
+
+  EXPECT_LT(0, counter.nodes);
+  EXPECT_EQ(8, counter.inputs);
+}
+
+TEST_F(SpecVisitorTest, Equality)
+{
+  giskard::DoubleSpecPtr a = giskard::double_const_spec(1.0);
+  giskard::DoubleSpecPtr b = giskard::double_const_spec(1.0);
+  giskard::DoubleSpecPtr c = giskard::double_const_spec(2.0);
+  giskard::VectorSpecPtr v1 = giskard::vector_constructor_spec(a, b, c);
+  giskard::VectorSpecPtr v2 = giskard::vector_constructor_spec(b, a, c);
+  giskard::VectorSpecPtr v3 = giskard::vector_constructor_spec(c, b, a);
+
+  EXPECT_TRUE(*a == *b);
+  EXPECT_FALSE(*a == *c);
+  EXPECT_TRUE(*v1 == *v2);
+  EXPECT_FALSE(*v1 == *v3);
+  EXPECT_FALSE(*a == *v1);
+}
+
+TEST_F(SpecVisitorTest, Hashing)
+{
+  giskard::ScopeSpec other_spec = 
+      YAML::LoadFile("pr2_left_arm_scope.yaml").as<giskard::ScopeSpec>();
+
+  ASSERT_EQ(scope_spec.size(), other_spec.size());
+  for(size_t i=0; i<scope_spec.size(); ++i)
+  {
+    ASSERT_TRUE(*(scope_spec[i].spec) == *(other_spec[i].spec));
+    EXPECT_EQ(giskard::hash_value(*(scope_spec[i].spec)),
+        giskard::hash_value(*(other_spec[i].spec)));
+    EXPECT_EQ(giskard::hash_value(*(scope_spec[i].spec)),
+        boost::hash<giskard::Spec>()(*(other_spec[i].spec)));
+  }
+
+  giskard::DoubleSpecPtr a = giskard::double_const_spec(1.0);
+  giskard::DoubleSpecPtr b = giskard::double_const_spec(2.0);
+  EXPECT_NE(giskard::hash_value(*giskard::vector_constructor_spec(a, b, a)),
+      giskard::hash_value(*giskard::vector_constructor_spec(b, a, a)));
+  giskard::DoubleInputSpec input;
+  input.set_input_num(0);
+  EXPECT_NE(giskard::hash_value(input),
+      giskard::hash_value(*giskard::double_const_spec(0.0)));
+}
+
+TEST_F(SpecVisitorTest, EncodeRoundtrip)
+{
+  for(size_t i=0; i<scope_spec.size(); ++i)
+  {
+    YAML::Node node;
+    node = scope_spec[i].spec;
+    ASSERT_NO_THROW(node.as<giskard::SpecPtr>());
+    giskard::SpecPtr spec = node.as<giskard::SpecPtr>();
+    EXPECT_EQ(scope_spec[i].spec->get_type(), spec->get_type());
+    EXPECT_TRUE(*(scope_spec[i].spec) == *spec);
+  }
+}
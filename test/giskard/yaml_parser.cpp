@@ -867,6 +867,31 @@ TEST_F(YamlParserTest, SoftConstraintSpec)
   EXPECT_STREQ(spec.name_.c_str(), "some name");
 }
 
+TEST_F(YamlParserTest, SoftConstraintSpecWithPriority)
+{
+  std::string s = "{soft-constraint: [-10.1, 120.2, 5.0, 1.1, some name, 2]}";
+
+  YAML::Node node = YAML::Load(s);
+
+  ASSERT_NO_THROW(node.as<giskard::SoftConstraintSpec>());
+  giskard::SoftConstraintSpec spec = node.as<giskard::SoftConstraintSpec>();
+
+  EXPECT_STREQ(spec.name_.c_str(), "some name");
+  EXPECT_EQ(2, spec.priority_);
+
+  YAML::Node encoded;
+  encoded = spec;
+  ASSERT_EQ(6, encoded["soft-constraint"].size());
+  EXPECT_EQ(2, encoded["soft-constraint"][5].as<size_t>());
+
+  // priority 0 is the default and gets omitted
+  spec.priority_ = 0;
+  encoded = spec;
+  EXPECT_EQ(5, encoded["soft-constraint"].size());
+  EXPECT_EQ(0, YAML::Load("{soft-constraint: [-10.1, 120.2, 5.0, 1.1, some name]}").
+      as<giskard::SoftConstraintSpec>().priority_);
+}
+
 TEST_F(YamlParserTest, HardConstraintSpec)
 {
   std::string s = "{hard-constraint: [-10.1, 120.2, 1.1]}";